@@ -6,12 +6,18 @@
 #include <osm/core/base_types.h>
 
 
+/* (640.5 + 12.5) cycles of (80Mhz / 64) per conversion */
+#define OSM_ADCS_SAMPLE_PERIOD_NS   522400
+
+
 typedef enum
 {
     OSM_ADCS_KEY_NONE,
     OSM_ADCS_KEY_CC,
     OSM_ADCS_KEY_BAT,
     OSM_ADCS_KEY_FTMA,
+    OSM_ADCS_KEY_CC_POWER,
+    OSM_ADCS_KEY_CC_THD,
 } osm_adcs_keys_t;
 
 
@@ -33,14 +39,20 @@ osm_adcs_resp_t osm_adcs_collect_avg(uint32_t* avg, unsigned num_channels, unsig
 osm_adcs_resp_t osm_adcs_collect_avgs(uint32_t* avgs, unsigned num_channels, unsigned num_samples, osm_adcs_keys_t key, uint32_t* time_taken);
 osm_adcs_resp_t osm_adcs_collect_rms(uint32_t* rms, uint32_t midpoint, unsigned num_channels, unsigned num_samples, unsigned cc_index, osm_adcs_keys_t key, uint32_t* time_taken);
 osm_adcs_resp_t osm_adcs_collect_rmss(uint32_t* rmss, uint32_t* midpoints, unsigned num_channels, unsigned num_samples, osm_adcs_keys_t key, uint32_t* time_taken);
+osm_adcs_resp_t osm_adcs_begin_power(osm_adcs_type_t* channels, unsigned num_channels, unsigned num_samples, unsigned ref_index, osm_adcs_keys_t key);
+osm_adcs_resp_t osm_adcs_collect_power(int64_t* in_phase, int64_t* lead, uint32_t midpoint, uint32_t ref_midpoint, unsigned index, osm_adcs_keys_t key, uint32_t* time_taken);
+osm_adcs_resp_t osm_adcs_begin_harmonics(osm_adcs_type_t* channels, unsigned num_channels, unsigned num_samples, unsigned num_bins, osm_adcs_keys_t key);
+osm_adcs_resp_t osm_adcs_collect_harmonics(uint32_t* rms, unsigned* num_bins, unsigned num_channels, unsigned num_samples, unsigned index, osm_adcs_keys_t key, uint32_t* time_taken);
 osm_adcs_resp_t osm_adcs_wait_done(uint32_t timeout, osm_adcs_keys_t key);
 void osm_adcs_release(osm_adcs_keys_t key);
 
+void osm_adcs_dma_half_complete(void);
 void osm_adcs_dma_complete(void);
 
 /* To be implemented in platform */
 void osm_platform_setup_adc(osm_adc_setup_config_t* config);
 void osm_platform_adc_set_regular_sequence(uint8_t num_channels, osm_adcs_type_t* channels);
 void osm_platform_adc_start_conversion_regular(void);
+void osm_platform_adc_stop_conversion_regular(void);
 void osm_platform_adc_power_off(void);
 void osm_platform_adc_set_num_data(unsigned num_data);
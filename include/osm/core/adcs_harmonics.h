@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Fundamental and harmonics of one channel of an interleaved ADC buffer,
+ * a Goertzel filter at each exact frequency, so they need not fall on the
+ * bins of an FFT. The filters run in integers, coefficients Q30, a block
+ * at a time as DMA fills them or over the whole buffer.
+ *
+ * Samples are Hann windowed over the length given at init, so the
+ * fundamental does not leak into the harmonics when the window is not a
+ * whole number of cycles, and neither does the midpoint, so it is not
+ * needed at all. */
+
+#define OSM_ADCS_HARMONICS_MAX      15      /* Fundamental and harmonics 2..15 */
+
+
+typedef struct
+{
+    int32_t     coef;       /* 2cos(w), Q30 */
+    int32_t     s1;
+    int32_t     s2;
+} osm_adcs_harmonics_bin_t;
+
+
+typedef struct
+{
+    osm_adcs_harmonics_bin_t    bins[OSM_ADCS_HARMONICS_MAX];
+    int32_t                     win_coef;   /* 2cos(2pi/length), Q30 */
+    int32_t                     win_c1;     /* cos of the window's last two samples, Q30 */
+    int32_t                     win_c2;
+    uint32_t                    length;
+    uint32_t                    count;
+    uint8_t                     num_bins;
+} osm_adcs_harmonics_t;
+
+
+unsigned osm_adcs_harmonics_init(osm_adcs_harmonics_t* harmonics, unsigned num_bins, uint32_t length, uint32_t sample_period_ns, unsigned line_hz);
+void     osm_adcs_harmonics_add(osm_adcs_harmonics_t* harmonics, const uint16_t* buf, unsigned buf_len, unsigned start_index, unsigned step);
+bool     osm_adcs_harmonics_get(const osm_adcs_harmonics_t* harmonics, uint32_t* rms);
+bool     osm_adcs_harmonics_thd(const uint32_t* rms, unsigned num_bins, uint32_t* thd);
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* True RMS of one channel of an interleaved ADC buffer, about a
+ * midpoint, both x1000 as the ADC code uses them. The result is
+ * midpoint - RMS, as the peak finding RMS it can replace gives.
+ *
+ * The fixed point kernel squares and sums in integers, two samples
+ * at a time with the Cortex-M4 SMLALD where there is one. The double
+ * version is kept as the reference to test and time it against.
+ *
+ * The accumulator keeps the sums to give the average and RMS of any
+ * number of samples, added a block at a time as DMA fills them.
+ *
+ * The power accumulator sums a channel's products with a reference
+ * channel, in step and against the reference's change over the samples
+ * either side. The second is the reference a quarter cycle ahead, for a
+ * sine, so any phase shift of the reference is a mix of the two. */
+
+
+typedef struct
+{
+    uint64_t    sum;
+    uint64_t    sum_squares;
+    uint32_t    count;
+} osm_adcs_rms_acc_t;
+
+
+typedef struct
+{
+    uint64_t    sum_products;       /* x[n] * v[n] */
+    int64_t     sum_lead_products;  /* x[n] * (v[n+1] - v[n-1]) */
+    int32_t     sum_lead;           /* v[n+1] - v[n-1] */
+    uint32_t    lead_count;
+    uint16_t    last_x;
+    uint16_t    last_v[2];
+    uint8_t     history;
+} osm_adcs_rms_power_acc_t;
+
+
+uint32_t osm_adcs_rms_isqrt(uint64_t value);
+uint64_t osm_adcs_rms_sum_squares(const uint16_t* buf, unsigned buf_len, unsigned start_index, unsigned step, int32_t midpoint);
+
+bool     osm_adcs_rms_fixed(const uint16_t* buf, unsigned buf_len, unsigned start_index, unsigned step, uint32_t midpoint, uint32_t* adc_rms);
+bool     osm_adcs_rms_double(const uint16_t* buf, unsigned buf_len, unsigned start_index, unsigned step, uint32_t midpoint, uint32_t* adc_rms);
+
+void     osm_adcs_rms_acc_add(osm_adcs_rms_acc_t* acc, const uint16_t* buf, unsigned buf_len, unsigned start_index, unsigned step);
+bool     osm_adcs_rms_acc_get_avg(const osm_adcs_rms_acc_t* acc, uint32_t* adc_avg);
+bool     osm_adcs_rms_acc_get_rms(const osm_adcs_rms_acc_t* acc, uint32_t midpoint, uint32_t* adc_rms);
+
+void     osm_adcs_rms_power_add(osm_adcs_rms_power_acc_t* acc, const uint16_t* buf, unsigned buf_len, unsigned index, unsigned ref_index, unsigned step);
+bool     osm_adcs_rms_power_get(const osm_adcs_rms_power_acc_t* acc, const osm_adcs_rms_acc_t* x_acc, const osm_adcs_rms_acc_t* v_acc, uint32_t x_midpoint, uint32_t v_midpoint, int64_t* in_phase, int64_t* lead);
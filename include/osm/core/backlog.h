@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Store and forward backlog of encoded uplink payloads, kept while the
+ * link is down and drained, oldest first, once it returns.
+ *
+ * Records live in a RAM ring. If the platform has reserved backlog
+ * flash pages, the oldest records spill into them when the ring fills,
+ * and survive a reset. Without flash, or when that is full too, the
+ * oldest records are dropped. */
+
+#define OSM_BACKLOG_TIMESTAMP_UNKNOWN   UINT32_MAX
+
+void     osm_backlog_init(void);
+
+bool     osm_backlog_push(uint32_t timestamp, const int8_t * data, unsigned len);
+unsigned osm_backlog_peek(uint32_t * timestamp, int8_t * data, unsigned size);
+void     osm_backlog_pop(void);
+
+unsigned osm_backlog_get_count(void);
+unsigned osm_backlog_get_dropped(void);
+
+/* Provided by platforms with backlog flash, pages are
+ * OSM_BACKLOG_FLASH_PAGE_SIZE and written in 8 byte units. */
+unsigned       osm_platform_backlog_flash_pages(void);
+const uint8_t* osm_platform_backlog_flash_page(unsigned page);
+bool           osm_platform_backlog_flash_erase(unsigned page);
+bool           osm_platform_backlog_flash_write(unsigned page, unsigned offset, const void * data, unsigned size);
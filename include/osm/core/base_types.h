@@ -102,6 +102,10 @@ typedef enum
     OSM_SENxx = 18,
     OSM_EXAMPLE_RS232         = 19,
     OSM_TMP4718       = 20,
+    OSM_CC_POWER      = 21,
+    OSM_CC_THD        = 22,
+    OSM_SOUND_LEVEL   = 23,
+    OSM_PULSE_TIMING  = 24,
 } osm_measurements_def_type_t;
 
 
@@ -129,6 +133,10 @@ typedef enum
 #endif // OSM_MEASUREMENTS_DEF_NAME_CUSTOM_1
 
 #define OSM_MEASUREMENTS_DEF_NAME_IO_READING        "IO_READING"
+#define OSM_MEASUREMENTS_DEF_NAME_CC_POWER          "CC_POWER"
+#define OSM_MEASUREMENTS_DEF_NAME_CC_THD            "CC_THD"
+#define OSM_MEASUREMENTS_DEF_NAME_SOUND_LEVEL       "SOUND_LEVEL"
+#define OSM_MEASUREMENTS_DEF_NAME_PULSE_TIMING      "PULSE_TIMING"
 
 
 typedef struct
@@ -226,7 +234,9 @@ typedef struct
     uint32_t baudrate;
     uint16_t first_dev_offset;
     uint16_t first_free_offset;
-    uint32_t _;
+    uint8_t  read_max_gap;      /* Max unrequested registers between two coalesced in a read. */
+    uint8_t  read_max_span;     /* Max registers in a coalesced read, 0 or 1 is disabled. */
+    uint16_t _;
     osm_modbus_free_t  blocks[OSM_MODBUS_BLOCKS];
 } __attribute__((__packed__)) osm_modbus_bus_t;
 
@@ -17,6 +17,7 @@ typedef struct
 bool     osm_msg_is(const char* ref, char* message);
 
 uint32_t osm_get_since_boot_ms(void);
+uint64_t osm_get_since_boot_us(void);
 uint32_t osm_since_boot_delta(uint32_t newer, uint32_t older);
 
 float    osm_Q_rsqrt( float number );
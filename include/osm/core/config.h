@@ -13,6 +13,8 @@
 
 #define OSM_MODBUS_RESP_TIMEOUT_MS 2000
 #define OSM_MODBUS_SENT_TIMEOUT_MS 2000
+#define OSM_MODBUS_READ_MAX_GAP    0
+#define OSM_MODBUS_READ_MAX_SPAN   16
 
 /* On some versions of gcc this header isn't defining it. Quick fix. */
 #ifndef PRIu64
@@ -40,6 +42,7 @@
 #define OSM_CC_DEFAULT_MIDPOINT                 (1000 * (OSM_ADC_MAX_VAL + 1) / 2 - 1)
 #define OSM_CC_DEFAULT_EXT_MAX_MA               (100 * 1000)
 #define OSM_CC_DEFAULT_INT_MAX_MV               50
+#define OSM_CC_LINE_FREQ_HZ                     50
 
 #define OSM_FTMA_NUM_COEFFS      4
 
@@ -54,8 +57,11 @@
 #define OSM_TIMER1_PRIORITY 2
 #define OSM_TIMER2_PRIORITY 1
 #define OSM_PPS_PRIORITY 1
+#define OSM_W1_PRIORITY  0
+#define OSM_I2C_PRIORITY 2
 
 #define OSM_PROTOCOL_HEX_ARRAY_SIZE 117
+#define OSM_PROTOCOL_COMPACT_SLOTS  32
 
 #define OSM_CMD_VUART 0
 #define OSM_UART_ERR_NU 0
@@ -93,6 +99,10 @@
 
 #define OSM_DMA_DATA_PCK_SZ    64
 
+#define OSM_BACKLOG_RAM_SIZE          512  /* Power of two */
+#define OSM_BACKLOG_RECORD_MAX_SIZE   256
+#define OSM_BACKLOG_FLASH_PAGE_SIZE   2048
+
 #define OSM_DEBUG_SYS             0x1
 #define OSM_DEBUG_ADC             0x2
 #define OSM_DEBUG_COMMS           0x4
@@ -113,7 +123,15 @@
 #define OSM_DEBUG_CUSTOM_0    0x100000
 #define OSM_DEBUG_CUSTOM_1    0x200000
 
-#define __ADC_RMS_FULL__
+#define __ADC_RMS_FULL__       /* True RMS, in fixed point unless __ADC_RMS_DOUBLE__ */
+#define __ADC_CONTINUOUS__     /* Sum samples from circular DMA halves, no whole buffer */
+
+#define OSM_ADCS_HALF_SAMPLES   120
+#ifdef __ADC_CONTINUOUS__
+#define OSM_ADCS_DMA_SAMPLES    (2 * OSM_ADCS_HALF_SAMPLES)
+#else
+#define OSM_ADCS_DMA_SAMPLES    OSM_ADCS_NUM_SAMPLES
+#endif
 
 #define OSM_IWDG_NORMAL_TIME_MS 10000
 #define OSM_IWDG_MAX_TIME_MS    32760
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Report by exception. A measurement with a dead-band is only sent when
+ * it moves outside the band around the last value sent, or when it has
+ * been held back for its heartbeat number of sends.
+ *
+ * The band is the larger of the absolute and relative thresholds, so
+ * a relative band can be given an absolute floor for values near 0. */
+
+#define OSM_DEADBAND_MAX            8
+#define OSM_DEADBAND_REL_SCALE      1000    /* rel_band is in 0.1% */
+#define OSM_DEADBAND_NONE           -1
+
+
+typedef struct
+{
+    uint8_t     index;          /* Measurement slot */
+    uint8_t     heartbeat;      /* Max sends held back in a row, 0 for no limit */
+    uint16_t    rel_band;       /* Of the last value sent, in 1/OSM_DEADBAND_REL_SCALE */
+    uint32_t    abs_band;       /* In sent units, so floats are x1000 */
+} __attribute__((__packed__)) osm_deadband_t;
+
+
+typedef struct
+{
+    int64_t     last;
+    uint8_t     held;
+    bool        has_last;
+} osm_deadband_state_t;
+
+
+bool osm_deadband_is_set(const osm_deadband_t* band);
+int  osm_deadband_find(const osm_deadband_t* bands, unsigned index);
+int  osm_deadband_get_free(const osm_deadband_t* bands);
+void osm_deadband_clear(osm_deadband_t* band, osm_deadband_state_t* state);
+
+bool osm_deadband_within(const osm_deadband_t* band, const osm_deadband_state_t* state, int64_t value);
+bool osm_deadband_hold(const osm_deadband_t* band, osm_deadband_state_t* state, int64_t value);
+void osm_deadband_sent(osm_deadband_state_t* state, int64_t value);
@@ -3,8 +3,51 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+/* An I2C transaction is a write then a read, either of which may be
+ * empty. Submitted, it waits in its bus's queue behind those of other
+ * drivers, and once run, the callback, if any, is called. On hardware
+ * that is from the interrupt. The transaction and its buffers must be
+ * left alone until it is no longer pending. */
+
+#define OSM_I2C_XFER_MAX_LEN        255     /* Of each of the write and read */
+
+
+typedef enum
+{
+    OSM_I2C_XFER_IDLE,
+    OSM_I2C_XFER_QUEUED,
+    OSM_I2C_XFER_ACTIVE,
+    OSM_I2C_XFER_DONE,
+    OSM_I2C_XFER_FAILED,
+} osm_i2c_xfer_status_t;
+
+
+typedef struct osm_i2c_xfer_t osm_i2c_xfer_t;
+
+typedef void (*osm_i2c_xfer_cb_t)(osm_i2c_xfer_t* xfer);
+
+struct osm_i2c_xfer_t
+{
+    uint32_t                        i2c;
+    uint8_t                         addr;
+    const uint8_t*                  w;
+    unsigned                        wn;
+    uint8_t*                        r;
+    unsigned                        rn;
+    unsigned                        timeout_ms;     /* From being started on the bus, not queued */
+    osm_i2c_xfer_cb_t               cb;
+    void*                           userdata;
+    /* Only used by the bus */
+    volatile osm_i2c_xfer_status_t  status;
+    uint32_t                        started_ms;
+    unsigned                        wi;
+    unsigned                        ri;
+};
+
 
 void osm_i2cs_init(void);
 void osm_i2cs_deinit(void);
+void osm_i2cs_iterate(void);
+bool osm_i2c_submit(osm_i2c_xfer_t* xfer);
+bool osm_i2c_xfer_pending(osm_i2c_xfer_t* xfer);
 bool osm_i2c_transfer_timeout(uint32_t i2c, uint8_t addr, const uint8_t *w, unsigned wn, uint8_t *r, unsigned rn, unsigned timeout_ms);
-
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <osm/core/i2c.h>
+
+/* The transactions waiting on a bus, the front one being run. Pushing
+ * and finishing must not interrupt each other, the port keeps the bus
+ * interrupt off around those it does outside of it. */
+
+#define OSM_I2C_QUEUE_SIZE      8       /* Power of 2 */
+
+
+typedef struct
+{
+    osm_i2c_xfer_t*     xfers[OSM_I2C_QUEUE_SIZE];
+    volatile uint32_t   head;
+    volatile uint32_t   tail;
+} osm_i2c_queue_t;
+
+
+void            osm_i2c_queue_init(osm_i2c_queue_t* queue);
+bool            osm_i2c_queue_push(osm_i2c_queue_t* queue, osm_i2c_xfer_t* xfer);
+osm_i2c_xfer_t* osm_i2c_queue_front(osm_i2c_queue_t* queue);
+void            osm_i2c_queue_start(osm_i2c_xfer_t* xfer, uint32_t now_ms);
+osm_i2c_xfer_t* osm_i2c_queue_finish(osm_i2c_queue_t* queue, bool ok);
+bool            osm_i2c_queue_timed_out(osm_i2c_queue_t* queue, uint32_t now_ms);
@@ -29,6 +29,8 @@ bool     osm_io_enable_w1(unsigned io);
 bool     osm_io_is_pulsecount_now(unsigned io);
 bool     osm_io_is_w1_now(unsigned io);
 bool     osm_io_is_watch_now(unsigned io);
+uint32_t osm_io_get_watch_window_ms(void);
+bool     osm_io_set_watch_window_ms(uint32_t window_ms);
 
 bool     osm_io_is_input(unsigned io);
 unsigned osm_io_get_bias(unsigned io);
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Edges of the watched IOs. The interrupt only pushes each into a queue,
+ * the main loop holds them until the oldest is a window old, and then
+ * takes them all into one uplink as a list, rather than an uplink an
+ * edge.
+ *
+ * What the queue can't hold, and what the list has no room for, is only
+ * counted. */
+
+#define OSM_IO_EVENTS_QUEUE_SIZE            64      /* Power of 2 */
+#define OSM_IO_EVENTS_QUEUE_WAKE            48      /* Entries at which to send without waiting out the window */
+#define OSM_IO_EVENTS_LIST_MAX              16      /* Events in an uplink */
+#define OSM_IO_EVENTS_DEFAULT_WINDOW_MS     1000
+#define OSM_IO_EVENTS_MAX_WINDOW_MS         32767   /* Persisted as a uint16_t, well clear of erased */
+
+
+typedef struct
+{
+    uint32_t    ms;                 /* Since boot */
+    uint8_t     io;
+    uint8_t     level;
+} osm_io_event_t;
+
+
+typedef struct
+{
+    osm_io_event_t      events[OSM_IO_EVENTS_QUEUE_SIZE];
+    volatile uint32_t   head;       /* Only written by the interrupt */
+    volatile uint32_t   tail;       /* Only written by the main loop */
+    volatile uint32_t   overflows;  /* Only written by the interrupt */
+    uint32_t            overflows_taken;
+    uint32_t            carried;    /* Dropped, not yet in a list */
+    uint32_t            folded;     /* Taken past the end of the list */
+    uint32_t            lists;
+} osm_io_events_t;
+
+
+/* From the interrupt, the count of entries waiting or 0 if dropped. */
+static inline unsigned osm_io_events_push(osm_io_events_t* events, unsigned io, bool level, uint32_t ms)
+{
+    uint32_t head = events->head;
+    uint32_t used = head - events->tail;
+    if (used >= OSM_IO_EVENTS_QUEUE_SIZE)
+    {
+        events->overflows++;
+        return 0;
+    }
+    osm_io_event_t* event = &events->events[head & (OSM_IO_EVENTS_QUEUE_SIZE - 1)];
+    event->ms = ms;
+    event->io = io;
+    event->level = level;
+    __sync_synchronize();
+    events->head = head + 1;
+    return used + 1;
+}
+
+
+void     osm_io_events_init(osm_io_events_t* events);
+bool     osm_io_events_pending(osm_io_events_t* events);
+uint32_t osm_io_events_due(osm_io_events_t* events, uint32_t now_ms, uint32_t window_ms);
+unsigned osm_io_events_take(osm_io_events_t* events, uint32_t io_mask, osm_io_event_t* list, unsigned max, uint32_t* dropped);
+void     osm_io_events_carry(osm_io_events_t* events, uint32_t dropped);
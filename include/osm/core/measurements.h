@@ -11,6 +11,7 @@
 
 #define OSM_MEASUREMENTS_DEFAULT_TRANSMIT_INTERVAL  (uint32_t)(15 * 1000)
 #define OSM_MEASUREMENTS_VALUE_STR_LEN              23
+#define OSM_MEASUREMENTS_BATCH_MAX                  16
 
 extern uint32_t transmit_interval;
 
@@ -78,7 +79,7 @@ typedef struct
     uint8_t                 num_samples:7;
     uint8_t                 has_sent:1;
     uint8_t                 num_samples_init:7;
-    uint8_t                 _:1;
+    uint8_t                 inf_cached:1;                                 /* Interface resolved into the slot's cache */
     uint8_t                 num_samples_collected:7;
     uint8_t                 __:1;
     uint32_t                collection_time_cache;
@@ -86,6 +87,15 @@ typedef struct
 } osm_measurements_data_t;
 
 
+/* Spread of the samples, in the same units as the value. */
+typedef struct
+{
+    int64_t stddev;
+    int64_t p50;
+    int64_t p95;
+} osm_measurements_stats_t;
+
+
 typedef bool (*measurements_for_each_cb_t)(osm_measurements_def_t* def, void * data);
 
 
@@ -99,6 +109,13 @@ bool     measurements_set_interval(char* name, uint8_t interval);       // Inter
 bool     measurements_get_interval(char* name, uint8_t * interval);     // Interval is time in multiples of transmit interval (default 5m) for the measurements to be sent.
 bool     measurements_set_samplecount(char* name, uint8_t samplecount); // How many samples should be taken in each interval
 bool     measurements_get_samplecount(char* name, uint8_t * samplecount); // How many samples should be taken in each interval
+bool     measurements_set_deadband(char* name, uint32_t abs_band, uint16_t rel_band, uint8_t heartbeat); // Only send when outside band, see deadband.h. 0 bands to disable.
+bool     measurements_get_deadband(char* name, uint32_t* abs_band, uint16_t* rel_band, uint8_t* heartbeat);
+bool     measurements_set_stats(char* name, bool enabled);   // Also send stddev, median and 95th percentile of the samples.
+bool     measurements_get_stats(char* name, bool* enabled);
+bool     osm_measurements_get_stats(osm_measurements_data_t* data, osm_measurements_stats_t* stats);
+bool     measurements_set_batch(uint8_t intervals, uint16_t max_mins);  // Send this many intervals in one uplink, flushed early once the oldest is max_mins old.
+void     measurements_get_batch(uint8_t* intervals, uint16_t* max_mins);
 
 void     osm_measurements_loop_iteration(void);
 void     osm_measurements_init(void);
@@ -2,11 +2,14 @@
 
 #include <osm/core/base_types.h>
 
-#define OSM_MEASUREMENTS_MAX_NUMBER                   256
+#define OSM_MEASUREMENTS_MAX_NUMBER                   224     /* The rest of the flash page is 1-Wire ROMs */
 
 #define OSM_MEASUREMENTS_PAYLOAD_VERSION       (uint8_t)0x02
+#define OSM_MEASUREMENTS_PAYLOAD_COMPACT_VERSION (uint8_t)0x03
 #define OSM_MEASUREMENTS_DATATYPE_SINGLE       (uint8_t)0x01
 #define OSM_MEASUREMENTS_DATATYPE_AVERAGED     (uint8_t)0x02
+#define OSM_MEASUREMENTS_DATATYPE_STATS        (uint8_t)0x03  /* Averaged, then stddev, median and 95th percentile */
+#define OSM_MEASUREMENTS_DATATYPE_EVENTS       (uint8_t)0x04  /* IO edges, see docs/protocols/lorawan_protocols.md */
 
 #define OSM_MEASUREMENTS_FW_VERSION             "FW"   /* string - Git SHA1 of firmware */
 #define OSM_MEASUREMENTS_CONFIG_REVISION        "CREV" /* int    - How many times config has been changed. */
@@ -39,10 +42,57 @@
 #define OSM_MEASUREMENTS_EXAMPLE_RS232_NAME     "R232" /* string - OSM_EXAMPLE_RS232 response from command */
 #define OSM_MEASUREMENTS_TMP4718_LOCAL_NAME     "TMP6" /* float  - Temperature on POE/Ethernet module, local */
 #define OSM_MEASUREMENTS_TMP4718_REMOTE_NAME    "TMP7" /* float  - Temperature on POE/Ethernet module, remote */
+#define OSM_MEASUREMENTS_CC_REAL_POWER_NAME     "PWR"  /* int    - Real power in W, summed over the current clamps on a voltage reference */
+#define OSM_MEASUREMENTS_CC_APPARENT_POWER_NAME "VA"   /* int    - Apparent power in VA, summed over the same clamps */
+#define OSM_MEASUREMENTS_CC_POWER_FACTOR_NAME   "PFAC" /* float  - Power factor, real over apparent power */
+#define OSM_MEASUREMENTS_CC_ENERGY_NAME         "KWH"  /* float  - Imported energy in kWh, persisted */
+#define OSM_MEASUREMENTS_CC_THD_1_NAME          "THD1" /* float  - Total harmonic distortion of CC1 in %, to its cc_harm harmonic */
+#define OSM_MEASUREMENTS_CC_THD_2_NAME          "THD2" /* float  - Total harmonic distortion of CC2 in % */
+#define OSM_MEASUREMENTS_CC_THD_3_NAME          "THD3" /* float  - Total harmonic distortion of CC3 in % */
+#define OSM_MEASUREMENTS_SOUND_LAEQ_NAME        "LAEQ" /* float  - A weighted Leq in dB since the last reading, from the filterbank */
+#define OSM_MEASUREMENTS_SOUND_LAMAX_NAME       "LAMX" /* float  - Loudest A weighted 125ms in dB since the last reading */
+#define OSM_MEASUREMENTS_SOUND_LAMIN_NAME       "LAMN" /* float  - Quietest A weighted 125ms in dB since the last reading */
+#define OSM_MEASUREMENTS_SOUND_BAND_31_NAME     "OB31" /* float  - 1/1 octave band Leq in dB, 31.5Hz */
+#define OSM_MEASUREMENTS_SOUND_BAND_63_NAME     "OB63" /* float  - 1/1 octave band Leq in dB, 63Hz */
+#define OSM_MEASUREMENTS_SOUND_BAND_125_NAME    "O125" /* float  - 1/1 octave band Leq in dB, 125Hz */
+#define OSM_MEASUREMENTS_SOUND_BAND_250_NAME    "O250" /* float  - 1/1 octave band Leq in dB, 250Hz */
+#define OSM_MEASUREMENTS_SOUND_BAND_500_NAME    "O500" /* float  - 1/1 octave band Leq in dB, 500Hz */
+#define OSM_MEASUREMENTS_SOUND_BAND_1K_NAME     "O1K"  /* float  - 1/1 octave band Leq in dB, 1kHz */
+#define OSM_MEASUREMENTS_SOUND_BAND_2K_NAME     "O2K"  /* float  - 1/1 octave band Leq in dB, 2kHz */
+#define OSM_MEASUREMENTS_PULSE_RATE_NAME_1      "FRQ1" /* float  - Pulse rate of CNT1 in Hz since the last reading, from the edge timestamps */
+#define OSM_MEASUREMENTS_PULSE_MIN_NAME_1       "PMN1" /* float  - Shortest interval between pulses of CNT1 in ms */
+#define OSM_MEASUREMENTS_PULSE_MAX_NAME_1       "PMX1" /* float  - Longest interval between pulses of CNT1 in ms */
+#define OSM_MEASUREMENTS_PULSE_JITTER_NAME_1    "PJT1" /* float  - Standard deviation of the intervals of CNT1 in ms */
+#define OSM_MEASUREMENTS_PULSE_RATE_NAME_2      "FRQ2" /* float  - Pulse rate of CNT2 in Hz */
+#define OSM_MEASUREMENTS_PULSE_MIN_NAME_2       "PMN2" /* float  - Shortest interval between pulses of CNT2 in ms */
+#define OSM_MEASUREMENTS_PULSE_MAX_NAME_2       "PMX2" /* float  - Longest interval between pulses of CNT2 in ms */
+#define OSM_MEASUREMENTS_PULSE_JITTER_NAME_2    "PJT2" /* float  - Standard deviation of the intervals of CNT2 in ms */
 
 #define OSM_MEASUREMENTS_LEGACY_PULSE_COUNT_NAME "PCNT"
 
+/* Names are at most OSM_MEASURE_NAME_LEN (4) chars, so pack them into a
+ * 32bit key. Anything after a NUL is ignored, like strncmp. */
+static inline uint32_t osm_measurements_name_key(const char* name)
+{
+    uint32_t key = 0;
+    for (unsigned n = 0; n < OSM_MEASURE_NAME_LEN && name[n]; n++)
+        key |= ((uint32_t)(uint8_t)name[n]) << (n * 8);
+    return key;
+}
+
 void osm_measurements_setup_default(osm_measurements_def_t* def, char* name, uint8_t interval, uint8_t samplecount, osm_measurements_def_type_t type);
 void osm_measurements_repop_indiv(char* name, uint8_t interval, uint8_t samplecount, osm_measurements_def_type_t type);
 
+/* Measurements that come as a set from one sensor, all off by default. */
+typedef enum
+{
+    OSM_MEASUREMENTS_GROUP_CC_POWER,
+    OSM_MEASUREMENTS_GROUP_CC_THD,
+    OSM_MEASUREMENTS_GROUP_PULSE_TIMING,
+    OSM_MEASUREMENTS_GROUP_SOUND_LEVEL,
+} osm_measurements_group_t;
+
+unsigned osm_measurements_setup_group_defaults(osm_measurements_def_t* measurements_arr, osm_measurements_group_t group);
+void osm_measurements_repop_group(osm_measurements_group_t group);
+
 osm_measurements_def_t*  osm_measurements_array_find(osm_measurements_def_t * measurements_arr, char* name);
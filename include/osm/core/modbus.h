@@ -4,12 +4,11 @@
 #include <osm/core/ring.h>
 #include <osm/core/log.h>
 #include <osm/core/modbus_mem.h>
+#include <osm/core/modbus_crc.h>
 
 
 bool osm_modbus_requires_echo_removal(void) __attribute__((weak));
 
-uint16_t osm_modbus_crc(uint8_t * buf, unsigned length);
-
 bool osm_modbus_set_reg(uint16_t unit_id, uint16_t reg_addr, uint8_t func, osm_modbus_reg_type_t type, osm_modbus_byte_orders_t byte_order, osm_modbus_word_orders_t word_order, float value);
 
 bool osm_modbus_start_read(osm_modbus_reg_t * reg);
@@ -0,0 +1,21 @@
+#pragma once
+#include <stdint.h>
+
+
+#define OSM_MODBUS_CRC_INIT 0xFFFF
+
+#define OSM_MODBUS_CRC_BITWISE 0 /* No table, smallest flash use. */
+#define OSM_MODBUS_CRC_TABLE   1 /* 512 byte table, a lookup per byte. */
+#define OSM_MODBUS_CRC_SLICE4  2 /* 2K of tables, four bytes per step. */
+
+#ifndef OSM_MODBUS_CRC_IMPL
+#define OSM_MODBUS_CRC_IMPL OSM_MODBUS_CRC_BITWISE
+#endif
+
+uint16_t osm_modbus_crc(uint8_t * buf, unsigned length);
+uint16_t osm_modbus_crc_update(uint16_t crc, const uint8_t * buf, unsigned length);
+
+/* All variants are built, unused ones are dropped by the linker's section GC. */
+uint16_t osm_modbus_crc_update_bitwise(uint16_t crc, const uint8_t * buf, unsigned length);
+uint16_t osm_modbus_crc_update_table(uint16_t crc, const uint8_t * buf, unsigned length);
+uint16_t osm_modbus_crc_update_slice4(uint16_t crc, const uint8_t * buf, unsigned length);
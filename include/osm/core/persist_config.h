@@ -6,7 +6,8 @@
 #include <osm/core/persist_config_header.h>
 
 
-#define OSM_PERSIST_BASE_VERSION           4
+#define OSM_PERSIST_BASE_VERSION           5
+#define OSM_PERSIST_BASE_VERSION_W1_ROMS   5  /* From this the measurements page ends with the 1-Wire ROMs */
 #define OSM_PERSIST_VERSION_SET(_x)        ((OSM_PERSIST_BASE_VERSION << 8) | _x)
 
 
@@ -29,3 +30,4 @@ struct osm_cmd_link_t* osm_persist_config_add_commands(struct osm_cmd_link_t* ta
 void osm_persist_config_inf_init(osm_measurements_inf_t* inf);
 
 bool osm_persist_config_update(const osm_persist_storage_t* from_config, osm_persist_storage_t* to_config);
+void osm_persist_measurements_update(uint16_t from_version, osm_persist_measurements_storage_t* measurements);
@@ -5,6 +5,9 @@
 
 #include <osm/core/measurements.h>
 #include <osm/core/config.h>
+#include <osm/core/deadband.h>
+#include <osm/core/stats.h>
+#include <osm/core/w1_rom.h>
 #include "persist_config_header_model.h"
 
 
@@ -34,6 +37,17 @@ typedef struct
     osm_persist_model_config_t  model_config;
     /* 16 byte boundary ---- */
     uint64_t                config_count;
+    uint8_t                 __[8];
+    /* 16 byte boundary ---- */
+    osm_deadband_t          deadbands[OSM_DEADBAND_MAX];
+    /* 16 byte boundary ---- */
+    uint16_t                stats[OSM_STATS_MAX];      /* Measurement slot + 1, 0 for none */
+    /* 16 byte boundary ---- */
+    uint8_t                 batch_intervals;           /* Intervals per uplink, 0 or 1 for none */
+    uint8_t                 ___;
+    uint16_t                batch_max_mins;            /* Oldest reading held, 0 for no bound */
+    uint32_t                cc_energy_wh;              /* Imported energy on the current clamps */
+    uint16_t                io_watch_window_ms;        /* Edges held for an uplink, 0 for the default */
 } __attribute__((__packed__)) osm_persist_storage_t;
 
 
@@ -42,9 +56,13 @@ OSM_STATIC_ASSERT_16BYTE_ALIGNED(osm_persist_storage_t, serial_number);
 OSM_STATIC_ASSERT_16BYTE_ALIGNED(osm_persist_storage_t, human_name);
 OSM_STATIC_ASSERT_16BYTE_ALIGNED(osm_persist_storage_t, model_config);
 OSM_STATIC_ASSERT_16BYTE_ALIGNED(osm_persist_storage_t, config_count);
+OSM_STATIC_ASSERT_16BYTE_ALIGNED(osm_persist_storage_t, deadbands);
+OSM_STATIC_ASSERT_16BYTE_ALIGNED(osm_persist_storage_t, stats);
+OSM_STATIC_ASSERT_16BYTE_ALIGNED(osm_persist_storage_t, batch_intervals);
 
 
 typedef struct
 {
     osm_measurements_def_t      measurements_arr[OSM_MEASUREMENTS_MAX_NUMBER];
+    osm_w1_rom_map_t            w1_roms[OSM_W1_ROM_MAP_MAX];    /* 1-Wire measurement ROMs, unused if unnamed */
 } __attribute__((__packed__)) osm_persist_measurements_storage_t;
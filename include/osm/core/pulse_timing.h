@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Inter-pulse timing of a pulsecount input. The edge interrupt only
+ * pushes its timestamp into a small ring, the main loop drains the ring
+ * into the period statistics, and a reading takes and clears them.
+ *
+ * The interval spanning a reading counts towards the next one, and
+ * should the ring overflow, the interval across what was dropped is not
+ * counted at all. */
+
+#define OSM_PULSE_TIMING_RING_SIZE      32      /* Power of 2 */
+#define OSM_PULSE_TIMING_RING_WAKE      24      /* Entries at which the interrupt should get the main loop to drain */
+#define OSM_PULSE_TIMING_GAP            (1ULL << 63)    /* Set on the first stamp after any were dropped */
+
+
+typedef struct
+{
+    volatile uint64_t   stamps_us[OSM_PULSE_TIMING_RING_SIZE];
+    volatile uint32_t   head;       /* Only written by the interrupt */
+    volatile uint32_t   tail;       /* Only written by the main loop */
+    volatile uint32_t   overflows;
+    bool                gap;        /* Only used by the interrupt */
+} osm_pulse_timing_ring_t;
+
+
+typedef struct
+{
+    uint64_t    last_us;
+    bool        has_last;
+    uint32_t    count;              /* Intervals since taken */
+    uint64_t    sum_us;
+    uint64_t    min_us;
+    uint64_t    max_us;
+    double      mean_us;            /* Welford's, for the jitter */
+    double      m2;
+    uint32_t    overflows_taken;
+} osm_pulse_timing_stats_t;
+
+
+typedef struct
+{
+    osm_pulse_timing_ring_t     ring;
+    osm_pulse_timing_stats_t    stats;
+} osm_pulse_timing_t;
+
+
+typedef struct
+{
+    float       rate_hz;
+    float       min_ms;
+    float       max_ms;
+    float       jitter_ms;          /* Standard deviation of the intervals */
+    uint32_t    count;
+    uint32_t    overflows;          /* Edges dropped since taken */
+} osm_pulse_timing_result_t;
+
+
+/* From the interrupt, the count of entries waiting or 0 if dropped. */
+static inline unsigned osm_pulse_timing_push(osm_pulse_timing_t* timing, uint64_t stamp_us)
+{
+    osm_pulse_timing_ring_t* ring = &timing->ring;
+    uint32_t head = ring->head;
+    uint32_t used = head - ring->tail;
+    if (used >= OSM_PULSE_TIMING_RING_SIZE)
+    {
+        ring->overflows++;
+        ring->gap = true;
+        return 0;
+    }
+    if (ring->gap)
+    {
+        stamp_us |= OSM_PULSE_TIMING_GAP;
+        ring->gap = false;
+    }
+    ring->stamps_us[head & (OSM_PULSE_TIMING_RING_SIZE - 1)] = stamp_us;
+    ring->head = head + 1;
+    return used + 1;
+}
+
+
+void osm_pulse_timing_init(osm_pulse_timing_t* timing);
+void osm_pulse_timing_drain(osm_pulse_timing_t* timing);
+bool osm_pulse_timing_take(osm_pulse_timing_t* timing, osm_pulse_timing_result_t* result);
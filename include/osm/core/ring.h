@@ -3,15 +3,31 @@
 #include <stdbool.h>
 #include <osm/core/config.h>
 
+/* Single producer, single consumer ring, safe without locks.
+ *
+ * The producer (UART ISR, DMA completion, Linux poll thread) only ever
+ * writes w_pos and the consumer (main loop) only ever writes r_pos.
+ * Each side loads the other's index with acquire ordering before
+ * touching the data, and publishes its own with release ordering after.
+ * That is C11 fences on Linux and DMB on Cortex-M.
+ *
+ * add/add_data/add_str/is_full are producer side, everything else is
+ * consumer side. ring_buf_clear() writes both indexes so is only for
+ * when the producer is idle, the consumer drops data with
+ * osm_ring_buf_discard_all().
+ */
 typedef struct
 {
     volatile char *   buf;
     unsigned          size;
+    unsigned          mask; /* size - 1 if size is a power of two, else 0 */
     volatile unsigned r_pos;
     volatile unsigned w_pos;
 } osm_ring_buf_t;
 
-#define RING_BUF_INIT(_buf_, _size_) {_buf_, _size_, 0, 0}
+#define RING_BUF_MASK(_size_) ((((_size_) & ((_size_) - 1)) == 0)?((_size_) - 1):0)
+
+#define RING_BUF_INIT(_buf_, _size_) {_buf_, _size_, RING_BUF_MASK(_size_), 0, 0}
 
 static inline void ring_buf_clear(osm_ring_buf_t * ring_buf) { ring_buf->r_pos = 0; ring_buf->w_pos = 0; }
 
@@ -24,8 +40,10 @@ bool     osm_ring_buf_is_full(osm_ring_buf_t * ring_buf);
 
 unsigned osm_ring_buf_read(osm_ring_buf_t * ring_buf, char * buf, unsigned len);
 unsigned osm_ring_buf_discard(osm_ring_buf_t * ring_buf, unsigned len);
+unsigned osm_ring_buf_discard_all(osm_ring_buf_t * ring_buf);
 unsigned osm_ring_buf_peek(osm_ring_buf_t * ring_buf, char * buf, unsigned len);
 unsigned osm_ring_buf_readline(osm_ring_buf_t * ring_buf, char * buf, unsigned len);
+unsigned osm_ring_buf_peek_span(osm_ring_buf_t * ring_buf, unsigned offset, char ** span);
 
 typedef unsigned (*ring_buf_consume_cb)(char * buf, unsigned len, void *data);
 
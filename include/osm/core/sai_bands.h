@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* A weighting and 1/1 octave bands of the microphone's stream, each a
+ * cascade of biquads run in integers, coefficients Q28, a DMA block at
+ * a time. The energy out of each is summed over however long it is left
+ * to run, so the levels are Leq over the whole of it, and the A weighted
+ * energy of each 125ms is kept for its loudest and quietest.
+ *
+ * Filter states run on from block to block, the sums are in their own
+ * accumulator so they can be taken and cleared without a glitch. */
+
+#define OSM_SAI_BANDS_SAMPLE_RATE_HZ    7812.5  /* 8MHz / (MCKDIV 2 * 2) / 256 */
+#define OSM_SAI_BANDS_COUNT             7       /* 31.5Hz to 2kHz, the 4kHz band is past Nyquist */
+#define OSM_SAI_BANDS_SECTIONS          4       /* 4th order Butterworth high pass then low pass */
+#define OSM_SAI_BANDS_A_SECTIONS        3
+#define OSM_SAI_BANDS_FAST_SAMPLES      977     /* 125ms */
+#define OSM_SAI_BANDS_SETTLE_SAMPLES    2048    /* Left out while the lowest band rings up */
+
+/* Levels are in this order. */
+#define OSM_SAI_BANDS_LEVEL_LAEQ        0
+#define OSM_SAI_BANDS_LEVEL_LAMAX       1
+#define OSM_SAI_BANDS_LEVEL_LAMIN       2
+#define OSM_SAI_BANDS_LEVEL_BAND        3
+#define OSM_SAI_BANDS_LEVEL_COUNT       (OSM_SAI_BANDS_LEVEL_BAND + OSM_SAI_BANDS_COUNT)
+
+
+typedef struct
+{
+    int32_t     b0;
+    int32_t     b1;
+    int32_t     b2;
+    int32_t     a1;
+    int32_t     a2;
+} osm_sai_bands_coeffs_t;
+
+
+typedef struct
+{
+    int32_t     x1;
+    int32_t     x2;
+    int32_t     y1;
+    int32_t     y2;
+    uint32_t    err;        /* Fraction dropped from the last output, fed back */
+} osm_sai_bands_state_t;
+
+
+typedef struct
+{
+    osm_sai_bands_state_t   a_states[OSM_SAI_BANDS_A_SECTIONS];
+    osm_sai_bands_state_t   band_states[OSM_SAI_BANDS_COUNT][OSM_SAI_BANDS_SECTIONS];
+    uint64_t                fast_energy;
+    uint32_t                fast_count;
+    uint32_t                settle;
+} osm_sai_bands_t;
+
+
+typedef struct
+{
+    double      a_energy;
+    double      band_energy[OSM_SAI_BANDS_COUNT];
+    uint64_t    fast_max;
+    uint64_t    fast_min;
+    uint32_t    fast_blocks;
+    uint32_t    count;
+} osm_sai_bands_acc_t;
+
+
+void osm_sai_bands_init(osm_sai_bands_t* bands);
+void osm_sai_bands_acc_clear(osm_sai_bands_acc_t* acc);
+void osm_sai_bands_add(osm_sai_bands_t* bands, osm_sai_bands_acc_t* acc, const volatile int32_t* samples, unsigned len);
+bool osm_sai_bands_get(const osm_sai_bands_acc_t* acc, float* rms);
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Min-heap of slots keyed on when they are next due, so only those due
+ * are looked at. A slot taken as due is put back at least
+ * OSM_SCHED_RETRY_MS on, so one that is busy doesn't come straight back
+ * to the top and keep the caller from ever getting past it. */
+
+#define OSM_SCHED_SIZE              256     /* Slots are uint8_t */
+#define OSM_SCHED_RETRY_MS          1
+
+
+typedef struct
+{
+    uint32_t due_ms[OSM_SCHED_SIZE];
+    uint8_t  heap[OSM_SCHED_SIZE];
+    unsigned len;
+} osm_sched_t;
+
+
+void osm_sched_clear(osm_sched_t* sched);
+void osm_sched_push(osm_sched_t* sched, unsigned slot, uint32_t due_ms);
+bool osm_sched_take_due(osm_sched_t* sched, uint32_t now_ms, unsigned* slot);
+void osm_sched_put_back(osm_sched_t* sched, unsigned slot, uint32_t now_ms, uint32_t wait_ms);
+bool osm_sched_get_wait(osm_sched_t* sched, uint32_t now_ms, uint32_t* wait_ms);
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+
+/* Streaming summary of a measurement's samples in fixed memory and
+ * constant time per sample. Welford's running mean and variance, and
+ * the P² (Jain & Chlamtac) estimate of the median and 95th percentile,
+ * which is exact until it has more than 5 samples. */
+
+#define OSM_STATS_MARKERS       5
+#define OSM_STATS_MAX           8       /* Measurements with stats at once */
+
+
+typedef struct
+{
+    float       q[OSM_STATS_MARKERS];   /* Marker heights */
+    uint16_t    n[OSM_STATS_MARKERS];   /* Marker positions, from 0 */
+} osm_stats_quantile_t;
+
+
+typedef struct
+{
+    uint16_t                count;
+    float                   mean;
+    float                   m2;
+    osm_stats_quantile_t    p50;
+    osm_stats_quantile_t    p95;
+} osm_stats_t;
+
+
+void  osm_stats_init(osm_stats_t* stats);
+void  osm_stats_add(osm_stats_t* stats, float value);
+
+float osm_stats_get_variance(const osm_stats_t* stats);
+float osm_stats_get_stddev(const osm_stats_t* stats);
+float osm_stats_get_p50(const osm_stats_t* stats);
+float osm_stats_get_p95(const osm_stats_t* stats);
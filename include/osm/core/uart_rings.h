@@ -18,6 +18,10 @@ void osm_uart_rings_in_drain();
 void osm_uart_rings_out_drain();
 void osm_uart_rings_drain_all_out(void);
 
+#ifdef OSM_UART_DMA_ZERO_COPY
+void osm_uart_ring_out_dma_done(unsigned uart);
+#endif
+
 void osm_uart_rings_check();
 
 void osm_uart_rings_init(void);
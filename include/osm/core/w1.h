@@ -5,8 +5,19 @@
 #include <osm/core/base_types.h>
 
 
+/* On completion of an async transfer. For a reset ok is the presence, for
+ * a read the byte is what was read. Called from the interrupt. */
+typedef void (*osm_w1_cb_t)(uint8_t index, bool ok, uint8_t byte, void* userdata);
+
+
 bool     osm_w1_reset(uint8_t index);
 uint8_t  osm_w1_read_byte(uint8_t index);
 void     osm_w1_send_byte(uint8_t index, uint8_t byte);
+bool     osm_w1_read_bit(uint8_t index);
+void     osm_w1_send_bit(uint8_t index, bool bit);
+bool     osm_w1_reset_async(uint8_t index, osm_w1_cb_t cb, void* userdata);
+bool     osm_w1_send_byte_async(uint8_t index, uint8_t byte, osm_w1_cb_t cb, void* userdata);
+bool     osm_w1_read_byte_async(uint8_t index, osm_w1_cb_t cb, void* userdata);
+bool     osm_w1_busy(void);
 void     osm_w1_init(uint8_t index);
 void     osm_w1_enable(unsigned io, bool enabled);
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <osm/core/config.h>
+
+/* Addressing many devices on one 1-Wire bus. The ROM search enumerates
+ * the 64 bit ROMs on a bus a device at a time, and each measurement is
+ * mapped to the ROM of its device, kept in the persistent config. */
+
+#define OSM_W1_ROM_LEN                  8
+#define OSM_W1_ROM_MAP_MAX              16
+
+#define OSM_W1_CMD_SEARCH_ROM           0xF0
+#define OSM_W1_CMD_MATCH_ROM            0x55
+#define OSM_W1_CMD_SKIP_ROM             0xCC
+
+
+typedef struct
+{
+    uint8_t     rom[OSM_W1_ROM_LEN];
+    int8_t      last_discrepancy;   /* Bit last taken as 0 where devices differ, -1 for none */
+    bool        last_device;
+} osm_w1_search_t;
+
+
+typedef struct
+{
+    char        name[OSM_MEASURE_NAME_LEN] __attribute__((nonstring));
+    uint8_t     rom[OSM_W1_ROM_LEN];
+    uint8_t     w1_index;
+    uint8_t     _[3];
+} __attribute__((__packed__)) osm_w1_rom_map_t;
+
+
+bool osm_w1_crc_check(const uint8_t* mem, unsigned size);
+void osm_w1_search_init(osm_w1_search_t* search);
+bool osm_w1_search_next(uint8_t index, osm_w1_search_t* search);
+void osm_w1_select(uint8_t index, const uint8_t* rom);
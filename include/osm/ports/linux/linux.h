@@ -34,6 +34,7 @@ bool osm_socket_connect(char* path, int* _socketfd);
 
 bool osm_peripherals_add_uart_tty_bridge(char * pty_name, unsigned uart);
 void osm_linux_uart_proc(unsigned uart, char* in, unsigned len);
+void osm_linux_io_watch_proc(unsigned uart, char* in, unsigned len);
 
 unsigned osm_linux_spawn(const char * rel_path);
 
@@ -14,7 +14,9 @@
 
 #include "model_pinmap.h"
 
-#define OSM_I2C_BUSES {{RCC_I2C1, RST_I2C1, I2C1, i2c_speed_sm_100k, 8, GPIO_AF4, {GPIOB, GPIO8|GPIO9} }}
+#define OSM_I2C_BUSES {{RCC_I2C1, RST_I2C1, I2C1, i2c_speed_sm_100k, 8, GPIO_AF4, {GPIOB, GPIO8|GPIO9}, NVIC_I2C1_EV_IRQ, NVIC_I2C1_ER_IRQ }}
+#define osm_i2c_bus_0_ev_isr    i2c1_ev_isr
+#define osm_i2c_bus_0_er_isr    i2c1_er_isr
 
 #define OSM_HTU21D_I2C          I2C1
 #define OSM_HTU21D_I2C_INDEX    0
@@ -59,6 +61,12 @@
 #define OSM_CAN_TIM         TIM3
 #define OSM_CAN_RST_TIM     RST_TIM3
 
+#define OSM_W1_RCC_TIM      RCC_TIM1
+#define OSM_W1_TIM          TIM1
+#define OSM_W1_RST_TIM      RST_TIM1
+#define OSM_W1_TIM_IRQ      NVIC_TIM1_CC_IRQ
+#define osm_w1_tim_isr      tim1_cc_isr
+
 
 #define OSM_SAI_PORT_N_PINS                    \
 {                                          \
@@ -48,6 +48,8 @@ typedef struct
     uint32_t clock_megahz;
     uint32_t gpio_func;
     osm_port_n_pins_t port_n_pins;
+    uint8_t ev_irq;
+    uint8_t er_irq;
 } osm_i2c_def_t;
 
 
@@ -5,14 +5,23 @@
 
 #include <osm/core/base_types.h>
 #include <osm/core/measurements.h>
+#include <osm/core/io_events.h>
 
 void        osm_protocol_system_init(void);
 
 bool        osm_protocol_init(void);
 bool        osm_protocol_append_measurement(osm_measurements_def_t* def, osm_measurements_data_t* data);
 bool        osm_protocol_send(void);
+void        osm_protocol_sent_ack(bool acked);
 void        osm_protocol_send_error_code(uint8_t err_code);
 
+bool        osm_protocol_init_backlog(void);
+unsigned    osm_protocol_get_payload(int8_t** payload);
+bool        osm_protocol_send_backlog(const int8_t* payload, unsigned len, uint32_t age_secs);
+bool        osm_protocol_resume(const int8_t* payload, unsigned len);
+bool        osm_protocol_append_interval(uint32_t offset_secs);
+bool        osm_protocol_append_io_events(const osm_io_event_t* events, unsigned count, uint32_t dropped, uint32_t now_ms);
+
 void        osm_protocol_loop_iteration(void);
 
 bool        osm_protocol_send_ready(void);
@@ -7,6 +7,7 @@
 
 #define OSM_CC_TYPE_A               'A'
 #define OSM_CC_TYPE_V               'V'
+#define OSM_CC_TYPE_U               'U'     /* Voltage transformer, the reference for power */
 
 
 typedef struct
@@ -15,6 +16,8 @@ typedef struct
     uint32_t ext_max_mA;
     uint32_t int_max_mV;
     char     type;
+    uint8_t  phase;     /* Thirds of a cycle behind the voltage reference, for three phase */
+    uint8_t  harmonics; /* Highest harmonic in the THD */
 } osm_cc_config_t;
 
 
@@ -26,6 +29,8 @@ bool                         osm_cc_get_all_blocking(osm_measurements_reading_t*
 bool                         osm_cc_set_active_clamps(osm_adcs_type_t* clamps, unsigned len);
 
 void                         osm_cc_inf_init(osm_measurements_inf_t* inf);
+void                         osm_cc_power_inf_init(osm_measurements_inf_t* inf);
+void                         osm_cc_thd_inf_init(osm_measurements_inf_t* inf);
 
 struct osm_cmd_link_t*           osm_cc_add_commands(struct osm_cmd_link_t* tail);
 
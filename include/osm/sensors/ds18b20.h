@@ -10,3 +10,5 @@ void                         osm_ds18b20_enable(bool enable);
 void                         osm_ds18b20_temp_init(void);
 
 void                         osm_ds18b20_inf_init(osm_measurements_inf_t* inf);
+
+struct osm_cmd_link_t*       osm_ds18b20_add_commands(struct osm_cmd_link_t* tail);
@@ -4,10 +4,16 @@
 
 #include <osm/core/base_types.h>
 #include <osm/core/io.h>
+#include <osm/core/io_events.h>
 
 
 extern const unsigned ios_watch_ios[IOS_WATCH_COUNT];
 
 bool osm_io_watch_enable(unsigned io, bool enabled, osm_io_pupd_t pupd);
 void osm_io_watch_isr(uint32_t exti_group);
+void osm_io_watch_push(unsigned io, bool level);
 void osm_io_watch_init(void);
+void osm_io_watch_iterate(void);
+bool osm_io_watch_append_events(void);
+bool osm_io_watch_events_pending(void);
+const osm_io_events_t* osm_io_watch_get_events(void);
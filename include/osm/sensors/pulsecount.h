@@ -11,6 +11,9 @@ void     osm_pulsecount_init(void);
 void     osm_pulsecount_enable(unsigned io, bool enable, osm_io_pupd_t pupd, osm_io_special_t edge);
 
 void     osm_pulsecount_inf_init(osm_measurements_inf_t* inf);
+void     osm_pulsecount_timing_inf_init(osm_measurements_inf_t* inf);
+
+void     osm_pulsecount_iterate(void);
 
 struct osm_cmd_link_t* osm_pulsecount_add_commands(struct osm_cmd_link_t* tail);
 
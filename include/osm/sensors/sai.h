@@ -12,4 +12,5 @@ bool                         osm_sai_set_coeff(uint8_t index, float coeff);
 void                         osm_sai_print_coeffs(osm_cmd_ctx_t * ctx);
 
 void                                osm_sai_inf_init(osm_measurements_inf_t* inf);
+void                                osm_sai_level_inf_init(osm_measurements_inf_t* inf);
 struct osm_cmd_link_t*           osm_sai_add_commands(struct osm_cmd_link_t* tail);
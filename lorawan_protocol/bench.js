@@ -0,0 +1,259 @@
+// Compares today's (version 2) payloads against the compact version 3
+// for a typical set of measurements, in bytes sent and decode time.
+// Each interval is fragmented at the firmware's payload size just as
+// the firmware does, and every uplink is acked.
+//
+//   node bench.js [intervals]
+
+const protocol = require("./cs_protocol");
+
+var HEX_ARRAY_SIZE = 117;
+var KEYFRAME = 16;
+var DECODE_ROUNDS = 200;
+
+var MEASUREMENTS = [
+    { name: "TEMP", is_float: true,  samples: 5, value: 21.5, step: 0.2  },
+    { name: "HUMI", is_float: true,  samples: 5, value: 45,   step: 1    },
+    { name: "PM10", is_float: true,  samples: 5, value: 12,   step: 2    },
+    { name: "PM25", is_float: true,  samples: 5, value: 8,    step: 1.5  },
+    { name: "CC1",  is_float: true,  samples: 5, value: 2300, step: 50   },
+    { name: "CC2",  is_float: true,  samples: 5, value: 1800, step: 50   },
+    { name: "CC3",  is_float: true,  samples: 5, value: 900,  step: 30   },
+    { name: "BAT",  is_float: true,  samples: 1, value: 3.61, step: 0.01 },
+    { name: "PCNT", is_float: false, samples: 1, value: 0,    step: 20   },
+    { name: "LGHT", is_float: false, samples: 5, value: 400,  step: 40   },
+];
+
+
+var rand_state = 12345;
+function Rand()
+{
+    rand_state = (rand_state * 1103515245 + 12345) % 2147483648;
+    return rand_state / 2147483648;
+}
+
+
+function Readings()
+{
+    var readings = [];
+    for (var i = 0; i < MEASUREMENTS.length; i++)
+    {
+        var m = MEASUREMENTS[i];
+        var scale = m.is_float ? 1000 : 1;
+        m.value += (Rand() - 0.5) * m.step;
+        if (!m.is_float)
+        {
+            m.value = Math.abs(Math.round(m.value));
+        }
+        var mean = Math.round(m.value * scale);
+        var spread = Math.round(Rand() * m.step * scale);
+        readings.push({ m: m, mean: mean, min: mean - spread, max: mean + Math.round(Rand() * m.step * scale) });
+    }
+    return readings;
+}
+
+
+function Push_le(out, val, size)
+{
+    for (var i = 0; i < size; i++)
+    {
+        out.push(Number(BigInt.asUintN(8, BigInt(val) >> BigInt(8 * i))));
+    }
+}
+
+
+function Push_name(out, name)
+{
+    for (var i = 0; i < 4; i++)
+    {
+        out.push(i < name.length ? name.charCodeAt(i) : 0);
+    }
+}
+
+
+// As _protocol_append_data_type_i64() and _protocol_append_data_type_float().
+function V2_value(out, val, is_float)
+{
+    if (is_float)
+    {
+        out.push(0x15);
+        Push_le(out, val, 4);
+        return;
+    }
+    var types = val > 0 ? [[0xFF, 0x01, 1], [0xFFFF, 0x02, 2], [0xFFFFFFFF, 0x03, 4]]
+                        : [[0x7F, 0x11, 1], [0x7FFF, 0x12, 2], [0x7FFFFFFF, 0x13, 4]];
+    for (var i = 0; i < types.length; i++)
+    {
+        if (Math.abs(val) <= types[i][0])
+        {
+            out.push(types[i][1]);
+            Push_le(out, val, types[i][2]);
+            return;
+        }
+    }
+    out.push(val > 0 ? 0x04 : 0x14);
+    Push_le(out, val, 8);
+}
+
+
+function V2_entry(r)
+{
+    var out = [];
+    Push_name(out, r.m.name);
+    var single = r.m.samples == 1;
+    out.push(single ? 1 : 2);
+    V2_value(out, r.mean, r.m.is_float);
+    if (!single)
+    {
+        V2_value(out, r.min, r.m.is_float);
+        V2_value(out, r.max, r.m.is_float);
+    }
+    return { bytes: out };
+}
+
+
+function Push_varint(out, val)
+{
+    val = BigInt(val);
+    do
+    {
+        var b = Number(val & 0x7Fn);
+        val >>= 7n;
+        out.push(val ? b | 0x80 : b);
+    }
+    while (val);
+}
+
+
+function Push_zigzag(out, val)
+{
+    val = BigInt(val);
+    Push_varint(out, BigInt.asUintN(64, (val << 1n) ^ (val >> 63n)));
+}
+
+
+// As _protocol_compact_append_measurement().
+function V3_entry(r, index, slots)
+{
+    var out = [];
+    var slot = slots[index];
+    if (!slot.define_acked)
+    {
+        Push_varint(out, (1 << 4) | 3);
+        Push_varint(out, index);
+        Push_name(out, r.m.name);
+    }
+    var single = r.m.samples == 1;
+    var delta = slot.has_value && (slot.sends % KEYFRAME) != 0;
+    Push_varint(out, (index << 4) | (single ? 0 : 1) | (delta ? 4 : 0) | (r.m.is_float ? 8 : 0));
+    Push_zigzag(out, delta ? r.mean - slot.value : r.mean);
+    if (!single)
+    {
+        Push_zigzag(out, r.mean - r.min);
+        Push_zigzag(out, r.max - r.mean);
+    }
+    return { bytes: out, commit: function() {
+        slot.define_acked = true;
+        slot.value = r.mean;
+        slot.has_value = true;
+        slot.sends++;
+    } };
+}
+
+
+function Encode(readings, header, entry)
+{
+    var payloads = [];
+    var payload = header();
+    for (var i = 0; i < readings.length; i++)
+    {
+        var e = entry(readings[i], i);
+        if (payload.length + e.bytes.length > HEX_ARRAY_SIZE)
+        {
+            payloads.push(payload);
+            payload = header();
+            e = entry(readings[i], i);
+        }
+        payload = payload.concat(e.bytes);
+        // Acked on send, as every uplink is.
+        if (e.commit)
+        {
+            e.commit();
+        }
+    }
+    payloads.push(payload);
+    return payloads;
+}
+
+
+function Check(readings, decoded)
+{
+    var obj = Object.assign.apply(null, [{}].concat(decoded));
+    for (var i = 0; i < readings.length; i++)
+    {
+        var r = readings[i];
+        var scale = r.m.is_float ? 1000 : 1;
+        if (Math.abs(obj[r.m.name] - r.mean / scale) > 0.0011)
+        {
+            throw new Error("Decoded " + r.m.name + " " + obj[r.m.name] + " != " + r.mean / scale);
+        }
+        if (r.m.samples > 1 && Math.abs(obj[r.m.name + "_max"] - r.max / scale) > 0.0011)
+        {
+            throw new Error("Decoded " + r.m.name + "_max " + obj[r.m.name + "_max"] + " != " + r.max / scale);
+        }
+    }
+}
+
+
+function Run(label, intervals, header, entry_fn)
+{
+    rand_state = 12345;
+    MEASUREMENTS.forEach(function(m) { m.start = m.start === undefined ? m.value : m.start; m.value = m.start; });
+
+    var state = { compact_state: {} };
+    var uplinks = [];
+    var entry = entry_fn();
+    var total = 0;
+    for (var n = 0; n < intervals; n++)
+    {
+        var readings = Readings();
+        var payloads = Encode(readings, header, entry);
+        var decoded = payloads.map(function(p) { return protocol.Decode(0, p, state); });
+        Check(readings, decoded);
+        payloads.forEach(function(p) { total += p.length; uplinks.push(p); });
+    }
+
+    var start = process.hrtime.bigint();
+    for (var round = 0; round < DECODE_ROUNDS; round++)
+    {
+        var round_state = { compact_state: {} };
+        for (var i = 0; i < uplinks.length; i++)
+        {
+            protocol.Decode(0, uplinks[i], round_state);
+        }
+    }
+    var ns = Number(process.hrtime.bigint() - start) / (DECODE_ROUNDS * uplinks.length);
+
+    console.log(label.padEnd(12) +
+                String(uplinks.length).padStart(8) +
+                String(total).padStart(10) +
+                (total / intervals).toFixed(1).padStart(14) +
+                (ns / 1000).toFixed(2).padStart(14));
+}
+
+
+var intervals = parseInt(process.argv[2] || "96");
+
+console.log("Format       Uplinks     Bytes  Bytes/interval  Decode us/uplink");
+Run("Version 2", intervals,
+    function() { return [2]; },
+    function() { return V2_entry; });
+
+var seq = 0;
+Run("Version 3", intervals,
+    function() { seq = (seq + 1) % 256; return [3, seq]; },
+    function()
+    {
+        var slots = MEASUREMENTS.map(function() { return { sends: 0 }; });
+        return function(r, i) { return V3_entry(r, i, slots); };
+    });
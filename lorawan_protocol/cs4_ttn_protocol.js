@@ -262,6 +262,18 @@ function decodeUplink(bytes)
               pos += Value_sizes(value_type);
               data[name+"_max"] = max;
               break;
+          }
+              // Multiple measurement with standard deviation, median and 95th percentile
+          else if (data_type == 3)
+          {
+              var suffixes = ["", "_min", "_max", "_sd", "_p50", "_p95"];
+              for (var i = 0; i < suffixes.length; i++)
+              {
+                  value_type = bytes.bytes[pos++];
+                  data[name+suffixes[i]] = Decode_value(value_type, bytes.bytes, pos);
+                  pos += Value_sizes(value_type);
+              }
+              break;
           }
           else
           {
@@ -185,17 +185,305 @@ function Error_lookup(err)
 }
 
 
-function Decode(fPort, bytes, variables)
+// Version 3 (compact) needs state kept between uplinks, the index
+// definitions and the last value of each index. Pass an object as
+// variables.compact_state to hold it, otherwise a module one is used.
+// Backlog records, sequence 0, need none and don't change it.
+var Compact_default_state = {};
+
+
+function Decode_varint(bytes, ctx)
 {
-    var pos = 0;
-    var obj = {};
+    var val = 0;
+    var mul = 1;
+    var b;
+    do
+    {
+        if (ctx.pos >= bytes.length)
+        {
+            return null;
+        }
+        b = bytes[ctx.pos++];
+        val += (b & 0x7F) * mul;
+        mul *= 128;
+    }
+    while (b & 0x80);
+    return val;
+}
 
-    var protocol_version = bytes[pos++];
 
-    if (protocol_version != 1 && protocol_version != 2)
+function Decode_zigzag(bytes, ctx)
+{
+    var val = Decode_varint(bytes, ctx);
+    if (val === null)
+    {
+        return null;
+    }
+    return (val % 2) ? -(val + 1) / 2 : val / 2;
+}
+
+
+function Decode_name(bytes, pos)
+{
+    var name = "";
+    for (var i = 0; i < 4; i++)
+    {
+        if (bytes[pos + i] != 0)
+        {
+            name += String.fromCharCode(bytes[pos + i]);
+        }
+    }
+    name = name.trim();
+    return name.replace(" ", "_");
+}
+
+
+// Batched uplinks hold several intervals, each after the first marked
+// with its offset in seconds. They decode to an INTERVALS list, the
+// first with OFFSET 0, and AGE, of the first, stays at the top.
+function Batch_interval(obj, offset)
+{
+    if (!obj.INTERVALS)
+    {
+        var first = { OFFSET: 0 };
+        for (var key in obj)
+        {
+            if (key != "AGE")
+            {
+                first[key] = obj[key];
+                delete obj[key];
+            }
+        }
+        obj.INTERVALS = [first];
+    }
+    var interval = { OFFSET: offset };
+    obj.INTERVALS.push(interval);
+    return interval;
+}
+
+
+// The age comes last, so each interval's is worked out once decoded.
+function Batch_finish(obj)
+{
+    if (obj.INTERVALS && obj.AGE !== undefined)
+    {
+        for (var i = 0; i < obj.INTERVALS.length; i++)
+        {
+            obj.INTERVALS[i].AGE = obj.AGE - obj.INTERVALS[i].OFFSET;
+        }
+    }
+    return obj;
+}
+
+
+// Edges of the watched IOs as [io, level, ms before the uplink], as the
+// JSON protocol sends them.
+function Io_event(io, level, age_ms)
+{
+    return [io, level, age_ms];
+}
+
+
+function Compact_seq_newer(seq, last)
+{
+    return last === undefined || ((seq - last + 256) % 256) < 128;
+}
+
+
+function Decode_compact(bytes, state)
+{
+    var obj = {};
+    var ctx = { pos: 1 };
+
+    if (bytes.length < 2)
     {
         return obj;
     }
+    var seq = bytes[ctx.pos++];
+    // Backlog records define all they use, so decode alone and leave
+    // the live state as it was.
+    if (seq == 0)
+    {
+        state = {};
+    }
+    // Mean and scale of each index in this uplink, for its stats.
+    var means = {};
+    // Where values go, moved on by each interval of a batch.
+    var out = obj;
+
+    if (!state.names)
+    {
+        state.names = {};
+        state.values = {};
+        state.seqs = {};
+    }
+
+    while (ctx.pos < bytes.length)
+    {
+        var header = Decode_varint(bytes, ctx);
+        if (header === null)
+        {
+            return obj;
+        }
+        var index = Math.floor(header / 16);
+        var form = header & 0x3;
+        var is_delta = header & 0x4;
+        var scale = (header & 0x8) ? 1000 : 1;
+
+        // System entries
+        if (form == 3)
+        {
+            if (index == 0)
+            {
+                var age = Decode_varint(bytes, ctx);
+                if (age === null)
+                {
+                    return obj;
+                }
+                obj["AGE"] = age;
+            }
+            else if (index == 1)
+            {
+                var def_index = Decode_varint(bytes, ctx);
+                if (def_index === null || ctx.pos + 4 > bytes.length)
+                {
+                    return obj;
+                }
+                var def_name = Decode_name(bytes, ctx.pos);
+                ctx.pos += 4;
+                if (state.names[def_index] != def_name)
+                {
+                    delete state.values[def_index];
+                    delete state.seqs[def_index];
+                }
+                state.names[def_index] = def_name;
+            }
+            else if (index == 2)
+            {
+                var stats_index = Decode_varint(bytes, ctx);
+                var sd = Decode_zigzag(bytes, ctx);
+                var p50 = Decode_zigzag(bytes, ctx);
+                var p95 = Decode_zigzag(bytes, ctx);
+                var of = means[stats_index];
+                if (p95 === null || of === undefined)
+                {
+                    return obj;
+                }
+                var stats_name = state.names[stats_index];
+                if (stats_name === undefined)
+                {
+                    stats_name = "IDX" + stats_index;
+                }
+                out[stats_name+"_sd"] = sd / of.scale;
+                out[stats_name+"_p50"] = (of.mean === null) ? null : (of.mean + p50) / of.scale;
+                out[stats_name+"_p95"] = (of.mean === null) ? null : (of.mean + p95) / of.scale;
+            }
+            else if (index == 3)
+            {
+                var offset = Decode_varint(bytes, ctx);
+                if (offset === null)
+                {
+                    return obj;
+                }
+                out = Batch_interval(obj, offset);
+            }
+            else if (index == 4)
+            {
+                var count = Decode_varint(bytes, ctx);
+                var dropped = Decode_varint(bytes, ctx);
+                var age_ms = Decode_varint(bytes, ctx);
+                if (age_ms === null)
+                {
+                    return obj;
+                }
+                var edges = [];
+                for (var i = 0; i < count; i++)
+                {
+                    var io = Decode_varint(bytes, ctx);
+                    var edge = Decode_varint(bytes, ctx);
+                    if (edge === null)
+                    {
+                        return obj;
+                    }
+                    age_ms -= Math.floor(edge / 2);
+                    edges.push(Io_event(io, edge & 1, age_ms));
+                }
+                out["IOEV"] = edges;
+                out["IOEV_drop"] = dropped;
+            }
+            else
+            {
+                return obj;
+            }
+            continue;
+        }
+
+        var name = state.names[index];
+        if (name === undefined)
+        {
+            name = "IDX" + index;
+        }
+
+        if (form == 2)
+        {
+            if (ctx.pos >= bytes.length)
+            {
+                return obj;
+            }
+            var len = bytes[ctx.pos++];
+            if (ctx.pos + len > bytes.length)
+            {
+                return obj;
+            }
+            var str = "";
+            for (var i = 0; i < len; i++)
+            {
+                str += String.fromCharCode(bytes[ctx.pos++]);
+            }
+            out[name] = str;
+            continue;
+        }
+
+        var mean = Decode_zigzag(bytes, ctx);
+        if (mean === null)
+        {
+            return obj;
+        }
+        if (is_delta)
+        {
+            var base = state.values[index];
+            mean = (base === undefined) ? null : mean + base;
+        }
+        if (mean !== null && Compact_seq_newer(seq, state.seqs[index]))
+        {
+            state.values[index] = mean;
+            state.seqs[index] = seq;
+        }
+        out[name] = (mean === null) ? null : mean / scale;
+        means[index] = { mean: mean, scale: scale };
+
+        if (form == 1)
+        {
+            var below = Decode_zigzag(bytes, ctx);
+            var above = Decode_zigzag(bytes, ctx);
+            if (below === null || above === null)
+            {
+                return obj;
+            }
+            out[name+"_min"] = (mean === null) ? null : (mean - below) / scale;
+            out[name+"_max"] = (mean === null) ? null : (mean + above) / scale;
+        }
+    }
+    return obj;
+}
+
+
+function Decode_v2(bytes)
+{
+    var pos = 1;
+    var obj = {};
+    // Where values go, moved on by each interval of a batch.
+    var out = obj;
 
     var name;
     while(pos < bytes.length)
@@ -229,7 +517,12 @@ function Decode(fPort, bytes, variables)
                 pos += next_size;
                 if (name == "ERR")
                     mean = Error_lookup(mean);
-                obj[name] = mean;
+                if (name == "IOFF")
+                {
+                    out = Batch_interval(obj, mean);
+                    break;
+                }
+                (name == "AGE" ? obj : out)[name] = mean;
                 break;
             // Multiple measurement
             case 2:
@@ -241,7 +534,7 @@ function Decode(fPort, bytes, variables)
                 }
                 mean = Decode_value(value_type, bytes, pos);
                 pos += next_size;
-                obj[name] = mean;
+                out[name] = mean;
 
                 value_type = bytes[pos++];
                 next_size = Value_sizes(value_type);
@@ -251,7 +544,7 @@ function Decode(fPort, bytes, variables)
                 }
                 min = Decode_value(value_type, bytes, pos);
                 pos += next_size;
-                obj[name+"_min"] = min;
+                out[name+"_min"] = min;
 
                 value_type = bytes[pos++];
                 next_size = Value_sizes(value_type);
@@ -261,7 +554,48 @@ function Decode(fPort, bytes, variables)
                 }
                 max = Decode_value(value_type, bytes, pos);
                 pos += next_size;
-                obj[name+"_max"] = max;
+                out[name+"_max"] = max;
+                break;
+            // Multiple measurement with standard deviation, median and 95th percentile
+            case 3:
+                var suffixes = ["", "_min", "_max", "_sd", "_p50", "_p95"];
+                for (var i = 0; i < suffixes.length; i++)
+                {
+                    value_type = bytes[pos++];
+                    next_size = Value_sizes(value_type);
+                    if (next_size + pos > bytes.length)
+                    {
+                        return obj;
+                    }
+                    out[name+suffixes[i]] = Decode_value(value_type, bytes, pos);
+                    pos += next_size;
+                }
+                break;
+            // IO edges, each the IO then its level and milliseconds since the last
+            case 4:
+                if (pos + 7 > bytes.length)
+                {
+                    return obj;
+                }
+                var count = Decode_u8(bytes, pos);
+                var dropped = Decode_u16(bytes, pos + 1);
+                var age_ms = Decode_u32(bytes, pos + 3) >>> 0;
+                pos += 7;
+                if (pos + count * 3 > bytes.length)
+                {
+                    return obj;
+                }
+                var edges = [];
+                for (var i = 0; i < count; i++)
+                {
+                    var io = Decode_u8(bytes, pos);
+                    var edge = Decode_u16(bytes, pos + 1);
+                    pos += 3;
+                    age_ms -= edge & 0x7FFF;
+                    edges.push(Io_event(io, edge >> 15, age_ms));
+                }
+                out[name] = edges;
+                out[name+"_drop"] = dropped;
                 break;
             default:
                 return obj;
@@ -270,6 +604,23 @@ function Decode(fPort, bytes, variables)
     return obj;
 }
 
+function Decode(fPort, bytes, variables)
+{
+    var protocol_version = bytes[0];
+
+    if (protocol_version == 3)
+    {
+        var state = (variables && variables.compact_state) ? variables.compact_state : Compact_default_state;
+        return Batch_finish(Decode_compact(bytes, state));
+    }
+
+    if (protocol_version != 1 && protocol_version != 2)
+    {
+        return {};
+    }
+    return Batch_finish(Decode_v2(bytes));
+}
+
 // Encode encodes the given object into an array of bytes.
 //  - fPort contains the LoRaWAN fPort number
 //  - obj is an object, e.g. {"temperature": 22.5}
@@ -7,5 +7,18 @@ function str_to_byte_arr(string_in)
     return byte_arr.toJSON().data;
 }
 
-var bytes = str_to_byte_arr(process.argv[2]);
-console.log(protocol.Decode(0, bytes, 0));
+if (process.argv.length > 3)
+{
+    // Several uplinks in order, compact payloads decode against the earlier ones.
+    var objs = [];
+    for (var i = 2; i < process.argv.length; i++)
+    {
+        objs.push(protocol.Decode(0, str_to_byte_arr(process.argv[i]), 0));
+    }
+    console.log(JSON.stringify(objs));
+}
+else
+{
+    var bytes = str_to_byte_arr(process.argv[2]);
+    console.log(protocol.Decode(0, bytes, 0));
+}
@@ -221,6 +221,16 @@ function Decoder(bytes, fPort, variables)
                 pos += Value_sizes(value_type);
                 obj[name+"_max"] = max;
                 break;
+            // Multiple measurement with standard deviation, median and 95th percentile
+            case 3:
+                var suffixes = ["", "_min", "_max", "_sd", "_p50", "_p95"];
+                for (var i = 0; i < suffixes.length; i++)
+                {
+                    value_type = bytes[pos++];
+                    obj[name+suffixes[i]] = Decode_value(value_type, bytes, pos);
+                    pos += Value_sizes(value_type);
+                }
+                break;
             default:
                 return obj;
         }
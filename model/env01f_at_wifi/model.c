@@ -148,10 +148,14 @@ bool osm_model_measurements_get_inf(osm_measurements_def_t * def, osm_measuremen
         case OSM_CONFIG_REVISION: osm_persist_config_inf_init(inf);  break;
         case OSM_MODBUS:        osm_modbus_inf_init(inf);      break;
         case OSM_CURRENT_CLAMP: osm_cc_inf_init(inf);          break;
+        case OSM_CC_POWER:      osm_cc_power_inf_init(inf);    break;
+        case OSM_CC_THD:        osm_cc_thd_inf_init(inf);      break;
         case OSM_W1_PROBE:      osm_ds18b20_inf_init(inf);     break;
         case OSM_PULSE_COUNT:   osm_pulsecount_inf_init(inf);  break;
         case OSM_LIGHT:         osm_veml7700_inf_init(inf);    break;
         case OSM_SOUND:         osm_sai_inf_init(inf);         break;
+        case OSM_SOUND_LEVEL:   osm_sai_level_inf_init(inf);   break;
+        case OSM_PULSE_TIMING:  osm_pulsecount_timing_inf_init(inf); break;
         case OSM_IO_READING:    osm_ios_inf_init(inf);         break;
         case OSM_SENxx:         osm_senxx_inf_init(inf);       break;
         case OSM_EXAMPLE_RS232:         osm_example_rs232_inf_init(inf);       break;
@@ -184,11 +188,15 @@ void osm_model_measurements_repopulate(void)
     osm_measurements_repop_indiv(OSM_MEASUREMENTS_CURRENT_CLAMP_1_NAME, 0,  1,  OSM_CURRENT_CLAMP   );
     osm_measurements_repop_indiv(OSM_MEASUREMENTS_CURRENT_CLAMP_2_NAME, 0,  1,  OSM_CURRENT_CLAMP   );
     osm_measurements_repop_indiv(OSM_MEASUREMENTS_CURRENT_CLAMP_3_NAME, 0,  1,  OSM_CURRENT_CLAMP   );
+    osm_measurements_repop_group(OSM_MEASUREMENTS_GROUP_CC_POWER);
+    osm_measurements_repop_group(OSM_MEASUREMENTS_GROUP_CC_THD);
     osm_measurements_repop_indiv(OSM_MEASUREMENTS_W1_PROBE_NAME_1,      0,  1,  OSM_W1_PROBE        );
     osm_measurements_repop_indiv(OSM_MEASUREMENTS_PULSE_COUNT_NAME_1,   0,  1,  OSM_PULSE_COUNT     );
     osm_measurements_repop_indiv(OSM_MEASUREMENTS_PULSE_COUNT_NAME_2,   0,  1,  OSM_PULSE_COUNT     );
+    osm_measurements_repop_group(OSM_MEASUREMENTS_GROUP_PULSE_TIMING);
     osm_measurements_repop_indiv(OSM_MEASUREMENTS_LIGHT_NAME,           1,  1,  OSM_LIGHT           );
     osm_measurements_repop_indiv(OSM_MEASUREMENTS_SOUND_NAME,           1,  1,  OSM_SOUND           );
+    osm_measurements_repop_group(OSM_MEASUREMENTS_GROUP_SOUND_LEVEL);
     osm_measurements_repop_indiv(OSM_MEASUREMENTS_EXAMPLE_RS232_NAME,   0,  1,  OSM_EXAMPLE_RS232   );
 }
 
@@ -196,6 +204,7 @@ void osm_model_measurements_repopulate(void)
 void osm_model_cmds_add_all(struct osm_cmd_link_t* tail)
 {
     tail = osm_cc_add_commands(tail);
+    tail = osm_ds18b20_add_commands(tail);
     tail = osm_can_impl_add_commands(tail);
     tail = osm_sai_add_commands(tail);
     tail = osm_persist_config_add_commands(tail);
@@ -257,11 +266,15 @@ unsigned osm_model_measurements_add_defaults(osm_measurements_def_t * measuremen
     osm_measurements_setup_default(&measurements_arr[pos++], OSM_MEASUREMENTS_CURRENT_CLAMP_1_NAME, 0,  1, OSM_CURRENT_CLAMP   );
     osm_measurements_setup_default(&measurements_arr[pos++], OSM_MEASUREMENTS_CURRENT_CLAMP_2_NAME, 0,  1, OSM_CURRENT_CLAMP   );
     osm_measurements_setup_default(&measurements_arr[pos++], OSM_MEASUREMENTS_CURRENT_CLAMP_3_NAME, 0,  1, OSM_CURRENT_CLAMP   );
+    pos += osm_measurements_setup_group_defaults(&measurements_arr[pos], OSM_MEASUREMENTS_GROUP_CC_POWER);
+    pos += osm_measurements_setup_group_defaults(&measurements_arr[pos], OSM_MEASUREMENTS_GROUP_CC_THD);
     osm_measurements_setup_default(&measurements_arr[pos++], OSM_MEASUREMENTS_W1_PROBE_NAME_1,      0,  1, OSM_W1_PROBE        );
     osm_measurements_setup_default(&measurements_arr[pos++], OSM_MEASUREMENTS_PULSE_COUNT_NAME_1,   0,  1, OSM_PULSE_COUNT     );
     osm_measurements_setup_default(&measurements_arr[pos++], OSM_MEASUREMENTS_PULSE_COUNT_NAME_2,   0,  1, OSM_PULSE_COUNT     );
+    pos += osm_measurements_setup_group_defaults(&measurements_arr[pos], OSM_MEASUREMENTS_GROUP_PULSE_TIMING);
     osm_measurements_setup_default(&measurements_arr[pos++], OSM_MEASUREMENTS_LIGHT_NAME,           1,  1, OSM_LIGHT           );
     osm_measurements_setup_default(&measurements_arr[pos++], OSM_MEASUREMENTS_SOUND_NAME,           1,  1, OSM_SOUND           );
+    pos += osm_measurements_setup_group_defaults(&measurements_arr[pos], OSM_MEASUREMENTS_GROUP_SOUND_LEVEL);
     osm_measurements_setup_default(&measurements_arr[pos++], OSM_MEASUREMENTS_EXAMPLE_RS232_NAME,   0,  1, OSM_EXAMPLE_RS232   );
     osm_ios_measurements_init();
     return pos;
@@ -272,6 +285,8 @@ void osm_model_main_loop_iterate(void)
 {
     osm_comms_direct_loop_iterate();
     osm_senxx_iterate();
+    osm_pulsecount_iterate();
+    osm_io_watch_iterate();
 }
 
 
@@ -16,6 +16,8 @@
 #define FLASH_MEASUREMENTS_PAGE     3
 #define FW_PAGE                     4
 #define NEW_FW_PAGE                 120
+#define FLASH_BACKLOG_PAGE          104
+#define FLASH_BACKLOG_PAGES         16
 
 #define FW_PAGES                    100
 #define FW_MAX_SIZE                 (FW_PAGES * FLASH_PAGE_SIZE)
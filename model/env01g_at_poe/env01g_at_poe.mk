@@ -9,12 +9,25 @@ env01g_at_poe_SOURCES := \
     $(OSM_DIR)/src/core/io.c \
     $(OSM_DIR)/src/core/ring.c \
     $(OSM_DIR)/src/core/modbus_mem.c \
+    $(OSM_DIR)/src/core/modbus_crc.c \
     $(OSM_DIR)/src/core/persist_base.c \
     $(OSM_DIR)/src/core/modbus.c \
     $(OSM_DIR)/src/core/measurements.c \
+    $(OSM_DIR)/src/core/backlog.c \
+    $(OSM_DIR)/src/core/deadband.c \
+    $(OSM_DIR)/src/core/stats.c \
     $(OSM_DIR)/src/core/measurements_mem.c \
     $(OSM_DIR)/src/core/modbus_measurements.c \
     $(OSM_DIR)/src/core/adcs.c \
+    $(OSM_DIR)/src/core/adcs_rms.c \
+    $(OSM_DIR)/src/core/adcs_harmonics.c \
+    $(OSM_DIR)/src/core/sai_bands.c \
+    $(OSM_DIR)/src/core/pulse_timing.c \
+    $(OSM_DIR)/src/core/io_events.c \
+    $(OSM_DIR)/src/core/io_watch.c \
+    $(OSM_DIR)/src/core/sched.c \
+    $(OSM_DIR)/src/core/w1_rom.c \
+    $(OSM_DIR)/src/core/i2c_queue.c \
     $(OSM_DIR)/src/core/common.c \
     $(OSM_DIR)/src/core/platform_common.c \
     $(OSM_DIR)/src/ports/stm/persist_config.c \
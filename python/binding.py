@@ -643,12 +643,44 @@ class dev_t(dev_base_t):
 
     def set_cc_type(self, phase, ctype):
         phases = [1,2,3]
-        units = ['A', 'V']
+        units = ['A', 'V', 'U']
         if phase not in phases or ctype not in units:
             debug_print('Invalid arguments supplied.')
             return
         return self.do_cmd(f"cc_type {phase} {ctype}")
 
+    def set_cc_phase(self, phase, third):
+        return self.do_cmd(f"cc_phase {phase} {third}")
+
+    def cc_power(self) -> dict | None:
+        r = self.do_cmd_multi("cc_power", timeout=3)
+        if not r:
+            return None
+        power = {}
+        for line in r:
+            m = re.match(r"(Real|Apparent|PF|Energy) = (-?[\d\.]+)", str(line))
+            if m:
+                power[m.group(1)] = float(m.group(2))
+        return power if len(power) == 4 else None
+
+    def cc_harmonics(self, phase, highest=None) -> tuple | None:
+        cmd = f"cc_harm {phase}" if highest is None else f"cc_harm {phase} {highest}"
+        r = self.do_cmd_multi(cmd, timeout=3)
+        if not r:
+            return None
+        harmonics = []
+        thd = None
+        for line in r:
+            m = re.match(r"H\d+ = (\d+)m", str(line))
+            if m:
+                harmonics.append(float(m.group(1)) / 1000)
+            m = re.match(r"THD = ([\d\.]+)%", str(line))
+            if m:
+                thd = float(m.group(1))
+        if thd is None:
+            return None
+        return harmonics, thd
+
     def save(self):
         return self.do_cmd("save")
 
@@ -46,6 +46,7 @@ class test_framework_t(object):
     JSON_MEMORY_PATH        = DEFAULT_OSM_BASE + "osm.json"
 
     INTERVAL_MINS           = 0.083
+    BACKLOG_INTERVALS       = 3
 
     DEFAULT_COMMS_MATCH_DICT = {
           "PM10"    : 30,
@@ -272,6 +273,81 @@ class test_framework_t(object):
             passed &= self._threshold_check(cc_name, f"{cc_name} Midpoint value is valid", mp, 2048.0, 0.)
         return passed
 
+    def _check_cc_power(self):
+        # CC1 as the voltage reference, CC2 lagging it and CC3 lagging the next phase.
+        v_amp, i_amp, lag = 1000., 200., math.pi / 6
+        adcs_config = {
+            "CC1": {"type": "AC", "amplitude": v_amp, "phase": 0.},
+            "CC2": {"type": "AC", "amplitude": i_amp, "phase": -lag},
+            "CC3": {"type": "AC", "amplitude": i_amp, "phase": -2 * math.pi / 3 - lag},
+        }
+        with open(self.DEFAULT_OSM_BASE + "adcs_config.json", "w") as f:
+            json.dump(adcs_config, f)
+        cc_g = self._vosm_conn.print_cc_gain
+        types_ = [cc_g[p * 2 + 1][-1] for p in range(3)]
+        self._vosm_conn.set_cc_type(1, 'U')
+        self._vosm_conn.set_cc_phase(3, 1)
+        power = self._vosm_conn.cc_power()
+        self._vosm_conn.set_cc_phase(3, 0)
+        self._vosm_conn.set_cc_type(1, types_[0])
+        if power is None:
+            return self._bool_check("CC power read", False, True)
+        # Gains are 100 exterior to 50 interior, the current through 22 ohm for type A.
+        per_count = 3300 / 4095 * 100 / 0.05
+        v_rms = v_amp * per_count / math.sqrt(2)
+        expected = 0
+        for t in types_[1:]:
+            i_rms = i_amp * per_count / math.sqrt(2) / (22 if t == 'A' else 1)
+            expected += v_rms * i_rms * math.cos(lag) / 1e6
+        passed = self._threshold_check("CC_POWER", "CC real power", power["Real"], expected, expected * 0.05)
+        passed &= self._threshold_check("CC_PFAC", "CC power factor", power["PF"], math.cos(lag), 0.05)
+        return passed
+
+    def _check_cc_thd(self):
+        distortion = [0.05, 0.2, 0., 0.1]
+        adcs_config = {
+            "CC2": {"type": "AC", "amplitude": 500., "phase": 0., "harmonics": distortion},
+        }
+        with open(self.DEFAULT_OSM_BASE + "adcs_config.json", "w") as f:
+            json.dump(adcs_config, f)
+        r = self._vosm_conn.cc_harmonics(2, 9)
+        if r is None:
+            return self._bool_check("CC harmonics read", False, True)
+        harmonics, thd = r
+        expected = math.sqrt(sum(d * d for d in distortion)) * 100
+        passed = self._threshold_check("CC_HARM", "CC2 harmonics found", len(harmonics), 9, 0)
+        passed &= self._threshold_check("CC_THD", "CC2 THD %", thd, expected, 0.5)
+        return passed
+
+    def _check_sound_levels(self):
+        # 125Hz alone, A weighting takes 16.1dB off it.
+        sai_config = {"tones": [{"hz": 125., "db": 80.}], "noise_db": 20.}
+        with open(self.DEFAULT_OSM_BASE + "sai_config.json", "w") as f:
+            json.dump(sai_config, f)
+        band = self._vosm_conn.O125.value
+        laeq = self._vosm_conn.LAEQ.value
+        other = self._vosm_conn.O1K.value
+        if band is False or laeq is False or other is False:
+            return self._bool_check("Sound levels read", False, True)
+        passed = self._threshold_check("O125", "125Hz octave band", band, 80., 1.)
+        passed &= self._threshold_check("LAEQ", "A weighted Leq", laeq, 63.9, 1.)
+        passed &= self._bool_check("1kHz octave band well down", other < band - 20, True)
+        return passed
+
+    def _check_pulse_timing(self):
+        # Edges each up to 2ms off, the intervals between them 1.6ms.
+        pulse_config = {"CNT1": {"hz": 20., "jitter_ms": 2.}}
+        with open(self.DEFAULT_OSM_BASE + "pulsecount_config.json", "w") as f:
+            json.dump(pulse_config, f)
+        self._vosm_conn.enable_pulsecount(0)
+        rate = self._vosm_conn.FRQ1.value
+        jitter = self._vosm_conn.PJT1.value
+        if rate is False or jitter is False:
+            return self._bool_check("Pulse timing read", False, True)
+        passed = self._threshold_check("FRQ1", "Pulse rate", rate, 20., 1.)
+        passed &= self._threshold_check("PJT1", "Pulse jitter", jitter, 1.6, 0.8)
+        return passed
+
     def test(self):
         self._logger.info("Starting Virtual OSM Test...")
 
@@ -360,6 +436,7 @@ class test_framework_t(object):
 
         if isinstance(self._vosm_conn.comms, lw_comms_t):
             passed &= self._check_lw_serial_comms()
+            passed &= self._check_lw_backlog()
         elif isinstance(self._vosm_conn.comms, wifi_comms_t):
             passed &= self._check_wifi_serial_comms()
         else:
@@ -368,6 +445,10 @@ class test_framework_t(object):
 
         passed &= self._check_json_config_tool()
         self._vosm_conn.measurements_enable(False)
+        passed &= self._check_cc_power()
+        passed &= self._check_cc_thd()
+        passed &= self._check_sound_levels()
+        passed &= self._check_pulse_timing()
         if self.do_ota:
             if isinstance(self._vosm_conn.comms, lw_comms_t):
                 # TODO: If LW comms, LW OTA update
@@ -532,6 +613,49 @@ class test_framework_t(object):
         self._logger.info("Measurement loop test complete.")
         return ret
 
+    def _read_comms_dicts(self, comms_conn, duration):
+        fds = [comms_conn, self._vosm_conn]
+        now = time.time()
+        end_time = now + duration
+        dicts = []
+        while now < end_time:
+            r = select.select(fds, [], [], end_time-now)
+            if len(r[0]):
+                if self._vosm_conn in r[0]:
+                    self._vosm_conn._ll.read()
+                if comms_conn in r[0]:
+                    resp_dict = comms_conn.read_dict()
+                    if resp_dict:
+                        dicts.append(resp_dict)
+            now = time.time()
+        return dicts
+
+    def _check_lw_backlog(self):
+        comms_conn = comms.comms_dev_t(self.DEFAULT_COMMS_PTY_PATH,
+                                       self.DEFAULT_PROTOCOL_PATH,
+                                       logger=self._logger,
+                                       log_file=self._log_file)
+        interval_s = self._vosm_conn.interval_mins * 60
+        self._vosm_conn.do_cmd("comms_link 0")
+        # Anything sent before the link went down.
+        self._read_comms_dicts(comms_conn, 0.5)
+        down = self._read_comms_dicts(comms_conn, interval_s * self.BACKLOG_INTERVALS)
+        self._vosm_conn.do_cmd("comms_link 1")
+        up = self._read_comms_dicts(comms_conn, interval_s + 3)
+        self._logger.debug(f"{up = }")
+
+        # Backlog records carry their age in seconds, live sends don't.
+        ages = [d["AGE"] for d in up if "AGE" in d]
+        steps = [older - newer for older, newer in zip(ages, ages[1:])]
+        ret = self._bool_check("Nothing sent with link down", len(down) == 0, True)
+        ret &= self._bool_check("Backlog sent on link up", len(ages) >= self.BACKLOG_INTERVALS - 1, True)
+        ret &= self._bool_check("Backlog before live", bool(up) and "AGE" in up[0], True)
+        ret &= self._bool_check("Backlog oldest first", all(step > 0 for step in steps), True)
+        ret &= self._bool_check("Backlog an interval apart", all(abs(step - interval_s) <= 1.5 for step in steps), True)
+        ret &= self._bool_check("Backlog holds readings", all("PM10" in d for d in up if "AGE" in d), True)
+        self._logger.info("Backlog test complete.")
+        return ret
+
     def _check_wifi_serial_comms(self):
         if int(paho.__version__.split(".")[0]) > 1:
             mqtt_conn = mqtt.Client(mqtt.CallbackAPIVersion.VERSION2)
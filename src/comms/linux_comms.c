@@ -24,6 +24,9 @@
 #define LINUX_COMMS_PRINT_CFG_JSON_TAIL                         "  }\n\r}"
 
 
+static bool _linux_comms_link_up = true;
+
+
 uint16_t osm_linux_comms_get_mtu(void)
 {
     return OSM_COMMS_DEFAULT_MTU;
@@ -100,7 +103,7 @@ void osm_linux_comms_process(char* message)
 
 bool osm_linux_comms_get_connected(void)
 {
-    return true;
+    return _linux_comms_link_up;
 }
 
 
@@ -179,12 +182,23 @@ static osm_command_response_t _linux_comms_dbg_cb(char* args, osm_cmd_ctx_t * ct
 }
 
 
+static osm_command_response_t _linux_comms_link_cb(char* args, osm_cmd_ctx_t * ctx)
+{
+    char* pos = osm_skip_space(args);
+    if (pos[0] == '0' || pos[0] == '1')
+        _linux_comms_link_up = pos[0] == '1';
+    osm_cmd_ctx_out(ctx,"Link: %s", _linux_comms_link_up ? "up" : "down");
+    return OSM_COMMAND_RESP_OK;
+}
+
+
 struct osm_cmd_link_t* osm_linux_comms_add_commands(struct osm_cmd_link_t* tail)
 {
     static struct osm_cmd_link_t cmds[] =
     {
         { "osm_comms_send"  ,  "Send linux_comms message"   , _linux_comms_send_cb          , false , NULL },
-        { "comms_dbg"   , "Comms Chip Debug"            , _linux_comms_dbg_cb           , false , NULL }
+        { "comms_dbg"   , "Comms Chip Debug"            , _linux_comms_dbg_cb           , false , NULL },
+        { "comms_link"  , "Set fake link up/down"       , _linux_comms_link_cb          , false , NULL }
     };
     return osm_add_commands(tail, cmds, OSM_ARRAY_SIZE(cmds));
 }
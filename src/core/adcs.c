@@ -1,14 +1,19 @@
 #include <inttypes.h>
 #include <math.h>
 #include <stddef.h>
+#include <string.h>
 
 #include <osm/core/adcs.h>
+#include <osm/core/adcs_harmonics.h>
+#include <osm/core/adcs_rms.h>
 
 #include <osm/core/common.h>
 #include <osm/core/config.h>
 #include <osm/core/log.h>
 #include <osm/core/platform.h>
 
+#include "pinmap.h"
+
 /* 640.5 + 12.5 cycles of (80Mhz / 64) clock
  * (640.5 + 12.5) * (1000000 / (80000000 / 64)) = 522.4 microseconds
  *
@@ -19,7 +24,7 @@
  */
 
 
-typedef uint16_t adcs_all_buf_t[OSM_ADCS_NUM_SAMPLES];
+typedef uint16_t adcs_all_buf_t[OSM_ADCS_DMA_SAMPLES];
 
 #define ADCS_MON_DEFAULT_COLLECTION_TIME    100;
 
@@ -31,6 +36,23 @@ static volatile uint32_t    _adcs_end_time      = 0;
 
 static osm_adc_setup_config_t _adcs_config = {.mem_addr = (uintptr_t)_adcs_buffer};
 
+#ifdef __ADC_CONTINUOUS__
+/* DMA runs circular over two halves, each folded into the sums of its
+ * channels from the interrupt as it fills, while the other half fills. */
+static osm_adcs_rms_acc_t   _adcs_accs[ADC_COUNT];
+static unsigned             _adcs_num_channels  = 0;
+static unsigned             _adcs_half_len      = 0;
+static volatile unsigned    _adcs_remaining     = 0;
+static osm_adcs_rms_power_acc_t _adcs_power_accs[ADC_COUNT];
+static unsigned             _adcs_power_ref     = ADC_COUNT;    /* ADC_COUNT for none */
+static osm_adcs_harmonics_t _adcs_harmonics[ADC_CC_COUNT];
+static unsigned             _adcs_harmonics_channels = 0;
+
+#if !defined(__ADC_RMS_FULL__) || defined(__ADC_RMS_DOUBLE__)
+#error "Continuous ADC only has the fixed point true RMS."
+#endif
+#endif //__ADC_CONTINUOUS__
+
 
 bool osm_adcs_to_mV(uint32_t value, uint32_t* mV)
 {
@@ -54,23 +76,24 @@ bool osm_adcs_to_mV(uint32_t value, uint32_t* mV)
 
 /* As the ADC RMS function calculates the RMS of potentially multiple ADCs in a single 
  * buffer, the step and start index are required to find the correct RMS.*/
-#ifdef __ADC_RMS_FULL__
+#if defined(__ADC_CONTINUOUS__)
 static bool _adcs_get_rms(const adcs_all_buf_t buff, unsigned buff_len, uint32_t* adc_rms, uint8_t start_index, uint8_t step, uint32_t midpoint)
 {
-    double inter_val = 0;
-    int32_t mp_small = midpoint / 1000;
-    for (unsigned i = start_index; i < buff_len; i+=step)
-    {
-        int64_t v = buff[i] - mp_small;
-        inter_val += v * v;
-    }
-    osm_adc_debug("inter_val = %.03lf", inter_val/1000.f);
-    inter_val /= (buff_len / step);
-    inter_val = sqrt(inter_val);
-    inter_val *= 1000;
-    inter_val = midpoint - inter_val;
-    osm_adc_debug("inter_val = %.03lf", inter_val/1000.f);
-    *adc_rms = inter_val;
+    if (!osm_adcs_rms_acc_get_rms(&_adcs_accs[start_index], midpoint, adc_rms))
+        return false;
+    osm_adc_debug("RMS = %"PRIu32".%03"PRIu32, *adc_rms/1000, *adc_rms%1000);
+    return true;
+}
+#elif defined(__ADC_RMS_FULL__)
+/* Fixed point unless __ADC_RMS_DOUBLE__, which is kept to compare. */
+static bool _adcs_get_rms(const adcs_all_buf_t buff, unsigned buff_len, uint32_t* adc_rms, uint8_t start_index, uint8_t step, uint32_t midpoint)
+{
+#ifdef __ADC_RMS_DOUBLE__
+    if (!osm_adcs_rms_double(buff, buff_len, start_index, step, midpoint, adc_rms))
+#else
+    if (!osm_adcs_rms_fixed(buff, buff_len, start_index, step, midpoint, adc_rms))
+#endif
+        return false;
     osm_adc_debug("RMS = %"PRIu32".%03"PRIu32, *adc_rms/1000, *adc_rms%1000);
     return true;
 }
@@ -127,6 +150,12 @@ static bool _adcs_get_rms(const adcs_all_buf_t buff, unsigned buff_len, uint32_t
 
 static bool _adcs_get_avg(const adcs_all_buf_t buff, unsigned buff_len, uint32_t* adc_avg, uint8_t start_index, uint8_t step)
 {
+#ifdef __ADC_CONTINUOUS__
+    if (!osm_adcs_rms_acc_get_avg(&_adcs_accs[start_index], adc_avg))
+        return false;
+    osm_adc_debug("AVG = %"PRIu32".%03"PRIu32, *adc_avg/1000, *adc_avg%1000);
+    return true;
+#else
     uint64_t sum = 0;
     for (unsigned i = start_index; i < buff_len; i+=step)
     {
@@ -137,6 +166,47 @@ static bool _adcs_get_avg(const adcs_all_buf_t buff, unsigned buff_len, uint32_t
     *adc_avg = sum / buff_len;
     osm_adc_debug("AVG = %"PRIu32".%03"PRIu32, *adc_avg/1000, *adc_avg%1000);
     return true;
+#endif //__ADC_CONTINUOUS__
+}
+
+
+#ifdef __ADC_CONTINUOUS__
+/* From the DMA interrupt, the last sequences may only part fill a half. */
+static void _adcs_dma_fold(const uint16_t* half)
+{
+    if (!_adcs_in_use)
+        return;
+    unsigned len = (_adcs_remaining < _adcs_half_len) ? _adcs_remaining : _adcs_half_len;
+    for (unsigned i = 0; i < _adcs_num_channels; i++)
+    {
+        osm_adcs_rms_acc_add(&_adcs_accs[i], half, len, i, _adcs_num_channels);
+        if (_adcs_power_ref < _adcs_num_channels && i != _adcs_power_ref)
+            osm_adcs_rms_power_add(&_adcs_power_accs[i], half, len, i, _adcs_power_ref, _adcs_num_channels);
+        if (i < _adcs_harmonics_channels)
+            osm_adcs_harmonics_add(&_adcs_harmonics[i], half, len, i, _adcs_num_channels);
+    }
+    _adcs_remaining -= len;
+    if (_adcs_remaining)
+        return;
+    osm_platform_adc_stop_conversion_regular();
+    _adcs_in_use = false;
+    _adcs_end_time = osm_get_since_boot_ms();
+}
+
+
+void osm_adcs_dma_half_complete(void)
+{
+    _adcs_dma_fold(_adcs_buffer);
+}
+
+
+void osm_adcs_dma_complete(void)
+{
+    _adcs_dma_fold(_adcs_buffer + _adcs_half_len);
+}
+#else
+void osm_adcs_dma_half_complete(void)
+{
 }
 
 
@@ -145,9 +215,10 @@ void osm_adcs_dma_complete(void)
     _adcs_in_use = false;
     _adcs_end_time = osm_get_since_boot_ms();
 }
+#endif //__ADC_CONTINUOUS__
 
 
-osm_adcs_resp_t osm_adcs_begin(osm_adcs_type_t* channels, unsigned num_channels, unsigned num_samples, osm_adcs_keys_t key)
+static osm_adcs_resp_t _adcs_begin(osm_adcs_type_t* channels, unsigned num_channels, unsigned num_samples, unsigned power_ref, unsigned harmonic_bins, osm_adcs_keys_t key)
 {
     if (!channels || !num_channels)
         return OSM_ADCS_RESP_FAIL;
@@ -161,11 +232,41 @@ osm_adcs_resp_t osm_adcs_begin(osm_adcs_type_t* channels, unsigned num_channels,
         return OSM_ADCS_RESP_WAIT;
     }
 
+#ifdef __ADC_CONTINUOUS__
+    if (num_channels > ADC_COUNT || num_samples < num_channels)
+    {
+        osm_adc_debug("Invalid ADC channels for samples.");
+        return OSM_ADCS_RESP_FAIL;
+    }
+
+    /* Whole sequences only, so each half starts on the first channel. */
+    _adcs_num_channels = num_channels;
+    _adcs_half_len = OSM_ADCS_HALF_SAMPLES - OSM_ADCS_HALF_SAMPLES % num_channels;
+    _adcs_remaining = num_samples - num_samples % num_channels;
+    memset(_adcs_accs, 0, sizeof(_adcs_accs));
+    memset(_adcs_power_accs, 0, sizeof(_adcs_power_accs));
+    _adcs_power_ref = power_ref;
+    _adcs_harmonics_channels = 0;
+    if (harmonic_bins)
+    {
+        if (num_channels > ADC_CC_COUNT)
+        {
+            osm_adc_debug("Too many ADC channels for harmonics.");
+            return OSM_ADCS_RESP_FAIL;
+        }
+        for (unsigned i = 0; i < num_channels; i++)
+            osm_adcs_harmonics_init(&_adcs_harmonics[i], harmonic_bins, _adcs_remaining / num_channels,
+                                    OSM_ADCS_SAMPLE_PERIOD_NS * num_channels, OSM_CC_LINE_FREQ_HZ);
+        _adcs_harmonics_channels = num_channels;
+    }
+    num_samples = 2 * _adcs_half_len;
+#else
     if (num_samples > OSM_ADCS_NUM_SAMPLES)
     {
         osm_adc_debug("ADC buffer too small for that many samples.");
         return OSM_ADCS_RESP_FAIL;
     }
+#endif //__ADC_CONTINUOUS__
 
     _adcs_in_use = true;
     _adcs_active_key = key;
@@ -178,6 +279,35 @@ osm_adcs_resp_t osm_adcs_begin(osm_adcs_type_t* channels, unsigned num_channels,
 }
 
 
+osm_adcs_resp_t osm_adcs_begin(osm_adcs_type_t* channels, unsigned num_channels, unsigned num_samples, osm_adcs_keys_t key)
+{
+    return _adcs_begin(channels, num_channels, num_samples, ADC_COUNT, 0, key);
+}
+
+
+/* As osm_adcs_begin, also summing each channel's products with the reference channel. */
+osm_adcs_resp_t osm_adcs_begin_power(osm_adcs_type_t* channels, unsigned num_channels, unsigned num_samples, unsigned ref_index, osm_adcs_keys_t key)
+{
+#ifdef __ADC_CONTINUOUS__
+    if (ref_index >= num_channels)
+        return OSM_ADCS_RESP_FAIL;
+    return _adcs_begin(channels, num_channels, num_samples, ref_index, 0, key);
+#else
+    osm_adc_debug("Power needs continuous ADC sampling.");
+    return OSM_ADCS_RESP_FAIL;
+#endif //__ADC_CONTINUOUS__
+}
+
+
+/* As osm_adcs_begin, also following each channel's harmonics when sampling is continuous. */
+osm_adcs_resp_t osm_adcs_begin_harmonics(osm_adcs_type_t* channels, unsigned num_channels, unsigned num_samples, unsigned num_bins, osm_adcs_keys_t key)
+{
+    if (!num_bins)
+        return OSM_ADCS_RESP_FAIL;
+    return _adcs_begin(channels, num_channels, num_samples, ADC_COUNT, num_bins, key);
+}
+
+
 osm_adcs_resp_t osm_adcs_collect_rms(uint32_t* rms, uint32_t midpoint, unsigned num_channels, unsigned num_samples, unsigned cc_index, osm_adcs_keys_t key, uint32_t* time_taken)
 {
     if (!rms)
@@ -292,6 +422,78 @@ osm_adcs_resp_t osm_adcs_collect_avgs(uint32_t* avgs, unsigned num_channels, uns
 }
 
 
+osm_adcs_resp_t osm_adcs_collect_power(int64_t* in_phase, int64_t* lead, uint32_t midpoint, uint32_t ref_midpoint, unsigned index, osm_adcs_keys_t key, uint32_t* time_taken)
+{
+    if (!in_phase || !lead)
+    {
+        osm_adc_debug("Handed NULL pointer.");
+        return OSM_ADCS_RESP_FAIL;
+    }
+    if (_adcs_in_use)
+    {
+        return OSM_ADCS_RESP_WAIT;
+    }
+    if (_adcs_active_key != key)
+        return OSM_ADCS_RESP_WAIT;
+#ifdef __ADC_CONTINUOUS__
+    if (_adcs_power_ref >= _adcs_num_channels || index >= _adcs_num_channels || index == _adcs_power_ref ||
+        !osm_adcs_rms_power_get(&_adcs_power_accs[index], &_adcs_accs[index], &_adcs_accs[_adcs_power_ref], midpoint, ref_midpoint, in_phase, lead))
+    {
+        osm_adc_debug("Could not get power for pos %u", index);
+        return OSM_ADCS_RESP_FAIL;
+    }
+    if (time_taken)
+        *time_taken = osm_since_boot_delta(_adcs_end_time, _adcs_start_time);
+    return OSM_ADCS_RESP_OK;
+#else
+    return OSM_ADCS_RESP_FAIL;
+#endif //__ADC_CONTINUOUS__
+}
+
+
+/* RMS of the fundamental and harmonics, x1000 ADC counts. num_bins is how
+ * many rms has room for, and then how many there are up to Nyquist. */
+osm_adcs_resp_t osm_adcs_collect_harmonics(uint32_t* rms, unsigned* num_bins, unsigned num_channels, unsigned num_samples, unsigned index, osm_adcs_keys_t key, uint32_t* time_taken)
+{
+    if (!rms || !num_bins)
+    {
+        osm_adc_debug("Handed NULL pointer.");
+        return OSM_ADCS_RESP_FAIL;
+    }
+    if (_adcs_in_use)
+    {
+        return OSM_ADCS_RESP_WAIT;
+    }
+    if (_adcs_active_key != key)
+        return OSM_ADCS_RESP_WAIT;
+#ifdef __ADC_CONTINUOUS__
+    if (index >= _adcs_harmonics_channels || _adcs_harmonics[index].num_bins > *num_bins)
+    {
+        osm_adc_debug("No harmonics for pos %u", index);
+        return OSM_ADCS_RESP_FAIL;
+    }
+    const osm_adcs_harmonics_t* harmonics = &_adcs_harmonics[index];
+#else
+    if (!num_channels || index >= num_channels || index >= num_samples)
+        return OSM_ADCS_RESP_FAIL;
+    osm_adcs_harmonics_t harmonics_local;
+    osm_adcs_harmonics_t* harmonics = &harmonics_local;
+    osm_adcs_harmonics_init(harmonics, *num_bins, (num_samples - index + num_channels - 1) / num_channels,
+                            OSM_ADCS_SAMPLE_PERIOD_NS * num_channels, OSM_CC_LINE_FREQ_HZ);
+    osm_adcs_harmonics_add(harmonics, _adcs_buffer, num_samples, index, num_channels);
+#endif //__ADC_CONTINUOUS__
+    if (!osm_adcs_harmonics_get(harmonics, rms))
+    {
+        osm_adc_debug("Could not get harmonics for pos %u", index);
+        return OSM_ADCS_RESP_FAIL;
+    }
+    *num_bins = harmonics->num_bins;
+    if (time_taken)
+        *time_taken = osm_since_boot_delta(_adcs_end_time, _adcs_start_time);
+    return OSM_ADCS_RESP_OK;
+}
+
+
 static bool _adcs_wait_loop_iteration(void* userdata)
 {
     return !_adcs_in_use;
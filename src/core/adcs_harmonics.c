@@ -0,0 +1,125 @@
+#include <math.h>
+
+#include <osm/core/adcs_harmonics.h>
+#include <osm/core/adcs_rms.h>
+
+
+#define ADCS_HARMONICS_COEF_ONE     (1L << 30)
+#define ADCS_HARMONICS_MAX_W        (0.9 * M_PI)    /* Near Nyquist the filter state grows too fast */
+#define ADCS_HARMONICS_SAMPLE_BITS  2               /* Fraction kept of windowed samples */
+#define ADCS_HARMONICS_CHUNK        32              /* Samples windowed at once, on the stack */
+
+
+static int32_t _adcs_harmonics_q30(double value)
+{
+    double q = round(value * ADCS_HARMONICS_COEF_ONE);
+    return (q > INT32_MAX) ? INT32_MAX : (int32_t)q;
+}
+
+
+/* Bins stop at the first harmonic too near Nyquist for the sample period. */
+unsigned osm_adcs_harmonics_init(osm_adcs_harmonics_t* harmonics, unsigned num_bins, uint32_t length, uint32_t sample_period_ns, unsigned line_hz)
+{
+    if (num_bins > OSM_ADCS_HARMONICS_MAX)
+        num_bins = OSM_ADCS_HARMONICS_MAX;
+    unsigned n = 0;
+    for (; n < num_bins; n++)
+    {
+        double w = 2 * M_PI * (n + 1) * line_hz * sample_period_ns / 1e9;
+        if (w > ADCS_HARMONICS_MAX_W)
+            break;
+        osm_adcs_harmonics_bin_t* bin = &harmonics->bins[n];
+        bin->coef = _adcs_harmonics_q30(2 * cos(w));
+        bin->s1 = 0;
+        bin->s2 = 0;
+    }
+    harmonics->num_bins = n;
+    harmonics->length = length;
+    harmonics->count = 0;
+    /* The window's cosine runs from sample -2, so the first is cos(0). */
+    double theta = length ? 2 * M_PI / length : 0;
+    harmonics->win_coef = _adcs_harmonics_q30(2 * cos(theta));
+    harmonics->win_c1 = _adcs_harmonics_q30(cos(theta));
+    harmonics->win_c2 = _adcs_harmonics_q30(cos(2 * theta));
+    return n;
+}
+
+
+/* Windowed a chunk at a time, then a bin at a time over the chunk, so
+ * its state stays in registers. Samples past the length are dropped. */
+void osm_adcs_harmonics_add(osm_adcs_harmonics_t* harmonics, const uint16_t* buf, unsigned buf_len, unsigned start_index, unsigned step)
+{
+    if (!step)
+        return;
+    int32_t chunk[ADCS_HARMONICS_CHUNK];
+    unsigned i = start_index;
+    while (i < buf_len && harmonics->count < harmonics->length)
+    {
+        unsigned len = 0;
+        int32_t c1 = harmonics->win_c1;
+        int32_t c2 = harmonics->win_c2;
+        for (; len < ADCS_HARMONICS_CHUNK && i < buf_len && harmonics->count + len < harmonics->length; len++, i += step)
+        {
+            int32_t c0 = (int32_t)(((int64_t)harmonics->win_coef * c1 + (ADCS_HARMONICS_COEF_ONE >> 1)) >> 30) - c2;
+            c2 = c1;
+            c1 = c0;
+            /* Hann is (1 - cos) / 2 */
+            chunk[len] = (int32_t)(((int64_t)buf[i] * (ADCS_HARMONICS_COEF_ONE - c0)) >> (31 - ADCS_HARMONICS_SAMPLE_BITS));
+        }
+        harmonics->win_c1 = c1;
+        harmonics->win_c2 = c2;
+        harmonics->count += len;
+
+        for (unsigned n = 0; n < harmonics->num_bins; n++)
+        {
+            osm_adcs_harmonics_bin_t* bin = &harmonics->bins[n];
+            int32_t coef = bin->coef;
+            int32_t s1 = bin->s1;
+            int32_t s2 = bin->s2;
+            for (unsigned j = 0; j < len; j++)
+            {
+                int32_t s0 = chunk[j] + (int32_t)(((int64_t)coef * s1 + (ADCS_HARMONICS_COEF_ONE >> 1)) >> 30) - s2;
+                s2 = s1;
+                s1 = s0;
+            }
+            bin->s1 = s1;
+            bin->s2 = s2;
+        }
+    }
+}
+
+
+/* RMS of each bin, x1000 ADC counts, once the whole window is added. */
+bool osm_adcs_harmonics_get(const osm_adcs_harmonics_t* harmonics, uint32_t* rms)
+{
+    if (!harmonics->num_bins || !harmonics->count || harmonics->count != harmonics->length)
+        return false;
+    /* The window sums to half its length, so a sine of amplitude A has
+     * |X| = A * length / 4, and the RMS is 2sqrt(2)|X| / length. */
+    double scale = 2 * M_SQRT2 * 1000 / ((double)harmonics->length * (1 << ADCS_HARMONICS_SAMPLE_BITS));
+    for (unsigned i = 0; i < harmonics->num_bins; i++)
+    {
+        const osm_adcs_harmonics_bin_t* bin = &harmonics->bins[i];
+        double coef = (double)bin->coef / ADCS_HARMONICS_COEF_ONE;
+        double s1 = bin->s1;
+        double s2 = bin->s2;
+        double power = s1 * s1 + s2 * s2 - coef * s1 * s2;
+        if (power < 0)
+            power = 0;
+        rms[i] = lround(sqrt(power) * scale);
+    }
+    return true;
+}
+
+
+/* Harmonics 2 and up against the fundamental, x1000 percent. */
+bool osm_adcs_harmonics_thd(const uint32_t* rms, unsigned num_bins, uint32_t* thd)
+{
+    if (num_bins < 2 || !rms[0])
+        return false;
+    uint64_t sum = 0;
+    for (unsigned i = 1; i < num_bins; i++)
+        sum += (uint64_t)rms[i] * rms[i];
+    *thd = (uint64_t)osm_adcs_rms_isqrt(sum) * 100000 / rms[0];
+    return true;
+}
@@ -0,0 +1,202 @@
+#include <math.h>
+
+#include <osm/core/adcs_rms.h>
+
+#ifdef __ARM_FEATURE_SIMD32
+#include <arm_acle.h>
+#endif
+
+
+/* Rounded to nearest, digit by digit so no divide or float. */
+uint32_t osm_adcs_rms_isqrt(uint64_t value)
+{
+    uint64_t root = 0;
+    uint64_t bit = 1ULL << 62;
+
+    while (bit > value)
+        bit >>= 2;
+
+    while (bit)
+    {
+        if (value >= root + bit)
+        {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+            root >>= 1;
+        bit >>= 2;
+    }
+    /* value is now the remainder, past root + 0.5 if more than root. */
+    if (value > root && root < UINT32_MAX)
+        root++;
+    return root;
+}
+
+
+uint64_t osm_adcs_rms_sum_squares(const uint16_t* buf, unsigned buf_len, unsigned start_index, unsigned step, int32_t midpoint)
+{
+    unsigned i = start_index;
+#ifdef __ARM_FEATURE_SIMD32
+    /* ADC samples are 12 bit so the differences pack two to a word. */
+    int64_t sum = 0;
+    for (; i + 3 * step < buf_len; i += 4 * step)
+    {
+        int32_t d0 = buf[i] - midpoint;
+        int32_t d1 = buf[i + step] - midpoint;
+        int32_t d2 = buf[i + 2 * step] - midpoint;
+        int32_t d3 = buf[i + 3 * step] - midpoint;
+        int32_t p0 = (int32_t)(((uint32_t)d1 << 16) | (uint16_t)d0);
+        int32_t p1 = (int32_t)(((uint32_t)d3 << 16) | (uint16_t)d2);
+        sum = __smlald(p0, p0, sum);
+        sum = __smlald(p1, p1, sum);
+    }
+#else
+    uint64_t sum = 0;
+    for (; i + 3 * step < buf_len; i += 4 * step)
+    {
+        int32_t d0 = buf[i] - midpoint;
+        int32_t d1 = buf[i + step] - midpoint;
+        int32_t d2 = buf[i + 2 * step] - midpoint;
+        int32_t d3 = buf[i + 3 * step] - midpoint;
+        sum += (int64_t)d0 * d0;
+        sum += (int64_t)d1 * d1;
+        sum += (int64_t)d2 * d2;
+        sum += (int64_t)d3 * d3;
+    }
+#endif
+    for (; i < buf_len; i += step)
+    {
+        int32_t d = buf[i] - midpoint;
+        sum += (int64_t)d * d;
+    }
+    return sum;
+}
+
+
+bool osm_adcs_rms_fixed(const uint16_t* buf, unsigned buf_len, unsigned start_index, unsigned step, uint32_t midpoint, uint32_t* adc_rms)
+{
+    if (!step || buf_len < step)
+        return false;
+    unsigned count = buf_len / step;
+    uint64_t sum = osm_adcs_rms_sum_squares(buf, buf_len, start_index, step, midpoint / 1000);
+    /* Mean square x1000000 so the root is x1000, divided in parts to not overflow. */
+    uint64_t mean_sq = (sum / count) * 1000000 + (sum % count) * 1000000 / count;
+    *adc_rms = midpoint - osm_adcs_rms_isqrt(mean_sq);
+    return true;
+}
+
+
+bool osm_adcs_rms_double(const uint16_t* buf, unsigned buf_len, unsigned start_index, unsigned step, uint32_t midpoint, uint32_t* adc_rms)
+{
+    if (!step || buf_len < step)
+        return false;
+    double inter_val = 0;
+    int32_t mp_small = midpoint / 1000;
+    for (unsigned i = start_index; i < buf_len; i+=step)
+    {
+        int64_t v = buf[i] - mp_small;
+        inter_val += v * v;
+    }
+    inter_val /= (buf_len / step);
+    inter_val = sqrt(inter_val);
+    inter_val *= 1000;
+    inter_val = midpoint - inter_val;
+    *adc_rms = inter_val;
+    return true;
+}
+
+
+void osm_adcs_rms_acc_add(osm_adcs_rms_acc_t* acc, const uint16_t* buf, unsigned buf_len, unsigned start_index, unsigned step)
+{
+    uint32_t sum = 0;
+    unsigned count = 0;
+    for (unsigned i = start_index; i < buf_len; i += step)
+    {
+        sum += buf[i];
+        count++;
+    }
+    acc->sum += sum;
+    acc->count += count;
+    acc->sum_squares += osm_adcs_rms_sum_squares(buf, buf_len, start_index, step, 0);
+}
+
+
+/* Mean of the sum x scale, divided in parts to not overflow. */
+static uint64_t _adcs_rms_acc_mean(uint64_t sum, uint32_t count, uint64_t scale)
+{
+    return (sum / count) * scale + (sum % count) * scale / count;
+}
+
+
+static int64_t _adcs_rms_acc_smean(int64_t sum, uint32_t count, int64_t scale)
+{
+    return (sum / (int64_t)count) * scale + (sum % (int64_t)count) * scale / (int64_t)count;
+}
+
+
+bool osm_adcs_rms_acc_get_avg(const osm_adcs_rms_acc_t* acc, uint32_t* adc_avg)
+{
+    if (!acc->count)
+        return false;
+    *adc_avg = _adcs_rms_acc_mean(acc->sum, acc->count, 1000);
+    return true;
+}
+
+
+bool osm_adcs_rms_acc_get_rms(const osm_adcs_rms_acc_t* acc, uint32_t midpoint, uint32_t* adc_rms)
+{
+    if (!acc->count)
+        return false;
+    /* Mean square about the midpoint is E[x^2] - 2mE[x] + m^2, here x1000000000. */
+    int64_t mean_sq = _adcs_rms_acc_mean(acc->sum_squares, acc->count, 1000000000);
+    int64_t mean = _adcs_rms_acc_mean(acc->sum, acc->count, 1000000);
+    int64_t mp = midpoint;
+    mean_sq += mp * mp * 1000 - 2 * mp * mean;
+    if (mean_sq < 0)
+        mean_sq = 0;
+    *adc_rms = midpoint - osm_adcs_rms_isqrt(mean_sq / 1000);
+    return true;
+}
+
+
+/* History carries over blocks, so the lead products run on from the last. */
+void osm_adcs_rms_power_add(osm_adcs_rms_power_acc_t* acc, const uint16_t* buf, unsigned buf_len, unsigned index, unsigned ref_index, unsigned step)
+{
+    for (unsigned i = 0; i + step <= buf_len; i += step)
+    {
+        uint16_t x = buf[i + index];
+        uint16_t v = buf[i + ref_index];
+        acc->sum_products += (uint32_t)x * v;
+        if (acc->history >= 2)
+        {
+            int32_t lead = (int32_t)v - acc->last_v[1];
+            acc->sum_lead_products += (int64_t)acc->last_x * lead;
+            acc->sum_lead += lead;
+            acc->lead_count++;
+        }
+        else
+            acc->history++;
+        acc->last_v[1] = acc->last_v[0];
+        acc->last_v[0] = v;
+        acc->last_x = x;
+    }
+}
+
+
+/* Both about the midpoints, x1000000 ADC counts squared. */
+bool osm_adcs_rms_power_get(const osm_adcs_rms_power_acc_t* acc, const osm_adcs_rms_acc_t* x_acc, const osm_adcs_rms_acc_t* v_acc, uint32_t x_midpoint, uint32_t v_midpoint, int64_t* in_phase, int64_t* lead)
+{
+    if (!x_acc->count || x_acc->count != v_acc->count || !acc->lead_count)
+        return false;
+    int64_t mx = x_midpoint;
+    int64_t mv = v_midpoint;
+    int64_t mean_x = _adcs_rms_acc_mean(x_acc->sum, x_acc->count, 1000);
+    int64_t mean_v = _adcs_rms_acc_mean(v_acc->sum, v_acc->count, 1000);
+    /* E[(x-mx)(v-mv)] = E[xv] - mxE[v] - mvE[x] + mxmv */
+    *in_phase = _adcs_rms_acc_mean(acc->sum_products, x_acc->count, 1000000)
+              - mx * mean_v - mv * mean_x + mx * mv;
+    *lead = _adcs_rms_acc_smean(acc->sum_lead_products, acc->lead_count, 1000000)
+          - mx * _adcs_rms_acc_smean(acc->sum_lead, acc->lead_count, 1000);
+    return true;
+}
@@ -0,0 +1,401 @@
+#include <string.h>
+#include <stddef.h>
+#include <inttypes.h>
+
+#include <osm/core/backlog.h>
+#include <osm/core/ring.h>
+#include <osm/core/log.h>
+#include <osm/core/config.h>
+
+
+#define BACKLOG_PAGE_MAGIC      0x424D534F /* "OSMB" */
+#define BACKLOG_RECORD_MAGIC    0xB10C
+#define BACKLOG_FLASH_ALIGN(_x_)  ALIGN_TO((_x_), 8)
+
+
+typedef struct
+{
+    uint16_t len;
+    uint32_t timestamp;
+} __attribute__((__packed__)) backlog_ram_header_t;
+
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t seq;
+} backlog_flash_page_header_t;
+
+
+/* Flash is programmed in double words, the sent marker is left erased
+ * and zeroed once the record is acknowledged so it isn't resent after
+ * a reset. */
+typedef struct
+{
+    uint16_t magic;
+    uint16_t len;
+    uint32_t timestamp;
+    uint64_t sent;
+} backlog_flash_record_t;
+
+
+static char _backlog_ram_buf[OSM_BACKLOG_RAM_SIZE];
+static osm_ring_buf_t _backlog_ring = RING_BUF_INIT(_backlog_ram_buf, sizeof(_backlog_ram_buf));
+
+static struct
+{
+    unsigned ram_count;
+    unsigned flash_count;
+    unsigned dropped;
+    unsigned pages;
+    unsigned r_page;
+    unsigned r_off;
+    unsigned w_page;
+    unsigned w_off;
+    uint32_t seq;
+    uint32_t boot_seq;
+    unsigned boot_off;
+} _backlog;
+
+
+unsigned __attribute__((weak)) osm_platform_backlog_flash_pages(void)
+{
+    return 0;
+}
+
+
+const uint8_t* __attribute__((weak)) osm_platform_backlog_flash_page(unsigned page)
+{
+    return NULL;
+}
+
+
+bool __attribute__((weak)) osm_platform_backlog_flash_erase(unsigned page)
+{
+    return false;
+}
+
+
+bool __attribute__((weak)) osm_platform_backlog_flash_write(unsigned page, unsigned offset, const void * data, unsigned size)
+{
+    return false;
+}
+
+
+static const backlog_flash_page_header_t* _backlog_flash_page_header(unsigned page)
+{
+    const backlog_flash_page_header_t* header = (const backlog_flash_page_header_t*)osm_platform_backlog_flash_page(page);
+    if (!header || header->magic != BACKLOG_PAGE_MAGIC)
+        return NULL;
+    return header;
+}
+
+
+static const backlog_flash_record_t* _backlog_flash_record(unsigned page, unsigned off)
+{
+    if (off + sizeof(backlog_flash_record_t) > OSM_BACKLOG_FLASH_PAGE_SIZE)
+        return NULL;
+    const backlog_flash_record_t* record = (const backlog_flash_record_t*)(osm_platform_backlog_flash_page(page) + off);
+    if (record->magic != BACKLOG_RECORD_MAGIC ||
+        off + sizeof(backlog_flash_record_t) + record->len > OSM_BACKLOG_FLASH_PAGE_SIZE)
+        return NULL;
+    return record;
+}
+
+
+static unsigned _backlog_flash_record_size(unsigned len)
+{
+    return sizeof(backlog_flash_record_t) + BACKLOG_FLASH_ALIGN(len);
+}
+
+
+static unsigned _backlog_flash_next(unsigned page)
+{
+    return (page + 1) % _backlog.pages;
+}
+
+
+static bool _backlog_flash_is_empty(void)
+{
+    return _backlog.r_page == _backlog.w_page && _backlog.r_off == _backlog.w_off;
+}
+
+
+/* Move the read position past page ends to the next record. */
+static void _backlog_flash_settle(void)
+{
+    if (!_backlog.flash_count)
+    {
+        _backlog.r_page = _backlog.w_page;
+        _backlog.r_off  = _backlog.w_off;
+        return;
+    }
+    while (!_backlog_flash_is_empty())
+    {
+        if (_backlog_flash_record(_backlog.r_page, _backlog.r_off))
+            return;
+        _backlog.r_page = _backlog_flash_next(_backlog.r_page);
+        _backlog.r_off  = sizeof(backlog_flash_page_header_t);
+    }
+}
+
+
+static bool _backlog_flash_new_page(void)
+{
+    unsigned next = _backlog_flash_next(_backlog.w_page);
+
+    if (_backlog.flash_count && next == _backlog.r_page)
+    {
+        /* Flash full too, lose the oldest page. */
+        unsigned lost = 0;
+        for (unsigned off = _backlog.r_off; _backlog_flash_record(next, off); off += _backlog_flash_record_size(_backlog_flash_record(next, off)->len))
+            lost++;
+        _backlog.flash_count -= lost;
+        _backlog.dropped     += lost;
+        _backlog.r_page = _backlog_flash_next(next);
+        _backlog.r_off  = sizeof(backlog_flash_page_header_t);
+        osm_log_error("Backlog flash full, dropped %u records.", lost);
+    }
+
+    if (!osm_platform_backlog_flash_erase(next))
+        return false;
+
+    backlog_flash_page_header_t header = {.magic = BACKLOG_PAGE_MAGIC, .seq = ++_backlog.seq};
+    if (!osm_platform_backlog_flash_write(next, 0, &header, sizeof(header)))
+        return false;
+
+    _backlog.w_page = next;
+    _backlog.w_off  = sizeof(header);
+    _backlog_flash_settle();
+    return true;
+}
+
+
+static void _backlog_ring_copy(unsigned offset, void * dst, unsigned size)
+{
+    uint8_t* pos = (uint8_t*)dst;
+    while (size)
+    {
+        char * span;
+        unsigned span_len = osm_ring_buf_peek_span(&_backlog_ring, offset, &span);
+        if (!span_len)
+            return;
+        if (span_len > size)
+            span_len = size;
+        memcpy(pos, span, span_len);
+        pos    += span_len;
+        offset += span_len;
+        size   -= span_len;
+    }
+}
+
+
+/* Spill the oldest RAM record into flash, straight from the ring. */
+static bool _backlog_flash_spill(const backlog_ram_header_t* ram_header)
+{
+    unsigned size = _backlog_flash_record_size(ram_header->len);
+
+    if (size > OSM_BACKLOG_FLASH_PAGE_SIZE - sizeof(backlog_flash_page_header_t))
+        return false;
+
+    if (!_backlog_flash_page_header(_backlog.w_page) || _backlog.w_off + size > OSM_BACKLOG_FLASH_PAGE_SIZE)
+    {
+        if (!_backlog_flash_new_page())
+            return false;
+    }
+
+    unsigned page = _backlog.w_page;
+    unsigned off  = _backlog.w_off;
+
+    for (unsigned n = 0; n < ram_header->len; n += 8)
+    {
+        uint8_t chunk[8];
+        unsigned chunk_len = ram_header->len - n;
+        if (chunk_len > sizeof(chunk))
+            chunk_len = sizeof(chunk);
+        _backlog_ring_copy(sizeof(backlog_ram_header_t) + n, chunk, chunk_len);
+        if (!osm_platform_backlog_flash_write(page, off + sizeof(backlog_flash_record_t) + n, chunk, chunk_len))
+            return false;
+    }
+
+    /* Header last, so a reset mid write leaves no half record. */
+    backlog_flash_record_t record = {.magic     = BACKLOG_RECORD_MAGIC,
+                                     .len       = ram_header->len,
+                                     .timestamp = ram_header->timestamp};
+    if (!osm_platform_backlog_flash_write(page, off, &record, offsetof(backlog_flash_record_t, sent)))
+        return false;
+
+    _backlog.w_off += size;
+    _backlog.flash_count++;
+    _backlog_flash_settle();
+    return true;
+}
+
+
+static void _backlog_flash_init(void)
+{
+    _backlog.pages       = osm_platform_backlog_flash_pages();
+    _backlog.flash_count = 0;
+    _backlog.seq         = 0;
+    _backlog.w_page      = (_backlog.pages)?(_backlog.pages - 1):0;
+    _backlog.w_off       = OSM_BACKLOG_FLASH_PAGE_SIZE;
+
+    bool found = false;
+    for (unsigned page = 0; page < _backlog.pages; page++)
+    {
+        const backlog_flash_page_header_t* header = _backlog_flash_page_header(page);
+        if (header && (!found || (int32_t)(header->seq - _backlog.seq) > 0))
+        {
+            _backlog.seq    = header->seq;
+            _backlog.w_page = page;
+            found = true;
+        }
+    }
+
+    if (found)
+    {
+        unsigned off = sizeof(backlog_flash_page_header_t);
+        const backlog_flash_record_t* record;
+        while ((record = _backlog_flash_record(_backlog.w_page, off)))
+            off += _backlog_flash_record_size(record->len);
+        _backlog.w_off = off;
+
+        /* Pages are used in turn, so the oldest follows the newest. */
+        for (unsigned n = 1; n <= _backlog.pages; n++)
+        {
+            unsigned page = (_backlog.w_page + n) % _backlog.pages;
+            if (!_backlog_flash_page_header(page))
+                continue;
+            for (off = sizeof(backlog_flash_page_header_t); (record = _backlog_flash_record(page, off)); off += _backlog_flash_record_size(record->len))
+            {
+                if (record->sent == 0)
+                    continue;
+                if (!_backlog.flash_count)
+                {
+                    _backlog.r_page = page;
+                    _backlog.r_off  = off;
+                }
+                _backlog.flash_count++;
+            }
+        }
+        if (_backlog.flash_count)
+            osm_measurements_debug("Backlog has %u records from flash.", _backlog.flash_count);
+    }
+
+    _backlog.boot_seq = _backlog.seq;
+    _backlog.boot_off = _backlog.w_off;
+    _backlog_flash_settle();
+}
+
+
+void osm_backlog_init(void)
+{
+    ring_buf_clear(&_backlog_ring);
+    _backlog.ram_count = 0;
+    _backlog.dropped   = 0;
+    _backlog_flash_init();
+}
+
+
+static void _backlog_ram_evict(void)
+{
+    backlog_ram_header_t header;
+    _backlog_ring_copy(0, &header, sizeof(header));
+
+    if (!_backlog.pages || !_backlog_flash_spill(&header))
+        _backlog.dropped++;
+
+    osm_ring_buf_discard(&_backlog_ring, sizeof(header) + header.len);
+    _backlog.ram_count--;
+}
+
+
+bool osm_backlog_push(uint32_t timestamp, const int8_t * data, unsigned len)
+{
+    backlog_ram_header_t header = {.len = len, .timestamp = timestamp};
+    unsigned size = sizeof(header) + len;
+
+    if (!len || len > OSM_BACKLOG_RECORD_MAX_SIZE || size >= OSM_BACKLOG_RAM_SIZE)
+    {
+        _backlog.dropped++;
+        return false;
+    }
+
+    while (OSM_BACKLOG_RAM_SIZE - 1 - osm_ring_buf_get_pending(&_backlog_ring) < size)
+        _backlog_ram_evict();
+
+    osm_ring_buf_add_data(&_backlog_ring, &header, sizeof(header));
+    osm_ring_buf_add_data(&_backlog_ring, (void*)data, len);
+    _backlog.ram_count++;
+    return true;
+}
+
+
+unsigned osm_backlog_peek(uint32_t * timestamp, int8_t * data, unsigned size)
+{
+    /* Anything in flash is older than what is in RAM. */
+    if (_backlog.flash_count)
+    {
+        const backlog_flash_record_t* record = _backlog_flash_record(_backlog.r_page, _backlog.r_off);
+        if (!record)
+            return 0;
+        const backlog_flash_page_header_t* header = _backlog_flash_page_header(_backlog.r_page);
+        bool before_reset = (int32_t)(header->seq - _backlog.boot_seq) < 0 ||
+                            (header->seq == _backlog.boot_seq && _backlog.r_off < _backlog.boot_off);
+        if (timestamp)
+            *timestamp = before_reset?OSM_BACKLOG_TIMESTAMP_UNKNOWN:record->timestamp;
+        if (record->len > size)
+            return 0;
+        memcpy(data, record + 1, record->len);
+        return record->len;
+    }
+
+    if (!_backlog.ram_count)
+        return 0;
+
+    backlog_ram_header_t header;
+    _backlog_ring_copy(0, &header, sizeof(header));
+    if (timestamp)
+        *timestamp = header.timestamp;
+    if (header.len > size)
+        return 0;
+    _backlog_ring_copy(sizeof(header), data, header.len);
+    return header.len;
+}
+
+
+void osm_backlog_pop(void)
+{
+    if (_backlog.flash_count)
+    {
+        const backlog_flash_record_t* record = _backlog_flash_record(_backlog.r_page, _backlog.r_off);
+        if (!record)
+            return;
+        uint64_t sent = 0;
+        osm_platform_backlog_flash_write(_backlog.r_page, _backlog.r_off + offsetof(backlog_flash_record_t, sent), &sent, sizeof(sent));
+        _backlog.r_off += _backlog_flash_record_size(record->len);
+        _backlog.flash_count--;
+        _backlog_flash_settle();
+        return;
+    }
+
+    if (!_backlog.ram_count)
+        return;
+
+    backlog_ram_header_t header;
+    _backlog_ring_copy(0, &header, sizeof(header));
+    osm_ring_buf_discard(&_backlog_ring, sizeof(header) + header.len);
+    _backlog.ram_count--;
+}
+
+
+unsigned osm_backlog_get_count(void)
+{
+    return _backlog.ram_count + _backlog.flash_count;
+}
+
+
+unsigned osm_backlog_get_dropped(void)
+{
+    return _backlog.dropped;
+}
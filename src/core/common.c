@@ -178,29 +178,6 @@ struct osm_cmd_link_t* osm_add_commands(struct osm_cmd_link_t* tail, struct osm_
 }
 
 
-uint16_t osm_modbus_crc(uint8_t * buf, unsigned length)
-{
-    uint16_t crc = 0xFFFF;
-
-    for (unsigned pos = 0; pos < length; pos++)
-    {
-        crc ^= (uint16_t)buf[pos];        // XOR byte into least sig. byte of crc
-
-        for (int i = 8; i != 0; i--)      // Loop over each bit
-        {
-            if ((crc & 0x0001) != 0)      // If the LSB is set
-            {
-                crc >>= 1;                // Shift right and XOR 0xA001
-                crc ^= 0xA001;
-            }
-            else                          // Else LSB is not set
-                crc >>= 1;                // Just shift right
-        }
-    }
-    return crc;
-}
-
-
 static bool _log_out_drain_iteration(void* userdata)
 {
     return !osm_uart_ring_out_busy(CMD_UART);
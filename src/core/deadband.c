@@ -0,0 +1,87 @@
+#include <string.h>
+
+#include <osm/core/deadband.h>
+
+
+bool osm_deadband_is_set(const osm_deadband_t* band)
+{
+    if (!band->abs_band && !band->rel_band)
+        return false;
+    /* Erased flash from before the table existed. */
+    return !(band->abs_band == UINT32_MAX && band->rel_band == UINT16_MAX);
+}
+
+
+int osm_deadband_find(const osm_deadband_t* bands, unsigned index)
+{
+    for (unsigned i = 0; i < OSM_DEADBAND_MAX; i++)
+    {
+        if (bands[i].index == index && osm_deadband_is_set(&bands[i]))
+            return i;
+    }
+    return OSM_DEADBAND_NONE;
+}
+
+
+int osm_deadband_get_free(const osm_deadband_t* bands)
+{
+    for (unsigned i = 0; i < OSM_DEADBAND_MAX; i++)
+    {
+        if (!osm_deadband_is_set(&bands[i]))
+            return i;
+    }
+    return OSM_DEADBAND_NONE;
+}
+
+
+void osm_deadband_clear(osm_deadband_t* band, osm_deadband_state_t* state)
+{
+    memset(band, 0, sizeof(osm_deadband_t));
+    memset(state, 0, sizeof(osm_deadband_state_t));
+}
+
+
+static uint64_t _deadband_abs_diff(int64_t a, int64_t b)
+{
+    return (a > b) ? (uint64_t)a - (uint64_t)b : (uint64_t)b - (uint64_t)a;
+}
+
+
+/* True if the value is inside the band and would be held back, without
+ * counting it as held. */
+bool osm_deadband_within(const osm_deadband_t* band, const osm_deadband_state_t* state, int64_t value)
+{
+    if (!osm_deadband_is_set(band) || !state->has_last)
+        return false;
+
+    if (band->heartbeat && state->held >= band->heartbeat)
+        return false;
+
+    uint64_t last = _deadband_abs_diff(state->last, 0);
+    uint64_t width = (last / OSM_DEADBAND_REL_SCALE) * band->rel_band +
+                     (last % OSM_DEADBAND_REL_SCALE) * band->rel_band / OSM_DEADBAND_REL_SCALE;
+    if (width < band->abs_band)
+        width = band->abs_band;
+
+    return _deadband_abs_diff(value, state->last) <= width;
+}
+
+
+/* True if the value is inside the band and can be held back this time. */
+bool osm_deadband_hold(const osm_deadband_t* band, osm_deadband_state_t* state, int64_t value)
+{
+    if (!osm_deadband_within(band, state, value))
+        return false;
+
+    if (state->held < UINT8_MAX)
+        state->held++;
+    return true;
+}
+
+
+void osm_deadband_sent(osm_deadband_state_t* state, int64_t value)
+{
+    state->last = value;
+    state->held = 0;
+    state->has_last = true;
+}
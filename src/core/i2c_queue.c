@@ -0,0 +1,73 @@
+#include <string.h>
+
+#include <osm/core/i2c_queue.h>
+
+
+void osm_i2c_queue_init(osm_i2c_queue_t* queue)
+{
+    memset(queue, 0, sizeof(osm_i2c_queue_t));
+}
+
+
+bool osm_i2c_queue_push(osm_i2c_queue_t* queue, osm_i2c_xfer_t* xfer)
+{
+    uint32_t head = queue->head;
+    if (head - queue->tail >= OSM_I2C_QUEUE_SIZE)
+        return false;
+    xfer->status = OSM_I2C_XFER_QUEUED;
+    xfer->wi = 0;
+    xfer->ri = 0;
+    queue->xfers[head & (OSM_I2C_QUEUE_SIZE - 1)] = xfer;
+    __sync_synchronize();
+    queue->head = head + 1;
+    return true;
+}
+
+
+osm_i2c_xfer_t* osm_i2c_queue_front(osm_i2c_queue_t* queue)
+{
+    uint32_t tail = queue->tail;
+    if (tail == queue->head)
+        return NULL;
+    __sync_synchronize();
+    return queue->xfers[tail & (OSM_I2C_QUEUE_SIZE - 1)];
+}
+
+
+/* The front is on the bus, its timeout runs from now. */
+void osm_i2c_queue_start(osm_i2c_xfer_t* xfer, uint32_t now_ms)
+{
+    xfer->started_ms = now_ms;
+    xfer->status = OSM_I2C_XFER_ACTIVE;
+}
+
+
+/* Ends the front, which is out of the queue before its callback so it
+ * can be submitted again from it. Returns the new front. */
+osm_i2c_xfer_t* osm_i2c_queue_finish(osm_i2c_queue_t* queue, bool ok)
+{
+    osm_i2c_xfer_t* xfer = osm_i2c_queue_front(queue);
+    if (!xfer)
+        return NULL;
+    queue->tail++;
+    xfer->status = ok ? OSM_I2C_XFER_DONE : OSM_I2C_XFER_FAILED;
+    if (xfer->cb)
+        xfer->cb(xfer);
+    return osm_i2c_queue_front(queue);
+}
+
+
+bool osm_i2c_queue_timed_out(osm_i2c_queue_t* queue, uint32_t now_ms)
+{
+    osm_i2c_xfer_t* xfer = osm_i2c_queue_front(queue);
+    if (!xfer || xfer->status != OSM_I2C_XFER_ACTIVE)
+        return false;
+    return (now_ms - xfer->started_ms) > xfer->timeout_ms;
+}
+
+
+bool osm_i2c_xfer_pending(osm_i2c_xfer_t* xfer)
+{
+    return xfer->status == OSM_I2C_XFER_QUEUED ||
+           xfer->status == OSM_I2C_XFER_ACTIVE;
+}
@@ -1,6 +1,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <inttypes.h>
 
 #include <osm/core/config.h>
 #include "pinmap.h"
@@ -351,6 +352,25 @@ bool osm_io_is_watch_now(unsigned io)
 }
 
 
+uint32_t osm_io_get_watch_window_ms(void)
+{
+    uint16_t window_ms = persist_data.io_watch_window_ms;
+    /* Unset, or erased flash from before it was kept. */
+    if (!window_ms || window_ms == UINT16_MAX)
+        return OSM_IO_EVENTS_DEFAULT_WINDOW_MS;
+    return window_ms;
+}
+
+
+bool osm_io_set_watch_window_ms(uint32_t window_ms)
+{
+    if (!window_ms || window_ms > OSM_IO_EVENTS_MAX_WINDOW_MS)
+        return false;
+    persist_data.io_watch_window_ms = window_ms;
+    return true;
+}
+
+
 unsigned osm_io_get_bias(unsigned io)
 {
     if (io >= OSM_ARRAY_SIZE(ios_pins))
@@ -642,13 +662,36 @@ bad_exit:
 }
 
 
+static osm_command_response_t _io_cmd_watch_window_cb(char* args, osm_cmd_ctx_t * ctx)
+{
+    /* [<ms>]
+     */
+    char * pos = osm_skip_space(args);
+    if (pos[0])
+    {
+        unsigned long window_ms = strtoul(pos, NULL, 10);
+        if (!osm_io_set_watch_window_ms(window_ms))
+        {
+            osm_cmd_ctx_error(ctx,"io_window [<ms 1-%u>]", OSM_IO_EVENTS_MAX_WINDOW_MS);
+            return OSM_COMMAND_RESP_ERR;
+        }
+    }
+    osm_cmd_ctx_out(ctx,"Watch edges held %"PRIu32" ms", osm_io_get_watch_window_ms());
+    const osm_io_events_t* events = osm_io_watch_get_events();
+    osm_cmd_ctx_out(ctx,"Lists %"PRIu32", folded %"PRIu32", overflows %"PRIu32,
+        events->lists, events->folded, events->overflows);
+    return OSM_COMMAND_RESP_OK;
+}
+
+
 struct osm_cmd_link_t* osm_ios_add_commands(struct osm_cmd_link_t* tail)
 {
     static struct osm_cmd_link_t cmds[] = {{ "ios",          "Print all IOs.",           _io_log_cb                        , false , NULL },
                                        { "io",           "Get/set IO set.",          _io_cb                            , false , NULL },
                                        { "en_pulse",     "Enable Pulsecount IO.",    _io_cmd_enable_pulsecount_cb      , false , NULL },
                                        { "en_w1",        "Enable OneWire IO.",       _io_cmd_enable_onewire_cb         , false , NULL },
-                                       { "en_watch",     "Enable Watch IO.",         _io_cmd_enable_watch_cb           , false , NULL }};
+                                       { "en_watch",     "Enable Watch IO.",         _io_cmd_enable_watch_cb           , false , NULL },
+                                       { "io_window",    "Get/set watch edge window.", _io_cmd_watch_window_cb         , false , NULL }};
     tail = osm_add_commands(tail, cmds, OSM_ARRAY_SIZE(cmds));
     return osm_pulsecount_add_commands(tail);
 }
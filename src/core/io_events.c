@@ -0,0 +1,76 @@
+#include <string.h>
+
+#include <osm/core/io_events.h>
+
+
+void osm_io_events_init(osm_io_events_t* events)
+{
+    memset(events, 0, sizeof(osm_io_events_t));
+}
+
+
+bool osm_io_events_pending(osm_io_events_t* events)
+{
+    return events->head != events->tail;
+}
+
+
+/* The IOs with edges waiting, once the oldest has waited out the window
+ * or the queue is filling, otherwise 0. */
+uint32_t osm_io_events_due(osm_io_events_t* events, uint32_t now_ms, uint32_t window_ms)
+{
+    uint32_t head = events->head;
+    uint32_t tail = events->tail;
+    if (head == tail)
+        return 0;
+    __sync_synchronize();
+    osm_io_event_t* oldest = &events->events[tail & (OSM_IO_EVENTS_QUEUE_SIZE - 1)];
+    if (now_ms - oldest->ms < window_ms &&
+        head - tail < OSM_IO_EVENTS_QUEUE_WAKE)
+        return 0;
+    uint32_t io_mask = 0;
+    for (; tail != head; tail++)
+        io_mask |= 1UL << events->events[tail & (OSM_IO_EVENTS_QUEUE_SIZE - 1)].io;
+    return io_mask;
+}
+
+
+/* Takes everything queued, the first max of the IOs in the mask into the
+ * list. The rest of theirs, any the queue dropped since last taken, and
+ * any carried, are counted in dropped, those of other IOs are thrown
+ * away. */
+unsigned osm_io_events_take(osm_io_events_t* events, uint32_t io_mask, osm_io_event_t* list, unsigned max, uint32_t* dropped)
+{
+    uint32_t head = events->head;
+    uint32_t tail = events->tail;
+    __sync_synchronize();
+    unsigned count = 0;
+    uint32_t folded = 0;
+    for (; tail != head; tail++)
+    {
+        osm_io_event_t* event = &events->events[tail & (OSM_IO_EVENTS_QUEUE_SIZE - 1)];
+        if (!(io_mask & (1UL << event->io)))
+            continue;
+        if (count < max)
+            list[count++] = *event;
+        else
+            folded++;
+    }
+    __sync_synchronize();
+    events->tail = tail;
+    uint32_t overflows = events->overflows;
+    *dropped = folded + (overflows - events->overflows_taken) + events->carried;
+    events->overflows_taken = overflows;
+    events->carried = 0;
+    events->folded += folded;
+    if (count)
+        events->lists++;
+    return count;
+}
+
+
+/* Dropped that went in no list, so counted in the next take instead. */
+void osm_io_events_carry(osm_io_events_t* events, uint32_t dropped)
+{
+    events->carried += dropped;
+}
@@ -0,0 +1,145 @@
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <osm/core/io.h>
+#include <osm/sensors/io_watch.h>
+#include <osm/core/config.h>
+#include <osm/core/platform.h>
+#include <osm/core/log.h>
+#include <osm/core/common.h>
+#include <osm/protocols/protocol.h>
+#include <osm/core/sleep.h>
+
+
+const unsigned              ios_watch_ios[IOS_WATCH_COUNT]                  = IOS_WATCH_IOS;
+static osm_measurements_def_t*  _ios_watch_measurements_def[IOS_WATCH_COUNT];
+static osm_measurements_data_t* _ios_watch_measurements_data[IOS_WATCH_COUNT];
+static osm_io_events_t          _io_watch_events;
+static bool                     _io_watch_flagged;
+
+
+/* From the port's edge interrupt. */
+void osm_io_watch_push(unsigned io, bool level)
+{
+    unsigned waiting = osm_io_events_push(&_io_watch_events, io, level, osm_get_since_boot_ms());
+    /* Up to start the window, and again should the queue be filling. */
+    if (waiting == 1 || waiting == OSM_IO_EVENTS_QUEUE_WAKE)
+        osm_sleep_exit_sleep_mode();
+}
+
+
+void osm_io_watch_init(void)
+{
+    /* Must be called after osm_measurements_init */
+    osm_io_events_init(&_io_watch_events);
+    _io_watch_flagged = false;
+    char name[OSM_MEASURE_NAME_NULLED_LEN] = OSM_IOS_MEASUREMENT_NAME_PRE;
+    unsigned len = strnlen(name, OSM_MEASURE_NAME_LEN);
+    char* p = name + len;
+    for (unsigned i = 0; i < IOS_WATCH_COUNT; i++)
+    {
+        snprintf(p, OSM_MEASURE_NAME_NULLED_LEN - len, "%02u", ios_watch_ios[i]);
+        if (!osm_measurements_get_measurements_def(name, &_ios_watch_measurements_def[i], &_ios_watch_measurements_data[i]))
+        {
+            _ios_watch_measurements_def[i] = NULL;
+            _ios_watch_measurements_data[i] = NULL;
+            osm_io_debug("Could not find measurements data for '%s'", name);
+        }
+    }
+
+    for(unsigned n = 0; n < OSM_ARRAY_SIZE(ios_pins); n++)
+    {
+        if (osm_io_is_watch_now(n))
+        {
+            uint8_t pupd;
+            if (!osm_ios_get_pupd(n, &pupd))
+            {
+                osm_io_debug("Could not get pull of IO %u", n);
+                continue;
+            }
+            if (!osm_io_watch_enable(n, true, pupd))
+                osm_io_debug("Could not enable IO watch for IO %u on init.", n);
+        }
+    }
+}
+
+
+static uint32_t _io_watch_reportable(void)
+{
+    uint32_t io_mask = 0;
+    for (unsigned i = 0; i < IOS_WATCH_COUNT; i++)
+    {
+        osm_measurements_def_t* def = _ios_watch_measurements_def[i];
+        if (def && _ios_watch_measurements_data[i] && def->interval && def->samplecount)
+            io_mask |= 1UL << ios_watch_ios[i];
+    }
+    return io_mask;
+}
+
+
+void osm_io_watch_iterate(void)
+{
+    if (_io_watch_flagged)
+        return;
+    uint32_t due = osm_io_events_due(&_io_watch_events, osm_get_since_boot_ms(), osm_io_get_watch_window_ms());
+    if (!due)
+        return;
+    due &= _io_watch_reportable();
+    for (unsigned i = 0; i < IOS_WATCH_COUNT; i++)
+    {
+        if (!(due & (1UL << ios_watch_ios[i])))
+            continue;
+        _ios_watch_measurements_data[i]->instant_send = 1;
+        _io_watch_flagged = true;
+    }
+    if (!_io_watch_flagged)
+    {
+        /* None that would be sent, don't keep them from sleep. */
+        uint32_t dropped;
+        osm_io_events_take(&_io_watch_events, 0, NULL, 0, &dropped);
+        osm_io_events_carry(&_io_watch_events, dropped);
+    }
+}
+
+
+/* Called building the instant uplink, after the levels. */
+bool osm_io_watch_append_events(void)
+{
+    osm_io_event_t list[OSM_IO_EVENTS_LIST_MAX];
+    uint32_t dropped;
+    _io_watch_flagged = false;
+    unsigned count = osm_io_events_take(&_io_watch_events, _io_watch_reportable(), list, OSM_IO_EVENTS_LIST_MAX, &dropped);
+    uint32_t now = osm_get_since_boot_ms();
+    /* Halve the list until it fits in what the levels left. */
+    while (count && !osm_protocol_append_io_events(list, count, dropped, now))
+    {
+        dropped += count - count / 2;
+        count /= 2;
+    }
+    if (!count)
+    {
+        if (dropped)
+        {
+            osm_io_debug("No room for IO edges, %"PRIu32" dropped to the next.", dropped);
+            osm_io_events_carry(&_io_watch_events, dropped);
+        }
+        return false;
+    }
+    return true;
+}
+
+
+/* Edges waiting out the window, that the main loop should stay up for. */
+bool osm_io_watch_events_pending(void)
+{
+    return !_io_watch_flagged && osm_io_events_pending(&_io_watch_events);
+}
+
+
+const osm_io_events_t* osm_io_watch_get_events(void)
+{
+    return &_io_watch_events;
+}
@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <math.h>
 
 #include <osm/core/measurements.h>
 #include <osm/core/log.h>
@@ -12,11 +13,16 @@
 #include <osm/core/persist_config.h>
 #include <osm/core/sleep.h>
 #include <osm/core/uart_rings.h>
+#include <osm/core/backlog.h>
+#include <osm/core/deadband.h>
+#include <osm/core/stats.h>
+#include <osm/core/sched.h>
 #include <osm/sensors/bat.h>
 #include <osm/core/platform.h>
 #include "platform_model.h"
 #include <osm/protocols/protocol.h>
 #include <osm/core/io.h>
+#include <osm/sensors/io_watch.h>
 
 
 #define MEASUREMENTS_DEFAULT_COLLECTION_TIME    (uint32_t)1000
@@ -44,11 +50,90 @@ typedef struct
 } measurements_info_t;
 
 
+/* Active measurement slots keyed on when they next need an init or
+ * collect. Rebuilt whenever the interval timing or the measurement
+ * definitions change. */
+typedef struct
+{
+    osm_sched_t sched;
+    uint32_t built_last_sent_ms;
+    uint32_t built_interval_count;
+    uint32_t built_transmit_interval;
+    bool     dirty;
+} measurements_sched_t;
+
+
+/* Dead-band values appended, only taken as sent once acknowledged. */
+typedef struct
+{
+    int64_t  values[OSM_DEADBAND_MAX];
+    uint8_t  pending;   /* Bit a slot */
+} measurements_deadband_pending_t;
+
+
+/* Intervals encoded into one backlog record until it is full, has
+ * enough intervals or its oldest reading has waited long enough. */
+typedef struct
+{
+    int8_t   payload[OSM_BACKLOG_RECORD_MAX_SIZE];
+    unsigned len;
+    uint32_t start;     /* Since boot, in seconds */
+    uint8_t  count;     /* Intervals in the payload */
+    uint8_t  queued[(OSM_MEASUREMENTS_MAX_NUMBER + 7) / 8];    /* In the payload, acknowledged once in the backlog */
+    measurements_deadband_pending_t deadband;
+} measurements_batch_t;
+
+
+#define MEASUREMENTS_UNACKED_RECORDS    2
+
+
+/* A live send's readings encoded as backlog records and kept until it
+ * is acknowledged, so that a lost send goes to the backlog. */
+typedef struct
+{
+    int8_t   payload[MEASUREMENTS_UNACKED_RECORDS][OSM_BACKLOG_RECORD_MAX_SIZE];
+    unsigned len[MEASUREMENTS_UNACKED_RECORDS];
+    unsigned count;     /* Records held */
+    uint32_t start;     /* Since boot, in seconds */
+    uint8_t  queued[(OSM_MEASUREMENTS_MAX_NUMBER + 7) / 8];
+} measurements_unacked_t;
+
+
+#define MEASUREMENTS_INF_CACHE_TYPES    32
+
+
+#define MEASUREMENTS_NAME_INDEX_BITS    9
+#define MEASUREMENTS_NAME_INDEX_SIZE    (1 << MEASUREMENTS_NAME_INDEX_BITS)
+
+_Static_assert(MEASUREMENTS_NAME_INDEX_SIZE >= 2 * OSM_MEASUREMENTS_MAX_NUMBER, "Name index load factor too high.");
+
+
+/* Open addressed hash of packed names to slot + 1, 0 is empty.
+ * Rebuilt on add/del/rename so never needs tombstones. */
+typedef struct
+{
+    uint16_t slots[MEASUREMENTS_NAME_INDEX_SIZE];
+} measurements_name_index_t;
+
+
+typedef struct
+{
+    osm_measurements_inf_t  by_type[MEASUREMENTS_INF_CACHE_TYPES];
+    osm_measurements_inf_t  uncached;
+    uint32_t                valid_types;
+} measurements_inf_cache_t;
+
+_Static_assert(OSM_MEASUREMENTS_MAX_NUMBER <= OSM_SCHED_SIZE, "Measurement slot index must fit heap entry.");
+
+
 static uint32_t                     _last_sent_ms                                        = 0;
 static bool                         _pending_send                                        = false;
 static measurements_check_time_t    _check_time                                          = {0, 0};
 static uint32_t                     _interval_count                                      =  0;
 static measurements_arr_t           _measurements_arr                                    = {0};
+static measurements_sched_t         _measurements_sched                                  = {.dirty = true};
+static measurements_inf_cache_t     _measurements_inf_cache                              = {0};
+static measurements_name_index_t    _measurements_name_index                             = {0};
 
 bool                                 measurements_enabled                                = true;
 
@@ -57,6 +142,20 @@ static osm_measurements_power_mode_t    _measurements_power_mode
 static unsigned _measurements_chunk_start_pos = 0;
 static unsigned _measurements_chunk_prev_start_pos = 0;
 
+static bool     _measurements_backlog_inflight = false;
+static uint32_t _measurements_backlog_sent_ms  = 0;
+static int8_t   _measurements_backlog_buf[OSM_BACKLOG_RECORD_MAX_SIZE];
+
+static measurements_batch_t _measurements_batch = {0};
+static measurements_unacked_t _measurements_unacked = {0};
+
+static osm_deadband_state_t _measurements_deadband_state[OSM_DEADBAND_MAX];
+static measurements_deadband_pending_t _measurements_deadband_sending = {0};
+
+_Static_assert(OSM_DEADBAND_MAX <= 8, "Dead-band pending bits must fit a byte.");
+
+static osm_stats_t          _measurements_stats[OSM_STATS_MAX];
+
 
 uint32_t transmit_interval = OSM_MEASUREMENTS_DEFAULT_TRANSMIT_INTERVAL; /* in minutes, defaulting to 15 minutes */
 
@@ -65,26 +164,71 @@ uint32_t transmit_interval = OSM_MEASUREMENTS_DEFAULT_TRANSMIT_INTERVAL; /* in m
 #define MEASUREMENTS_MIN_TRANSMIT_MS                (15 * 1000)
 
 
-bool osm_measurements_get_measurements_def(char* name, osm_measurements_def_t ** measurements_def, osm_measurements_data_t ** measurements_data)
+static unsigned _measurements_name_index_hash(uint32_t key)
 {
-    if (!name || strlen(name) > OSM_MEASURE_NAME_LEN || !name[0])
-        return false;
+    return (key * 2654435761UL) >> (32 - MEASUREMENTS_NAME_INDEX_BITS);
+}
+
+
+static void _measurements_name_index_rebuild(void)
+{
+    memset(&_measurements_name_index, 0, sizeof(_measurements_name_index));
 
     for (unsigned i = 0; i < OSM_MEASUREMENTS_MAX_NUMBER; i++)
     {
-        osm_measurements_def_t * def   = &_measurements_arr.def[i];
-        osm_measurements_data_t * data = &_measurements_arr.data[i];
-        if (strncmp(def->name, name, OSM_MEASURE_NAME_LEN) == 0)
+        uint32_t key = osm_measurements_name_key(_measurements_arr.def[i].name);
+        if (!key)
+            continue;
+
+        unsigned pos = _measurements_name_index_hash(key);
+        while (true)
         {
-            if (measurements_def)
-                *measurements_def = def;
-            if (measurements_data)
-                *measurements_data = data;
-            return true;
+            uint16_t slot = _measurements_name_index.slots[pos];
+            if (!slot)
+            {
+                _measurements_name_index.slots[pos] = i + 1;
+                break;
+            }
+            /* First of duplicate names wins, as with the old linear scan. */
+            if (osm_measurements_name_key(_measurements_arr.def[slot - 1].name) == key)
+                break;
+            pos = (pos + 1) & (MEASUREMENTS_NAME_INDEX_SIZE - 1);
         }
     }
+}
 
-    return false;
+
+static int _measurements_name_index_find(char* name)
+{
+    if (!name || strlen(name) > OSM_MEASURE_NAME_LEN || !name[0])
+        return -1;
+
+    uint32_t key = osm_measurements_name_key(name);
+    unsigned pos = _measurements_name_index_hash(key);
+
+    while (true)
+    {
+        uint16_t slot = _measurements_name_index.slots[pos];
+        if (!slot)
+            return -1;
+        if (osm_measurements_name_key(_measurements_arr.def[slot - 1].name) == key)
+            return slot - 1;
+        pos = (pos + 1) & (MEASUREMENTS_NAME_INDEX_SIZE - 1);
+    }
+}
+
+
+bool osm_measurements_get_measurements_def(char* name, osm_measurements_def_t ** measurements_def, osm_measurements_data_t ** measurements_data)
+{
+    int i = _measurements_name_index_find(name);
+    if (i < 0)
+        return false;
+
+    if (measurements_def)
+        *measurements_def = &_measurements_arr.def[i];
+    if (measurements_data)
+        *measurements_data = &_measurements_arr.data[i];
+    return true;
 }
 
 
@@ -151,11 +295,227 @@ static void _measurements_reset_send(void)
     osm_protocol_reset();
     _measurements_chunk_start_pos = _measurements_chunk_prev_start_pos = 0;
     _pending_send = false;
+    _measurements_deadband_sending.pending = 0;
     for (unsigned i = 0; i < OSM_MEASUREMENTS_MAX_NUMBER; i++)
         _measurements_arr.data[i].has_sent = false;
 }
 
 
+static void _measurements_data_clear(osm_measurements_data_t* data)
+{
+    memset(&data->value, 0, sizeof(osm_measurements_value_t));
+    data->num_samples = 0;
+    data->num_samples_init = 0;
+    data->num_samples_collected = 0;
+}
+
+
+static bool _measurements_deadband_value(osm_measurements_data_t* data, int64_t* value)
+{
+    switch(data->value_type)
+    {
+        case OSM_MEASUREMENTS_VALUE_TYPE_I64:
+            *value = data->value.value_64.sum / data->num_samples;
+            return true;
+        case OSM_MEASUREMENTS_VALUE_TYPE_FLOAT:
+            *value = data->value.value_f.sum / data->num_samples;
+            return true;
+        default:
+            return false;
+    }
+}
+
+
+/* As _measurements_deadband_hold, but only asking. */
+static bool _measurements_deadband_within(unsigned i)
+{
+    int slot = osm_deadband_find(persist_data.deadbands, i);
+    if (slot == OSM_DEADBAND_NONE)
+        return false;
+
+    int64_t value;
+    if (!_measurements_deadband_value(&_measurements_arr.data[i], &value))
+        return false;
+
+    return osm_deadband_within(&persist_data.deadbands[slot], &_measurements_deadband_state[slot], value);
+}
+
+
+/* Call before the value is appended, true if it's inside its dead-band
+ * and should not be sent this interval. */
+static bool _measurements_deadband_hold(unsigned i)
+{
+    int slot = osm_deadband_find(persist_data.deadbands, i);
+    if (slot == OSM_DEADBAND_NONE)
+        return false;
+
+    int64_t value;
+    if (!_measurements_deadband_value(&_measurements_arr.data[i], &value))
+        return false;
+
+    if (!osm_deadband_hold(&persist_data.deadbands[slot], &_measurements_deadband_state[slot], value))
+        return false;
+
+    osm_measurements_debug("\"%s\" inside dead-band, held back.", _measurements_arr.def[i].name);
+    return true;
+}
+
+
+static void _measurements_deadband_appended(unsigned i, measurements_deadband_pending_t* pending)
+{
+    int slot = osm_deadband_find(persist_data.deadbands, i);
+    if (slot == OSM_DEADBAND_NONE)
+        return;
+
+    int64_t value;
+    if (!_measurements_deadband_value(&_measurements_arr.data[i], &value))
+        return;
+    pending->values[slot] = value;
+    pending->pending |= 1 << slot;
+}
+
+
+static void _measurements_deadband_forget(unsigned slot)
+{
+    _measurements_deadband_sending.pending &= ~(1 << slot);
+    _measurements_batch.deadband.pending &= ~(1 << slot);
+}
+
+
+/* Once the server has the values, the bands move to them. */
+static void _measurements_deadband_sent(measurements_deadband_pending_t* pending)
+{
+    for (unsigned slot = 0; slot < OSM_DEADBAND_MAX; slot++)
+    {
+        if (pending->pending & (1 << slot))
+            osm_deadband_sent(&_measurements_deadband_state[slot], pending->values[slot]);
+    }
+    pending->pending = 0;
+}
+
+
+static osm_measurements_inf_t* _measurements_get_inf(osm_measurements_def_t* def, osm_measurements_data_t* data)
+{
+    /* The model resolves interfaces on type alone, so only one copy
+     * per type is kept and slots just remember if they've resolved. */
+    if (def->type >= MEASUREMENTS_INF_CACHE_TYPES)
+    {
+        if (!osm_model_measurements_get_inf(def, data, &_measurements_inf_cache.uncached))
+            return NULL;
+        return &_measurements_inf_cache.uncached;
+    }
+
+    osm_measurements_inf_t* inf = &_measurements_inf_cache.by_type[def->type];
+
+    if (data && data->inf_cached)
+        return inf;
+
+    if (_measurements_inf_cache.valid_types & (1UL << def->type))
+    {
+        if (data)
+            data->value_type = inf->value_type_cb(def->name);
+    }
+    else
+    {
+        if (!osm_model_measurements_get_inf(def, data, inf))
+            return NULL;
+        _measurements_inf_cache.valid_types |= (1UL << def->type);
+    }
+
+    if (data)
+        data->inf_cached = 1;
+    return inf;
+}
+
+
+/* Encode the readings due from start as the backlog would keep them,
+ * returning the slot the records are full at, where the live send
+ * must stop too. */
+static unsigned _measurements_unacked_hold(unsigned start)
+{
+    memset(_measurements_unacked.queued, 0, sizeof(_measurements_unacked.queued));
+    _measurements_unacked.count = 0;
+    _measurements_unacked.start = osm_get_since_boot_ms() / 1000;
+
+    unsigned i = start;
+    while (i < OSM_MEASUREMENTS_MAX_NUMBER)
+    {
+        if (_measurements_unacked.count == MEASUREMENTS_UNACKED_RECORDS)
+            return i;
+        if (!osm_protocol_init_backlog())
+        {
+            osm_measurements_debug("Could not initialise protocol to hold send.");
+            _measurements_unacked.count = 0;
+            break;
+        }
+
+        unsigned num_qd = 0;
+        for (; i < OSM_MEASUREMENTS_MAX_NUMBER; i++)
+        {
+            osm_measurements_def_t*  def  = &_measurements_arr.def[i];
+            osm_measurements_data_t* data = &_measurements_arr.data[i];
+            if (!def->interval || (_interval_count % def->interval != 0) ||
+                !data->num_samples || _measurements_deadband_within(i))
+                continue;
+            if (!osm_protocol_append_measurement(def, data))
+            {
+                if (!num_qd)
+                {
+                    osm_log_error("Measurement \"%s\" does not fit in backlog record.", def->name);
+                    i++;
+                }
+                break;
+            }
+            num_qd++;
+            _measurements_unacked.queued[i / 8] |= 1 << (i % 8);
+        }
+
+        if (num_qd)
+        {
+            int8_t* payload;
+            unsigned n = _measurements_unacked.count++;
+            _measurements_unacked.len[n] = osm_protocol_get_payload(&payload);
+            memcpy(_measurements_unacked.payload[n], payload, _measurements_unacked.len[n]);
+        }
+    }
+    return OSM_MEASUREMENTS_MAX_NUMBER;
+}
+
+
+/* The live send was lost, so put what was held of it in the backlog. */
+static bool _measurements_unacked_store(void)
+{
+    if (!_measurements_unacked.count)
+        return false;
+
+    for (unsigned n = 0; n < _measurements_unacked.count; n++)
+    {
+        if (!osm_backlog_push(_measurements_unacked.start, _measurements_unacked.payload[n], _measurements_unacked.len[n]))
+            /* Counted in the backlog's dropped. */
+            osm_log_error("Failed to add %u bytes to backlog.", _measurements_unacked.len[n]);
+    }
+    osm_measurements_debug("Send not acknowledged, %u records to backlog.", _measurements_unacked.count);
+    _measurements_unacked.count = 0;
+
+    for (unsigned i = 0; i < OSM_MEASUREMENTS_MAX_NUMBER; i++)
+    {
+        if (!(_measurements_unacked.queued[i / 8] & (1 << (i % 8))))
+            continue;
+        osm_measurements_def_t*  def  = &_measurements_arr.def[i];
+        osm_measurements_data_t* data = &_measurements_arr.data[i];
+        osm_measurements_inf_t* inf = _measurements_get_inf(def, data);
+        if (inf && inf->acked_cb)
+            inf->acked_cb(def->name);
+        /* Held, but past where the live send stopped. */
+        if (!data->has_sent)
+            _measurements_data_clear(data);
+        data->has_sent = false;
+    }
+    _measurements_deadband_sent(&_measurements_deadband_sending);
+    return true;
+}
+
+
 static void _measurements_send(void)
 {
     uint16_t            num_qd = 0;
@@ -197,18 +557,23 @@ static void _measurements_send(void)
         return;
     }
 
-    if (!_measurements_send_start())
-        return;
-
     if (_measurements_chunk_start_pos == OSM_MEASUREMENTS_MAX_NUMBER)
         _measurements_chunk_start_pos = 0;
 
+    unsigned end = _measurements_unacked_hold(_measurements_chunk_start_pos);
+
+    if (!_measurements_send_start())
+    {
+        _measurements_unacked.count = 0;
+        return;
+    }
+
     unsigned i = _measurements_chunk_start_pos;
 
     if (_measurements_chunk_start_pos)
         osm_measurements_debug("Resuming previous measurements send.");
 
-    for (; i < OSM_MEASUREMENTS_MAX_NUMBER; i++)
+    for (; i < end; i++)
     {
         osm_measurements_def_t*  def  = &_measurements_arr.def[i];
         osm_measurements_data_t* data = &_measurements_arr.data[i];
@@ -221,6 +586,11 @@ static void _measurements_send(void)
                 osm_log_error("Measurement \"%s\" requested but value not set.", def->name);
                 continue;
             }
+            if (_measurements_deadband_hold(i))
+            {
+                _measurements_data_clear(data);
+                continue;
+            }
             if (!osm_protocol_append_measurement(def, data))
             {
                 osm_measurements_debug("Failed to queue send of  \"%s\".", def->name);
@@ -229,13 +599,17 @@ static void _measurements_send(void)
                 break;
             }
             data->has_sent = true;
+            _measurements_deadband_appended(i, &_measurements_deadband_sending);
             num_qd++;
-            memset(&data->value, 0, sizeof(osm_measurements_value_t));
-            data->num_samples = 0;
-            data->num_samples_init = 0;
-            data->num_samples_collected = 0;
+            _measurements_data_clear(data);
         }
     }
+    if (i == end && end < OSM_MEASUREMENTS_MAX_NUMBER)
+    {
+        /* The rest wait for room to hold them. */
+        _measurements_chunk_prev_start_pos = _measurements_chunk_start_pos;
+        _measurements_chunk_start_pos = i;
+    }
     bool is_max = i == OSM_MEASUREMENTS_MAX_NUMBER;
     if (is_max)
     {
@@ -256,6 +630,7 @@ static void _measurements_send(void)
         if (!send_ret)
         {
             osm_measurements_debug("Protocol send failed, resetting protocol");
+            _measurements_unacked_store();
             _measurements_reset_send();
             return;
         }
@@ -264,6 +639,8 @@ static void _measurements_send(void)
         else
             osm_measurements_debug("Fragment send, wait to send more.");
     }
+    else
+        _measurements_unacked.count = 0;
 }
 
 
@@ -299,14 +676,204 @@ static uint32_t _measurements_get_collection_time(osm_measurements_def_t* def, o
 }
 
 
+static unsigned _measurements_batch_get_intervals(void)
+{
+    /* 0xFF is erased flash from before batching. */
+    uint8_t intervals = persist_data.batch_intervals;
+    if (!intervals || intervals > OSM_MEASUREMENTS_BATCH_MAX)
+        return 1;
+    return intervals;
+}
+
+
+static uint32_t _measurements_batch_get_max_secs(void)
+{
+    uint16_t max_mins = persist_data.batch_max_mins;
+    if (max_mins == UINT16_MAX)
+        return 0;
+    return max_mins * 60UL;
+}
+
+
+static void _measurements_batch_flush(void)
+{
+    if (!_measurements_batch.count)
+        return;
+    osm_measurements_debug("Batch of %"PRIu8" intervals, %u bytes.", _measurements_batch.count, _measurements_batch.len);
+    if (osm_backlog_push(_measurements_batch.start, _measurements_batch.payload, _measurements_batch.len))
+    {
+        for (unsigned i = 0; i < OSM_MEASUREMENTS_MAX_NUMBER; i++)
+        {
+            if (!(_measurements_batch.queued[i / 8] & (1 << (i % 8))))
+                continue;
+            osm_measurements_def_t* def = &_measurements_arr.def[i];
+            osm_measurements_inf_t* inf = _measurements_get_inf(def, &_measurements_arr.data[i]);
+            if (inf && inf->acked_cb)
+                inf->acked_cb(def->name);
+        }
+        _measurements_deadband_sent(&_measurements_batch.deadband);
+    }
+    else
+        /* Counted in the backlog's dropped. */
+        osm_log_error("Failed to add %u bytes to backlog.", _measurements_batch.len);
+    memset(_measurements_batch.queued, 0, sizeof(_measurements_batch.queued));
+    _measurements_batch.deadband.pending = 0;
+    _measurements_batch.count = 0;
+}
+
+
+/* Carry on with the open batch, or start a new payload if there isn't one. */
+static bool _measurements_batch_open(uint32_t now)
+{
+    if (_measurements_batch.count)
+        return osm_protocol_resume(_measurements_batch.payload, _measurements_batch.len) &&
+               osm_protocol_append_interval(now - _measurements_batch.start);
+    _measurements_batch.start = now;
+    return osm_protocol_init_backlog();
+}
+
+
+/* Encode what is due this interval into the batch, flushing it to the
+ * backlog in as many records as it takes, rather than dropping it. */
+static void _measurements_batch_store(uint32_t now)
+{
+    unsigned i = 0;
+
+    while (i < OSM_MEASUREMENTS_MAX_NUMBER)
+    {
+        bool resumed = _measurements_batch.count;
+        if (!_measurements_batch_open(now))
+        {
+            if (resumed)
+            {
+                _measurements_batch_flush();
+                continue;
+            }
+            osm_measurements_debug("Could not initialise protocol for backlog.");
+            return;
+        }
+
+        unsigned num_qd = 0;
+        for (; i < OSM_MEASUREMENTS_MAX_NUMBER; i++)
+        {
+            osm_measurements_def_t*  def  = &_measurements_arr.def[i];
+            osm_measurements_data_t* data = &_measurements_arr.data[i];
+            if (!def->interval || (_interval_count % def->interval != 0))
+                continue;
+            if (data->num_samples == 0)
+            {
+                data->num_samples_init = 0;
+                data->num_samples_collected = 0;
+                osm_log_error("Measurement \"%s\" requested but value not set.", def->name);
+                continue;
+            }
+            if (_measurements_deadband_hold(i))
+            {
+                _measurements_data_clear(data);
+                continue;
+            }
+            if (!osm_protocol_append_measurement(def, data))
+            {
+                if (!num_qd && !resumed)
+                {
+                    osm_log_error("Measurement \"%s\" does not fit in backlog record.", def->name);
+                    i++;
+                }
+                break;
+            }
+            num_qd++;
+            _measurements_deadband_appended(i, &_measurements_batch.deadband);
+            _measurements_batch.queued[i / 8] |= 1 << (i % 8);
+            _measurements_data_clear(data);
+        }
+
+        if (num_qd)
+        {
+            int8_t* payload;
+            _measurements_batch.len = osm_protocol_get_payload(&payload);
+            memcpy(_measurements_batch.payload, payload, _measurements_batch.len);
+            if (!resumed)
+                _measurements_batch.count = 0;
+            _measurements_batch.count++;
+        }
+        if (i < OSM_MEASUREMENTS_MAX_NUMBER)
+            /* Full, the rest go in a record of their own. */
+            _measurements_batch_flush();
+    }
+
+    uint32_t max_secs = _measurements_batch_get_max_secs();
+    uint32_t next = now + INTERVAL_TRANSMIT_MS / 1000;
+    if (_measurements_batch.count >= _measurements_batch_get_intervals() ||
+        (max_secs && next - _measurements_batch.start > max_secs))
+        _measurements_batch_flush();
+    osm_measurements_debug("Backlog holds %u records, %u dropped.", osm_backlog_get_count(), osm_backlog_get_dropped());
+}
+
+
+/* Send the oldest backlog record, one at a time, ahead of new readings. */
+static void _measurements_backlog_send(uint32_t now)
+{
+    if (_measurements_backlog_inflight)
+    {
+        if (osm_since_boot_delta(now, _measurements_backlog_sent_ms) > INTERVAL_TRANSMIT_MS/4)
+        {
+            osm_measurements_debug("Backlog send timed out.");
+            _measurements_backlog_inflight = false;
+        }
+        return;
+    }
+
+    if (_pending_send || !osm_backlog_get_count())
+        return;
+
+    uint32_t timestamp;
+    unsigned len = osm_backlog_peek(&timestamp, _measurements_backlog_buf, sizeof(_measurements_backlog_buf));
+    if (!len)
+    {
+        osm_log_error("Backlog record unreadable, dropping.");
+        osm_backlog_pop();
+        return;
+    }
+
+    uint32_t age = OSM_BACKLOG_TIMESTAMP_UNKNOWN;
+    if (timestamp != OSM_BACKLOG_TIMESTAMP_UNKNOWN)
+        age = now / 1000 - timestamp;
+
+    /* Set first, comms may acknowledge from within the send. */
+    _measurements_backlog_inflight = true;
+    _measurements_backlog_sent_ms = now;
+    if (!osm_protocol_send_backlog(_measurements_backlog_buf, len, age))
+    {
+        osm_measurements_debug("Backlog send failed.");
+        _measurements_backlog_inflight = false;
+    }
+}
+
+
 void osm_on_protocol_sent_ack(bool ack)
 {
+    osm_protocol_sent_ack(ack);
+
+    if (_measurements_backlog_inflight)
+    {
+        _measurements_backlog_inflight = false;
+        if (ack)
+            osm_backlog_pop();
+        if (_pending_send)
+            _measurements_send();
+        return;
+    }
+
     if (!ack)
     {
+        _measurements_unacked_store();
         _measurements_chunk_prev_start_pos = _measurements_chunk_start_pos = 0;
          _pending_send = false;
+        _measurements_deadband_sending.pending = 0;
         return;
     }
+    _measurements_unacked.count = 0;
+    _measurements_deadband_sent(&_measurements_deadband_sending);
     unsigned start = _measurements_chunk_prev_start_pos;
     unsigned end = _measurements_chunk_start_pos ? _measurements_chunk_start_pos : OSM_MEASUREMENTS_MAX_NUMBER;
     for (unsigned i = start; i < end; i++)
@@ -314,12 +881,15 @@ void osm_on_protocol_sent_ack(bool ack)
         osm_measurements_def_t*  def  = &_measurements_arr.def[i];
         if (!def->name[0] || !def->interval || (_interval_count % def->interval != 0))
             continue;
-        osm_measurements_inf_t inf;
-        if (!osm_model_measurements_get_inf(def, NULL, &inf))
+        /* Held back by its dead-band, so nothing to acknowledge. */
+        if (!_measurements_arr.data[i].has_sent)
+            continue;
+        osm_measurements_inf_t* inf = _measurements_get_inf(def, &_measurements_arr.data[i]);
+        if (!inf)
             continue;
 
-        if (inf.acked_cb)
-            inf.acked_cb(def->name);
+        if (inf->acked_cb)
+            inf->acked_cb(def->name);
         _measurements_arr.data[i].has_sent = false;
     }
     if (_pending_send)
@@ -338,8 +908,8 @@ static bool _measurements_def_is_active(osm_measurements_def_t* def)
 static osm_measurements_sensor_state_t _measurements_sample_init_iteration(osm_measurements_def_t* def, osm_measurements_data_t* data)
 {
     /* returns boolean of not busy/waiting for measurement */
-    osm_measurements_inf_t inf;
-    if (!osm_model_measurements_get_inf(def, data, &inf))
+    osm_measurements_inf_t* inf = _measurements_get_inf(def, data);
+    if (!inf)
     {
         osm_measurements_debug("Failed to get the interface for %s.", def->name);
         data->num_samples_init++;
@@ -354,7 +924,7 @@ static osm_measurements_sensor_state_t _measurements_sample_init_iteration(osm_m
         data->num_samples_collected++;
         return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
     }
-    if (!inf.init_cb)
+    if (!inf->init_cb)
     {
         // Init functions are optional
         data->num_samples_init++;
@@ -362,7 +932,7 @@ static osm_measurements_sensor_state_t _measurements_sample_init_iteration(osm_m
         osm_measurements_debug("%s has no init function (optional).", def->name);
         return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
     }
-    osm_measurements_sensor_state_t resp = inf.init_cb(def->name, false);
+    osm_measurements_sensor_state_t resp = inf->init_cb(def->name, false);
     switch(resp)
     {
         case OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS:
@@ -385,8 +955,8 @@ static osm_measurements_sensor_state_t _measurements_sample_init_iteration(osm_m
 
 static bool _measurements_sample_iteration_iteration(osm_measurements_def_t* def, osm_measurements_data_t* data)
 {
-    osm_measurements_inf_t inf;
-    if (!osm_model_measurements_get_inf(def, data, &inf))
+    osm_measurements_inf_t* inf = _measurements_get_inf(def, data);
+    if (!inf)
     {
         osm_measurements_debug("Failed to get the interface for %s.", def->name);
         data->num_samples_init++;
@@ -394,12 +964,12 @@ static bool _measurements_sample_iteration_iteration(osm_measurements_def_t* def
         data->is_collecting = 0;
         return false;
     }
-    if (!inf.iteration_cb)
+    if (!inf->iteration_cb)
     {
         // Iteration callbacks are optional
         return false;
     }
-    osm_measurements_sensor_state_t resp = inf.iteration_cb(def->name);
+    osm_measurements_sensor_state_t resp = inf->iteration_cb(def->name);
     switch (resp)
     {
         case OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS:
@@ -445,6 +1015,29 @@ static osm_measurements_sensor_state_t _measurements_sample_get_resp(osm_measure
 }
 
 
+static int _measurements_stats_find(unsigned index)
+{
+    for (unsigned n = 0; n < OSM_STATS_MAX; n++)
+    {
+        if (persist_data.stats[n] == index + 1)
+            return n;
+    }
+    return -1;
+}
+
+
+static void _measurements_sample_proc_stats(osm_measurements_data_t* data, float value)
+{
+    int slot = _measurements_stats_find(data - _measurements_arr.data);
+    if (slot < 0)
+        return;
+    osm_stats_t* stats = &_measurements_stats[slot];
+    if (data->num_samples == 1)
+        osm_stats_init(stats);
+    osm_stats_add(stats, value);
+}
+
+
 static void _measurements_sample_proc_i64(osm_measurements_data_t* data, osm_measurements_reading_t * new_value)
 {
     osm_measurements_debug("Value : %"PRIi64, new_value->v_i64);
@@ -470,6 +1063,8 @@ static void _measurements_sample_proc_i64(osm_measurements_data_t* data, osm_mea
             data->value.value_64.min = new_value->v_i64;
     }
 
+    _measurements_sample_proc_stats(data, new_value->v_i64);
+
     osm_measurements_debug("Sum : %"PRIi64, data->value.value_64.sum);
     osm_measurements_debug("Min : %"PRIi64, data->value.value_64.min);
     osm_measurements_debug("Max : %"PRIi64, data->value.value_64.max);
@@ -511,6 +1106,8 @@ static void _measurements_sample_proc_float(osm_measurements_data_t* data, osm_m
             data->value.value_f.min = new_value->v_f32;
     }
 
+    _measurements_sample_proc_stats(data, new_value->v_f32);
+
     osm_measurements_debug("Sum : %"PRIi32".%03"PRIu32, data->value.value_f.sum/1000, (uint32_t)abs(data->value.value_f.sum)%1000);
     osm_measurements_debug("Min : %"PRIi32".%03"PRIu32, data->value.value_f.min/1000, (uint32_t)abs(data->value.value_f.min)%1000);
     osm_measurements_debug("Max : %"PRIi32".%03"PRIu32, data->value.value_f.max/1000, (uint32_t)abs(data->value.value_f.max)%1000);
@@ -519,14 +1116,14 @@ static void _measurements_sample_proc_float(osm_measurements_data_t* data, osm_m
 
 static osm_measurements_sensor_state_t _measurements_sample_get_iteration(osm_measurements_def_t* def, osm_measurements_data_t* data)
 {
-    osm_measurements_inf_t inf;
-    if (!osm_model_measurements_get_inf(def, data, &inf))
+    osm_measurements_inf_t* inf = _measurements_get_inf(def, data);
+    if (!inf)
     {
         osm_measurements_debug("Failed to get the interface for %s.", def->name);
         data->num_samples_collected++;
         return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
     }
-    if (!inf.get_cb)
+    if (!inf->get_cb)
     {
         // Get function is non-optional
         data->num_samples_collected++;
@@ -535,7 +1132,7 @@ static osm_measurements_sensor_state_t _measurements_sample_get_iteration(osm_me
     }
 
     osm_measurements_reading_t new_value;
-    osm_measurements_sensor_state_t rsp = _measurements_sample_get_resp(def, data, &inf, &new_value);
+    osm_measurements_sensor_state_t rsp = _measurements_sample_get_resp(def, data, inf, &new_value);
 
     if (rsp == OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS)
     {
@@ -555,16 +1152,18 @@ static osm_measurements_sensor_state_t _measurements_sample_get_iteration(osm_me
                 return false;
         }
 
-        data->collection_time_cache = _measurements_get_collection_time(def, &inf);
+        data->collection_time_cache = _measurements_get_collection_time(def, inf);
     }
     return rsp;
 }
 
 
-static void _measurements_sample(void)
+static uint32_t _measurements_sample_slot(unsigned i, uint32_t now)
 {
+    osm_measurements_def_t*  def  = &_measurements_arr.def[i];
+    osm_measurements_data_t* data = &_measurements_arr.data[i];
+
     uint32_t            sample_interval;
-    uint32_t            now = osm_get_since_boot_ms();
     uint32_t            time_since_interval;
 
     uint32_t            time_init_boundary;
@@ -572,112 +1171,158 @@ static void _measurements_sample(void)
     uint32_t            time_collect;
 
     uint32_t            wait_time;
+    uint32_t            min_wait_time;
 
-    _check_time.last_checked_time = now;
-    _check_time.wait_time = UINT32_MAX;
+    sample_interval = def->interval * INTERVAL_TRANSMIT_MS / def->samplecount;
+    time_since_interval = osm_since_boot_delta(now, _last_sent_ms) + (_interval_count % def->interval) * INTERVAL_TRANSMIT_MS;
 
-    for (unsigned i = 0; i < OSM_MEASUREMENTS_MAX_NUMBER; i++)
-    {
-        osm_measurements_def_t*  def  = &_measurements_arr.def[i];
-        osm_measurements_data_t* data = &_measurements_arr.data[i];
+    /* is_immediate is only valid if samplecount is 1 */
+    bool is_immediate = def->is_immediate && def->samplecount == 1;
 
-        // Breakout if the interval or samplecount is 0 or has no name
-        if (!_measurements_def_is_active(def))
-        {
-            continue;
-        }
-
-        sample_interval = def->interval * INTERVAL_TRANSMIT_MS / def->samplecount;
-        time_since_interval = osm_since_boot_delta(now, _last_sent_ms) + (_interval_count % def->interval) * INTERVAL_TRANSMIT_MS;
-
-        /* is_immediate is only valid if samplecount is 1 */
-        bool is_immediate = def->is_immediate && def->samplecount == 1;
+    if (is_immediate)
+        /* Collect 10 ms before needing to send. */
+        time_init_boundary = (data->num_samples_init * sample_interval) + sample_interval - 10;
+    else
+        time_init_boundary = (data->num_samples_init * sample_interval) + sample_interval/2;
 
-        if (is_immediate)
-            /* Collect 10 ms before needing to send. */
-            time_init_boundary = (data->num_samples_init * sample_interval) + sample_interval - 10;
-        else
-            time_init_boundary = (data->num_samples_init * sample_interval) + sample_interval/2;
+    if (time_init_boundary < data->collection_time_cache)
+    {
+        // Assert that no negative rollover could happen for long collection times. Just do it immediately.
+        data->collection_time_cache = time_init_boundary;
+    }
 
-        if (time_init_boundary < data->collection_time_cache)
+    time_init   = time_init_boundary - data->collection_time_cache;
+    if (is_immediate)
+        time_collect    = (data->num_samples_collected  * sample_interval) + sample_interval - 10;
+    else
+        time_collect    = (data->num_samples_collected  * sample_interval) + sample_interval/2;
+    if (time_since_interval >= time_init)
+    {
+        if (data->num_samples_collected < data->num_samples_init)
         {
-            // Assert that no negative rollover could happen for long collection times. Just do it immediately.
-            data->collection_time_cache = time_init_boundary;
+            data->num_samples_collected++;
+            osm_measurements_debug("Could not collect before next init.");
         }
-
-        time_init   = time_init_boundary - data->collection_time_cache;
-        if (is_immediate)
-            time_collect    = (data->num_samples_collected  * sample_interval) + sample_interval - 10;
-        else
-            time_collect    = (data->num_samples_collected  * sample_interval) + sample_interval/2;
-        if (time_since_interval >= time_init)
+        /* If the init function returned false, then the sensor is
+         * busy, so the wait time should be 0 */
+        osm_measurements_sensor_state_t init_rsp = _measurements_sample_init_iteration(def, data);
+        if (init_rsp == OSM_MEASUREMENTS_SENSOR_STATE_BUSY)
         {
-            if (data->num_samples_collected < data->num_samples_init)
-            {
-                data->num_samples_collected++;
-                osm_measurements_debug("Could not collect before next init.");
-            }
-            /* If the init function returned false, then the sensor is
-             * busy, so the wait time should be 0 */
-            osm_measurements_sensor_state_t init_rsp = _measurements_sample_init_iteration(def, data);
-            if (init_rsp == OSM_MEASUREMENTS_SENSOR_STATE_BUSY)
-            {
-                wait_time = 0;
-            }
-            else
-            {
-                wait_time = osm_since_boot_delta(data->collection_time_cache + time_init, time_since_interval);
-            }
+            wait_time = 0;
         }
         else
         {
-            wait_time = osm_since_boot_delta(time_init, time_since_interval);
+            wait_time = osm_since_boot_delta(data->collection_time_cache + time_init, time_since_interval);
         }
+    }
+    else
+    {
+        wait_time = osm_since_boot_delta(time_init, time_since_interval);
+    }
 
-        if (_check_time.wait_time > wait_time)
-        {
-            _check_time.wait_time = wait_time;
-        }
+    min_wait_time = wait_time;
 
-        // The sample is collected every interval/samplecount but offset by 1/2.
-        // ||   .   .   .   .   .   ||   .   .   .   .   .   ||
-        //    ^   ^   ^   ^   ^   ^    ^   ^   ^   ^   ^   ^
+    // The sample is collected every interval/samplecount but offset by 1/2.
+    // ||   .   .   .   .   .   ||   .   .   .   .   .   ||
+    //    ^   ^   ^   ^   ^   ^    ^   ^   ^   ^   ^   ^
 
-        if (data->num_samples_collected == data->num_samples_init)
-        {
-        }
-        else if (data->num_samples_collected + 1 == data->num_samples_init)
+    if (data->num_samples_collected == data->num_samples_init)
+    {
+    }
+    else if (data->num_samples_collected + 1 == data->num_samples_init)
+    {
+        if (time_since_interval >= time_collect )
         {
-            if (time_since_interval >= time_collect )
+            osm_measurements_sensor_state_t get_rsp = _measurements_sample_get_iteration(def, data);
+            if (get_rsp == OSM_MEASUREMENTS_SENSOR_STATE_BUSY)
             {
-                osm_measurements_sensor_state_t get_rsp = _measurements_sample_get_iteration(def, data);
-                if (get_rsp == OSM_MEASUREMENTS_SENSOR_STATE_BUSY)
-                {
-                    wait_time = 0;
-                }
-                else
-                {
-                    wait_time = osm_since_boot_delta(time_collect + sample_interval, data->collection_time_cache + time_since_interval);
-                }
+                wait_time = 0;
             }
             else
             {
-                wait_time = osm_since_boot_delta(time_collect, time_since_interval);
+                wait_time = osm_since_boot_delta(time_collect + sample_interval, data->collection_time_cache + time_since_interval);
             }
         }
         else
         {
-            osm_log_error("Collect and init fell out of sync for %s, skipping collects.", def->name);
-            data->num_samples_collected = data->num_samples_init;
+            wait_time = osm_since_boot_delta(time_collect, time_since_interval);
         }
+    }
+    else
+    {
+        osm_log_error("Collect and init fell out of sync for %s, skipping collects.", def->name);
+        data->num_samples_collected = data->num_samples_init;
+    }
+
+    if (min_wait_time > wait_time)
+    {
+        min_wait_time = wait_time;
+    }
+    osm_uart_rings_out_drain();
+    return min_wait_time;
+}
+
+
+static void _measurements_sched_invalidate(void)
+{
+    _measurements_sched.dirty = true;
+    /* Don't wait out a stale wait time to reschedule. */
+    _check_time.wait_time = 0;
+}
+
+
+static bool _measurements_sched_is_stale(void)
+{
+    return _measurements_sched.dirty                                            ||
+           _measurements_sched.built_last_sent_ms     != _last_sent_ms          ||
+           _measurements_sched.built_interval_count   != _interval_count        ||
+           _measurements_sched.built_transmit_interval != transmit_interval;
+}
+
+
+static void _measurements_sched_rebuild(uint32_t now)
+{
+    osm_sched_clear(&_measurements_sched.sched);
+    _measurements_sched.dirty                   = false;
+    _measurements_sched.built_last_sent_ms      = _last_sent_ms;
+    _measurements_sched.built_interval_count    = _interval_count;
+    _measurements_sched.built_transmit_interval = transmit_interval;
+
+    for (unsigned i = 0; i < OSM_MEASUREMENTS_MAX_NUMBER; i++)
+    {
+        // Breakout if the interval or samplecount is 0 or has no name
+        if (!_measurements_def_is_active(&_measurements_arr.def[i]))
+            continue;
+
+        osm_sched_push(&_measurements_sched.sched, i, now + _measurements_sample_slot(i, now));
+    }
+}
 
-        if (_check_time.wait_time > wait_time)
+
+static void _measurements_sample(void)
+{
+    uint32_t now = osm_get_since_boot_ms();
+
+    _check_time.last_checked_time = now;
+
+    if (_measurements_sched_is_stale())
+    {
+        _measurements_sched_rebuild(now);
+    }
+    else
+    {
+        /* Only touch the measurements that are due, a busy one is
+         * retried on the next pass rather than spun on. */
+        unsigned i;
+        while (osm_sched_take_due(&_measurements_sched.sched, now, &i))
         {
-            _check_time.wait_time = wait_time;
+            if (!_measurements_def_is_active(&_measurements_arr.def[i]))
+                continue;
+            osm_sched_put_back(&_measurements_sched.sched, i, now, _measurements_sample_slot(i, now));
         }
-        osm_uart_rings_out_drain();
     }
-    if (_check_time.wait_time == UINT32_MAX)
+
+    if (!osm_sched_get_wait(&_measurements_sched.sched, now, &_check_time.wait_time))
         _check_time.wait_time = 0;
 }
 
@@ -730,17 +1375,17 @@ bool osm_measurements_add(osm_measurements_def_t* measurements_def)
         memcpy(def, measurements_def, sizeof(osm_measurements_def_t));
         memset(data, 0, sizeof(osm_measurements_data_t));
         {
-            osm_measurements_inf_t inf;
-            if (!osm_model_measurements_get_inf(def, data, &inf))
+            osm_measurements_inf_t* inf = _measurements_get_inf(def, data);
+            if (!inf)
             {
                 osm_log_error("Could not get measurement interface.");
                 memset(def, 0, sizeof(osm_measurements_def_t));
                 memset(data, 0, sizeof(osm_measurements_data_t));
                 return false;
             }
-            data->collection_time_cache = _measurements_get_collection_time(def, &inf);
-            if (inf.enable_cb)
-                inf.enable_cb(def->name, def->interval > 0);
+            data->collection_time_cache = _measurements_get_collection_time(def, inf);
+            if (inf->enable_cb)
+                inf->enable_cb(def->name, def->interval > 0);
         }
         unsigned name_len = strnlen(def->name, OSM_MEASURE_NAME_LEN);
         unsigned i;
@@ -754,6 +1399,8 @@ bool osm_measurements_add(osm_measurements_def_t* measurements_def)
             if (def->name[i] == ' ')
                 def->name[i] = '\0';
         }
+        _measurements_name_index_rebuild();
+        _measurements_sched_invalidate();
         return true;
     }
     osm_log_error("Could not find a space to add %s", measurements_def->name);
@@ -763,23 +1410,30 @@ bool osm_measurements_add(osm_measurements_def_t* measurements_def)
 
 bool osm_measurements_del(char* name)
 {
-    for (unsigned i = 0; i < OSM_MEASUREMENTS_MAX_NUMBER; i++)
-    {
-        if (strcmp(name, _measurements_arr.def[i].name) == 0)
-        {
-            osm_measurements_def_t*  def = &_measurements_arr.def[i];
-            osm_measurements_data_t* data = &_measurements_arr.data[i];
-            osm_measurements_inf_t inf;
-            if (!osm_model_measurements_get_inf(def, data, &inf))
-                return false;
-            if (inf.enable_cb)
-                inf.enable_cb(def->name, false);
-            memset(def, 0, sizeof(osm_measurements_def_t));
-            memset(data, 0, sizeof(osm_measurements_data_t));
-            return true;
-        }
-    }
-    return false;
+    osm_measurements_def_t*  def;
+    osm_measurements_data_t* data;
+    if (!osm_measurements_get_measurements_def(name, &def, &data))
+        return false;
+
+    osm_measurements_inf_t* inf = _measurements_get_inf(def, data);
+    if (!inf)
+        return false;
+    if (inf->enable_cb)
+        inf->enable_cb(def->name, false);
+    int slot = osm_deadband_find(persist_data.deadbands, def - _measurements_arr.def);
+    if (slot != OSM_DEADBAND_NONE)
+    {
+        osm_deadband_clear(&persist_data.deadbands[slot], &_measurements_deadband_state[slot]);
+        _measurements_deadband_forget(slot);
+    }
+    slot = _measurements_stats_find(def - _measurements_arr.def);
+    if (slot >= 0)
+        persist_data.stats[slot] = 0;
+    memset(def, 0, sizeof(osm_measurements_def_t));
+    memset(data, 0, sizeof(osm_measurements_data_t));
+    _measurements_name_index_rebuild();
+    _measurements_sched_invalidate();
+    return true;
 }
 
 
@@ -792,14 +1446,15 @@ bool measurements_set_interval(char* name, uint8_t interval)
         return false;
     }
 
-    osm_measurements_inf_t inf;
-    if (!osm_model_measurements_get_inf(def, data, &inf))
+    osm_measurements_inf_t* inf = _measurements_get_inf(def, data);
+    if (!inf)
         return false;
 
-    if (inf.enable_cb && ((interval > 0) != (def->interval > 0)))
-        inf.enable_cb(name, interval > 0);
+    if (inf->enable_cb && ((interval > 0) != (def->interval > 0)))
+        inf->enable_cb(name, interval > 0);
 
     def->interval = interval;
+    _measurements_sched_invalidate();
     return true;
 }
 
@@ -829,6 +1484,7 @@ bool measurements_set_samplecount(char* name, uint8_t samplecount)
         return false;
     }
     measurements_def->samplecount = samplecount;
+    _measurements_sched_invalidate();
     return true;
 }
 
@@ -845,6 +1501,138 @@ bool measurements_get_samplecount(char* name, uint8_t * samplecount)
 }
 
 
+bool measurements_set_deadband(char* name, uint32_t abs_band, uint16_t rel_band, uint8_t heartbeat)
+{
+    osm_measurements_def_t* measurements_def = NULL;
+    if (!osm_measurements_get_measurements_def(name, &measurements_def, NULL))
+    {
+        return false;
+    }
+    unsigned index = measurements_def - _measurements_arr.def;
+
+    int slot = osm_deadband_find(persist_data.deadbands, index);
+    if (slot != OSM_DEADBAND_NONE)
+    {
+        osm_deadband_clear(&persist_data.deadbands[slot], &_measurements_deadband_state[slot]);
+        _measurements_deadband_forget(slot);
+    }
+
+    if (!abs_band && !rel_band)
+        return true;
+
+    slot = osm_deadband_get_free(persist_data.deadbands);
+    if (slot == OSM_DEADBAND_NONE)
+    {
+        osm_log_error("No free dead-bands, max is %u.", OSM_DEADBAND_MAX);
+        return false;
+    }
+    osm_deadband_t* band = &persist_data.deadbands[slot];
+    band->index     = index;
+    band->abs_band  = abs_band;
+    band->rel_band  = rel_band;
+    band->heartbeat = heartbeat;
+    return true;
+}
+
+
+bool measurements_set_stats(char* name, bool enabled)
+{
+    osm_measurements_def_t* measurements_def = NULL;
+    osm_measurements_data_t* data;
+    if (!osm_measurements_get_measurements_def(name, &measurements_def, &data))
+    {
+        return false;
+    }
+    unsigned index = measurements_def - _measurements_arr.def;
+    int slot = _measurements_stats_find(index);
+    if (!enabled)
+    {
+        if (slot >= 0)
+            persist_data.stats[slot] = 0;
+        return true;
+    }
+    if (slot >= 0)
+        return true;
+    for (slot = 0; slot < OSM_STATS_MAX && persist_data.stats[slot]; slot++);
+    if (slot == OSM_STATS_MAX)
+    {
+        osm_log_error("No free stats, max is %u.", OSM_STATS_MAX);
+        return false;
+    }
+    /* Start afresh with the next interval's first sample. */
+    _measurements_data_clear(data);
+    persist_data.stats[slot] = index + 1;
+    return true;
+}
+
+
+bool measurements_get_stats(char* name, bool* enabled)
+{
+    osm_measurements_def_t* measurements_def = NULL;
+    if (!enabled || !osm_measurements_get_measurements_def(name, &measurements_def, NULL))
+    {
+        return false;
+    }
+    *enabled = _measurements_stats_find(measurements_def - _measurements_arr.def) >= 0;
+    return true;
+}
+
+
+bool osm_measurements_get_stats(osm_measurements_data_t* data, osm_measurements_stats_t* stats)
+{
+    int slot = _measurements_stats_find(data - _measurements_arr.data);
+    if (slot < 0 || _measurements_stats[slot].count != data->num_samples || data->num_samples < 2)
+        return false;
+    osm_stats_t* s = &_measurements_stats[slot];
+    stats->stddev = lroundf(osm_stats_get_stddev(s));
+    stats->p50    = lroundf(osm_stats_get_p50(s));
+    stats->p95    = lroundf(osm_stats_get_p95(s));
+    return true;
+}
+
+
+bool measurements_set_batch(uint8_t intervals, uint16_t max_mins)
+{
+    if (!intervals || intervals > OSM_MEASUREMENTS_BATCH_MAX || max_mins == UINT16_MAX)
+        return false;
+    /* What is open was batched on the old settings. */
+    _measurements_batch_flush();
+    persist_data.batch_intervals = intervals;
+    persist_data.batch_max_mins = max_mins;
+    return true;
+}
+
+
+void measurements_get_batch(uint8_t* intervals, uint16_t* max_mins)
+{
+    *intervals = _measurements_batch_get_intervals();
+    *max_mins = _measurements_batch_get_max_secs() / 60;
+}
+
+
+bool measurements_get_deadband(char* name, uint32_t* abs_band, uint16_t* rel_band, uint8_t* heartbeat)
+{
+    osm_measurements_def_t* measurements_def = NULL;
+    if (!abs_band || !rel_band || !heartbeat ||
+        !osm_measurements_get_measurements_def(name, &measurements_def, NULL))
+    {
+        return false;
+    }
+    int slot = osm_deadband_find(persist_data.deadbands, measurements_def - _measurements_arr.def);
+    if (slot == OSM_DEADBAND_NONE)
+    {
+        *abs_band = 0;
+        *rel_band = 0;
+        *heartbeat = 0;
+        return true;
+    }
+    *abs_band  = persist_data.deadbands[slot].abs_band;
+    *rel_band  = persist_data.deadbands[slot].rel_band;
+    *heartbeat = persist_data.deadbands[slot].heartbeat;
+    return true;
+}
+
+
 static uint16_t _measurements_iterate_callbacks(void)
 {
     uint16_t active_count = 0;
@@ -878,6 +1666,10 @@ static void _measurements_sleep_iteration(void)
             return;
     }
 
+    /* Up for the window of edges to close. */
+    if (osm_io_watch_events_pending())
+        return;
+
     uint32_t sleep_time;
     /* Get new now as above functions may have taken a while */
     uint32_t now = osm_get_since_boot_ms();
@@ -937,6 +1729,20 @@ void _measurements_check_instant_send(void)
     if (!to_instant_send)
         return;
 
+    /* Before taking the flags, so they wait for when it can send. */
+    if (_measurements_chunk_start_pos != OSM_MEASUREMENTS_MAX_NUMBER && _measurements_chunk_start_pos != 0)
+    {
+        osm_measurements_debug("Cannot instant send, there is a measurement send underway.");
+        return;
+    }
+    uint32_t now = osm_get_since_boot_ms();
+    /* Add +10 as this is called before measurements_send and to ensure no negative overflow. */
+    if (osm_since_boot_delta(_last_sent_ms + INTERVAL_TRANSMIT_MS + 10, now) <= MEASUREMENTS_MIN_TRANSMIT_MS + 10)
+    {
+        osm_measurements_debug("Cannot send instant send, scheduled uplink soon.");
+        return;
+    }
+
     if (!osm_protocol_init())
     {
         osm_measurements_debug("Could not initialise the hex array for the protocol.");
@@ -967,23 +1773,14 @@ void _measurements_check_instant_send(void)
             count++;
         }
     }
+    /* The edges behind the levels, in what room they left. */
+    if (osm_io_watch_append_events())
+        count++;
     if (!count)
     {
         osm_measurements_debug("No measurements were added, not sending.");
         return;
     }
-    if (_measurements_chunk_start_pos != OSM_MEASUREMENTS_MAX_NUMBER && _measurements_chunk_start_pos != 0)
-    {
-        osm_measurements_debug("Cannot instant send, there is a measurement send underway.");
-        return;
-    }
-    uint32_t now = osm_get_since_boot_ms();
-    /* Add +10 as this is called before measurements_send and to ensure no negative overflow. */
-    if (osm_since_boot_delta(_last_sent_ms + INTERVAL_TRANSMIT_MS + 10, now) <= MEASUREMENTS_MIN_TRANSMIT_MS + 10)
-    {
-        osm_measurements_debug("Cannot send instant send, scheduled uplink soon.");
-        return;
-    }
     osm_protocol_send();
 }
 
@@ -995,30 +1792,31 @@ void osm_measurements_loop_iteration(void)
 
     static bool has_printed_no_con = false;
 
-    if (!osm_protocol_get_connected())
+    uint32_t now = osm_get_since_boot_ms();
+    bool connected = osm_protocol_get_connected();
+
+    if (!connected)
     {
         if (!has_printed_no_con)
         {
-            osm_measurements_debug("Not connected to send, not taking readings.");
+            osm_measurements_debug("Not connected to send, queuing readings in backlog.");
             has_printed_no_con = true;
             _measurements_chunk_start_pos = _measurements_chunk_prev_start_pos = 0;
             _pending_send = false;
+            _measurements_backlog_inflight = false;
         }
-        _measurements_iterate_callbacks();
-        return;
     }
-    uint32_t now = osm_get_since_boot_ms();
-
-    if (has_printed_no_con)
+    else if (has_printed_no_con)
     {
-        osm_measurements_debug("Connected to send, starting readings.");
-        _last_sent_ms = now;
+        osm_measurements_debug("Connected to send, %u backlog records to send.", osm_backlog_get_count());
         has_printed_no_con = false;
-        return;
     }
 
-    if (osm_protocol_send_ready())
+    if (connected && osm_protocol_send_ready())
+    {
         _measurements_check_instant_send();
+        _measurements_backlog_send(now);
+    }
 
     if (osm_since_boot_delta(now, _check_time.last_checked_time) > _check_time.wait_time)
     {
@@ -1031,7 +1829,14 @@ void osm_measurements_loop_iteration(void)
             _interval_count = 0;
         }
         _interval_count++;
-        _measurements_send();
+        if (connected && _measurements_batch_get_intervals() == 1)
+            _measurements_send();
+        else
+        {
+            /* Batches are sent from the backlog as they are flushed. */
+            _measurements_batch_store(now / 1000);
+            _last_sent_ms = now;
+        }
     }
     uint16_t count_active = _measurements_iterate_callbacks();
     /* If no measurements require active calls. */
@@ -1086,6 +1891,25 @@ void osm_measurements_init(void)
     }
     else osm_measurements_debug("Loading measurements.");
 
+    _measurements_name_index_rebuild();
+
+    for (unsigned n = 0; n < OSM_DEADBAND_MAX; n++)
+    {
+        osm_deadband_t* band = &persist_data.deadbands[n];
+        if (!osm_deadband_is_set(band) || !_measurements_arr.def[band->index].name[0])
+        {
+            osm_deadband_clear(band, &_measurements_deadband_state[n]);
+            _measurements_deadband_forget(n);
+        }
+    }
+
+    for (unsigned n = 0; n < OSM_STATS_MAX; n++)
+    {
+        uint16_t index = persist_data.stats[n];
+        if (index > OSM_MEASUREMENTS_MAX_NUMBER || (index && !_measurements_arr.def[index - 1].name[0]))
+            persist_data.stats[n] = 0;
+    }
+
     for(unsigned n = 0; n < OSM_MEASUREMENTS_MAX_NUMBER; n++)
     {
         osm_measurements_def_t* def = &_measurements_arr.def[n];
@@ -1094,23 +1918,27 @@ void osm_measurements_init(void)
         if (!def->name[0])
             continue;
 
-        osm_measurements_inf_t inf;
-        if (!osm_model_measurements_get_inf(def, data, &inf))
+        osm_measurements_inf_t* inf = _measurements_get_inf(def, data);
+        if (!inf)
             continue;
-        _measurements_arr.data[n].collection_time_cache = _measurements_get_collection_time(def, &inf);
-        if (inf.enable_cb)
-            inf.enable_cb(def->name, def->interval > 0);
+        _measurements_arr.data[n].collection_time_cache = _measurements_get_collection_time(def, inf);
+        if (inf->enable_cb)
+            inf->enable_cb(def->name, def->interval > 0);
     }
 
     if (!found)
         osm_persist_commit();
 
+    _measurements_sched_invalidate();
+
     transmit_interval = persist_data.model_config.mins_interval;
 
     if (transmit_interval % 1000)
         osm_measurements_debug("Loading interval of %"PRIu32".%03"PRIu32" minutes", transmit_interval/1000, transmit_interval%1000);
     else
         osm_measurements_debug("Loading interval of %"PRIu32" minutes", transmit_interval/1000);
+
+    osm_backlog_init();
 }
 
 
@@ -1178,30 +2006,30 @@ static bool _measurements_get_reading2(osm_measurements_def_t* def, osm_measurem
         return false;
     }
 
-    osm_measurements_inf_t inf;
-    if (!osm_model_measurements_get_inf(def, data, &inf))
+    osm_measurements_inf_t* inf = _measurements_get_inf(def, data);
+    if (!inf)
     {
         osm_measurements_debug("Could not get measurement interface.");
         return false;
     }
 
-    bool was_not_enabled = inf.is_enabled_cb && inf.enable_cb && !inf.is_enabled_cb(def->name);
+    bool was_not_enabled = inf->is_enabled_cb && inf->enable_cb && !inf->is_enabled_cb(def->name);
     if (was_not_enabled)
-        inf.enable_cb(def->name, true);
+        inf->enable_cb(def->name, true);
 
-    if (inf.init_cb && inf.init_cb(def->name, true) != OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS)
+    if (inf->init_cb && inf->init_cb(def->name, true) != OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS)
     {
         osm_measurements_debug("Could not begin the measurement.");
         goto bad_exit;
     }
-    data->collection_time_cache = _measurements_get_collection_time(def, &inf);
+    data->collection_time_cache = _measurements_get_collection_time(def, inf);
 
     data->is_collecting = 1;
     uint32_t init_time = osm_get_since_boot_ms();
 
-    _measurements_get_reading_packet_t info = {{def, data, &inf}, reading, type, false};
+    _measurements_get_reading_packet_t info = {{def, data, inf}, reading, type, false};
     bool iterate_success = osm_main_loop_iterate_for(data->collection_time_cache, _measurements_get_reading_iteration, &info);
-    if (inf.iteration_cb && !iterate_success)
+    if (inf->iteration_cb && !iterate_success)
     {
         osm_measurements_debug("Failed on iterate.");
         goto bad_exit;
@@ -1232,12 +2060,14 @@ static bool _measurements_get_reading2(osm_measurements_def_t* def, osm_measurem
         osm_measurements_debug("Collect is timed out...");
 
     if (was_not_enabled)
-        inf.enable_cb(def->name, false);
+        inf->enable_cb(def->name, false);
 
+    /* Collection time may have changed under the scheduler. */
+    _measurements_sched_invalidate();
     return info.func_success;
 bad_exit:
     if (was_not_enabled)
-        inf.enable_cb(def->name, false);
+        inf->enable_cb(def->name, false);
     data->is_collecting = 0;
     return false;
 }
@@ -1303,12 +2133,16 @@ bool osm_measurements_rename(char* orig_name, char* new_name_raw)
         return false;
     }
     osm_measurements_def_t* def;
-    if (!osm_measurements_get_measurements_def(orig_name, &def, NULL))
+    osm_measurements_data_t* data;
+    if (!osm_measurements_get_measurements_def(orig_name, &def, &data))
     {
         osm_measurements_debug("Can not get the measurements def.");
         return false;
     }
     strncpy(def->name, new_name, OSM_MEASURE_NAME_NULLED_LEN);
+    /* Value type is resolved by name, so resolve again. */
+    data->inf_cached = 0;
+    _measurements_name_index_rebuild();
     return true;
 }
 
@@ -1378,15 +2212,16 @@ static osm_command_response_t _measurements_get_to_cb(char* args, osm_cmd_ctx_t
     char * p = osm_skip_space(args);
 
     osm_measurements_def_t* def;
-    osm_measurements_inf_t inf;
-    if (!osm_measurements_get_measurements_def(p, &def, NULL) ||
-        !osm_model_measurements_get_inf(def, NULL, &inf))
+    osm_measurements_data_t* data;
+    osm_measurements_inf_t* inf;
+    if (!osm_measurements_get_measurements_def(p, &def, &data) ||
+        !(inf = _measurements_get_inf(def, data)))
     {
         osm_cmd_ctx_error(ctx,"Failed to get measurement details of \"%s\"", p);
         return OSM_COMMAND_RESP_ERR;
     }
 
-    osm_cmd_ctx_out(ctx,"%s : %u", p, (unsigned)(_measurements_get_collection_time(def, &inf) * 1.5));
+    osm_cmd_ctx_out(ctx,"%s : %u", p, (unsigned)(_measurements_get_collection_time(def, inf) * 1.5));
     return OSM_COMMAND_RESP_OK;
 }
 
@@ -1410,6 +2245,10 @@ static const char* measurements_type_to_str(osm_measurements_def_type_t type)
     static const char custom_0_name[]       = OSM_MEASUREMENTS_DEF_NAME_CUSTOM_0;
     static const char custom_1_name[]       = OSM_MEASUREMENTS_DEF_NAME_CUSTOM_1;
     static const char io_reading_name[]     = OSM_MEASUREMENTS_DEF_NAME_IO_READING;
+    static const char cc_power_name[]       = OSM_MEASUREMENTS_DEF_NAME_CC_POWER;
+    static const char cc_thd_name[]         = OSM_MEASUREMENTS_DEF_NAME_CC_THD;
+    static const char sound_level_name[]    = OSM_MEASUREMENTS_DEF_NAME_SOUND_LEVEL;
+    static const char pulse_timing_name[]   = OSM_MEASUREMENTS_DEF_NAME_PULSE_TIMING;
 
     switch (type)
     {
@@ -1447,6 +2286,14 @@ static const char* measurements_type_to_str(osm_measurements_def_type_t type)
             return custom_1_name;
         case OSM_IO_READING:
             return io_reading_name;
+        case OSM_CC_POWER:
+            return cc_power_name;
+        case OSM_CC_THD:
+            return cc_thd_name;
+        case OSM_SOUND_LEVEL:
+            return sound_level_name;
+        case OSM_PULSE_TIMING:
+            return pulse_timing_name;
         default:
             break;
     }
@@ -1571,6 +2418,126 @@ static osm_command_response_t _measurements_samplecount_cb(char * args, osm_cmd_
 }
 
 
+/* deadband <name> [<abs> <rel %> <heartbeat>], abs is in reported units
+ * and 0 0 turns it off. */
+static osm_command_response_t _measurements_deadband_cb(char * args, osm_cmd_ctx_t * ctx)
+{
+    char* p = osm_skip_space(args);
+    char* name = p;
+    p = strchr(p, ' ');
+    if (p)
+    {
+        p[0] = 0;
+        p = osm_skip_space(p+1);
+    }
+
+    osm_measurements_def_t* def;
+    osm_measurements_data_t* data;
+    if (!osm_measurements_get_measurements_def(name, &def, &data))
+    {
+        osm_cmd_ctx_error(ctx,"Unknown measurement");
+        return OSM_COMMAND_RESP_ERR;
+    }
+    _measurements_get_inf(def, data);
+    unsigned scale = (data->value_type == OSM_MEASUREMENTS_VALUE_TYPE_FLOAT) ? 1000 : 1;
+
+    if (p && (isdigit((int)p[0]) || p[0] == '.'))
+    {
+        char* np;
+        double abs_band = strtod(p, &np);
+        double rel_band = strtod(np, &np);
+        unsigned long heartbeat = strtoul(np, NULL, 10);
+        if (abs_band < 0 || abs_band * scale > UINT32_MAX ||
+            rel_band < 0 || rel_band * 10 > UINT16_MAX     ||
+            heartbeat > UINT8_MAX)
+        {
+            osm_cmd_ctx_error(ctx,"deadband <name> [<abs> <rel %%> <heartbeat>]");
+            return OSM_COMMAND_RESP_ERR;
+        }
+        if (data->value_type == OSM_MEASUREMENTS_VALUE_TYPE_STR)
+        {
+            osm_cmd_ctx_error(ctx,"No dead-band for string measurements");
+            return OSM_COMMAND_RESP_ERR;
+        }
+        if (!measurements_set_deadband(name, abs_band * scale, rel_band * 10, heartbeat))
+        {
+            osm_cmd_ctx_error(ctx,"Failed to set dead-band");
+            return OSM_COMMAND_RESP_ERR;
+        }
+    }
+
+    uint32_t abs_band;
+    uint16_t rel_band;
+    uint8_t heartbeat;
+    measurements_get_deadband(name, &abs_band, &rel_band, &heartbeat);
+    if (!abs_band && !rel_band)
+        osm_cmd_ctx_out(ctx,"%s has no dead-band", name);
+    else if (scale == 1000)
+        osm_cmd_ctx_out(ctx,"Dead-band of %s = %"PRIu32".%03"PRIu32" %u.%u%% heartbeat %"PRIu8,
+                        name, abs_band / 1000, abs_band % 1000, rel_band / 10, rel_band % 10, heartbeat);
+    else
+        osm_cmd_ctx_out(ctx,"Dead-band of %s = %"PRIu32" %u.%u%% heartbeat %"PRIu8,
+                        name, abs_band, rel_band / 10, rel_band % 10, heartbeat);
+    return OSM_COMMAND_RESP_OK;
+}
+
+
+static osm_command_response_t _measurements_stats_cb(char * args, osm_cmd_ctx_t * ctx)
+{
+    char* p = osm_skip_space(args);
+    char* name = p;
+    p = strchr(p, ' ');
+    if (p)
+    {
+        p[0] = 0;
+        p = osm_skip_space(p+1);
+    }
+    if (p && isdigit((int)p[0]))
+    {
+        bool enabled = strtoul(p, NULL, 10);
+        if (!measurements_set_stats(name, enabled))
+        {
+            osm_cmd_ctx_error(ctx,"Failed to set stats of %s", name);
+            return OSM_COMMAND_RESP_ERR;
+        }
+    }
+    bool enabled;
+    if (!measurements_get_stats(name, &enabled))
+    {
+        osm_cmd_ctx_error(ctx,"Unknown measurement");
+        return OSM_COMMAND_RESP_ERR;
+    }
+    osm_cmd_ctx_out(ctx,"Stats of %s = %s", name, enabled ? "on" : "off");
+    return OSM_COMMAND_RESP_OK;
+}
+
+
+static osm_command_response_t _measurements_batch_cb(char * args, osm_cmd_ctx_t * ctx)
+{
+    char* p = osm_skip_space(args);
+    if (isdigit((int)p[0]))
+    {
+        char* np;
+        unsigned long intervals = strtoul(p, &np, 10);
+        unsigned long max_mins = strtoul(np, NULL, 10);
+        if (intervals > UINT8_MAX || max_mins >= UINT16_MAX ||
+            !measurements_set_batch(intervals, max_mins))
+        {
+            osm_cmd_ctx_error(ctx,"batch [<intervals 1-%u> [<max mins>]]", OSM_MEASUREMENTS_BATCH_MAX);
+            return OSM_COMMAND_RESP_ERR;
+        }
+    }
+    uint8_t intervals;
+    uint16_t max_mins;
+    measurements_get_batch(&intervals, &max_mins);
+    if (max_mins)
+        osm_cmd_ctx_out(ctx,"Batch of %"PRIu8" intervals, flushed after %"PRIu16" mins", intervals, max_mins);
+    else
+        osm_cmd_ctx_out(ctx,"Batch of %"PRIu8" intervals", intervals);
+    return OSM_COMMAND_RESP_OK;
+}
+
+
 static osm_command_response_t _measurements_repop_cb(char* args, osm_cmd_ctx_t * ctx)
 {
     osm_model_measurements_repopulate();
@@ -1634,6 +2601,7 @@ static osm_command_response_t _measurements_is_immediate_cb(char* args, osm_cmd_
         goto print_out;
 
     def->is_immediate = enabled;
+    _measurements_sched_invalidate();
 
 print_out:
     if (def->is_immediate)
@@ -1655,6 +2623,9 @@ struct osm_cmd_link_t* osm_measurements_add_commands(struct osm_cmd_link_t* tail
         { "get_meas_type","Get the type of measurement",         _measurements_get_type_cb       , false , NULL },
         { "interval",     "Get/Set the interval",                _measurements_interval_cb       , false , NULL },
         { "samplecount",  "Get/Set the samplecount",             _measurements_samplecount_cb    , false , NULL },
+        { "deadband",     "Get/Set report by exception band",    _measurements_deadband_cb       , false , NULL },
+        { "stats",        "Get/Set sending sample spread",       _measurements_stats_cb          , false , NULL },
+        { "batch",        "Get/Set intervals per uplink",        _measurements_batch_cb          , false , NULL },
         { "interval_mins","Get/Set interval minutes",            _measurements_interval_mins_cb  , false , NULL },
         { "repop",        "Repopulate measurements.",            _measurements_repop_cb          , false , NULL },
         { "is_immediate", "Set/unset immediate measurements.",   _measurements_is_immediate_cb   , false , NULL },
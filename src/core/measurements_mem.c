@@ -23,15 +23,78 @@ void osm_measurements_repop_indiv(char* name, uint8_t interval, uint8_t sampleco
 }
 
 
+typedef struct
+{
+    char* const*                names;
+    unsigned                    count;
+    osm_measurements_def_type_t type;
+} measurements_group_t;
+
+
+static char* const _measurements_cc_power_names[]       = { OSM_MEASUREMENTS_CC_REAL_POWER_NAME,
+                                                            OSM_MEASUREMENTS_CC_APPARENT_POWER_NAME,
+                                                            OSM_MEASUREMENTS_CC_POWER_FACTOR_NAME,
+                                                            OSM_MEASUREMENTS_CC_ENERGY_NAME };
+static char* const _measurements_cc_thd_names[]         = { OSM_MEASUREMENTS_CC_THD_1_NAME,
+                                                            OSM_MEASUREMENTS_CC_THD_2_NAME,
+                                                            OSM_MEASUREMENTS_CC_THD_3_NAME };
+static char* const _measurements_pulse_timing_names[]   = { OSM_MEASUREMENTS_PULSE_RATE_NAME_1,
+                                                            OSM_MEASUREMENTS_PULSE_MIN_NAME_1,
+                                                            OSM_MEASUREMENTS_PULSE_MAX_NAME_1,
+                                                            OSM_MEASUREMENTS_PULSE_JITTER_NAME_1,
+                                                            OSM_MEASUREMENTS_PULSE_RATE_NAME_2,
+                                                            OSM_MEASUREMENTS_PULSE_MIN_NAME_2,
+                                                            OSM_MEASUREMENTS_PULSE_MAX_NAME_2,
+                                                            OSM_MEASUREMENTS_PULSE_JITTER_NAME_2 };
+static char* const _measurements_sound_level_names[]    = { OSM_MEASUREMENTS_SOUND_LAEQ_NAME,
+                                                            OSM_MEASUREMENTS_SOUND_LAMAX_NAME,
+                                                            OSM_MEASUREMENTS_SOUND_LAMIN_NAME,
+                                                            OSM_MEASUREMENTS_SOUND_BAND_31_NAME,
+                                                            OSM_MEASUREMENTS_SOUND_BAND_63_NAME,
+                                                            OSM_MEASUREMENTS_SOUND_BAND_125_NAME,
+                                                            OSM_MEASUREMENTS_SOUND_BAND_250_NAME,
+                                                            OSM_MEASUREMENTS_SOUND_BAND_500_NAME,
+                                                            OSM_MEASUREMENTS_SOUND_BAND_1K_NAME,
+                                                            OSM_MEASUREMENTS_SOUND_BAND_2K_NAME };
+
+static const measurements_group_t _measurements_groups[] =
+{
+    [OSM_MEASUREMENTS_GROUP_CC_POWER]       = { _measurements_cc_power_names,     OSM_ARRAY_SIZE(_measurements_cc_power_names),     OSM_CC_POWER     },
+    [OSM_MEASUREMENTS_GROUP_CC_THD]         = { _measurements_cc_thd_names,       OSM_ARRAY_SIZE(_measurements_cc_thd_names),       OSM_CC_THD       },
+    [OSM_MEASUREMENTS_GROUP_PULSE_TIMING]   = { _measurements_pulse_timing_names, OSM_ARRAY_SIZE(_measurements_pulse_timing_names), OSM_PULSE_TIMING },
+    [OSM_MEASUREMENTS_GROUP_SOUND_LEVEL]    = { _measurements_sound_level_names,  OSM_ARRAY_SIZE(_measurements_sound_level_names),  OSM_SOUND_LEVEL  },
+};
+
+
+/* Returns how many were set up, for the model to move its position on. */
+unsigned osm_measurements_setup_group_defaults(osm_measurements_def_t* measurements_arr, osm_measurements_group_t group)
+{
+    const measurements_group_t* g = &_measurements_groups[group];
+    for (unsigned i = 0; i < g->count; i++)
+        osm_measurements_setup_default(&measurements_arr[i], g->names[i], 0, 1, g->type);
+    return g->count;
+}
+
+
+void osm_measurements_repop_group(osm_measurements_group_t group)
+{
+    const measurements_group_t* g = &_measurements_groups[group];
+    for (unsigned i = 0; i < g->count; i++)
+        osm_measurements_repop_indiv(g->names[i], 0, 1, g->type);
+}
+
+
 osm_measurements_def_t*  osm_measurements_array_find(osm_measurements_def_t * measurements_arr, char* name)
 {
     if (!measurements_arr || !name || strlen(name) > OSM_MEASURE_NAME_LEN || !name[0])
         return NULL;
 
+    uint32_t key = osm_measurements_name_key(name);
+
     for (unsigned i = 0; i < OSM_MEASUREMENTS_MAX_NUMBER; i++)
     {
         osm_measurements_def_t * def = &measurements_arr[i];
-        if (strncmp(def->name, name, OSM_MEASURE_NAME_LEN) == 0)
+        if (osm_measurements_name_key(def->name) == key)
             return def;
     }
 
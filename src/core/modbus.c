@@ -16,7 +16,10 @@
 #include <osm/core/platform.h>
 #include "pinmap.h"
 
-#define MODBUS_TX_GAP_MS        100
+#define MODBUS_TX_GAP_MS        100 /* Most extra turnaround a device can back off to. */
+
+#define MODBUS_DEV_TIMING_COUNT         8
+#define MODBUS_RESP_TIMEOUT_MIN_MS      100
 
 #define MODBUS_ERROR_MASK 0x80
 
@@ -40,12 +43,19 @@
 #define MAX_MODBUS_PACKET_SIZE    127
 #define MODBUS_PACKET_BUF_SIZ     20
 
+/* Largest read reply that fits in modbuspacket: addr, func, count, data, crc and binary stop. */
+#define MODBUS_MAX_SPAN_REGS      ((MAX_MODBUS_PACKET_SIZE - 6) / 2)
+
 
 static uint8_t modbuspacket[MAX_MODBUS_PACKET_SIZE];
 static uint8_t tx_modbuspacket[MODBUS_PACKET_BUF_SIZ];
 
 static unsigned modbuspacket_len = 0;
 
+/* Reply body is left in the UART ring and CRC'd in place as it arrives. */
+static uint16_t modbus_rx_crc = OSM_MODBUS_CRC_INIT;
+static unsigned modbus_rx_crc_count = 0;
+
 static char _message_queue_regs[1 + sizeof(osm_modbus_reg_t*) * MODBUS_SLOTS] = {0};
 
 static osm_ring_buf_t _message_queue = RING_BUF_INIT(_message_queue_regs, sizeof(_message_queue_regs));
@@ -58,12 +68,41 @@ static bool     modbus_want_rx = false;
 
 static uint32_t modbus_send_start_delay = 0;
 static uint32_t modbus_send_stop_delay = 0;
+static uint32_t modbus_frame_gap = 0;
 
 static uint32_t modbus_retransmit_count = 0;
 
 static unsigned _echo_bytes = 0;
 
 
+/* Response latency learnt per device, as TCP does for RTT, so a slow
+ * device gets a longer timeout without throttling fast ones. */
+typedef struct
+{
+    uint8_t  unit_id;       /* 0 is unused, broadcast is never polled. */
+    uint8_t  samples;
+    uint16_t tx_gap;        /* Extra turnaround in ms, backed off on timeouts. */
+    uint32_t srtt;          /* Smoothed latency in ms, scaled by 8. */
+    uint32_t rttvar;        /* Latency mean deviation in ms, scaled by 4. */
+} modbus_dev_timing_t;
+
+static modbus_dev_timing_t   _modbus_dev_timings[MODBUS_DEV_TIMING_COUNT] = {{0}};
+static uint8_t               _modbus_cur_unit_id = 0;
+
+
+/* Registers of the same unit and function with addresses close
+ * enough together are read with one request and the reply fanned
+ * out to each of them. */
+static struct
+{
+    osm_modbus_reg_t * regs[MODBUS_SLOTS];
+    unsigned           count;
+    uint16_t           reg_addr;
+    uint16_t           reg_count;
+    bool               disabled;    /* Device rejected a span, read singly until queue drains. */
+} _modbus_read_span = {0};
+
+
 static struct
 {
     union
@@ -125,6 +164,8 @@ static void _modbus_setup_delays(unsigned speed, uint8_t databits, osm_osm_uart_
         modbus_send_start_delay = _modbus_get_deci_char_time(35 /*3.5*/, speed, databits, parity, stop);
         modbus_send_stop_delay = _modbus_get_deci_char_time(35 /*3.5*/, speed, databits, parity, stop);
     }
+    /* Frames are always separated by at least 3.5 chars of silence. */
+    modbus_frame_gap = _modbus_get_deci_char_time(35 /*3.5*/, speed, databits, parity, stop);
     osm_modbus_debug("Modbus @ %s %u %u%c%s", (modbus_bus->binary_protocol)?"BIN":"RTU", speed, databits, osm_uart_parity_as_char(parity), osm_uart_stop_bits_as_str(stop));
 
     modbus_bus->baudrate    = speed;
@@ -212,23 +253,233 @@ bool osm_modbus_get_reg_set_expected_done(bool * passfail)
 }
 
 
-static void _modbus_do_start_read(osm_modbus_reg_t * reg)
+/* Only looks, so asking after a unit never costs another its entry. */
+static modbus_dev_timing_t * _modbus_find_dev_timing(uint8_t unit_id)
 {
-    uint8_t unit_id = osm_modbus_reg_get_unit_id(reg);
+    if (!unit_id)
+        return NULL;
+    for (unsigned n = 0; n < MODBUS_DEV_TIMING_COUNT; n++)
+    {
+        if (_modbus_dev_timings[n].unit_id == unit_id)
+            return &_modbus_dev_timings[n];
+    }
+    return NULL;
+}
 
-    unsigned reg_count = 1;
 
-    switch (reg->type)
+/* For recording a reply or timeout, taking an entry if the unit has none. */
+static modbus_dev_timing_t * _modbus_get_dev_timing(uint8_t unit_id)
+{
+    static unsigned _next_evict = 0;
+
+    if (!unit_id)
+        return NULL;
+
+    modbus_dev_timing_t * timing = _modbus_find_dev_timing(unit_id);
+    if (timing)
+        return timing;
+
+    modbus_dev_timing_t * empty = NULL;
+    for (unsigned n = 0; !empty && n < MODBUS_DEV_TIMING_COUNT; n++)
     {
-        case OSM_MODBUS_REG_TYPE_U16    : reg_count = 1; break;
-        case OSM_MODBUS_REG_TYPE_I16    : reg_count = 1; break;
-        case OSM_MODBUS_REG_TYPE_U32    : reg_count = 2; break;
-        case OSM_MODBUS_REG_TYPE_I32    : reg_count = 2; break;
-        case OSM_MODBUS_REG_TYPE_FLOAT  : reg_count = 2; break;
-        default: break;
+        if (!_modbus_dev_timings[n].unit_id)
+            empty = &_modbus_dev_timings[n];
+    }
+
+    if (!empty)
+    {
+        empty = &_modbus_dev_timings[_next_evict];
+        _next_evict = (_next_evict + 1) % MODBUS_DEV_TIMING_COUNT;
+    }
+
+    memset(empty, 0, sizeof(modbus_dev_timing_t));
+    empty->unit_id = unit_id;
+    return empty;
+}
+
+
+static uint32_t _modbus_dev_timing_timeout(modbus_dev_timing_t * timing)
+{
+    if (!timing || !timing->samples)
+        return OSM_MODBUS_RESP_TIMEOUT_MS;
+
+    uint32_t timeout = (timing->srtt >> 3) + timing->rttvar + modbus_frame_gap;
+
+    if (timeout < MODBUS_RESP_TIMEOUT_MIN_MS)
+        return MODBUS_RESP_TIMEOUT_MIN_MS;
+    if (timeout > OSM_MODBUS_RESP_TIMEOUT_MS)
+        return OSM_MODBUS_RESP_TIMEOUT_MS;
+    return timeout;
+}
+
+
+static void _modbus_dev_timing_good(modbus_dev_timing_t * timing, uint32_t latency)
+{
+    if (!timing)
+        return;
+
+    if (latency > OSM_MODBUS_RESP_TIMEOUT_MS)
+        latency = OSM_MODBUS_RESP_TIMEOUT_MS;
+
+    if (!timing->samples)
+    {
+        timing->srtt   = latency << 3;
+        timing->rttvar = latency << 1;
+    }
+    else
+    {
+        int32_t err = (int32_t)latency - (int32_t)(timing->srtt >> 3);
+        timing->srtt += err;
+        if (err < 0)
+            err = -err;
+        timing->rttvar += err - (timing->rttvar >> 2);
+    }
+
+    /* Bound the variance so one slow reply can't hold the timeout at max. */
+    if (timing->rttvar > OSM_MODBUS_RESP_TIMEOUT_MS)
+        timing->rttvar = OSM_MODBUS_RESP_TIMEOUT_MS;
+
+    if (timing->samples < UINT8_MAX)
+        timing->samples++;
+
+    timing->tx_gap = (timing->tx_gap > 3)?(timing->tx_gap - (timing->tx_gap >> 2)):0;
+
+    osm_modbus_debug("Unit 0x%"PRIx8" latency %"PRIu32"ms, timeout %"PRIu32"ms", timing->unit_id, latency, _modbus_dev_timing_timeout(timing));
+}
+
+
+static void _modbus_dev_timing_timedout(modbus_dev_timing_t * timing)
+{
+    if (!timing)
+        return;
+
+    timing->rttvar <<= 1;
+    if (timing->rttvar > OSM_MODBUS_RESP_TIMEOUT_MS)
+        timing->rttvar = OSM_MODBUS_RESP_TIMEOUT_MS;
+
+    timing->tx_gap = (timing->tx_gap)?(timing->tx_gap * 2):modbus_frame_gap;
+    if (timing->tx_gap > MODBUS_TX_GAP_MS)
+        timing->tx_gap = MODBUS_TX_GAP_MS;
+}
+
+
+static unsigned _modbus_reg_type_count(uint8_t type)
+{
+    switch (type)
+    {
+        case OSM_MODBUS_REG_TYPE_U32    : return 2;
+        case OSM_MODBUS_REG_TYPE_I32    : return 2;
+        case OSM_MODBUS_REG_TYPE_FLOAT  : return 2;
+        default: return 1;
+    }
+}
+
+
+static unsigned _modbus_queue_peek_all(osm_modbus_reg_t ** regs)
+{
+    unsigned len = osm_ring_buf_get_pending(&_message_queue);
+    return osm_ring_buf_peek(&_message_queue, (char*)regs, len) / sizeof(osm_modbus_reg_t*);
+}
+
+
+static void _modbus_plan_read_span(osm_modbus_reg_t * reg)
+{
+    _modbus_read_span.regs[0]   = reg;
+    _modbus_read_span.count     = 1;
+    _modbus_read_span.reg_addr  = reg->reg_addr;
+    _modbus_read_span.reg_count = _modbus_reg_type_count(reg->type);
+
+    unsigned max_span = modbus_bus->read_max_span;
+    unsigned max_gap  = modbus_bus->read_max_gap;
+
+    if (max_span > MODBUS_MAX_SPAN_REGS)
+        max_span = MODBUS_MAX_SPAN_REGS;
+
+    if (_modbus_read_span.disabled || max_span < 2)
+        return;
+
+    osm_modbus_reg_t * queued[MODBUS_SLOTS];
+    unsigned queued_count = _modbus_queue_peek_all(queued);
+    uint16_t unit_id = osm_modbus_reg_get_unit_id(reg);
+
+    /* Keep growing the span until no queued register joins it. Queue
+     * isn't in address order, so one pass isn't enough. */
+    bool grown = true;
+    while (grown)
+    {
+        grown = false;
+        for (unsigned n = 0; n < queued_count; n++)
+        {
+            osm_modbus_reg_t * other = queued[n];
+            if (!other || other == reg)
+                continue;
+            if (other->func != reg->func || osm_modbus_reg_get_unit_id(other) != unit_id)
+                continue;
+
+            unsigned span_start  = _modbus_read_span.reg_addr;
+            unsigned span_end    = span_start + _modbus_read_span.reg_count;
+            unsigned other_start = other->reg_addr;
+            unsigned other_end   = other_start + _modbus_reg_type_count(other->type);
+
+            if (other_start > span_end + max_gap || other_end + max_gap < span_start)
+                continue;
+
+            unsigned new_start = (other_start < span_start)?other_start:span_start;
+            unsigned new_end   = (other_end > span_end)?other_end:span_end;
+
+            if (new_end - new_start > max_span)
+                continue;
+
+            _modbus_read_span.regs[_modbus_read_span.count++] = other;
+            _modbus_read_span.reg_addr  = new_start;
+            _modbus_read_span.reg_count = new_end - new_start;
+            queued[n] = NULL;
+            grown = true;
+        }
+    }
+
+    if (_modbus_read_span.count > 1)
+        osm_modbus_debug("Coalesced %u registers into read of %"PRIu16" from 0x%"PRIx16, _modbus_read_span.count, _modbus_read_span.reg_count, _modbus_read_span.reg_addr);
+}
+
+
+static void _modbus_queue_remove_read_span(void)
+{
+    osm_modbus_reg_t * queued[MODBUS_SLOTS];
+    unsigned queued_count = _modbus_queue_peek_all(queued);
+
+    ring_buf_clear(&_message_queue);
+
+    for (unsigned n = 0; n < queued_count; n++)
+    {
+        bool in_span = false;
+        for (unsigned i = 0; i < _modbus_read_span.count; i++)
+        {
+            if (queued[n] == _modbus_read_span.regs[i])
+            {
+                in_span = true;
+                break;
+            }
+        }
+        if (!in_span)
+            osm_ring_buf_add_data(&_message_queue, &queued[n], sizeof(osm_modbus_reg_t*));
     }
 
-    osm_modbus_debug("Reading %"PRIu8" of %."STR(OSM_MODBUS_NAME_LEN)"s (0x%"PRIx8":0x%"PRIx16")" , reg_count, reg->name, unit_id, reg->reg_addr);
+    if (!osm_ring_buf_get_pending(&_message_queue))
+        _modbus_read_span.disabled = false;
+}
+
+
+static void _modbus_do_start_read(osm_modbus_reg_t * reg)
+{
+    uint8_t unit_id = osm_modbus_reg_get_unit_id(reg);
+
+    _modbus_plan_read_span(reg);
+
+    uint16_t reg_addr  = _modbus_read_span.reg_addr;
+    unsigned reg_count = _modbus_read_span.reg_count;
+
+    osm_modbus_debug("Reading %"PRIu8" of %."STR(OSM_MODBUS_NAME_LEN)"s (0x%"PRIx8":0x%"PRIx16")" , reg_count, reg->name, unit_id, reg_addr);
 
     unsigned body_size = 4;
 
@@ -239,8 +490,8 @@ static void _modbus_do_start_read(osm_modbus_reg_t * reg)
         /* ====================================== */
         /* PDU payload (Protocol Data Unit) */
         tx_modbuspacket[1] = OSM_MODBUS_READ_HOLDING_FUNC; /*Holding*/
-        tx_modbuspacket[2] = reg->reg_addr >> 8;   /*Register read address */
-        tx_modbuspacket[3] = reg->reg_addr & 0xFF;
+        tx_modbuspacket[2] = reg_addr >> 8;   /*Register read address */
+        tx_modbuspacket[3] = reg_addr & 0xFF;
         tx_modbuspacket[4] = reg_count >> 8; /*Register read count */
         tx_modbuspacket[5] = reg_count & 0xFF;
         body_size = 6;
@@ -253,8 +504,8 @@ static void _modbus_do_start_read(osm_modbus_reg_t * reg)
         /* ====================================== */
         /* PDU payload (Protocol Data Unit) */
         tx_modbuspacket[1] = OSM_MODBUS_READ_INPUT_FUNC; /*Input*/
-        tx_modbuspacket[2] = reg->reg_addr >> 8;   /*Register read address */
-        tx_modbuspacket[3] = reg->reg_addr & 0xFF;
+        tx_modbuspacket[2] = reg_addr >> 8;   /*Register read address */
+        tx_modbuspacket[3] = reg_addr & 0xFF;
         tx_modbuspacket[4] = reg_count >> 8; /*Register read count */
         tx_modbuspacket[5] = reg_count & 0xFF;
         body_size = 6;
@@ -267,6 +518,7 @@ static void _modbus_do_start_read(osm_modbus_reg_t * reg)
 
     modbus_want_rx = true;
     modbus_cur_send_time = osm_get_since_boot_ms();
+    _modbus_cur_unit_id = unit_id;
 
     if (modbus_bus->binary_protocol)
     {
@@ -282,7 +534,8 @@ static void _modbus_do_start_read(osm_modbus_reg_t * reg)
         if (osm_modbus_requires_echo_removal())
             _echo_bytes = 8;
     }
-    reg->value_state = OSM_MB_REG_WAITING;
+    for (unsigned n = 0; n < _modbus_read_span.count; n++)
+        _modbus_read_span.regs[n]->value_state = OSM_MB_REG_WAITING;
 }
 
 
@@ -491,6 +744,7 @@ bool osm_modbus_set_reg(uint16_t unit_id, uint16_t reg_addr, uint8_t func, osm_m
 
     modbus_want_rx = true;
     modbus_cur_send_time = osm_get_since_boot_ms();
+    _modbus_cur_unit_id = unit_id;
     if (modbus_bus->binary_protocol)
     {
         osm_uart_ring_out(EXT_UART, (char[]){MODBUS_BIN_START}, 1);
@@ -559,6 +813,18 @@ bool osm_modbus_start_read(osm_modbus_reg_t * reg)
 }
 
 
+static uint32_t _modbus_next_message_gap(void)
+{
+    osm_modbus_reg_t * next_reg = NULL;
+
+    if (osm_ring_buf_peek(&_message_queue, (char*)&next_reg, sizeof(next_reg)) != sizeof(next_reg) || !next_reg)
+        return modbus_frame_gap;
+
+    modbus_dev_timing_t * timing = _modbus_find_dev_timing(osm_modbus_reg_get_unit_id(next_reg));
+    return modbus_frame_gap + (timing ? timing->tx_gap : 0);
+}
+
+
 static void _modbus_next_message(void)
 {
     osm_modbus_reg_t * current_reg = NULL;
@@ -571,6 +837,43 @@ static void _modbus_next_message(void)
 }
 
 
+/* Gives up on the whole span being read, each of its registers fails. */
+static void _modbus_drop_read(void)
+{
+    osm_modbus_debug("Dropping message in queue.");
+    modbus_retransmit_count = 0;
+
+    if (!_modbus_read_span.count)
+    {
+        osm_modbus_reg_t * current_reg = NULL;
+        if (osm_ring_buf_read(&_message_queue, (char*)&current_reg, sizeof(current_reg)) != sizeof(current_reg) || current_reg == NULL)
+        {
+            osm_modbus_debug("Failed to drop message, dropping all messages.");
+            ring_buf_clear(&_message_queue);
+            return;
+        }
+        current_reg->value_state = OSM_MB_REG_INVALID;
+        return;
+    }
+
+    _modbus_queue_remove_read_span();
+    for (unsigned n = 0; n < _modbus_read_span.count; n++)
+        _modbus_read_span.regs[n]->value_state = OSM_MB_REG_INVALID;
+    _modbus_read_span.count = 0;
+}
+
+
+/* Read not answered properly, send again now or once the bus is idle, until given up on. */
+static void _modbus_retry_or_drop(bool resend)
+{
+    modbus_retransmit_count++;
+    if (modbus_retransmit_count >= MODBUS_MAX_RETRANSMITS)
+        _modbus_drop_read();
+    else if (resend)
+        _modbus_next_message();
+}
+
+
 static bool _modbus_has_timedout(osm_ring_buf_t * ring)
 {
     uint32_t delta = (modbus_read_timing_init)?
@@ -578,47 +881,188 @@ static bool _modbus_has_timedout(osm_ring_buf_t * ring)
                     :
                     osm_since_boot_delta(osm_get_since_boot_ms(), modbus_cur_send_time);
 
-    if (delta < OSM_MODBUS_RESP_TIMEOUT_MS)
+    if (delta < _modbus_dev_timing_timeout(_modbus_find_dev_timing(_modbus_cur_unit_id)))
         return false;
     osm_modbus_debug("Message timeout, dumping left overs.");
+    _modbus_dev_timing_timedout(_modbus_get_dev_timing(_modbus_cur_unit_id));
     modbuspacket_len = 0;
     modbus_read_timing_init = 0;
     modbus_want_rx = false;
-    ring_buf_clear(ring);
+    osm_ring_buf_discard_all(ring);
 
-    modbus_retransmit_count++;
-    if (modbus_retransmit_count < MODBUS_MAX_RETRANSMITS)
-        _modbus_next_message();
-    else
+    _modbus_retry_or_drop(true);
+    return true;
+}
+
+static void _modbus_reg_cb(osm_modbus_reg_t * reg, uint8_t * data, uint8_t size, osm_modbus_byte_orders_t byte_order, osm_modbus_word_orders_t word_order);
+
+
+static uint8_t * _modbus_ring_body(osm_ring_buf_t * ring, unsigned offset, unsigned size, uint8_t * tmp)
+{
+    char * span;
+    if (osm_ring_buf_peek_span(ring, offset, &span) >= size)
+        return (uint8_t*)span;
+
+    /* Value straddles the ring's wrap, only then copy. */
+    unsigned n = 0;
+    while (n < size)
     {
-        osm_modbus_reg_t * current_reg = NULL;
+        unsigned span_len = osm_ring_buf_peek_span(ring, offset + n, &span);
+        if (!span_len)
+            break;
+        if (span_len > size - n)
+            span_len = size - n;
+        memcpy(tmp + n, span, span_len);
+        n += span_len;
+    }
+    return tmp;
+}
 
-        osm_modbus_debug("Dropping message in queue.");
-        modbus_retransmit_count = 0;
 
-        if (osm_ring_buf_read(&_message_queue, (char*)&current_reg, sizeof(current_reg)) != sizeof(current_reg) || current_reg == NULL)
+static void _modbus_process_reply(osm_ring_buf_t * ring)
+{
+    uint8_t unit_id = modbuspacket[0];
+    uint8_t func    = modbuspacket[1];
+    if (func == OSM_MODBUS_WRITE_SINGLE_HOLDING_FUNC)
+    {
+        if (unit_id != _modbus_reg_set_expected.unit_id)
         {
-            osm_modbus_debug("Failed to drop message, dropping all messages.");
-            ring_buf_clear(&_message_queue);
+            _modbus_reg_set_expected.not_done = false;
+            _modbus_reg_set_expected.passfail = false;
+            osm_modbus_debug("Unexpected unit id (0x%02"PRIX8" != 0x%02"PRIX8").", unit_id, _modbus_reg_set_expected.unit_id);
+            return;
+        }
+        uint16_t reg_addr = (modbuspacket[2] << 8) | modbuspacket[3];
+        if (reg_addr != _modbus_reg_set_expected.reg_addr)
+        {
+            _modbus_reg_set_expected.not_done = false;
+            _modbus_reg_set_expected.passfail = false;
+            osm_modbus_debug("Unexpected register address (0x%04"PRIX16" != 0x%04"PRIX16").", reg_addr, _modbus_reg_set_expected.reg_addr);
+            return;
         }
+        uint16_t value = (modbuspacket[4] << 8) | modbuspacket[5];
+        if (value != _modbus_reg_set_expected.value)
+        {
+            _modbus_reg_set_expected.not_done = false;
+            _modbus_reg_set_expected.passfail = false;
+            osm_modbus_debug("Unexpected value (0x%04"PRIX16" != 04%"PRIX16").", value, _modbus_reg_set_expected.value);
+            return;
+        }
+        osm_modbus_debug("Received acknowledgement.");
+        _modbus_reg_set_expected.not_done = false;
+        _modbus_reg_set_expected.passfail = true;
+        return;
+    }
+    else if (func == OSM_MODBUS_WRITE_MULTIPLE_HOLDING_FUNC)
+    {
+        if (unit_id != _modbus_reg_set_expected.unit_id)
+        {
+            _modbus_reg_set_expected.not_done = false;
+            _modbus_reg_set_expected.passfail = false;
+            osm_modbus_debug("Unexpected unit id (0x%02"PRIX8" != 0x%02"PRIX8").", unit_id, _modbus_reg_set_expected.unit_id);
+            return;
+        }
+        uint16_t reg_addr = (modbuspacket[2] << 8) | modbuspacket[3];
+        if (reg_addr != _modbus_reg_set_expected.reg_addr)
+        {
+            _modbus_reg_set_expected.not_done = false;
+            _modbus_reg_set_expected.passfail = false;
+            osm_modbus_debug("Unexpected register address (0x%04"PRIX16" != 0x%04"PRIX16").", reg_addr, _modbus_reg_set_expected.reg_addr);
+            return;
+        }
+        uint16_t num_written = (modbuspacket[4] << 8) | modbuspacket[5];
+        if (num_written != _modbus_reg_set_expected.num_written)
+        {
+            _modbus_reg_set_expected.not_done = false;
+            _modbus_reg_set_expected.passfail = false;
+            osm_modbus_debug("Unexpected num_written (0x%04"PRIX16" != 04%"PRIX16").", num_written, _modbus_reg_set_expected.num_written);
+            return;
+        }
+        osm_modbus_debug("Received acknowledgement.");
+        _modbus_reg_set_expected.not_done = false;
+        _modbus_reg_set_expected.passfail = true;
+        return;
     }
 
-    return true;
+    if (!_modbus_read_span.count)
+    {
+        osm_log_error("Modbus comms issues!");
+        return;
+    }
+
+    modbus_read_last_good = osm_get_since_boot_ms();
+
+    modbus_retransmit_count = 0;
+
+    bool is_exception = ((modbuspacket[1] == (OSM_MODBUS_READ_HOLDING_FUNC | MODBUS_ERROR_MASK)) ||
+                         (modbuspacket[1] == (OSM_MODBUS_READ_INPUT_FUNC | MODBUS_ERROR_MASK)));
+
+    if (is_exception && _modbus_read_span.count > 1)
+    {
+        /* Probably a gap register the device doesn't have. Leave them queued to be read one by one. */
+        osm_modbus_debug("Exception: 0x%02"PRIx8" on coalesced read, reading singly.", modbuspacket[2]);
+        _modbus_read_span.disabled = true;
+        _modbus_read_span.count = 0;
+        return;
+    }
+
+    // Good or bad, we think we have the whole message for current registers, so remove them from queue.
+    _modbus_queue_remove_read_span();
+
+    for (unsigned n = 0; n < _modbus_read_span.count; n++)
+    {
+        osm_modbus_reg_t * current_reg = _modbus_read_span.regs[n];
+        if (current_reg->value_state != OSM_MB_REG_WAITING)
+            osm_modbus_debug("Reg :%."STR(OSM_MODBUS_NAME_LEN)"s not waiting!", current_reg->name);
+        current_reg->value_state = OSM_MB_REG_INVALID;
+    }
+
+    if (is_exception)
+    {
+        osm_modbus_debug("Exception: 0x%02"PRIx8, modbuspacket[2]);
+        _modbus_read_span.count = 0;
+        return;
+    }
+
+    if (modbuspacket[2] != _modbus_read_span.reg_count * 2)
+    {
+        osm_log_error("Modbus comms issues!");
+        _modbus_read_span.count = 0;
+        return;
+    }
+
+    for (unsigned n = 0; n < _modbus_read_span.count; n++)
+    {
+        osm_modbus_reg_t * current_reg = _modbus_read_span.regs[n];
+        osm_modbus_dev_t * dev = modbus_reg_get_dev(current_reg);
+
+        if (dev->unit_id != modbuspacket[0])
+        {
+            osm_log_error("Modbus comms issues!");
+            continue;
+        }
+
+        unsigned offset = (current_reg->reg_addr - _modbus_read_span.reg_addr) * 2;
+        unsigned size   = _modbus_reg_type_count(current_reg->type) * 2;
+        uint8_t  tmp[4];
+
+        _modbus_reg_cb(current_reg, _modbus_ring_body(ring, offset, size, tmp), size, dev->byte_order, dev->word_order);
+    }
+    _modbus_read_span.count = 0;
 }
 
-static void _modbus_reg_cb(osm_modbus_reg_t * reg, uint8_t * data, uint8_t size, osm_modbus_byte_orders_t byte_order, osm_modbus_word_orders_t word_order);
 
 void osm_modbus_uart_ring_in_process(osm_ring_buf_t * ring)
 {
     static unsigned _header_size = 0;
     if (!modbus_want_rx)
     {
-        ring_buf_clear(ring);
+        osm_ring_buf_discard_all(ring);
 
         if (osm_ring_buf_get_pending(&_message_queue))
         {
             uint32_t delta = osm_since_boot_delta(osm_get_since_boot_ms(), modbus_read_last_good);
-            if (delta > MODBUS_TX_GAP_MS)
+            if (delta > _modbus_next_message_gap())
                 _modbus_next_message();
         }
         return;
@@ -712,6 +1156,26 @@ void osm_modbus_uart_ring_in_process(osm_ring_buf_t * ring)
                 return;
             }
 
+            if ((func == OSM_MODBUS_READ_HOLDING_FUNC || func == OSM_MODBUS_READ_INPUT_FUNC) &&
+                (!_modbus_read_span.count || modbuspacket[2] != _modbus_read_span.reg_count * 2))
+            {
+                /* Not the reply we are waiting for, don't wait for the rest of it. */
+                osm_modbus_debug("Unexpected read reply length : %"PRIu8, modbuspacket[2]);
+                modbuspacket_len = 0;
+                modbus_want_rx = false;
+                if (_modbus_read_span.count > 1)
+                {
+                    /* Device may not do spans, try again register by register. */
+                    _modbus_read_span.disabled = true;
+                    _modbus_read_span.count = 0;
+                }
+                _modbus_retry_or_drop(false);
+                return;
+            }
+
+            modbus_rx_crc = osm_modbus_crc_update(OSM_MODBUS_CRC_INIT, modbuspacket, _header_size);
+            modbus_rx_crc_count = 0;
+
             osm_modbus_debug("Reply type length : %u", modbuspacket_len);
             if (modbus_bus->binary_protocol)
             {
@@ -719,6 +1183,8 @@ void osm_modbus_uart_ring_in_process(osm_ring_buf_t * ring)
                 osm_modbus_debug("Binary prototype extra 1 byte required.");
             }
 
+            len = osm_ring_buf_get_pending(ring);
+
             modbus_read_timing_init = osm_get_since_boot_ms();
             osm_modbus_debug("header received, timer started at:%"PRIu32" body:%u/%u", modbus_read_timing_init, len, modbuspacket_len);
         }
@@ -738,6 +1204,22 @@ void osm_modbus_uart_ring_in_process(osm_ring_buf_t * ring)
     if (!modbuspacket_len)
         return;
 
+    /* Fold body bytes into the CRC as they arrive, straight from the
+     * ring. Binary frames' stop byte isn't covered by the CRC. */
+    unsigned crc_len = modbuspacket_len - ((modbus_bus->binary_protocol)?1:0);
+    unsigned crc_avail = (len < crc_len)?len:crc_len;
+    while (modbus_rx_crc_count < crc_avail)
+    {
+        char * span;
+        unsigned span_len = osm_ring_buf_peek_span(ring, modbus_rx_crc_count, &span);
+        if (!span_len)
+            break;
+        if (span_len > crc_avail - modbus_rx_crc_count)
+            span_len = crc_avail - modbus_rx_crc_count;
+        modbus_rx_crc = osm_modbus_crc_update(modbus_rx_crc, (uint8_t*)span, span_len);
+        modbus_rx_crc_count += span_len;
+    }
+
     if (len < modbuspacket_len)
     {
         _modbus_has_timedout(ring);
@@ -747,135 +1229,42 @@ void osm_modbus_uart_ring_in_process(osm_ring_buf_t * ring)
     modbus_read_timing_init = 0;
     osm_modbus_debug("Message bytes (%u) reached.", modbuspacket_len);
 
-    osm_ring_buf_read(ring, (char*)modbuspacket + _header_size, modbuspacket_len);
+    unsigned frame_len = modbuspacket_len;
+    modbuspacket_len = 0;
+    modbus_want_rx = false;
 
     if (modbus_bus->binary_protocol)
     {
-        if (modbuspacket[modbuspacket_len + _header_size - 1] != MODBUS_BIN_STOP)
+        char * stop;
+        if (!osm_ring_buf_peek_span(ring, frame_len - 1, &stop) || *stop != MODBUS_BIN_STOP)
         {
             osm_modbus_debug("Not binary frame stopped, discarded.");
+            osm_ring_buf_discard(ring, frame_len);
             return;
         }
-        modbuspacket_len--;
     }
 
-    // Now include the header too.
-    modbuspacket_len += _header_size;
+    osm_log_debug_data(OSM_DEBUG_MODBUS, modbuspacket, _header_size);
 
-    osm_log_debug_data(OSM_DEBUG_MODBUS, modbuspacket, modbuspacket_len);
-
-    uint16_t crc = osm_modbus_crc(modbuspacket, modbuspacket_len - 2);
-
-    if ( (modbuspacket[modbuspacket_len-1] != (crc >> 8)) ||
-         (modbuspacket[modbuspacket_len-2] != (crc & 0xFF)) )
+    /* CRC run over the frame including its own CRC leaves no remainder. */
+    if (modbus_rx_crc)
     {
         osm_modbus_debug("Bad CRC");
-        modbuspacket_len = 0;
-        modbus_want_rx = false;
+        osm_ring_buf_discard(ring, frame_len);
         return;
     }
 
     osm_modbus_debug("Good CRC");
-    modbuspacket_len = 0;
-    modbus_want_rx = false;
 
-    uint8_t unit_id = modbuspacket[0];
-    uint8_t func    = modbuspacket[1];
-    if (func == OSM_MODBUS_WRITE_SINGLE_HOLDING_FUNC)
-    {
-        if (unit_id != _modbus_reg_set_expected.unit_id)
-        {
-            _modbus_reg_set_expected.not_done = false;
-            _modbus_reg_set_expected.passfail = false;
-            osm_modbus_debug("Unexpected unit id (0x%02"PRIX8" != 0x%02"PRIX8").", unit_id, _modbus_reg_set_expected.unit_id);
-            return;
-        }
-        uint16_t reg_addr = (modbuspacket[2] << 8) | modbuspacket[3];
-        if (reg_addr != _modbus_reg_set_expected.reg_addr)
-        {
-            _modbus_reg_set_expected.not_done = false;
-            _modbus_reg_set_expected.passfail = false;
-            osm_modbus_debug("Unexpected register address (0x%04"PRIX16" != 0x%04"PRIX16").", reg_addr, _modbus_reg_set_expected.reg_addr);
-            return;
-        }
-        uint16_t value = (modbuspacket[4] << 8) | modbuspacket[5];
-        if (value != _modbus_reg_set_expected.value)
-        {
-            _modbus_reg_set_expected.not_done = false;
-            _modbus_reg_set_expected.passfail = false;
-            osm_modbus_debug("Unexpected value (0x%04"PRIX16" != 04%"PRIX16").", value, _modbus_reg_set_expected.value);
-            return;
-        }
-        osm_modbus_debug("Received acknowledgement.");
-        _modbus_reg_set_expected.not_done = false;
-        _modbus_reg_set_expected.passfail = true;
-        return;
-    }
-    else if (func == OSM_MODBUS_WRITE_MULTIPLE_HOLDING_FUNC)
-    {
-        if (unit_id != _modbus_reg_set_expected.unit_id)
-        {
-            _modbus_reg_set_expected.not_done = false;
-            _modbus_reg_set_expected.passfail = false;
-            osm_modbus_debug("Unexpected unit id (0x%02"PRIX8" != 0x%02"PRIX8").", unit_id, _modbus_reg_set_expected.unit_id);
-            return;
-        }
-        uint16_t reg_addr = (modbuspacket[2] << 8) | modbuspacket[3];
-        if (reg_addr != _modbus_reg_set_expected.reg_addr)
-        {
-            _modbus_reg_set_expected.not_done = false;
-            _modbus_reg_set_expected.passfail = false;
-            osm_modbus_debug("Unexpected register address (0x%04"PRIX16" != 0x%04"PRIX16").", reg_addr, _modbus_reg_set_expected.reg_addr);
-            return;
-        }
-        uint16_t num_written = (modbuspacket[4] << 8) | modbuspacket[5];
-        if (num_written != _modbus_reg_set_expected.num_written)
-        {
-            _modbus_reg_set_expected.not_done = false;
-            _modbus_reg_set_expected.passfail = false;
-            osm_modbus_debug("Unexpected num_written (0x%04"PRIX16" != 04%"PRIX16").", num_written, _modbus_reg_set_expected.num_written);
-            return;
-        }
-        osm_modbus_debug("Received acknowledgement.");
-        _modbus_reg_set_expected.not_done = false;
-        _modbus_reg_set_expected.passfail = true;
-        return;
-    }
-
-    // Good or bad, we think we have the whole message for current register, so remove it from queue.
-    osm_modbus_reg_t * current_reg = NULL;
-
-    if (osm_ring_buf_read(&_message_queue, (char*)&current_reg, sizeof(current_reg)) != sizeof(current_reg) || current_reg == NULL)
-    {
-        osm_log_error("Modbus comms issues!");
-        return;
-    }
-
-    if (current_reg->value_state != OSM_MB_REG_WAITING)
-        osm_modbus_debug("Reg :%."STR(OSM_MODBUS_NAME_LEN)"s not waiting!", current_reg->name);
-
-    current_reg->value_state = OSM_MB_REG_INVALID;
-
-    modbus_read_last_good = osm_get_since_boot_ms();
-
-    modbus_retransmit_count = 0;
-
-    if ((modbuspacket[1] == (OSM_MODBUS_READ_HOLDING_FUNC | MODBUS_ERROR_MASK)) ||
-        (modbuspacket[1] == (OSM_MODBUS_READ_INPUT_FUNC | MODBUS_ERROR_MASK)))
-    {
-        osm_modbus_debug("Exception: 0x%02"PRIx8, modbuspacket[2]);
-        return;
-    }
-
-    osm_modbus_dev_t * dev = modbus_reg_get_dev(current_reg);
+    if (_modbus_cur_unit_id == modbuspacket[0])
+        _modbus_dev_timing_good(_modbus_get_dev_timing(_modbus_cur_unit_id), osm_since_boot_delta(osm_get_since_boot_ms(), modbus_cur_send_time));
 
-    if (dev->unit_id != modbuspacket[0])
-    {
-        osm_log_error("Modbus comms issues!");
-        return;
-    }
+    /* Only the short fixed bodies are copied out, read data is decoded from the ring. */
+    if (modbuspacket[1] != OSM_MODBUS_READ_HOLDING_FUNC && modbuspacket[1] != OSM_MODBUS_READ_INPUT_FUNC)
+        osm_ring_buf_peek(ring, (char*)modbuspacket + _header_size, crc_len - 2);
 
-    _modbus_reg_cb(current_reg, modbuspacket + 3, modbuspacket[2], dev->byte_order, dev->word_order);
+    _modbus_process_reply(ring);
+    osm_ring_buf_discard(ring, frame_len);
 }
 
 
@@ -1100,12 +1489,62 @@ static osm_command_response_t _modbus_log_cb(char* args, osm_cmd_ctx_t * ctx)
 }
 
 
+static osm_command_response_t _modbus_timing_cb(char* args, osm_cmd_ctx_t * ctx)
+{
+    osm_cmd_ctx_out(ctx,"Modbus frame gap %"PRIu32"ms", modbus_frame_gap);
+    for (unsigned n = 0; n < MODBUS_DEV_TIMING_COUNT; n++)
+    {
+        modbus_dev_timing_t * timing = &_modbus_dev_timings[n];
+        if (!timing->unit_id)
+            continue;
+        osm_cmd_ctx_out(ctx,"- Unit 0x%"PRIx8" latency:%"PRIu32"ms timeout:%"PRIu32"ms gap:%"PRIu16"ms samples:%"PRIu8,
+                        timing->unit_id, timing->srtt >> 3, _modbus_dev_timing_timeout(timing), timing->tx_gap, timing->samples);
+    }
+    return OSM_COMMAND_RESP_OK;
+}
+
+
+static osm_command_response_t _modbus_coalesce_cb(char* args, osm_cmd_ctx_t * ctx)
+{
+    /*[<max_gap> <max_span>]
+     * EXAMPLE: 2 16
+     * A max_span of 0 or 1 disables coalescing reads.
+     */
+    char * pos = osm_skip_space(args);
+    if (pos[0])
+    {
+        char * next;
+        unsigned max_gap = strtoul(pos, &next, 0);
+        if (next == pos)
+            goto bad_exit;
+        pos = osm_skip_space(next);
+        unsigned max_span = strtoul(pos, &next, 0);
+        if (next == pos)
+            goto bad_exit;
+        if (max_span > MODBUS_MAX_SPAN_REGS || (max_span > 1 && max_gap >= max_span))
+        {
+            osm_cmd_ctx_error(ctx,"Max span must be at most %u and larger than max gap.", (unsigned)MODBUS_MAX_SPAN_REGS);
+            return OSM_COMMAND_RESP_ERR;
+        }
+        modbus_bus->read_max_gap  = max_gap;
+        modbus_bus->read_max_span = max_span;
+    }
+    osm_cmd_ctx_out(ctx,"Modbus read max gap:%"PRIu8" max span:%"PRIu8, modbus_bus->read_max_gap, modbus_bus->read_max_span);
+    return OSM_COMMAND_RESP_OK;
+bad_exit:
+    osm_cmd_ctx_error(ctx,"[<max_gap> <max_span>]");
+    return OSM_COMMAND_RESP_ERR;
+}
+
+
 struct osm_cmd_link_t* osm_modbus_add_commands(struct osm_cmd_link_t* tail)
 {
     static struct osm_cmd_link_t cmds[] =
     {
         { "mb_setup",     "Change Modbus comms",      _modbus_setup_cb               , false , NULL },
         { "mb_log",       "Show modbus setup",        _modbus_log_cb                 , false , NULL },
+        { "mb_coalesce",  "Get/Set modbus read span", _modbus_coalesce_cb            , false , NULL },
+        { "mb_timing",    "Show modbus dev timings",  _modbus_timing_cb              , false , NULL },
     };
     return osm_modbus_add_mem_commands(osm_add_commands(tail, cmds, OSM_ARRAY_SIZE(cmds)));
 }
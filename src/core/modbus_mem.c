@@ -570,6 +570,8 @@ void osm_modbus_bus_init(osm_modbus_bus_t * bus)
         modbus_bus->parity      = OSM_MODBUS_PARITY;
         modbus_bus->stopbits    = OSM_MODBUS_STOP;
         modbus_bus->binary_protocol = false;
+        modbus_bus->read_max_gap    = OSM_MODBUS_READ_MAX_GAP;
+        modbus_bus->read_max_span   = OSM_MODBUS_READ_MAX_SPAN;
         modbus_bus->first_free_offset = _modbus_get_offset(modbus_bus->blocks);
         for(unsigned n = 0; n < (OSM_MODBUS_BLOCKS-1) /*Last is zeroed*/; n++)
             modbus_bus->blocks[n].next_free_offset = _modbus_get_offset(&modbus_bus->blocks[n+1]);
@@ -589,6 +591,8 @@ bool osm_modbus_persist_config_cmp(osm_modbus_bus_t* d0, osm_modbus_bus_t* d1)
         d0->parity                  != d1->parity               ||
         d0->dev_count               != d1->dev_count            ||
         d0->baudrate                != d1->baudrate             ||
+        d0->read_max_gap            != d1->read_max_gap         ||
+        d0->read_max_span           != d1->read_max_span        ||
         d0->first_dev_offset        != d1->first_dev_offset     ||
         d0->first_free_offset       != d1->first_free_offset    )
     {
@@ -16,18 +16,59 @@ bool osm_persist_config_update(const osm_persist_storage_t* from_config, osm_per
 {
     uint16_t base_version = from_config->version >> 8;
     uint16_t model_version = from_config->version & 0xFF;
-    if (OSM_PERSIST_BASE_VERSION == base_version)
+    /* The base before the 1-Wire ROMs only changed the measurements page. */
+    if (OSM_PERSIST_BASE_VERSION == base_version ||
+        OSM_PERSIST_BASE_VERSION_W1_ROMS - 1 == base_version)
     {
         memcpy(to_config, from_config, sizeof(osm_persist_storage_t));
+        to_config->version = PERSIST_VERSION;
     }
     else
     {
         return false;
     }
+    if (OSM_PERSIST_VERSION_SET(model_version) == PERSIST_VERSION)
+        return true;
     return osm_model_config_update((const void*)&from_config->model_config, &to_config->model_config, model_version);
 }
 
 
+static bool _persist_measurement_def_used(const osm_measurements_def_t* def)
+{
+    return def->name[0] && (uint8_t)def->name[0] != 0xFF;
+}
+
+
+/* Before the 1-Wire ROMs, measurement slots ran on to the end of the
+ * page, so move any in what are now the ROMs down into free slots. */
+void osm_persist_measurements_update(uint16_t from_version, osm_persist_measurements_storage_t* measurements)
+{
+    if ((from_version >> 8) >= OSM_PERSIST_BASE_VERSION_W1_ROMS)
+        return;
+    _Static_assert(sizeof(measurements->w1_roms) % sizeof(osm_measurements_def_t) == 0, "1-Wire ROMs not whole old measurement slots.");
+    osm_measurements_def_t old_defs[sizeof(measurements->w1_roms) / (sizeof(osm_measurements_def_t))];
+    memcpy(old_defs, measurements->w1_roms, sizeof(old_defs));
+    memset(measurements->w1_roms, 0, sizeof(measurements->w1_roms));
+
+    unsigned free_slot = 0;
+    for (unsigned i = 0; i < OSM_ARRAY_SIZE(old_defs); i++)
+    {
+        osm_measurements_def_t* def = &old_defs[i];
+        if (!_persist_measurement_def_used(def))
+            continue;
+        while (free_slot < OSM_MEASUREMENTS_MAX_NUMBER &&
+               _persist_measurement_def_used(&measurements->measurements_arr[free_slot]))
+            free_slot++;
+        if (free_slot == OSM_MEASUREMENTS_MAX_NUMBER)
+        {
+            osm_log_error("No slot for measurement \"%s\", dropped.", def->name);
+            continue;
+        }
+        measurements->measurements_arr[free_slot++] = *def;
+    }
+}
+
+
 char * osm_persist_get_serial_number(void)
 {
     return persist_data.serial_number;
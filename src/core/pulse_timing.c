@@ -0,0 +1,82 @@
+#include <math.h>
+#include <string.h>
+
+#include <osm/core/pulse_timing.h>
+
+
+static void _pulse_timing_stats_clear(osm_pulse_timing_stats_t* stats)
+{
+    stats->count = 0;
+    stats->sum_us = 0;
+    stats->min_us = UINT64_MAX;
+    stats->max_us = 0;
+    stats->mean_us = 0;
+    stats->m2 = 0;
+}
+
+
+void osm_pulse_timing_init(osm_pulse_timing_t* timing)
+{
+    memset(timing, 0, sizeof(osm_pulse_timing_t));
+    _pulse_timing_stats_clear(&timing->stats);
+}
+
+
+static void _pulse_timing_add(osm_pulse_timing_stats_t* stats, uint64_t stamp_us)
+{
+    bool had_last = stats->has_last;
+    uint64_t last_us = stats->last_us;
+    stats->last_us = stamp_us;
+    stats->has_last = true;
+    /* Not after a gap, nor back over the millisecond count wrapping. */
+    if (!had_last || stamp_us <= last_us)
+        return;
+    uint64_t interval = stamp_us - last_us;
+    stats->count++;
+    stats->sum_us += interval;
+    if (interval < stats->min_us)
+        stats->min_us = interval;
+    if (interval > stats->max_us)
+        stats->max_us = interval;
+    double delta = (double)interval - stats->mean_us;
+    stats->mean_us += delta / stats->count;
+    stats->m2 += delta * ((double)interval - stats->mean_us);
+}
+
+
+void osm_pulse_timing_drain(osm_pulse_timing_t* timing)
+{
+    osm_pulse_timing_ring_t* ring = &timing->ring;
+    uint32_t head = ring->head;
+    uint32_t tail = ring->tail;
+    while (tail != head)
+    {
+        uint64_t stamp_us = ring->stamps_us[tail & (OSM_PULSE_TIMING_RING_SIZE - 1)];
+        if (stamp_us & OSM_PULSE_TIMING_GAP)
+            timing->stats.has_last = false;
+        _pulse_timing_add(&timing->stats, stamp_us & ~OSM_PULSE_TIMING_GAP);
+        tail++;
+    }
+    ring->tail = tail;
+}
+
+
+/* Takes what has been drained and clears it, false if there are no
+ * intervals to give, though the rate of 0 and overflows are still set. */
+bool osm_pulse_timing_take(osm_pulse_timing_t* timing, osm_pulse_timing_result_t* result)
+{
+    osm_pulse_timing_stats_t* stats = &timing->stats;
+    memset(result, 0, sizeof(osm_pulse_timing_result_t));
+    result->count = stats->count;
+    uint32_t overflows = timing->ring.overflows;
+    result->overflows = overflows - stats->overflows_taken;
+    stats->overflows_taken = overflows;
+    if (!stats->count)
+        return false;
+    result->rate_hz = stats->count * 1e6 / stats->sum_us;
+    result->min_ms = stats->min_us / 1000.;
+    result->max_ms = stats->max_us / 1000.;
+    result->jitter_ms = sqrt(stats->m2 / stats->count) / 1000.;
+    _pulse_timing_stats_clear(stats);
+    return true;
+}
@@ -1,23 +1,71 @@
 #include <stdlib.h>
 #include <string.h>
+#if !defined(__arm__)
+#include <stdatomic.h>
+#endif
 
 #include <osm/core/ring.h>
 #include <osm/core/log.h>
 
 
+/* Aligned word accesses are single copy atomic on both targets, only
+ * ordering against the buffer data is needed. */
+static inline unsigned _ring_buf_load_acquire(volatile unsigned * pos)
+{
+    unsigned r = *pos;
+#if defined(__arm__)
+    __asm__ volatile ("dmb" ::: "memory");
+#else
+    atomic_thread_fence(memory_order_acquire);
+#endif
+    return r;
+}
+
+
+static inline void _ring_buf_store_release(volatile unsigned * pos, unsigned value)
+{
+#if defined(__arm__)
+    __asm__ volatile ("dmb" ::: "memory");
+#else
+    atomic_thread_fence(memory_order_release);
+#endif
+    *pos = value;
+}
+
+
+/* Positions only ever step on by at most size, so a compare does for
+ * rings that aren't a power of two. */
+static inline unsigned _ring_buf_wrap(osm_ring_buf_t * ring_buf, unsigned pos)
+{
+    if (ring_buf->mask)
+        return pos & ring_buf->mask;
+    return (pos >= ring_buf->size)?(pos - ring_buf->size):pos;
+}
+
+
+/* Copy out len bytes from pos, split at the wrap. */
+static void _ring_buf_copy_out(osm_ring_buf_t * ring_buf, unsigned pos, char * buf, unsigned len)
+{
+    unsigned first = ring_buf->size - pos;
+    if (first > len)
+        first = len;
+    memcpy(buf, (char*)&ring_buf->buf[pos], first);
+    memcpy(buf + first, (char*)ring_buf->buf, len - first);
+}
+
 
 bool osm_ring_buf_add(osm_ring_buf_t * ring_buf, char c)
 {
     /* So we know it's got data, we never let write pos catch read pos*/
     unsigned w_pos = ring_buf->w_pos;
-    unsigned w_next = (w_pos + 1) % ring_buf->size;
+    unsigned w_next = _ring_buf_wrap(ring_buf, w_pos + 1);
 
-    if (w_next == ring_buf->r_pos)
+    if (w_next == _ring_buf_load_acquire(&ring_buf->r_pos))
         return false;
 
     ring_buf->buf[w_pos] = c;
 
-    ring_buf->w_pos = w_next;
+    _ring_buf_store_release(&ring_buf->w_pos, w_next);
 
     return true;
 }
@@ -25,26 +73,36 @@ bool osm_ring_buf_add(osm_ring_buf_t * ring_buf, char c)
 
 bool     osm_ring_buf_add_data(osm_ring_buf_t * ring_buf, void * data, unsigned size)
 {
-    char * pos = (char*)data;
-    while(size--)
-        if (!osm_ring_buf_add(ring_buf, *pos++))
-            return false;
-    return true;
+    /* So we know it's got data, we never let write pos catch read pos*/
+    unsigned space = ring_buf->size - 1 - osm_ring_buf_get_pending(ring_buf);
+    bool fits = (size <= space);
+    if (!fits)
+        size = space;
+
+    unsigned w_pos = ring_buf->w_pos;
+    unsigned first = ring_buf->size - w_pos;
+    if (first > size)
+        first = size;
+
+    memcpy((char*)&ring_buf->buf[w_pos], data, first);
+    memcpy((char*)ring_buf->buf, (char*)data + first, size - first);
+
+    _ring_buf_store_release(&ring_buf->w_pos, _ring_buf_wrap(ring_buf, w_pos + size));
+    return fits;
 }
 
 
 void osm_ring_buf_add_str(osm_ring_buf_t * ring_buf, char * s)
 {
-    while(*s)
-        osm_ring_buf_add(ring_buf, *s++);
+    osm_ring_buf_add_data(ring_buf, s, strlen(s));
 }
 
 
 
 unsigned osm_ring_buf_get_pending(osm_ring_buf_t * ring_buf)
 {
-    unsigned r_pos = ring_buf->r_pos;
-    unsigned w_pos = ring_buf->w_pos;
+    unsigned r_pos = _ring_buf_load_acquire(&ring_buf->r_pos);
+    unsigned w_pos = _ring_buf_load_acquire(&ring_buf->w_pos);
     if (r_pos == w_pos)
         return 0;
     unsigned sec_size = (r_pos < w_pos)?(w_pos - r_pos):(ring_buf->size - r_pos + w_pos);
@@ -55,56 +113,68 @@ unsigned osm_ring_buf_get_pending(osm_ring_buf_t * ring_buf)
 bool      osm_ring_buf_is_full(osm_ring_buf_t * ring_buf)
 {
     /* So we know it's got data, we never let write pos catch read pos*/
-    unsigned w_next = (ring_buf->w_pos + 1) % ring_buf->size;
-    return (w_next == ring_buf->r_pos);
+    unsigned w_next = _ring_buf_wrap(ring_buf, ring_buf->w_pos + 1);
+    return (w_next == _ring_buf_load_acquire(&ring_buf->r_pos));
 }
 
 
 unsigned  osm_ring_buf_read(osm_ring_buf_t * ring_buf, char * buf, unsigned len)
 {
-    for(unsigned n = 0; n < len; n++)
-    {
-        unsigned r_pos = ring_buf->r_pos;
-        buf[n] = ring_buf->buf[r_pos];
-        if (r_pos == ring_buf->w_pos)
-            return n;
-        r_pos++;
-        r_pos %= ring_buf->size;
-        ring_buf->r_pos = r_pos;
-    }
+    len = osm_ring_buf_peek(ring_buf, buf, len);
+    _ring_buf_store_release(&ring_buf->r_pos, _ring_buf_wrap(ring_buf, ring_buf->r_pos + len));
     return len;
 }
 
 
 unsigned osm_ring_buf_discard(osm_ring_buf_t * ring_buf, unsigned len)
 {
-    unsigned r_pos = ring_buf->r_pos;
-
-    for(unsigned n = 0; n < len; n++)
-    {
-        if (r_pos == ring_buf->w_pos)
-            return n;
-        r_pos++;
-        r_pos %= ring_buf->size;
-        ring_buf->r_pos = r_pos;
-    }
+    unsigned pending = osm_ring_buf_get_pending(ring_buf);
+    if (len > pending)
+        len = pending;
+    _ring_buf_store_release(&ring_buf->r_pos, _ring_buf_wrap(ring_buf, ring_buf->r_pos + len));
     return len;
+}
+
 
+unsigned osm_ring_buf_discard_all(osm_ring_buf_t * ring_buf)
+{
+    return osm_ring_buf_discard(ring_buf, osm_ring_buf_get_pending(ring_buf));
 }
 
 
 unsigned osm_ring_buf_peek(osm_ring_buf_t * ring_buf, char * buf, unsigned len)
 {
-    unsigned r_pos = ring_buf->r_pos;
+    unsigned pending = osm_ring_buf_get_pending(ring_buf);
+    if (len > pending)
+        len = pending;
+    _ring_buf_copy_out(ring_buf, ring_buf->r_pos, buf, len);
+    return len;
+}
 
-    for(unsigned n = 0; n < len; n++)
-    {
-        buf[n] = ring_buf->buf[r_pos];
-        if (r_pos == ring_buf->w_pos)
-            return n;
-        r_pos++;
-        r_pos %= ring_buf->size;
-    }
+
+
+/* Contiguous readable bytes from offset past the read position, without copying. */
+unsigned osm_ring_buf_peek_span(osm_ring_buf_t * ring_buf, unsigned offset, char ** span)
+{
+    if (offset >= osm_ring_buf_get_pending(ring_buf))
+        return 0;
+
+    unsigned pos = _ring_buf_wrap(ring_buf, ring_buf->r_pos + offset);
+    unsigned w_pos = _ring_buf_load_acquire(&ring_buf->w_pos);
+
+    *span = (char*)&ring_buf->buf[pos];
+    return (pos < w_pos)?(w_pos - pos):(ring_buf->size - pos);
+}
+
+
+static unsigned _ring_buf_find_eol(const char * s, unsigned len)
+{
+    const char * nl = memchr(s, '\n', len);
+    if (nl)
+        len = nl - s;
+    const char * cr = memchr(s, '\r', len);
+    if (cr)
+        len = cr - s;
     return len;
 }
 
@@ -121,37 +191,42 @@ unsigned  osm_ring_buf_readline(osm_ring_buf_t * ring_buf, char * buf, unsigned
 
     toread = (toread > len)?len:toread;
 
-    unsigned r_pos = ring_buf->r_pos;
+    /* Scan at most two contiguous spans for the line end. */
+    unsigned n = 0;
+    while (n < toread)
+    {
+        char * span;
+        unsigned span_len = osm_ring_buf_peek_span(ring_buf, n, &span);
+        if (span_len > toread - n)
+            span_len = toread - n;
+        unsigned found = _ring_buf_find_eol(span, span_len);
+        n += found;
+        if (found < span_len)
+            break;
+    }
 
-    for(unsigned n = 0; n < toread; n++)
+    if (n < toread)
     {
-        char c = ring_buf->buf[r_pos];
-        r_pos++;
-        r_pos %= ring_buf->size;
+        unsigned r_pos = ring_buf->r_pos;
+        _ring_buf_copy_out(ring_buf, r_pos, buf, n);
+        buf[n] = 0;
 
-        if (c == '\n' || c == '\r')
+        unsigned eol = 1;
+        if ((n + 1) < toread)
         {
-            if ((n + 1) < toread)
-            {
-                c = ring_buf->buf[r_pos];
-                if (c == '\r' || c == '\n')
-                {
-                    r_pos++;
-                    r_pos %= ring_buf->size;
-                }
-            }
-
-            buf[n]          = 0;
-            ring_buf->r_pos = r_pos;
-            return n;
+            char c = ring_buf->buf[_ring_buf_wrap(ring_buf, r_pos + n + 1)];
+            if (c == '\r' || c == '\n')
+                eol++;
         }
-        else buf[n] = c;
+        _ring_buf_store_release(&ring_buf->r_pos, _ring_buf_wrap(ring_buf, r_pos + n + eol));
+        return n;
     }
 
     if (len == toread)
     {
+        _ring_buf_copy_out(ring_buf, ring_buf->r_pos, buf, len);
         buf[len]        = 0;
-        ring_buf->r_pos = r_pos;
+        _ring_buf_store_release(&ring_buf->r_pos, _ring_buf_wrap(ring_buf, ring_buf->r_pos + len));
         return len;
     }
 
@@ -161,36 +236,16 @@ unsigned  osm_ring_buf_readline(osm_ring_buf_t * ring_buf, char * buf, unsigned
 
 unsigned     osm_ring_buf_consume(osm_ring_buf_t * ring_buf, ring_buf_consume_cb cb, char * tmp_buf, unsigned len, void * data)
 {
-    unsigned r_pos = ring_buf->r_pos;
-
-    for(unsigned n = 0; n < len; n++)
-    {
-        if (r_pos == ring_buf->w_pos)
-        {
-            len = n;
-            break;
-        }
-        tmp_buf[n] = ring_buf->buf[r_pos];
-        r_pos++;
-        r_pos %= ring_buf->size;
-    }
+    len = osm_ring_buf_peek(ring_buf, tmp_buf, len);
 
     if (!len)
         return 0;
 
     unsigned consumed = cb(tmp_buf, len, data);
 
-    if (consumed < len)
-    {
-        unsigned unconsumed = len - consumed;
-        while(unconsumed--)
-        {
-            if (r_pos)
-                r_pos--;
-            else
-                r_pos = ring_buf->size-1;
-        }
-    }
-    ring_buf->r_pos = r_pos;
+    if (consumed > len)
+        consumed = len;
+
+    _ring_buf_store_release(&ring_buf->r_pos, _ring_buf_wrap(ring_buf, ring_buf->r_pos + consumed));
     return consumed;
 }
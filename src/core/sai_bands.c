@@ -0,0 +1,260 @@
+#include <math.h>
+#include <string.h>
+
+#include <osm/core/sai_bands.h>
+
+
+#define SAI_BANDS_COEF_SHIFT        28
+#define SAI_BANDS_COEF_ONE          (1L << SAI_BANDS_COEF_SHIFT)
+#define SAI_BANDS_CHUNK             32      /* Samples filtered at once, on the stack */
+#define SAI_BANDS_LOWEST_HZ         31.25   /* Base 2 mid bands, 1kHz * 2^n */
+
+/* Analogue poles of A weighting, IEC 61672. */
+#define SAI_BANDS_A_F1              20.598997
+#define SAI_BANDS_A_F2              107.65265
+#define SAI_BANDS_A_F3              737.86223
+#define SAI_BANDS_A_F4              12194.217
+#define SAI_BANDS_A_REF_HZ          1000.
+
+
+static osm_sai_bands_coeffs_t _sai_bands_a_coeffs[OSM_SAI_BANDS_A_SECTIONS];
+static osm_sai_bands_coeffs_t _sai_bands_coeffs[OSM_SAI_BANDS_COUNT][OSM_SAI_BANDS_SECTIONS];
+static bool                   _sai_bands_coeffs_done = false;
+
+
+static int32_t _sai_bands_q28(double value)
+{
+    return (int32_t)round(value * SAI_BANDS_COEF_ONE);
+}
+
+
+/* Normalised to a0 and to a gain of one at the reference. */
+static void _sai_bands_set_coeffs(osm_sai_bands_coeffs_t* coeffs, const double* b, const double* a, double ref_hz)
+{
+    double w = 2 * M_PI * ref_hz / OSM_SAI_BANDS_SAMPLE_RATE_HZ;
+    double b_re = b[0] + b[1] * cos(w) + b[2] * cos(2 * w);
+    double b_im = -b[1] * sin(w) - b[2] * sin(2 * w);
+    double a_re = a[0] + a[1] * cos(w) + a[2] * cos(2 * w);
+    double a_im = -a[1] * sin(w) - a[2] * sin(2 * w);
+    double gain = sqrt((b_re * b_re + b_im * b_im) / (a_re * a_re + a_im * a_im));
+    coeffs->b0 = _sai_bands_q28(b[0] / (a[0] * gain));
+    coeffs->b1 = _sai_bands_q28(b[1] / (a[0] * gain));
+    coeffs->b2 = _sai_bands_q28(b[2] / (a[0] * gain));
+    coeffs->a1 = _sai_bands_q28(a[1] / a[0]);
+    coeffs->a2 = _sai_bands_q28(a[2] / a[0]);
+}
+
+
+/* A pole of the analogue filter by the bilinear transform. */
+static double _sai_bands_bilinear_pole(double hz)
+{
+    double k = 2 * OSM_SAI_BANDS_SAMPLE_RATE_HZ;
+    double p = 2 * M_PI * hz;
+    return (k - p) / (k + p);
+}
+
+
+/* Bilinear, so past about 2kHz A weighting falls away early, about
+ * 1.3dB short at 3kHz, where there is little left of it to weigh. */
+static void _sai_bands_a_weighting(void)
+{
+    double z1 = _sai_bands_bilinear_pole(SAI_BANDS_A_F1);
+    double z2 = _sai_bands_bilinear_pole(SAI_BANDS_A_F2);
+    double z3 = _sai_bands_bilinear_pole(SAI_BANDS_A_F3);
+    double z4 = _sai_bands_bilinear_pole(SAI_BANDS_A_F4);
+    /* The four zeros at DC, the two at infinity fall at Nyquist. */
+    const double high_pass[3] = {1, -2, 1};
+    const double low_pass[3] = {1, 2, 1};
+    double a[3] = {1, -2 * z1, z1 * z1};
+    _sai_bands_set_coeffs(&_sai_bands_a_coeffs[0], high_pass, a, SAI_BANDS_A_REF_HZ);
+    a[1] = -(z2 + z3);
+    a[2] = z2 * z3;
+    _sai_bands_set_coeffs(&_sai_bands_a_coeffs[1], high_pass, a, SAI_BANDS_A_REF_HZ);
+    a[1] = -2 * z4;
+    a[2] = z4 * z4;
+    _sai_bands_set_coeffs(&_sai_bands_a_coeffs[2], low_pass, a, SAI_BANDS_A_REF_HZ);
+}
+
+
+/* Each band a 4th order Butterworth high pass at its lower edge then
+ * low pass at its upper, as two biquads apiece, each set to a gain of
+ * one at the middle of the band. */
+static void _sai_bands_octaves(void)
+{
+    const double qs[2] = {0.54119610, 1.3065630};
+    for (unsigned n = 0; n < OSM_SAI_BANDS_COUNT; n++)
+    {
+        double centre = SAI_BANDS_LOWEST_HZ * (1 << n);
+        for (unsigned s = 0; s < OSM_SAI_BANDS_SECTIONS; s++)
+        {
+            bool is_high = s < 2;
+            double edge = is_high ? centre / M_SQRT2 : centre * M_SQRT2;
+            double w = 2 * M_PI * edge / OSM_SAI_BANDS_SAMPLE_RATE_HZ;
+            double alpha = sin(w) / (2 * qs[s % 2]);
+            double c = cos(w);
+            double b[3];
+            if (is_high)
+            {
+                b[0] = (1 + c) / 2;
+                b[1] = -(1 + c);
+            }
+            else
+            {
+                b[0] = (1 - c) / 2;
+                b[1] = 1 - c;
+            }
+            b[2] = b[0];
+            const double a[3] = {1 + alpha, -2 * c, 1 - alpha};
+            _sai_bands_set_coeffs(&_sai_bands_coeffs[n][s], b, a, centre);
+        }
+    }
+}
+
+
+void osm_sai_bands_init(osm_sai_bands_t* bands)
+{
+    if (!_sai_bands_coeffs_done)
+    {
+        _sai_bands_a_weighting();
+        _sai_bands_octaves();
+        _sai_bands_coeffs_done = true;
+    }
+    memset(bands, 0, sizeof(osm_sai_bands_t));
+    bands->settle = OSM_SAI_BANDS_SETTLE_SAMPLES;
+}
+
+
+void osm_sai_bands_acc_clear(osm_sai_bands_acc_t* acc)
+{
+    memset(acc, 0, sizeof(osm_sai_bands_acc_t));
+    acc->fast_min = UINT64_MAX;
+}
+
+
+/* Direct form 1, the fraction the shift drops is added back in next
+ * time, else the lowest bands, with poles near one, amplify it. */
+static void _sai_bands_filter(const osm_sai_bands_coeffs_t* coeffs, osm_sai_bands_state_t* state, int32_t* chunk, unsigned len)
+{
+    int32_t x1 = state->x1, x2 = state->x2;
+    int32_t y1 = state->y1, y2 = state->y2;
+    uint32_t err = state->err;
+    for (unsigned i = 0; i < len; i++)
+    {
+        int32_t x = chunk[i];
+        int64_t acc = (int64_t)err
+                    + (int64_t)coeffs->b0 * x
+                    + (int64_t)coeffs->b1 * x1
+                    + (int64_t)coeffs->b2 * x2
+                    - (int64_t)coeffs->a1 * y1
+                    - (int64_t)coeffs->a2 * y2;
+        int32_t y = (int32_t)(acc >> SAI_BANDS_COEF_SHIFT);
+        err = (uint32_t)(acc & (SAI_BANDS_COEF_ONE - 1));
+        x2 = x1;
+        x1 = x;
+        y2 = y1;
+        y1 = y;
+        chunk[i] = y;
+    }
+    state->x1 = x1;
+    state->x2 = x2;
+    state->y1 = y1;
+    state->y2 = y2;
+    state->err = err;
+}
+
+
+static uint64_t _sai_bands_sum_squares(const int32_t* chunk, unsigned len)
+{
+    uint64_t sum = 0;
+    for (unsigned i = 0; i < len; i++)
+        sum += (int64_t)chunk[i] * chunk[i];
+    return sum;
+}
+
+
+/* Samples are 24 bit in 32, signed or not. A chunk at a time, and no
+ * chunk crosses the end of settling or of a fast block. */
+void osm_sai_bands_add(osm_sai_bands_t* bands, osm_sai_bands_acc_t* acc, const volatile int32_t* samples, unsigned len)
+{
+    int32_t input[SAI_BANDS_CHUNK];
+    int32_t chunk[SAI_BANDS_CHUNK];
+    unsigned i = 0;
+    while (i < len)
+    {
+        unsigned chunk_len = len - i;
+        if (chunk_len > SAI_BANDS_CHUNK)
+            chunk_len = SAI_BANDS_CHUNK;
+        if (bands->settle)
+        {
+            if (chunk_len > bands->settle)
+                chunk_len = bands->settle;
+        }
+        else if (chunk_len > OSM_SAI_BANDS_FAST_SAMPLES - bands->fast_count)
+            chunk_len = OSM_SAI_BANDS_FAST_SAMPLES - bands->fast_count;
+
+        for (unsigned j = 0; j < chunk_len; j++)
+            input[j] = (int32_t)((uint32_t)samples[i + j] << 8) >> 8;
+        i += chunk_len;
+
+        memcpy(chunk, input, chunk_len * sizeof(int32_t));
+        for (unsigned s = 0; s < OSM_SAI_BANDS_A_SECTIONS; s++)
+            _sai_bands_filter(&_sai_bands_a_coeffs[s], &bands->a_states[s], chunk, chunk_len);
+        uint64_t a_energy = _sai_bands_sum_squares(chunk, chunk_len);
+
+        uint64_t band_energy[OSM_SAI_BANDS_COUNT];
+        for (unsigned n = 0; n < OSM_SAI_BANDS_COUNT; n++)
+        {
+            memcpy(chunk, input, chunk_len * sizeof(int32_t));
+            for (unsigned s = 0; s < OSM_SAI_BANDS_SECTIONS; s++)
+                _sai_bands_filter(&_sai_bands_coeffs[n][s], &bands->band_states[n][s], chunk, chunk_len);
+            band_energy[n] = _sai_bands_sum_squares(chunk, chunk_len);
+        }
+
+        if (bands->settle)
+        {
+            bands->settle -= chunk_len;
+            continue;
+        }
+
+        acc->a_energy += a_energy;
+        for (unsigned n = 0; n < OSM_SAI_BANDS_COUNT; n++)
+            acc->band_energy[n] += band_energy[n];
+        acc->count += chunk_len;
+
+        bands->fast_energy += a_energy;
+        bands->fast_count += chunk_len;
+        if (bands->fast_count == OSM_SAI_BANDS_FAST_SAMPLES)
+        {
+            if (bands->fast_energy > acc->fast_max)
+                acc->fast_max = bands->fast_energy;
+            if (bands->fast_energy < acc->fast_min)
+                acc->fast_min = bands->fast_energy;
+            acc->fast_blocks++;
+            bands->fast_energy = 0;
+            bands->fast_count = 0;
+        }
+    }
+}
+
+
+/* RMS of each level, in the order of OSM_SAI_BANDS_LEVEL_*, in sample
+ * counts. Short of a whole fast block, its max and min are the Leq. */
+bool osm_sai_bands_get(const osm_sai_bands_acc_t* acc, float* rms)
+{
+    if (!acc->count)
+        return false;
+    rms[OSM_SAI_BANDS_LEVEL_LAEQ] = sqrt(acc->a_energy / acc->count);
+    if (acc->fast_blocks)
+    {
+        rms[OSM_SAI_BANDS_LEVEL_LAMAX] = sqrt((double)acc->fast_max / OSM_SAI_BANDS_FAST_SAMPLES);
+        rms[OSM_SAI_BANDS_LEVEL_LAMIN] = sqrt((double)acc->fast_min / OSM_SAI_BANDS_FAST_SAMPLES);
+    }
+    else
+    {
+        rms[OSM_SAI_BANDS_LEVEL_LAMAX] = rms[OSM_SAI_BANDS_LEVEL_LAEQ];
+        rms[OSM_SAI_BANDS_LEVEL_LAMIN] = rms[OSM_SAI_BANDS_LEVEL_LAEQ];
+    }
+    for (unsigned n = 0; n < OSM_SAI_BANDS_COUNT; n++)
+        rms[OSM_SAI_BANDS_LEVEL_BAND + n] = sqrt(acc->band_energy[n] / acc->count);
+    return true;
+}
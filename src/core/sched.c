@@ -0,0 +1,90 @@
+#include <osm/core/sched.h>
+
+
+static bool _sched_before(osm_sched_t* sched, unsigned a, unsigned b)
+{
+    return (int32_t)(sched->due_ms[a] - sched->due_ms[b]) < 0;
+}
+
+
+void osm_sched_clear(osm_sched_t* sched)
+{
+    sched->len = 0;
+}
+
+
+void osm_sched_push(osm_sched_t* sched, unsigned slot, uint32_t due_ms)
+{
+    uint8_t* heap = sched->heap;
+    unsigned pos = sched->len++;
+
+    sched->due_ms[slot] = due_ms;
+
+    while (pos)
+    {
+        unsigned parent = (pos - 1) / 2;
+        if (!_sched_before(sched, slot, heap[parent]))
+            break;
+        heap[pos] = heap[parent];
+        pos = parent;
+    }
+    heap[pos] = slot;
+}
+
+
+static unsigned _sched_pop(osm_sched_t* sched)
+{
+    uint8_t* heap = sched->heap;
+    unsigned top = heap[0];
+    unsigned last = heap[--sched->len];
+    unsigned len = sched->len;
+    unsigned pos = 0;
+
+    while (true)
+    {
+        unsigned child = pos * 2 + 1;
+        if (child >= len)
+            break;
+        if (child + 1 < len && _sched_before(sched, heap[child + 1], heap[child]))
+            child++;
+        if (!_sched_before(sched, heap[child], last))
+            break;
+        heap[pos] = heap[child];
+        pos = child;
+    }
+    if (len)
+        heap[pos] = last;
+    return top;
+}
+
+
+/* The soonest slot out of the heap, if it is due. */
+bool osm_sched_take_due(osm_sched_t* sched, uint32_t now_ms, unsigned* slot)
+{
+    if (!sched->len)
+        return false;
+    if ((int32_t)(sched->due_ms[sched->heap[0]] - now_ms) > 0)
+        return false;
+    *slot = _sched_pop(sched);
+    return true;
+}
+
+
+/* A taken slot back in, never due again the same pass. */
+void osm_sched_put_back(osm_sched_t* sched, unsigned slot, uint32_t now_ms, uint32_t wait_ms)
+{
+    if (wait_ms < OSM_SCHED_RETRY_MS)
+        wait_ms = OSM_SCHED_RETRY_MS;
+    osm_sched_push(sched, slot, now_ms + wait_ms);
+}
+
+
+/* Until the soonest is due, false if there are none. */
+bool osm_sched_get_wait(osm_sched_t* sched, uint32_t now_ms, uint32_t* wait_ms)
+{
+    if (!sched->len)
+        return false;
+    int32_t wait = (int32_t)(sched->due_ms[sched->heap[0]] - now_ms);
+    *wait_ms = (wait > 0)?(uint32_t)wait:0;
+    return true;
+}
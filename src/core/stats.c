@@ -0,0 +1,142 @@
+#include <string.h>
+#include <math.h>
+
+#include <osm/core/stats.h>
+
+
+void osm_stats_init(osm_stats_t* stats)
+{
+    memset(stats, 0, sizeof(osm_stats_t));
+}
+
+
+static float _stats_parabolic(const osm_stats_quantile_t* qt, unsigned i, int d)
+{
+    float n_prev = qt->n[i - 1];
+    float n_this = qt->n[i];
+    float n_next = qt->n[i + 1];
+    return qt->q[i] + d / (n_next - n_prev) *
+        ((n_this - n_prev + d) * (qt->q[i + 1] - qt->q[i]) / (n_next - n_this) +
+         (n_next - n_this - d) * (qt->q[i] - qt->q[i - 1]) / (n_this - n_prev));
+}
+
+
+static float _stats_linear(const osm_stats_quantile_t* qt, unsigned i, int d)
+{
+    return qt->q[i] + d * (qt->q[i + d] - qt->q[i]) / ((float)qt->n[i + d] - qt->n[i]);
+}
+
+
+/* count is the number of samples before this one. */
+static void _stats_quantile_add(osm_stats_quantile_t* qt, float p, unsigned count, float value)
+{
+    if (count < OSM_STATS_MARKERS)
+    {
+        /* Too few for markers, keep them sorted. */
+        unsigned i = count;
+        while (i && qt->q[i - 1] > value)
+        {
+            qt->q[i] = qt->q[i - 1];
+            i--;
+        }
+        qt->q[i] = value;
+        qt->n[count] = count;
+        return;
+    }
+
+    unsigned k;
+    if (value < qt->q[0])
+    {
+        qt->q[0] = value;
+        k = 0;
+    }
+    else if (value >= qt->q[4])
+    {
+        qt->q[4] = value;
+        k = 3;
+    }
+    else
+    {
+        for (k = 0; k < 3 && value >= qt->q[k + 1]; k++);
+    }
+
+    for (unsigned i = k + 1; i < OSM_STATS_MARKERS; i++)
+        qt->n[i]++;
+
+    const float dn[OSM_STATS_MARKERS] = {0, p / 2, p, (1 + p) / 2, 1};
+
+    for (unsigned i = 1; i < OSM_STATS_MARKERS - 1; i++)
+    {
+        float d = dn[i] * count - qt->n[i];
+        int step;
+        if (d >= 1 && qt->n[i + 1] - qt->n[i] > 1)
+            step = 1;
+        else if (d <= -1 && qt->n[i - 1] - qt->n[i] < -1)
+            step = -1;
+        else
+            continue;
+
+        float q = _stats_parabolic(qt, i, step);
+        if (qt->q[i - 1] < q && q < qt->q[i + 1])
+            qt->q[i] = q;
+        else
+            qt->q[i] = _stats_linear(qt, i, step);
+        qt->n[i] += step;
+    }
+}
+
+
+static float _stats_quantile_get(const osm_stats_quantile_t* qt, float p, unsigned count)
+{
+    if (!count)
+        return 0;
+    if (count > OSM_STATS_MARKERS)
+        return qt->q[2];
+
+    float pos = p * (count - 1);
+    unsigned lo = pos;
+    if (lo + 1 >= count)
+        return qt->q[count - 1];
+    return qt->q[lo] + (pos - lo) * (qt->q[lo + 1] - qt->q[lo]);
+}
+
+
+void osm_stats_add(osm_stats_t* stats, float value)
+{
+    if (stats->count == UINT16_MAX)
+        return;
+
+    _stats_quantile_add(&stats->p50, 0.5f, stats->count, value);
+    _stats_quantile_add(&stats->p95, 0.95f, stats->count, value);
+
+    stats->count++;
+    float delta = value - stats->mean;
+    stats->mean += delta / stats->count;
+    stats->m2 += delta * (value - stats->mean);
+}
+
+
+float osm_stats_get_variance(const osm_stats_t* stats)
+{
+    if (stats->count < 2)
+        return 0;
+    return stats->m2 / (stats->count - 1);
+}
+
+
+float osm_stats_get_stddev(const osm_stats_t* stats)
+{
+    return sqrtf(osm_stats_get_variance(stats));
+}
+
+
+float osm_stats_get_p50(const osm_stats_t* stats)
+{
+    return _stats_quantile_get(&stats->p50, 0.5f, stats->count);
+}
+
+
+float osm_stats_get_p95(const osm_stats_t* stats)
+{
+    return _stats_quantile_get(&stats->p95, 0.95f, stats->count);
+}
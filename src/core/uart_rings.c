@@ -30,6 +30,14 @@ char line_buffer[CMD_LINELEN];
 
 static dma_uart_buf_t uart_dma_buf[OSM_UART_CHANNELS_COUNT];
 
+#ifdef OSM_UART_DMA_ZERO_COPY
+/* Bytes of the out ring being DMA'd in place, released on completion.
+ * Only the main loop moves the ring's read position, the port only
+ * flags the DMA as done. */
+static unsigned          uart_dma_inflight[OSM_UART_CHANNELS_COUNT];
+static volatile bool     uart_dma_done[OSM_UART_CHANNELS_COUNT];
+#endif
+
 static void _uart_cmd_out(osm_cmd_ctx_t * ctx, const char * fmt, va_list ap);
 static void _uart_cmd_error(osm_cmd_ctx_t * ctx, const char * fmt, va_list ap);
 static void _uart_cmd_flush(osm_cmd_ctx_t * ctx);
@@ -197,12 +205,40 @@ void osm_uart_ring_in_drain(unsigned uart)
 }
 
 
+#ifdef OSM_UART_DMA_ZERO_COPY
+/* Called by the port once the DMA from the out ring is done, which
+ * could be from the ISR. The bytes stay in the ring until the next
+ * drain releases them. */
+void osm_uart_ring_out_dma_done(unsigned uart)
+{
+    if (uart >= OSM_UART_CHANNELS_COUNT)
+        return;
+
+    uart_dma_done[uart] = true;
+}
+
+
+/* False while a DMA from the ring is still going. */
+static bool _uart_ring_out_dma_release(unsigned uart, osm_ring_buf_t * ring)
+{
+    unsigned len = uart_dma_inflight[uart];
+    if (!len)
+        return true;
+    if (!uart_dma_done[uart])
+        return false;
+    uart_dma_done[uart] = false;
+    uart_dma_inflight[uart] = 0;
+    osm_ring_buf_discard(ring, len);
+    return true;
+}
+#else
 static unsigned _uart_out_dma(char * c, unsigned len, void * puart)
 {
     unsigned uart = *(unsigned*)puart;
 
     return osm_uart_dma_out(uart, c, len);
 }
+#endif
 
 
 static void uart_ring_out_drain(unsigned uart)
@@ -212,6 +248,11 @@ static void uart_ring_out_drain(unsigned uart)
 
     osm_ring_buf_t * ring = &ring_out_bufs[uart];
 
+#ifdef OSM_UART_DMA_ZERO_COPY
+    if (!_uart_ring_out_dma_release(uart, ring))
+        return;
+#endif
+
     if(!osm_model_uart_ring_do_out_drain(uart, ring))
         return;
 
@@ -225,9 +266,20 @@ static void uart_ring_out_drain(unsigned uart)
         if (uart)
             osm_log_debug(DEBUG_UART(uart), "UART %u OUT > %u", uart, len);
 
+#ifdef OSM_UART_DMA_ZERO_COPY
+        char * span;
+        len = osm_ring_buf_peek_span(ring, 0, &span);
+
+        /* Set first, the DMA can be done before this returns. */
+        uart_dma_done[uart] = false;
+        uart_dma_inflight[uart] = len;
+        if (!osm_uart_dma_out(uart, span, len))
+            uart_dma_inflight[uart] = 0;
+#else
         len = (len > OSM_DMA_DATA_PCK_SZ)?OSM_DMA_DATA_PCK_SZ:len;
 
         osm_ring_buf_consume(ring, _uart_out_dma, uart_dma_buf[uart], len, &uart);
+#endif
     }
 }
 
@@ -305,6 +357,10 @@ void osm_uart_rings_out_wipe(unsigned uart)
 {
     if (uart < OSM_UART_CHANNELS_COUNT)
     {
+#ifdef OSM_UART_DMA_ZERO_COPY
+        uart_dma_inflight[uart] = 0;
+        uart_dma_done[uart] = false;
+#endif
         _uart_rings_wipe(&ring_out_bufs[uart]);
     }
 }
@@ -0,0 +1,104 @@
+#include <string.h>
+
+#include <osm/core/w1.h>
+#include <osm/core/w1_rom.h>
+
+
+/* The Maxim CRC of size bytes, checked against the byte after. */
+bool osm_w1_crc_check(const uint8_t* mem, unsigned size)
+{
+    uint8_t crc = 0x00;
+    for (unsigned i = 0; i < size; i++)
+    {
+        uint8_t byte = mem[i];
+        for (uint8_t j = 0; j < 8; ++j)
+        {
+            uint8_t blend = (crc ^ byte) & 0x01;
+            crc >>= 1;
+            if (blend)
+                crc ^= 0x8C;
+            byte >>= 1;
+        }
+    }
+    return crc == mem[size];
+}
+
+
+void osm_w1_search_init(osm_w1_search_t* search)
+{
+    memset(search->rom, 0, OSM_W1_ROM_LEN);
+    search->last_discrepancy = -1;
+    search->last_device = false;
+}
+
+
+/* The next ROM on the bus into search->rom, false once all are found or
+ * the bus fails. Each device sends each bit of its ROM then its
+ * complement, so where both read 0 the devices differ. The first search
+ * takes 0 at each, and each after takes the last 0 taken as 1 instead,
+ * following the ROM before up to it. */
+bool osm_w1_search_next(uint8_t index, osm_w1_search_t* search)
+{
+    if (search->last_device)
+        return false;
+    if (!osm_w1_reset(index))
+    {
+        search->last_device = true;
+        return false;
+    }
+    osm_w1_send_byte(index, OSM_W1_CMD_SEARCH_ROM);
+    int last_zero = -1;
+    for (int bit = 0; bit < OSM_W1_ROM_LEN * 8; bit++)
+    {
+        uint8_t* byte = &search->rom[bit / 8];
+        uint8_t mask = 1 << (bit % 8);
+        bool id = osm_w1_read_bit(index);
+        bool cmp = osm_w1_read_bit(index);
+        bool dir;
+        if (id && cmp)
+        {
+            /* None left on the bus. */
+            search->last_device = true;
+            return false;
+        }
+        if (id != cmp)
+            dir = id;
+        else
+        {
+            if (bit < search->last_discrepancy)
+                dir = *byte & mask;
+            else
+                dir = (bit == search->last_discrepancy);
+            if (!dir)
+                last_zero = bit;
+        }
+        if (dir)
+            *byte |= mask;
+        else
+            *byte &= ~mask;
+        osm_w1_send_bit(index, dir);
+    }
+    search->last_discrepancy = last_zero;
+    if (last_zero < 0)
+        search->last_device = true;
+    if (!osm_w1_crc_check(search->rom, OSM_W1_ROM_LEN - 1))
+    {
+        search->last_device = true;
+        return false;
+    }
+    return true;
+}
+
+
+/* After a reset, addresses the device of the ROM, or all with no ROM. */
+void osm_w1_select(uint8_t index, const uint8_t* rom)
+{
+    if (!rom)
+    {
+        osm_w1_send_byte(index, OSM_W1_CMD_SKIP_ROM);
+        return;
+    }
+    osm_w1_send_byte(index, OSM_W1_CMD_MATCH_ROM);
+    for (unsigned i = 0; i < OSM_W1_ROM_LEN; i++)
+        osm_w1_send_byte(index, rom[i]);
+}
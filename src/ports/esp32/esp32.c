@@ -7,6 +7,7 @@
 #include <driver/gpio.h>
 #include <soc/clk_tree_defs.h>
 #include <esp_task_wdt.h>
+#include <esp_timer.h>
 #include <esp_wifi.h>
 
 #include <osm/core/platform.h>
@@ -171,6 +172,11 @@ void osm_platform_adc_start_conversion_regular(void)
 }
 
 
+void osm_platform_adc_stop_conversion_regular(void)
+{
+}
+
+
 void osm_platform_adc_power_off(void)
 {
 }
@@ -195,6 +201,12 @@ uint32_t osm_get_since_boot_ms(void)
 }
 
 
+uint64_t osm_get_since_boot_us(void)
+{
+    return esp_timer_get_time();
+}
+
+
 void osm_platform_gpio_init(const osm_port_n_pins_t * gpio_pin)
 {
 }
@@ -69,6 +69,32 @@ bool osm_i2c_transfer_timeout(uint32_t i2c, uint8_t addr, const uint8_t *w, unsi
 }
 
 
+/* No queue here, the transaction is run as it is submitted. */
+bool osm_i2c_submit(osm_i2c_xfer_t* xfer)
+{
+    if (osm_i2c_xfer_pending(xfer))
+        return false;
+    xfer->status = OSM_I2C_XFER_ACTIVE;
+    xfer->wi = 0;
+    xfer->ri = 0;
+    bool ok = osm_i2c_transfer_timeout(xfer->i2c, xfer->addr, xfer->w, xfer->wn, xfer->r, xfer->rn, xfer->timeout_ms);
+    if (ok)
+    {
+        xfer->wi = xfer->wn;
+        xfer->ri = xfer->rn;
+    }
+    xfer->status = ok ? OSM_I2C_XFER_DONE : OSM_I2C_XFER_FAILED;
+    if (xfer->cb)
+        xfer->cb(xfer);
+    return true;
+}
+
+
+void osm_i2cs_iterate(void)
+{
+}
+
+
 static void i2c_deinit(unsigned i2c_index)
 {
     if (i2c_index > OSM_ARRAY_SIZE(i2c_buses))
@@ -7,8 +7,10 @@
 #include <sys/socket.h>
 
 #include <osm/core/i2c.h>
+#include <osm/core/i2c_queue.h>
 
 #include <osm/core/log.h>
+#include <osm/core/common.h>
 #include "linux.h"
 
 
@@ -19,6 +21,7 @@
 
 static bool _i2c_connected = false;
 static int  _i2c_socketfd = -1;
+static osm_i2c_queue_t _i2c_queue = {0};
 
 
 void osm_i2cs_init(void)
@@ -45,7 +48,7 @@ void osm_i2c_linux_deinit(void)
 }
 
 
-bool osm_i2c_transfer_timeout(uint32_t i2c, uint8_t addr, const uint8_t *w, unsigned wn, uint8_t *r, unsigned rn, unsigned timeout_ms)
+static bool _i2c_transfer(uint8_t addr, const uint8_t *w, unsigned wn, uint8_t *r, unsigned rn)
 {
     if ((!w && wn) || (!r && rn))
     {
@@ -154,3 +157,52 @@ recv_bad_exit:
     osm_log_error("Received message doesn't match sent. (%s)", buf);
     return false;
 }
+
+
+bool osm_i2c_submit(osm_i2c_xfer_t* xfer)
+{
+    /* Already queued, a second push would run it twice. */
+    if (osm_i2c_xfer_pending(xfer))
+        return false;
+    if (!osm_i2c_queue_push(&_i2c_queue, xfer))
+    {
+        osm_log_error("I2C queue full");
+        return false;
+    }
+    return true;
+}
+
+
+/* The fake bus has one queue for all, run through in order here. */
+void osm_i2cs_iterate(void)
+{
+    osm_i2c_xfer_t* xfer = osm_i2c_queue_front(&_i2c_queue);
+    while (xfer)
+    {
+        osm_i2c_queue_start(xfer, osm_get_since_boot_ms());
+        bool ok = _i2c_transfer(xfer->addr, xfer->w, xfer->wn, xfer->r, xfer->rn);
+        if (ok)
+        {
+            xfer->wi = xfer->wn;
+            xfer->ri = xfer->rn;
+        }
+        xfer = osm_i2c_queue_finish(&_i2c_queue, ok);
+    }
+}
+
+
+bool osm_i2c_transfer_timeout(uint32_t i2c, uint8_t addr, const uint8_t *w, unsigned wn, uint8_t *r, unsigned rn, unsigned timeout_ms)
+{
+    osm_i2c_xfer_t xfer = {.i2c = i2c,
+                           .addr = addr,
+                           .w = w,
+                           .wn = wn,
+                           .r = r,
+                           .rn = rn,
+                           .timeout_ms = timeout_ms};
+    if (!osm_i2c_submit(&xfer))
+        return false;
+    while (osm_i2c_xfer_pending(&xfer))
+        osm_i2cs_iterate();
+    return xfer.status == OSM_I2C_XFER_DONE;
+}
@@ -1,6 +1,7 @@
 #include <stdbool.h>
 #include <inttypes.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <stddef.h>
 #include <string.h>
 
@@ -9,11 +10,13 @@
 #include <osm/core/config.h>
 #include <osm/core/platform.h>
 #include <osm/core/log.h>
+#include "linux.h"
 
+#define IO_WATCH_LINE_LEN                   16
 
-const unsigned              ios_watch_ios[IOS_WATCH_COUNT]                  = IOS_WATCH_IOS;
-static osm_measurements_def_t*  _ios_watch_measurements_def[IOS_WATCH_COUNT];
-static osm_measurements_data_t* _ios_watch_measurements_data[IOS_WATCH_COUNT];
+
+static char                     _io_watch_line[IO_WATCH_LINE_LEN];
+static unsigned                 _io_watch_line_len;
 
 
 bool osm_io_watch_enable(unsigned io, bool enabled, osm_io_pupd_t pupd)
@@ -30,36 +33,45 @@ bool osm_io_watch_enable(unsigned io, bool enabled, osm_io_pupd_t pupd)
 
 void osm_io_watch_isr(uint32_t exti_group)
 {
-    for (unsigned i = 0; i < IOS_WATCH_COUNT; i++)
-    {
-
-        osm_measurements_def_t* def = _ios_watch_measurements_def[i];
-        osm_measurements_data_t* data = _ios_watch_measurements_data[i];
-        if (!def || !data)
-            return;
+    /* Edges come from the IO_WATCH pty, see osm_linux_io_watch_proc. */
+}
 
-        if (!def->interval || !def->samplecount)
-            return;
 
-        data->instant_send = 1;
-    }
+static void _io_watch_edge(unsigned io, bool level)
+{
+    if (io >= IOS_COUNT || !osm_io_is_watch_now(io))
+        return;
+    if (osm_platform_gpio_get(&ios_pins[io]) != level)
+        osm_platform_gpio_set(&ios_pins[io], level);
+    osm_io_watch_push(io, level);
 }
 
 
-void osm_io_watch_init(void)
+/* Lines of "<io> <level>" written to the IO_WATCH pty stand in for the
+ * edge interrupt. */
+void osm_linux_io_watch_proc(unsigned uart, char* in, unsigned len)
 {
-    /* Must be called after osm_measurements_init */
-    char name[OSM_MEASURE_NAME_NULLED_LEN] = OSM_IOS_MEASUREMENT_NAME_PRE;
-    unsigned len = strnlen(name, OSM_MEASURE_NAME_LEN);
-    char* p = name + len;
-    for (unsigned i = 0; i < IOS_WATCH_COUNT; i++)
+    for (unsigned n = 0; n < len; n++)
     {
-        snprintf(p, OSM_MEASURE_NAME_NULLED_LEN - len, "%02u", ios_watch_ios[i]);
-        if (!osm_measurements_get_measurements_def(name, &_ios_watch_measurements_def[i], &_ios_watch_measurements_data[i]))
+        char c = in[n];
+        if (c != '\n' && c != '\r')
+        {
+            if (_io_watch_line_len < IO_WATCH_LINE_LEN - 1)
+                _io_watch_line[_io_watch_line_len++] = c;
+            continue;
+        }
+        _io_watch_line[_io_watch_line_len] = 0;
+        unsigned line_len = _io_watch_line_len;
+        _io_watch_line_len = 0;
+        if (!line_len)
+            continue;
+        char* pos = NULL;
+        unsigned io = strtoul(_io_watch_line, &pos, 10);
+        if (pos == _io_watch_line)
         {
-            _ios_watch_measurements_def[i] = NULL;
-            _ios_watch_measurements_data[i] = NULL;
-            osm_io_debug("Could not find measurements data for '%s'", name);
+            osm_io_debug("Bad IO watch line '%s'", _io_watch_line);
+            continue;
         }
+        _io_watch_edge(io, strtoul(pos, NULL, 10));
     }
 }
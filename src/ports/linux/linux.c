@@ -36,6 +36,7 @@
 #include "pinmap.h"
 #include <osm/core/cmd.h>
 #include <osm/core/i2c.h>
+#include <osm/core/backlog.h>
 
 #define LINUX_PTY_BUF_SIZ       64
 #define LINUX_LINE_BUF_SIZ      1024
@@ -50,6 +51,8 @@
 #define LINUX_NEW_FW_LOC_BUF_SIZ                128
 #define LINUX_REBOOT_FILE_TIMEOUT_S 60
 
+#define LINUX_BACKLOG_FLASH_PAGES   4
+
 #define LINUX_FD_SAVE_FMT_PTY                                           "%d %"STR(OSM_LINUX_PTY_NAME_STR_SIZE)"s %"PRIi32" %"PRIi32" %u\n"
 #define LINUX_FD_SAVE_FMT_SOCKET_SERVER                                 "%d %"STR(OSM_LINUX_PTY_NAME_STR_SIZE)"s %"PRIi32"\n"
 #define LINUX_FD_SAVE_FMT_SOCKET_CLIENT                                 "%d %"STR(OSM_LINUX_PTY_NAME_STR_SIZE)"s %"PRIi32" %"STR(OSM_LINUX_PTY_NAME_STR_SIZE)"s\n"
@@ -138,6 +141,7 @@ static struct pollfd    pfds[LINUX_MAX_NFDS];
 static uint32_t         nfds;
 static pthread_t        _linux_listener_thread_id;
 static persist_mem_t    _linux_persist_mem          = {0};
+static uint8_t          _linux_backlog_flash[LINUX_BACKLOG_FLASH_PAGES][OSM_BACKLOG_FLASH_PAGE_SIZE];
 static volatile bool    _linux_running              = true;
 static bool             _linux_in_debug             = false;
 volatile bool           linux_threads_deinit        = false;
@@ -176,6 +180,11 @@ static fd_t fd_list[LINUX_MAX_NFDS] = {
         .name = {"UART_EXAMPLE_RS232"},
         .pty  = {.uart = RS232_UART},
         .cb   = osm_linux_uart_proc,
+    },
+    {
+        .type = LINUX_FD_TYPE_PTY,
+        .name = {"IO_WATCH"},
+        .cb   = osm_linux_io_watch_proc,
     }
 };
 
@@ -643,6 +652,8 @@ static void _linux_insert_fd(fd_t new_fd)
         {
             continue;
         }
+        /* The saved file only has the descriptors, not what reads them. */
+        new_fd.cb = fd->cb;
         memcpy(fd, &new_fd, sizeof(fd_t));
         osm_linux_port_debug("Loaded FD %u \"%s\" T:%d", i, fd->name, fd->type);
         found = true;
@@ -1691,6 +1702,36 @@ void osm_platform_finish_fw(void)
 }
 
 
+unsigned osm_platform_backlog_flash_pages(void)
+{
+    return LINUX_BACKLOG_FLASH_PAGES;
+}
+
+
+const uint8_t* osm_platform_backlog_flash_page(unsigned page)
+{
+    return _linux_backlog_flash[page];
+}
+
+
+bool osm_platform_backlog_flash_erase(unsigned page)
+{
+    memset(_linux_backlog_flash[page], 0xFF, OSM_BACKLOG_FLASH_PAGE_SIZE);
+    return true;
+}
+
+
+bool osm_platform_backlog_flash_write(unsigned page, unsigned offset, const void * data, unsigned size)
+{
+    /* Like flash, programming only clears bits. */
+    const uint8_t* src = (const uint8_t*)data;
+    uint8_t* dst = _linux_backlog_flash[page] + offset;
+    for (unsigned n = 0; n < size; n++)
+        dst[n] &= src[n];
+    return memcmp(dst, src, size) == 0;
+}
+
+
 void osm_platform_clear_flash_flags(void)
 {
     ;
@@ -1771,6 +1812,7 @@ void osm_platform_main_loop_iterate(void)
         _sock_line_used_len = 0;
     }
 
+    osm_i2cs_iterate();
     osm_model_main_loop_iterate();
 }
 
@@ -1782,6 +1824,12 @@ uint32_t osm_get_since_boot_ms(void)
 }
 
 
+uint64_t osm_get_since_boot_us(void)
+{
+    return osm_linux_get_current_us() - _linux_boot_time_us;
+}
+
+
 void osm_linux_usleep(unsigned usecs)
 {
     if (!_linux_running)
@@ -9,6 +9,7 @@ LINUX_STRIP ?= strip
 
 #Compiler options
 LINUX_DEFINES := -D_GNU_SOURCE
+LINUX_DEFINES += -DOSM_MODBUS_CRC_IMPL=OSM_MODBUS_CRC_SLICE4
 
 LINUX_CFLAGS		+= -O0 -g -std=gnu11 -pedantic $(LINUX_DEFINES) -Wno-variadic-macros
 LINUX_CFLAGS		+= -Wall -Wextra -Werror -Wno-unused-parameter -Wno-address-of-packed-member
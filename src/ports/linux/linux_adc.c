@@ -10,6 +10,7 @@
 #include "pinmap.h"
 #include <osm/core/log.h>
 #include <osm/core/adcs.h>
+#include <osm/core/adcs_harmonics.h>
 #include "linux.h"
 #include "persist_config_header_model.h"
 
@@ -40,6 +41,9 @@
 #define ADCS_FTMA_16MA_AMPLITUDE                2975.437f
 #define ADCS_FTMA_20MA_AMPLITUDE                3719.296f
 
+#define ADCS_SAMPLE_US                          600     /* 900ms for OSM_ADCS_NUM_SAMPLES, as before */
+#define ADCS_WAVE_AC_HARMONICS                  (OSM_ADCS_HARMONICS_MAX - 1)
+
 
 typedef enum
 {
@@ -59,6 +63,7 @@ typedef struct
             float amplitude_offset;
             float phase;
             float frequency;
+            float harmonics[ADCS_WAVE_AC_HARMONICS];    /* 2nd and up, fractions of the fundamental */
         } ac;
         struct
         {
@@ -69,8 +74,10 @@ typedef struct
 } adcs_wave_t;
 
 
-static uint16_t*    _adcs_buf                           = NULL;         /* sizeof OSM_ADCS_NUM_SAMPLES */
+static uint16_t*    _adcs_buf                           = NULL;         /* sizeof OSM_ADCS_DMA_SAMPLES */
 static unsigned     _adcs_num_data                      = 0;
+static unsigned     _adcs_sample_pos                    = 0;
+static volatile bool _adcs_running                      = false;
 static uint8_t      _adcs_num_active_channels           = 0;
 static osm_adcs_type_t  _adcs_active_channels[ADC_COUNT]    = {0};
 static adcs_wave_t  _adcs_waves[ADC_COUNT]              = { {.type=ADCS_WAVE_TYPE_DC, .dc={.amplitude=OSM_ADC_MAX_VAL,                    .random_amplitude=ADCS_WAVE_DC_DEFAULT_RANDOM_AMPLITUDE } } ,     /* OSM_BAT_MON         */
@@ -91,18 +98,20 @@ static uint16_t _adcs_calculate_dc_wave(adcs_wave_t* wave)
 
 static uint16_t _adcs_calculate_ac_wave(adcs_wave_t* wave, float x)
 {
-    float k = wave->ac.frequency * 2 * M_PI;
-    return (wave->ac.amplitude * sin(k * x + wave->ac.phase) + wave->ac.amplitude_offset);
+    float w = wave->ac.frequency * 2 * M_PI * x + wave->ac.phase;
+    float v = sin(w);
+    for (unsigned i = 0; i < ADCS_WAVE_AC_HARMONICS; i++)
+        v += wave->ac.harmonics[i] * sin((i + 2) * w);
+    return (wave->ac.amplitude * v + wave->ac.amplitude_offset);
 }
 
 
-static void _adcs_fill_buffer(void)
+/* Time runs on from the last fill, so the waves are continuous across DMA
+ * halves, and each sample is a conversion time after the last, as the
+ * channels of a sequence are on the real ADC. */
+static void _adcs_fill_buffer(unsigned offset, unsigned len)
 {
-    osm_adc_debug("Active:");
-    for (uint8_t i = 0; i < _adcs_num_active_channels; i++)
-        osm_adc_debug("- %"PRIu8, _adcs_active_channels[i]);
-
-    for (unsigned i = 0; i < _adcs_num_data; i++)
+    for (unsigned i = offset; i < offset + len; i++, _adcs_sample_pos++)
     {
         osm_adcs_type_t* chan = (osm_adcs_type_t*)&_adcs_active_channels[i % _adcs_num_active_channels];
         adcs_wave_t* wave;
@@ -139,7 +148,7 @@ static void _adcs_fill_buffer(void)
         switch(wave->type)
         {
             case ADCS_WAVE_TYPE_AC:
-                _adcs_buf[i] = _adcs_calculate_ac_wave(wave, ((float)i) / _adcs_num_data);
+                _adcs_buf[i] = _adcs_calculate_ac_wave(wave, (float)_adcs_sample_pos * OSM_ADCS_SAMPLE_PERIOD_NS / 1e9f);
                 break;
             case ADCS_WAVE_TYPE_DC:
                 _adcs_buf[i] = _adcs_calculate_dc_wave(wave);
@@ -181,7 +190,7 @@ static bool _adcs_load_from_file(void)
     }
     for (unsigned i = 0; i < ADC_CC_COUNT; i++)
     {
-        adcs_wave_t* wave = &_adcs_waves[i];
+        adcs_wave_t* wave = &_adcs_waves[ADC_INDEX_CURRENT_CLAMP_1 + i];
         if (!wave)
             continue;
         char name[5];
@@ -206,6 +215,7 @@ static bool _adcs_load_from_file(void)
                 wave->ac.amplitude_offset = ADCS_WAVE_AC_DEFAULT_AMPLITUDE_OFFSET;
                 wave->ac.frequency        = ADCS_WAVE_AC_DEFAULT_FREQUENCY;
                 wave->ac.phase            = ADCS_WAVE_AC_DEFAULT_PHASE;
+                memset(wave->ac.harmonics, 0, sizeof(wave->ac.harmonics));
             }
 
             if (_adcs_float_from_json(cc, "amplitude", &v))
@@ -219,6 +229,14 @@ static bool _adcs_load_from_file(void)
 
             if (_adcs_float_from_json(cc, "phase", &v))
                 wave->ac.phase = v;
+
+            struct json_object * harmonics = json_object_object_get(cc, "harmonics");
+            if (harmonics && json_object_is_type(harmonics, json_type_array))
+            {
+                unsigned num_harmonics = json_object_array_length(harmonics);
+                for (unsigned j = 0; j < ADCS_WAVE_AC_HARMONICS; j++)
+                    wave->ac.harmonics[j] = (j < num_harmonics) ? json_object_get_double(json_object_array_get_idx(harmonics, j)) : 0;
+            }
         }
         else if (strncmp(type_str, ADCS_WAVE_TYPE_DC_STRING, 2) == 0)
         {
@@ -254,9 +272,31 @@ void osm_linux_adc_generate(void)
 {
     if (_adcs_load_from_file())
         _adcs_remove_file();
-    _adcs_fill_buffer();
-    osm_linux_usleep(900000); // FIXME: Set this to something closer to real use.
+
+    osm_adc_debug("Active:");
+    for (uint8_t i = 0; i < _adcs_num_active_channels; i++)
+        osm_adc_debug("- %"PRIu8, _adcs_active_channels[i]);
+
+    _adcs_sample_pos = 0;
+#ifdef __ADC_CONTINUOUS__
+    /* Circular DMA, half at a time until the ADC code stops it. */
+    unsigned half = _adcs_num_data / 2;
+    while (_adcs_running)
+    {
+        _adcs_fill_buffer(0, half);
+        osm_linux_usleep(half * ADCS_SAMPLE_US);
+        osm_adcs_dma_half_complete();
+        if (!_adcs_running)
+            break;
+        _adcs_fill_buffer(half, half);
+        osm_linux_usleep(half * ADCS_SAMPLE_US);
+        osm_adcs_dma_complete();
+    }
+#else
+    _adcs_fill_buffer(0, _adcs_num_data);
+    osm_linux_usleep(_adcs_num_data * ADCS_SAMPLE_US);
     osm_adcs_dma_complete();
+#endif //__ADC_CONTINUOUS__
 }
 
 
@@ -275,10 +315,17 @@ void osm_platform_adc_set_regular_sequence(uint8_t num_channels, osm_adcs_type_t
 
 void osm_platform_adc_start_conversion_regular(void)
 {
+    _adcs_running = true;
     osm_linux_kick_adc_gen();
 }
 
 
+void osm_platform_adc_stop_conversion_regular(void)
+{
+    _adcs_running = false;
+}
+
+
 void osm_platform_adc_power_off(void)
 {
 }
@@ -0,0 +1,50 @@
+#!/usr/bin/env python3
+
+import os
+import sys
+import time
+import basetypes
+
+
+class io_edges_dev_t(basetypes.pty_dev_t):
+    def _read_pending(self):
+        self._read()
+
+    def toggle(self, ios, rate_hz, count):
+        level = 1
+        period = 1. / rate_hz
+        for n in range(count):
+            for io in ios:
+                self._write(f"{io} {level}\n".encode())
+            level = 1 - level
+            time.sleep(period)
+
+
+def main(args):
+    import argparse
+    osm_loc = os.getenv("OSM_LOC", "/tmp/osm/")
+    DEFAULT_VIRTUAL_IO_WATCH_PATH = os.path.join(osm_loc, "IO_WATCH_slave")
+    if not os.path.exists(osm_loc):
+        os.mkdir(osm_loc)
+
+    def get_args():
+        parser = argparse.ArgumentParser(description='Virtual edges on watched IOs.' )
+        parser.add_argument('ios', metavar='IO', type=int, nargs='+', help='The watched IOs to toggle')
+        parser.add_argument('-r', '--rate', type=float, help='Edges a second on each IO', default=10.)
+        parser.add_argument('-n', '--count', type=int, help='Edges on each IO', default=100)
+        parser.add_argument('-p', '--pseudoterminal', metavar='PTY', type=str, help='The pseudoterminal for the edges', default=DEFAULT_VIRTUAL_IO_WATCH_PATH)
+        return parser.parse_args(args)
+
+    args = get_args()
+
+    io_edges_dev = io_edges_dev_t(args.pseudoterminal)
+    try:
+        io_edges_dev.toggle(args.ios, args.rate, args.count)
+    except KeyboardInterrupt:
+        print("io_edges_dev_t : Caught keyboard interrupt.")
+        return -1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))
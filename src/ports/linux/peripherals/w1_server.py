@@ -2,6 +2,8 @@
 
 import sys
 import os
+import functools
+import operator
 import socket_server_base as socket_server
 
 
@@ -11,17 +13,43 @@ communication to be faked.
 """
 
 DS18B20_DEFAULT_TEMPERATURE     = 25.0625
+DS18B20_FAMILY_CODE             = 0x28
+
+W1_CMD_SEARCH_ROM               = 0xF0
+W1_CMD_MATCH_ROM                = 0x55
+W1_CMD_SKIP_ROM                 = 0xCC
+W1_ROM_LEN                      = 8
+
+
+def w1_crc(mem):
+    assert isinstance(mem, list),   "Memory should be a binary array."
+    size = len(mem)
+
+    crc = 0
+    for i in range(0, size):
+         byte = mem[i]
+         for j in range (0, 8):
+            blend = (crc ^ byte) & 0x01
+            crc >>= 1
+            if blend:
+                crc ^= 0x8C
+            byte >>= 1
+    return crc
 
 
 
 class ds18b20_t(object):
-    def __init__(self, temperature=DS18B20_DEFAULT_TEMPERATURE, logger=None):
+    def __init__(self, temperature=DS18B20_DEFAULT_TEMPERATURE, serial=1, logger=None):
         self._temperature = temperature
         self._qd_temperature = None
-        self.COMMANDS = { 0xCC : self._command_skip_rom ,
-                          0x44 : self._command_conv_t   ,
+        rom = [DS18B20_FAMILY_CODE] + [(serial >> (8 * i)) & 0xFF for i in range(6)]
+        self.rom = rom + [w1_crc(rom)]
+        self.COMMANDS = { 0x44 : self._command_conv_t   ,
                           0xBE : self._command_read_scp }
 
+    def rom_bit(self, bit):
+        return (self.rom[bit // 8] >> (bit % 8)) & 1
+
     @property
     def temperature(self):
         return self._temperature
@@ -30,9 +58,6 @@ class ds18b20_t(object):
     def temperature(self, new_temperature):
         self._temperature = new_temperature
 
-    def _command_skip_rom(self):
-        return None
-
     def _command_conv_t(self):
         self._qd_temperature = self._temperature
         return None
@@ -53,23 +78,19 @@ class ds18b20_t(object):
         bytes_[5] = 0xFF                # Reserved (FFh)
         bytes_[6] = 0                   # Reserved
         bytes_[7] = 0x10                # Reserved (10h)
-        bytes_[8] = self._crc(bytes_[:8])
+        bytes_[8] = w1_crc(bytes_[:8])
         return bytes_
 
-    def _crc(self, mem):
-        assert isinstance(mem, list),   "Memory should be a binary array."
-        size = len(mem)
 
-        crc = 0
-        for i in range(0, size):
-             byte = mem[i]
-             for j in range (0, 8):
-                blend = (crc ^ byte) & 0x01
-                crc >>= 1
-                if blend:
-                    crc ^= 0x8C
-                byte >>= 1
-        return crc
+class w1_bus_state_t(object):
+    """
+    Each connection is from a reset, so starts with a ROM command.
+    """
+    def __init__(self, devs):
+        self.devs       = list(devs)
+        self.selected   = None
+        self.match      = None
+        self.search_bit = None
 
 
 class w1_server_t(socket_server.socket_server_t):
@@ -78,25 +99,71 @@ class w1_server_t(socket_server.socket_server_t):
 
         self.info(f"W1 SERVER INITIALISED")
         self._devs = devs
-
-    def _process(self, client, raw_data):
-        data_list = list(raw_data)
-        for data in data_list:
-            self.debug(f"W1 << OSM [{'%02x'% data}]")
-
-            found = False
-            for dev in self._devs:
-                command = dev.COMMANDS.get(data, None)
-                if command is not None:
-                    found = True
-                    break
-            if not found:
+        self._states = {}
+
+    def _close_client(self, client):
+        self._states.pop(client.fileno(), None)
+        super()._close_client(client)
+
+    def _respond(self, client, resp):
+        self.debug(f"W1 >> OSM [{', '.join(['%02x'%r for r in resp])}]")
+        self._send_to_client(client, bytes(resp))
+
+    def _search_bits(self, client, state):
+        # Wired-AND of the bit, then of its complement, of those left.
+        bit = state.search_bit
+        id_  = int(all(dev.rom_bit(bit)     for dev in state.devs))
+        cmp_ = int(all(not dev.rom_bit(bit) for dev in state.devs))
+        self._respond(client, [id_, cmp_])
+
+    def _rom_command(self, client, state, data):
+        if data == W1_CMD_SKIP_ROM:
+            state.selected = list(self._devs)
+        elif data == W1_CMD_MATCH_ROM:
+            state.match = []
+        elif data == W1_CMD_SEARCH_ROM:
+            state.search_bit = 0
+            self._search_bits(client, state)
+        else:
+            self.debug(f"Unknown ROM command, skipping.")
+
+    def _process_byte(self, client, state, data):
+        if state.match is not None:
+            state.match.append(data)
+            if len(state.match) == W1_ROM_LEN:
+                state.selected = [dev for dev in self._devs if dev.rom == state.match]
+                state.match = None
+            return
+        if state.search_bit is not None:
+            bit = state.search_bit
+            state.devs = [dev for dev in state.devs if dev.rom_bit(bit) == (data & 1)]
+            state.search_bit += 1
+            if state.search_bit < W1_ROM_LEN * 8:
+                self._search_bits(client, state)
+            else:
+                state.search_bit = None
+            return
+        if state.selected is None:
+            self._rom_command(client, state, data)
+            return
+        resps = []
+        for dev in state.selected:
+            command = dev.COMMANDS.get(data, None)
+            if command is None:
                 self.debug(f"Unknown command, skipping.")
                 return
             resp = command()
             if resp is not None:
-                self.debug(f"W1 >> OSM [{', '.join(['%02x'%r for r in resp])}]")
-                self._send_to_client(client, bytes(resp))
+                resps.append(resp)
+        if resps:
+            # More than one answering pull the bus low together.
+            self._respond(client, [functools.reduce(operator.and_, b) for b in zip(*resps)])
+
+    def _process(self, client, raw_data):
+        state = self._states.setdefault(client.fileno(), w1_bus_state_t(self._devs))
+        for data in list(raw_data):
+            self.debug(f"W1 << OSM [{'%02x'% data}]")
+            self._process_byte(client, state, data)
 
 
 def main():
@@ -105,12 +172,12 @@ def main():
     def get_args():
         parser = argparse.ArgumentParser(description='Fake W1 server.' )
         parser.add_argument("-t", "--temperature", help='The temperature it is set to.', type=float, default=DS18B20_DEFAULT_TEMPERATURE)
+        parser.add_argument("-n", "--probes", help='Probes on the bus, each a degree warmer than the last.', type=int, default=1)
         return parser.parse_args()
 
     args = get_args()
 
-    ds18b20 = ds18b20_t(args.temperature)
-    devs    = [ds18b20]
+    devs    = [ds18b20_t(args.temperature + i, serial=i + 1) for i in range(args.probes)]
     osm_loc = os.getenv("OSM_LOC", "/tmp/osm/")
     if not os.path.exists(osm_loc):
         os.mkdir(osm_loc)
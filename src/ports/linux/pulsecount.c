@@ -1,9 +1,136 @@
 #include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
+#include <json-c/json.h>
+#include <json-c/json_util.h>
+
+#include <osm/core/log.h>
+#include <osm/core/common.h>
+#include <osm/core/io.h>
+#include <osm/core/pulse_timing.h>
 #include <osm/sensors/pulsecount.h>
+#include "linux.h"
 
 
 #define PULSECOUNT_COLLECTION_TIME_MS       1000;
+#define PULSECOUNT_CONFIG_FILE              "pulsecount_config.json"
+#define PULSECOUNT_MAX_CATCH_UP_US          60000000ULL /* Longer behind than this is skipped, not made */
+
+#define PULSECOUNT_TIMING_RATE              0
+#define PULSECOUNT_TIMING_MIN               1
+#define PULSECOUNT_TIMING_MAX               2
+#define PULSECOUNT_TIMING_JITTER            3
+#define PULSECOUNT_TIMING_COUNT             4
+#define PULSECOUNT_TIMING_SHARE_MS          10000   /* Timings of one round of readings share a take */
+
+
+/* A pulse train in place of the input, each edge off its nominal time by
+ * up to the jitter either way. */
+typedef struct
+{
+    float       hz;
+    float       jitter_ms;
+    uint64_t    start_us;
+    uint64_t    next;               /* Of the edges since the start */
+} pulsecount_train_t;
+
+
+typedef struct
+{
+    osm_special_io_info_t       info;
+    const char*                 timing_names[PULSECOUNT_TIMING_COUNT];
+    pulsecount_train_t          train;
+    uint32_t                    count;
+    uint32_t                    send_count;
+    osm_pulse_timing_t          timing;
+    osm_pulse_timing_result_t   timing_result;
+    uint32_t                    timing_time;
+    uint8_t                     timing_taken;
+    bool                        timing_valid;
+} pulsecount_instance_t;
+
+
+static pulsecount_instance_t _pulsecount_instances[] =
+{
+    { .info         = { OSM_MEASUREMENTS_PULSE_COUNT_NAME_1, W1_PULSE_1_IO },
+      .timing_names = { OSM_MEASUREMENTS_PULSE_RATE_NAME_1, OSM_MEASUREMENTS_PULSE_MIN_NAME_1, OSM_MEASUREMENTS_PULSE_MAX_NAME_1, OSM_MEASUREMENTS_PULSE_JITTER_NAME_1 } },
+    { .info         = { OSM_MEASUREMENTS_PULSE_COUNT_NAME_2, W1_PULSE_2_IO },
+      .timing_names = { OSM_MEASUREMENTS_PULSE_RATE_NAME_2, OSM_MEASUREMENTS_PULSE_MIN_NAME_2, OSM_MEASUREMENTS_PULSE_MAX_NAME_2, OSM_MEASUREMENTS_PULSE_JITTER_NAME_2 } },
+};
+
+
+/* {"CNT1": {"hz": 20, "jitter_ms": 2}} */
+static bool _pulsecount_load_from_file(void)
+{
+    char osm_pulsecount_loc[OSM_LOCATION_LEN];
+    osm_concat_osm_location(osm_pulsecount_loc, OSM_LOCATION_LEN, PULSECOUNT_CONFIG_FILE);
+    FILE* pulsecount_config_file = fopen(osm_pulsecount_loc, "r");
+    if (!pulsecount_config_file)
+        return false;
+    struct json_object * root = json_object_from_fd(fileno(pulsecount_config_file));
+    fclose(pulsecount_config_file);
+    if (!root)
+        return false;
+    for (unsigned i = 0; i < OSM_ARRAY_SIZE(_pulsecount_instances); i++)
+    {
+        pulsecount_instance_t* inst = &_pulsecount_instances[i];
+        char name[OSM_MEASURE_NAME_NULLED_LEN] = {0};
+        memcpy(name, inst->info.name, OSM_MEASURE_NAME_LEN);
+        struct json_object * train = json_object_object_get(root, name);
+        if (!train)
+            continue;
+        struct json_object * val = json_object_object_get(train, "hz");
+        inst->train.hz = val ? json_object_get_double(val) : 0;
+        val = json_object_object_get(train, "jitter_ms");
+        inst->train.jitter_ms = val ? json_object_get_double(val) : 0;
+        inst->train.start_us = osm_get_since_boot_us();
+        inst->train.next = 1;
+        osm_pulsecount_debug("%.4s train of %.3fHz, %.3fms jitter.", inst->info.name, inst->train.hz, inst->train.jitter_ms);
+    }
+    json_object_put(root);
+    return true;
+}
+
+
+static void _pulsecount_remove_file(void)
+{
+    char osm_pulsecount_loc[OSM_LOCATION_LEN];
+    osm_concat_osm_location(osm_pulsecount_loc, OSM_LOCATION_LEN, PULSECOUNT_CONFIG_FILE);
+    remove(osm_pulsecount_loc);
+}
+
+
+static void _pulsecount_load(void)
+{
+    if (_pulsecount_load_from_file())
+        _pulsecount_remove_file();
+}
+
+
+/* The edges the train has had since last time, as the interrupt would
+ * have counted and stamped them. */
+static void _pulsecount_generate(pulsecount_instance_t* inst, uint64_t now_us)
+{
+    pulsecount_train_t* train = &inst->train;
+    if (train->hz <= 0)
+        return;
+    double period_us = 1e6 / train->hz;
+    double jitter_us = train->jitter_ms * 1000.;
+    uint64_t due = (now_us - train->start_us) / period_us;
+    uint64_t max_behind = PULSECOUNT_MAX_CATCH_UP_US / period_us;
+    if (due > train->next + max_behind)
+        train->next = due - max_behind;
+    for (; train->next <= due; train->next++)
+    {
+        double offset = jitter_us * (2. * rand() / RAND_MAX - 1.);
+        uint64_t stamp_us = train->start_us + train->next * period_us + offset;
+        inst->count++;
+        if (osm_pulse_timing_push(&inst->timing, stamp_us) >= OSM_PULSE_TIMING_RING_WAKE)
+            osm_pulse_timing_drain(&inst->timing);
+    }
+}
 
 
 void osm_pulsecount_init(void)
@@ -11,10 +138,42 @@ void osm_pulsecount_init(void)
 }
 
 
+static pulsecount_instance_t* _pulsecount_get_instance_by_io(unsigned io)
+{
+    for (unsigned i = 0; i < OSM_ARRAY_SIZE(_pulsecount_instances); i++)
+    {
+        if (_pulsecount_instances[i].info.io == io)
+            return &_pulsecount_instances[i];
+    }
+    return NULL;
+}
+
+
 void osm_pulsecount_enable(unsigned io, bool enable, osm_io_pupd_t pupd, osm_io_special_t edge)
 {
+    pulsecount_instance_t* inst = _pulsecount_get_instance_by_io(io);
+    if (!inst)
+        return;
+    inst->count = 0;
+    inst->send_count = 0;
+    osm_pulse_timing_init(&inst->timing);
+    inst->timing_valid = false;
     if (enable)
-        osm_pulsecount_init();
+        _pulsecount_load();
+}
+
+
+void osm_pulsecount_iterate(void)
+{
+    uint64_t now_us = osm_get_since_boot_us();
+    for (unsigned i = 0; i < OSM_ARRAY_SIZE(_pulsecount_instances); i++)
+    {
+        pulsecount_instance_t* inst = &_pulsecount_instances[i];
+        if (!osm_io_is_pulsecount_now(inst->info.io))
+            continue;
+        _pulsecount_generate(inst, now_us);
+        osm_pulse_timing_drain(&inst->timing);
+    }
 }
 
 
@@ -34,20 +193,58 @@ static osm_measurements_sensor_state_t _pulsecount_collection_time(char* name, u
 }
 
 
+static bool _pulsecount_get_instance(pulsecount_instance_t** instance, char* name)
+{
+    for (unsigned i = 0; i < OSM_ARRAY_SIZE(_pulsecount_instances); i++)
+    {
+        if (strncmp(name, _pulsecount_instances[i].info.name, OSM_MEASURE_NAME_LEN) == 0)
+        {
+            *instance = &_pulsecount_instances[i];
+            return true;
+        }
+    }
+    osm_pulsecount_debug("Could not find name in instances.");
+    return false;
+}
+
+
 static osm_measurements_sensor_state_t _pulsecount_begin(char* name, bool in_isolation)
 {
+    pulsecount_instance_t* instance;
+    if (!_pulsecount_get_instance(&instance, name))
+        return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+    if (!osm_io_is_pulsecount_now(instance->info.io))
+        return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+    _pulsecount_load();
     return OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS;
 }
 
 
 static osm_measurements_sensor_state_t _pulsecount_get(char* name, osm_measurements_reading_t* value)
 {
-    return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+    pulsecount_instance_t* instance;
+    if (!_pulsecount_get_instance(&instance, name))
+        return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+    if (!osm_io_is_pulsecount_now(instance->info.io))
+    {
+        osm_pulsecount_debug("IO %s not set up.", name);
+        return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+    }
+    osm_pulsecount_iterate();
+    instance->send_count = instance->count;
+    osm_pulsecount_debug("%.4s at end %"PRIu32, instance->info.name, instance->send_count);
+    value->v_i64 = (int64_t)instance->send_count;
+    return OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS;
 }
 
 
 static void _pulsecount_ack(char* name)
 {
+    pulsecount_instance_t* instance;
+    if (!_pulsecount_get_instance(&instance, name))
+        return;
+    instance->count -= instance->send_count;
+    instance->send_count = 0;
 }
 
 
@@ -67,6 +264,102 @@ void     osm_pulsecount_inf_init(osm_measurements_inf_t* inf)
 }
 
 
+static bool _pulsecount_timing_get_instance(pulsecount_instance_t** instance, unsigned* stat, char* name)
+{
+    for (unsigned i = 0; i < OSM_ARRAY_SIZE(_pulsecount_instances); i++)
+    {
+        for (unsigned j = 0; j < PULSECOUNT_TIMING_COUNT; j++)
+        {
+            if (strncmp(name, _pulsecount_instances[i].timing_names[j], OSM_MEASURE_NAME_LEN) == 0)
+            {
+                *instance = &_pulsecount_instances[i];
+                *stat = j;
+                return true;
+            }
+        }
+    }
+    osm_pulsecount_debug("Could not find name in timings.");
+    return false;
+}
+
+
+static osm_measurements_sensor_state_t _pulsecount_timing_begin(char* name, bool in_isolation)
+{
+    pulsecount_instance_t* instance;
+    unsigned stat;
+    if (!_pulsecount_timing_get_instance(&instance, &stat, name))
+        return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+    if (!osm_io_is_pulsecount_now(instance->info.io))
+        return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+    _pulsecount_load();
+    return OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS;
+}
+
+
+static bool _pulsecount_timing_has_take(pulsecount_instance_t* instance, unsigned stat)
+{
+    return instance->timing_valid &&
+           !(instance->timing_taken & (1 << stat)) &&
+           osm_since_boot_delta(osm_get_since_boot_ms(), instance->timing_time) < PULSECOUNT_TIMING_SHARE_MS;
+}
+
+
+static osm_measurements_sensor_state_t _pulsecount_timing_get(char* name, osm_measurements_reading_t* value)
+{
+    pulsecount_instance_t* instance;
+    unsigned stat;
+    if (!_pulsecount_timing_get_instance(&instance, &stat, name))
+        return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+    if (!osm_io_is_pulsecount_now(instance->info.io))
+    {
+        osm_pulsecount_debug("IO %s not set up.", name);
+        return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+    }
+    osm_pulse_timing_result_t* result = &instance->timing_result;
+    if (!_pulsecount_timing_has_take(instance, stat))
+    {
+        osm_pulsecount_iterate();
+        osm_pulse_timing_take(&instance->timing, result);
+        instance->timing_valid = true;
+        instance->timing_taken = 0;
+        instance->timing_time = osm_get_since_boot_ms();
+        osm_pulsecount_debug("%.4s timed %"PRIu32" intervals, %"PRIu32" edges dropped.",
+                             instance->info.name, result->count, result->overflows);
+    }
+    instance->timing_taken |= 1 << stat;
+    float v;
+    switch (stat)
+    {
+        case PULSECOUNT_TIMING_RATE:    v = result->rate_hz;    break;
+        case PULSECOUNT_TIMING_MIN:     v = result->min_ms;     break;
+        case PULSECOUNT_TIMING_MAX:     v = result->max_ms;     break;
+        default:                        v = result->jitter_ms;  break;
+    }
+    if (stat != PULSECOUNT_TIMING_RATE && !result->count)
+    {
+        osm_pulsecount_debug("No intervals for %.4s.", name);
+        return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+    }
+    value->v_f32 = osm_to_f32_from_float(v);
+    return OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS;
+}
+
+
+static osm_measurements_value_type_t _pulsecount_timing_value_type(char* name)
+{
+    return OSM_MEASUREMENTS_VALUE_TYPE_FLOAT;
+}
+
+
+void     osm_pulsecount_timing_inf_init(osm_measurements_inf_t* inf)
+{
+    inf->collection_time_cb = _pulsecount_collection_time;
+    inf->init_cb            = _pulsecount_timing_begin;
+    inf->get_cb             = _pulsecount_timing_get;
+    inf->value_type_cb      = _pulsecount_timing_value_type;
+}
+
+
 struct osm_cmd_link_t* osm_pulsecount_add_commands(struct osm_cmd_link_t* tail)
 {
     return tail;
@@ -1,9 +1,98 @@
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <inttypes.h>
+
+#include <json-c/json.h>
+#include <json-c/json_util.h>
 
 #include <osm/sensors/sai.h>
 
 #include <osm/core/log.h>
 #include <osm/core/common.h>
+#include <osm/core/persist_config.h>
+#include <osm/core/sai_bands.h>
+#include "linux.h"
+
+
+#define SAI_CONFIG_FILE                     "sai_config.json"
+
+#define SAI_DEFAULT_COLLECTION_TIME         1000
+#define SAI_HALF_SAMPLES                    128     /* As the STM's DMA half */
+#define SAI_NO_BUF_SAMPLES                  20      /* Samples to each of sound_no_buf */
+#define SAI_MAX_CATCH_UP_MS                 60000   /* Longer idle than this is skipped, not made */
+
+#define SAI_SND_USER                        OSM_SAI_BANDS_LEVEL_COUNT
+#define SAI_LEVEL_USERS                     ((1 << OSM_SAI_BANDS_LEVEL_COUNT) - 1)
+#define SAI_LEVEL_SHARE_MS                  10000   /* Levels of one round of readings share a take */
+
+/* ICS-43434, -26dBFS for 94dB SPL, full scale the RMS of a full scale sine. */
+#define SAI_FULL_SCALE_RMS                  (8388608. / M_SQRT2)
+#define SAI_FULL_SCALE_DB                   120.
+
+#define SAI_MAX_TONES                       4
+#define SAI_DEFAULT_TONE_HZ                 1000.f
+#define SAI_DEFAULT_TONE_DB                 60.f
+#define SAI_DEFAULT_NOISE_DB                35.f
+
+
+typedef struct
+{
+    float       hz;
+    float       db;
+} sai_tone_t;
+
+
+typedef struct
+{
+    sai_tone_t  tones[SAI_MAX_TONES];
+    unsigned    num_tones;
+    float       noise_db;
+} sai_wave_t;
+
+
+typedef struct
+{
+    uint64_t    sum_squares;
+    uint32_t    count;
+} sai_sample_t;
+
+
+typedef struct
+{
+    float       rms[OSM_SAI_BANDS_LEVEL_COUNT];
+    uint32_t    time;
+    uint16_t    taken;
+    bool        valid;
+} sai_levels_t;
+
+
+static sai_wave_t            _sai_wave                  = {.tones = {{SAI_DEFAULT_TONE_HZ, SAI_DEFAULT_TONE_DB}},
+                                                           .num_tones = 1,
+                                                           .noise_db = SAI_DEFAULT_NOISE_DB};
+static uint64_t              _sai_gen_pos               = 0;    /* Samples made since the stream started */
+static uint32_t              _sai_gen_start_ms          = 0;
+
+static sai_sample_t          _sai_sample                = {0};
+static uint16_t              _sai_stream_users          = 0;    /* A bit for SND and for each level */
+static osm_sai_bands_t       _sai_bands;
+static osm_sai_bands_acc_t   _sai_bands_acc;
+static sai_levels_t          _sai_levels                = {0};
+
+static const char * const    _sai_level_names[OSM_SAI_BANDS_LEVEL_COUNT] =
+{
+    OSM_MEASUREMENTS_SOUND_LAEQ_NAME,
+    OSM_MEASUREMENTS_SOUND_LAMAX_NAME,
+    OSM_MEASUREMENTS_SOUND_LAMIN_NAME,
+    OSM_MEASUREMENTS_SOUND_BAND_31_NAME,
+    OSM_MEASUREMENTS_SOUND_BAND_63_NAME,
+    OSM_MEASUREMENTS_SOUND_BAND_125_NAME,
+    OSM_MEASUREMENTS_SOUND_BAND_250_NAME,
+    OSM_MEASUREMENTS_SOUND_BAND_500_NAME,
+    OSM_MEASUREMENTS_SOUND_BAND_1K_NAME,
+    OSM_MEASUREMENTS_SOUND_BAND_2K_NAME,
+};
 
 
 void osm_sai_init(void)
@@ -21,33 +110,308 @@ void osm_sai_print_coeffs(osm_cmd_ctx_t * ctx)
 {
 }
 
+
+static double _sai_db_to_rms(float db)
+{
+    return SAI_FULL_SCALE_RMS * pow(10., (db - SAI_FULL_SCALE_DB) / 20.);
+}
+
+
+static float _sai_rms_to_db(double rms)
+{
+    if (rms < 1.)
+        rms = 1.;
+    return SAI_FULL_SCALE_DB + 20. * log10(rms / SAI_FULL_SCALE_RMS);
+}
+
+
+/* {"tones": [{"hz": 125, "db": 80}], "noise_db": 30} */
+static bool _sai_load_from_file(void)
+{
+    char osm_sai_loc[OSM_LOCATION_LEN];
+    osm_concat_osm_location(osm_sai_loc, OSM_LOCATION_LEN, SAI_CONFIG_FILE);
+    FILE* sai_config_file = fopen(osm_sai_loc, "r");
+    if (!sai_config_file)
+        return false;
+    struct json_object * root = json_object_from_fd(fileno(sai_config_file));
+    fclose(sai_config_file);
+    if (!root)
+        return false;
+    struct json_object * tones = json_object_object_get(root, "tones");
+    if (tones && json_object_is_type(tones, json_type_array))
+    {
+        unsigned num_tones = json_object_array_length(tones);
+        if (num_tones > SAI_MAX_TONES)
+            num_tones = SAI_MAX_TONES;
+        for (unsigned i = 0; i < num_tones; i++)
+        {
+            struct json_object * tone = json_object_array_get_idx(tones, i);
+            _sai_wave.tones[i].hz = json_object_get_double(json_object_object_get(tone, "hz"));
+            _sai_wave.tones[i].db = json_object_get_double(json_object_object_get(tone, "db"));
+        }
+        _sai_wave.num_tones = num_tones;
+    }
+    struct json_object * noise = json_object_object_get(root, "noise_db");
+    if (noise)
+        _sai_wave.noise_db = json_object_get_double(noise);
+    json_object_put(root);
+    osm_sound_debug("Loaded %u tones, noise %.1f dB.", _sai_wave.num_tones, _sai_wave.noise_db);
+    return true;
+}
+
+
+static void _sai_remove_file(void)
+{
+    char osm_sai_loc[OSM_LOCATION_LEN];
+    osm_concat_osm_location(osm_sai_loc, OSM_LOCATION_LEN, SAI_CONFIG_FILE);
+    remove(osm_sai_loc);
+}
+
+
+static void _sai_stream_add(const int32_t* half)
+{
+    if (_sai_stream_users & (1 << SAI_SND_USER))
+    {
+        uint64_t sum = 0;
+        for (unsigned i = 0; i < SAI_HALF_SAMPLES; i++)
+        {
+            int32_t val = (int32_t)((uint32_t)half[i] << 8) >> 8;
+            sum += (int64_t)val * val;
+        }
+        _sai_sample.sum_squares += sum;
+        _sai_sample.count += SAI_HALF_SAMPLES;
+    }
+    if (_sai_stream_users & SAI_LEVEL_USERS)
+        osm_sai_bands_add(&_sai_bands, &_sai_bands_acc, half, SAI_HALF_SAMPLES);
+}
+
+
+/* Uniform noise of this RMS. */
+static double _sai_noise(double rms)
+{
+    return rms * sqrt(3.) * (2. * rand() / RAND_MAX - 1.);
+}
+
+
+/* What the DMA would have given since last time, a half at a time. */
+static void _sai_generate(void)
+{
+    if (!_sai_stream_users)
+        return;
+    uint32_t elapsed = osm_since_boot_delta(osm_get_since_boot_ms(), _sai_gen_start_ms);
+    uint64_t target = (uint64_t)elapsed * OSM_SAI_BANDS_SAMPLE_RATE_HZ / 1000;
+    uint64_t max_behind = (uint64_t)(SAI_MAX_CATCH_UP_MS * OSM_SAI_BANDS_SAMPLE_RATE_HZ / 1000);
+    if (target > _sai_gen_pos + max_behind)
+        _sai_gen_pos = target - max_behind;
+
+    double amplitudes[SAI_MAX_TONES];
+    for (unsigned i = 0; i < _sai_wave.num_tones; i++)
+        amplitudes[i] = _sai_db_to_rms(_sai_wave.tones[i].db) * M_SQRT2;
+    double noise = _sai_db_to_rms(_sai_wave.noise_db);
+
+    int32_t half[SAI_HALF_SAMPLES];
+    while (_sai_gen_pos + SAI_HALF_SAMPLES <= target)
+    {
+        for (unsigned i = 0; i < SAI_HALF_SAMPLES; i++)
+        {
+            double t = (double)(_sai_gen_pos + i) / OSM_SAI_BANDS_SAMPLE_RATE_HZ;
+            double v = _sai_noise(noise);
+            for (unsigned j = 0; j < _sai_wave.num_tones; j++)
+                v += amplitudes[j] * sin(2 * M_PI * _sai_wave.tones[j].hz * t);
+            half[i] = (int32_t)lround(v) & 0xFFFFFF;
+        }
+        _sai_stream_add(half);
+        _sai_gen_pos += SAI_HALF_SAMPLES;
+    }
+}
+
+
+static void _sai_stream_start(unsigned user)
+{
+    _sai_generate();
+    uint16_t users = _sai_stream_users;
+    if (users & (1 << user))
+        return;
+    if (user != SAI_SND_USER && !(users & SAI_LEVEL_USERS))
+    {
+        osm_sai_bands_init(&_sai_bands);
+        osm_sai_bands_acc_clear(&_sai_bands_acc);
+        _sai_levels.valid = false;
+    }
+    _sai_stream_users = users | (1 << user);
+    if (!users)
+    {
+        if (_sai_load_from_file())
+            _sai_remove_file();
+        _sai_gen_pos = 0;
+        _sai_gen_start_ms = osm_get_since_boot_ms();
+    }
+}
+
+
+static void _sai_stream_stop(unsigned user)
+{
+    _sai_generate();
+    _sai_stream_users &= ~(1 << user);
+}
+
+
+static uint32_t _sai_get_no_buf(void)
+{
+    return persist_data.model_config.sai_no_buf;
+}
+
+
 static osm_measurements_sensor_state_t _sai_collection_time(char* name, uint32_t* collection_time)
 {
-    return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+    *collection_time = SAI_DEFAULT_COLLECTION_TIME;
+    return OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS;
 }
 
 
 static osm_measurements_sensor_state_t _sai_iteration_callback(char* name)
 {
-    return OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS;
+    _sai_generate();
+    if (_sai_sample.count >= _sai_get_no_buf() * SAI_NO_BUF_SAMPLES)
+        return OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS;
+    return OSM_MEASUREMENTS_SENSOR_STATE_BUSY;
 }
 
 
 static osm_measurements_sensor_state_t _sai_measurements_init(char* name, bool in_isolation)
 {
-    return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+    _sai_generate();
+    _sai_sample.sum_squares = 0;
+    _sai_sample.count = 0;
+    _sai_stream_start(SAI_SND_USER);
+    return OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS;
 }
 
 
 static osm_measurements_sensor_state_t _sai_measurements_get(char* name, osm_measurements_reading_t* value)
 {
-    return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+    _sai_stream_stop(SAI_SND_USER);
+    if (!_sai_sample.count)
+    {
+        osm_sound_debug("No samples computed.");
+        return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+    }
+    float dB = _sai_rms_to_db(sqrt((double)_sai_sample.sum_squares / _sai_sample.count));
+    osm_sound_debug("%.1f dB from %"PRIu32" samples.", dB, _sai_sample.count);
+    value->v_f32 = osm_to_f32_from_float(dB);
+    return OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS;
+}
+
+
+static bool _sai_level_get_index(unsigned* index, char* name)
+{
+    for (unsigned i = 0; i < OSM_SAI_BANDS_LEVEL_COUNT; i++)
+    {
+        if (strncmp(name, _sai_level_names[i], OSM_MEASURE_NAME_LEN) == 0)
+        {
+            *index = i;
+            return true;
+        }
+    }
+    osm_sound_debug("Unknown sound level '%.*s'.", OSM_MEASURE_NAME_LEN, name);
+    return false;
+}
+
+
+static void _sai_level_enable(char* name, bool enabled)
+{
+    unsigned index;
+    if (!_sai_level_get_index(&index, name))
+        return;
+    if (enabled)
+        _sai_stream_start(index);
+    else
+        _sai_stream_stop(index);
 }
 
 
-static osm_measurements_value_type_t _pulsecount_value_type(char* name)
+static bool _sai_level_is_enabled(char* name)
 {
-    return OSM_MEASUREMENTS_VALUE_TYPE_I64;
+    unsigned index;
+    if (!_sai_level_get_index(&index, name))
+        return false;
+    return _sai_stream_users & (1 << index);
+}
+
+
+static osm_measurements_sensor_state_t _sai_level_init(char* name, bool in_isolation)
+{
+    unsigned index;
+    if (!_sai_level_get_index(&index, name))
+        return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+    _sai_stream_start(index);
+    return OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS;
+}
+
+
+static bool _sai_level_has_take(unsigned index)
+{
+    return _sai_levels.valid &&
+           !(_sai_levels.taken & (1 << index)) &&
+           osm_since_boot_delta(osm_get_since_boot_ms(), _sai_levels.time) < SAI_LEVEL_SHARE_MS;
+}
+
+
+static osm_measurements_sensor_state_t _sai_level_iteration(char* name)
+{
+    unsigned index;
+    if (!_sai_level_get_index(&index, name))
+        return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+    _sai_generate();
+    if (_sai_level_has_take(index) || _sai_bands_acc.count >= OSM_SAI_BANDS_FAST_SAMPLES)
+        return OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS;
+    return OSM_MEASUREMENTS_SENSOR_STATE_BUSY;
+}
+
+
+/* As on the STM, bands are placed against the A weighted level. */
+static float _sai_level_dB(unsigned index)
+{
+    float* rms = _sai_levels.rms;
+    if (index < OSM_SAI_BANDS_LEVEL_BAND)
+        return _sai_rms_to_db(rms[index]);
+    float ref = rms[OSM_SAI_BANDS_LEVEL_LAEQ];
+    if (ref < 1.f)
+        ref = 1.f;
+    float band = (rms[index] < 1e-3f) ? 1e-3f : rms[index];
+    return _sai_rms_to_db(ref) + 20.f * log10f(band / ref);
+}
+
+
+static osm_measurements_sensor_state_t _sai_level_get(char* name, osm_measurements_reading_t* value)
+{
+    unsigned index;
+    if (!_sai_level_get_index(&index, name))
+        return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+    if (!_sai_level_has_take(index))
+    {
+        _sai_generate();
+        _sai_levels.valid = osm_sai_bands_get(&_sai_bands_acc, _sai_levels.rms);
+        osm_sai_bands_acc_clear(&_sai_bands_acc);
+        _sai_levels.taken = 0;
+        _sai_levels.time = osm_get_since_boot_ms();
+        if (!_sai_levels.valid)
+        {
+            osm_sound_debug("No filtered samples.");
+            return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+        }
+    }
+    _sai_levels.taken |= 1 << index;
+    float dB = _sai_level_dB(index);
+    osm_sound_debug("%s = %.1f dB", _sai_level_names[index], dB);
+    value->v_f32 = osm_to_f32_from_float(dB);
+    return OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS;
+}
+
+
+static osm_measurements_value_type_t _sai_value_type(char* name)
+{
+    return OSM_MEASUREMENTS_VALUE_TYPE_FLOAT;
 }
 
 
@@ -57,7 +421,19 @@ void  osm_sai_inf_init(osm_measurements_inf_t* inf)
     inf->init_cb            = _sai_measurements_init;
     inf->get_cb             = _sai_measurements_get;
     inf->iteration_cb       = _sai_iteration_callback;
-    inf->value_type_cb      = _pulsecount_value_type;
+    inf->value_type_cb      = _sai_value_type;
+}
+
+
+void  osm_sai_level_inf_init(osm_measurements_inf_t* inf)
+{
+    inf->collection_time_cb = _sai_collection_time;
+    inf->init_cb            = _sai_level_init;
+    inf->get_cb             = _sai_level_get;
+    inf->iteration_cb       = _sai_level_iteration;
+    inf->enable_cb          = _sai_level_enable;
+    inf->is_enabled_cb      = _sai_level_is_enabled;
+    inf->value_type_cb      = _sai_value_type;
 }
 
 
@@ -56,6 +56,53 @@ void osm_w1_send_byte(uint8_t index, uint8_t byte)
 }
 
 
+/* The fake bus has a byte for each bit in the ROM search. */
+bool osm_w1_read_bit(uint8_t index)
+{
+    return osm_w1_read_byte(index) & 1;
+}
+
+
+void osm_w1_send_bit(uint8_t index, bool bit)
+{
+    osm_w1_send_byte(index, bit ? 1 : 0);
+}
+
+
+/* The fake bus is a socket, so the transfer is done before returning. */
+bool osm_w1_reset_async(uint8_t index, osm_w1_cb_t cb, void* userdata)
+{
+    bool ok = osm_w1_reset(index);
+    if (cb)
+        cb(index, ok, 0, userdata);
+    return true;
+}
+
+
+bool osm_w1_send_byte_async(uint8_t index, uint8_t byte, osm_w1_cb_t cb, void* userdata)
+{
+    osm_w1_send_byte(index, byte);
+    if (cb)
+        cb(index, _w1_connected, 0, userdata);
+    return true;
+}
+
+
+bool osm_w1_read_byte_async(uint8_t index, osm_w1_cb_t cb, void* userdata)
+{
+    uint8_t byte = osm_w1_read_byte(index);
+    if (cb)
+        cb(index, _w1_connected, byte, userdata);
+    return true;
+}
+
+
+bool osm_w1_busy(void)
+{
+    return false;
+}
+
+
 void osm_w1_init(uint8_t index)
 {
 }
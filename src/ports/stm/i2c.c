@@ -1,17 +1,24 @@
 #include <libopencm3/stm32/gpio.h>
 #include <libopencm3/stm32/rcc.h>
 #include <libopencm3/stm32/i2c.h>
+#include <libopencm3/cm3/nvic.h>
 
 #include <osm/core/i2c.h>
+#include <osm/core/i2c_queue.h>
 
 #include "pinmap.h"
 #include <osm/core/log.h>
+#include <osm/core/config.h>
 #include <osm/core/common.h>
 #include <osm/core/uart_rings.h>
 
 
+#define I2C_IRQS    (I2C_CR1_TXIE | I2C_CR1_RXIE | I2C_CR1_TCIE | I2C_CR1_NACKIE | I2C_CR1_STOPIE | I2C_CR1_ERRIE)
+
+
 static const osm_i2c_def_t i2c_buses[]     = OSM_I2C_BUSES;
 static uint8_t         i2c_buses_ready = 0;
+static osm_i2c_queue_t i2c_queues[OSM_ARRAY_SIZE(i2c_buses)];
 
 
 static void _i2c_setup(const osm_i2c_def_t * i2c_bus)
@@ -59,112 +66,199 @@ static void i2c_init(unsigned i2c_index)
     gpio_set_output_options(i2c_bus->port_n_pins.port, GPIO_OTYPE_OD, GPIO_OSPEED_VERYHIGH, i2c_bus->port_n_pins.pins);
 
     _i2c_setup(i2c_bus);
+
+    nvic_set_priority(i2c_bus->ev_irq, OSM_I2C_PRIORITY);
+    nvic_set_priority(i2c_bus->er_irq, OSM_I2C_PRIORITY);
+    nvic_enable_irq(i2c_bus->ev_irq);
+    nvic_enable_irq(i2c_bus->er_irq);
 }
 
 
-bool osm_i2c_transfer_timeout(uint32_t i2c, uint8_t addr, const uint8_t *w, unsigned wn, uint8_t *r, unsigned rn, unsigned timeout_ms)
+static int _i2c_get_index(uint32_t i2c)
 {
-    /* i2c_transfer7 but with ms timeout. */
-    uint32_t start_ms = osm_get_since_boot_ms();
-
-    const osm_i2c_def_t * i2c_bus = NULL;
-    for (uint8_t i = 0; i < OSM_ARRAY_SIZE(i2c_buses); i++)
+    for (unsigned i = 0; i < OSM_ARRAY_SIZE(i2c_buses); i++)
     {
         if (i2c_buses[i].i2c == i2c)
-        {
-            i2c_bus = & i2c_buses[i];
-            break;
-        }
+            return i;
     }
+    return -1;
+}
+
 
-    if (!i2c_bus)
+static void _i2c_irqs_enable(unsigned index, bool enable)
+{
+    const osm_i2c_def_t * i2c_bus = &i2c_buses[index];
+    if (enable)
     {
-        osm_log_error("I2C given invalid");
-        return false;
+        nvic_enable_irq(i2c_bus->ev_irq);
+        nvic_enable_irq(i2c_bus->er_irq);
+    }
+    else
+    {
+        nvic_disable_irq(i2c_bus->ev_irq);
+        nvic_disable_irq(i2c_bus->er_irq);
     }
+}
+
 
-    if (wn)
+static void _i2c_start(unsigned index, osm_i2c_xfer_t* xfer)
+{
+    uint32_t i2c = i2c_buses[index].i2c;
+
+    osm_i2c_queue_start(xfer, osm_get_since_boot_ms());
+    I2C_ICR(i2c) = I2C_ICR_STOPCF | I2C_ICR_NACKCF | I2C_ICR_BERRCF | I2C_ICR_ARLOCF;
+    i2c_set_7bit_address(i2c, xfer->addr);
+    if (xfer->wn)
     {
-        i2c_set_7bit_address(i2c, addr);
         i2c_set_write_transfer_dir(i2c);
-        i2c_set_bytes_to_transfer(i2c, wn);
-        if (rn)
+        i2c_set_bytes_to_transfer(i2c, xfer->wn);
+        if (xfer->rn)
             i2c_disable_autoend(i2c);
         else
             i2c_enable_autoend(i2c);
+    }
+    else
+    {
+        i2c_set_read_transfer_dir(i2c);
+        i2c_set_bytes_to_transfer(i2c, xfer->rn);
+        i2c_enable_autoend(i2c);
+    }
+    i2c_enable_interrupt(i2c, I2C_IRQS);
+    i2c_send_start(i2c);
+}
 
-        i2c_send_start(i2c);
 
-        while (wn--)
-        {
-            bool wait = true;
-            while (wait)
-            {
-                if (i2c_transmit_int_status(i2c))
-                {
-                    wait = false;
-                }
-                if (osm_since_boot_delta(osm_get_since_boot_ms(), start_ms) > timeout_ms)
-                {
-                    osm_log_error("I2C timeout WAITing");
-                    _i2c_setup(i2c_bus);
-                    return false;
-                }
-                while (i2c_nack(i2c))
-                {
-                    if (osm_since_boot_delta(osm_get_since_boot_ms(), start_ms) > timeout_ms)
-                    {
-                        osm_log_error("I2C timeout NACKing");
-                        _i2c_setup(i2c_bus);
-                        return false;
-                    }
-                    osm_uart_rings_out_drain();
-                }
-            }
-            i2c_send_data(i2c, *w++);
-        }
+/* Only with the bus interrupts off or from them. */
+static void _i2c_finish(unsigned index, bool ok)
+{
+    uint32_t i2c = i2c_buses[index].i2c;
+
+    i2c_disable_interrupt(i2c, I2C_IRQS);
+    if (!ok)
+        _i2c_setup(&i2c_buses[index]);
+    osm_i2c_xfer_t* next = osm_i2c_queue_finish(&i2c_queues[index], ok);
+    if (next && next->status == OSM_I2C_XFER_QUEUED)
+        _i2c_start(index, next);
+}
 
-        if (rn)
-        {
-            while (!i2c_transfer_complete(i2c))
-            {
-                if (osm_since_boot_delta(osm_get_since_boot_ms(), start_ms) > timeout_ms)
-                {
-                    osm_log_error("I2C timeout READing");
-                    _i2c_setup(i2c_bus);
-                    return false;
-                }
-                osm_uart_rings_out_drain();
-            }
-        }
+
+static void _i2c_isr(unsigned index)
+{
+    uint32_t i2c = i2c_buses[index].i2c;
+    osm_i2c_xfer_t* xfer = osm_i2c_queue_front(&i2c_queues[index]);
+    if (!xfer || xfer->status != OSM_I2C_XFER_ACTIVE)
+    {
+        i2c_disable_interrupt(i2c, I2C_IRQS);
+        return;
     }
 
-    if (rn)
+    uint32_t isr = I2C_ISR(i2c);
+    if (isr & (I2C_ISR_BERR | I2C_ISR_ARLO | I2C_ISR_NACKF))
+    {
+        _i2c_finish(index, false);
+        return;
+    }
+    if ((isr & I2C_ISR_TXIS) && xfer->wi < xfer->wn)
+        i2c_send_data(i2c, xfer->w[xfer->wi++]);
+    if (isr & I2C_ISR_RXNE)
     {
-        i2c_set_7bit_address(i2c, addr);
+        uint8_t byte = i2c_get_data(i2c);
+        if (xfer->ri < xfer->rn)
+            xfer->r[xfer->ri++] = byte;
+    }
+    if (isr & I2C_ISR_TC)
+    {
+        /* Written without a stop, now the read with a repeated start. */
         i2c_set_read_transfer_dir(i2c);
-        i2c_set_bytes_to_transfer(i2c, rn);
+        i2c_set_bytes_to_transfer(i2c, xfer->rn);
+        i2c_enable_autoend(i2c);
         i2c_send_start(i2c);
+    }
+    if (isr & I2C_ISR_STOPF)
+    {
+        I2C_ICR(i2c) = I2C_ICR_STOPCF;
+        _i2c_finish(index, xfer->wi == xfer->wn && xfer->ri == xfer->rn);
+    }
+}
+
+
+void osm_i2c_bus_0_ev_isr(void)
+{
+    _i2c_isr(0);
+}
+
+
+void osm_i2c_bus_0_er_isr(void)
+{
+    _i2c_isr(0);
+}
+
+
+bool osm_i2c_submit(osm_i2c_xfer_t* xfer)
+{
+    /* Already queued, a second push would run it twice. */
+    if (osm_i2c_xfer_pending(xfer))
+        return false;
+    if ((!xfer->w && xfer->wn) || (!xfer->r && xfer->rn) ||
+        xfer->wn > OSM_I2C_XFER_MAX_LEN || xfer->rn > OSM_I2C_XFER_MAX_LEN)
+    {
+        osm_log_error("I2C transaction invalid");
+        return false;
+    }
+    int index = _i2c_get_index(xfer->i2c);
+    if (index < 0)
+    {
+        osm_log_error("I2C given invalid");
+        return false;
+    }
+
+    _i2c_irqs_enable(index, false);
+    osm_i2c_queue_t* queue = &i2c_queues[index];
+    bool queued = osm_i2c_queue_push(queue, xfer);
+    if (queued && osm_i2c_queue_front(queue) == xfer)
+        _i2c_start(index, xfer);
+    _i2c_irqs_enable(index, true);
+    if (!queued)
+        osm_log_error("I2C queue full");
+    return queued;
+}
 
-        i2c_enable_autoend(i2c);
 
-        for (size_t i = 0; i < rn; i++)
+void osm_i2cs_iterate(void)
+{
+    uint32_t now_ms = osm_get_since_boot_ms();
+    for (unsigned i = 0; i < OSM_ARRAY_SIZE(i2c_buses); i++)
+    {
+        if (!osm_i2c_queue_timed_out(&i2c_queues[i], now_ms))
+            continue;
+        _i2c_irqs_enable(i, false);
+        if (osm_i2c_queue_timed_out(&i2c_queues[i], now_ms))
         {
-            while (i2c_received_data(i2c) == 0)
-            {
-                if (osm_since_boot_delta(osm_get_since_boot_ms(), start_ms) > timeout_ms)
-                {
-                    osm_log_error("I2C timeout");
-                    _i2c_setup(i2c_bus);
-                    return false;
-                }
-                osm_uart_rings_out_drain();
-            }
-            r[i] = i2c_get_data(i2c);
+            osm_log_error("I2C timeout");
+            _i2c_finish(i, false);
         }
+        _i2c_irqs_enable(i, true);
     }
+}
 
-    return true;
+
+bool osm_i2c_transfer_timeout(uint32_t i2c, uint8_t addr, const uint8_t *w, unsigned wn, uint8_t *r, unsigned rn, unsigned timeout_ms)
+{
+    osm_i2c_xfer_t xfer = {.i2c = i2c,
+                           .addr = addr,
+                           .w = w,
+                           .wn = wn,
+                           .r = r,
+                           .rn = rn,
+                           .timeout_ms = timeout_ms};
+    if (!osm_i2c_submit(&xfer))
+        return false;
+    while (osm_i2c_xfer_pending(&xfer))
+    {
+        osm_i2cs_iterate();
+        osm_uart_rings_out_drain();
+    }
+    return xfer.status == OSM_I2C_XFER_DONE;
 }
 
 
@@ -182,6 +276,11 @@ static void i2c_deinit(unsigned i2c_index)
     i2c_buses_ready &= ~(1 << i2c_index);
 
     const osm_i2c_def_t * i2c_bus = &i2c_buses[i2c_index];
+    _i2c_irqs_enable(i2c_index, false);
+    i2c_disable_interrupt(i2c_bus->i2c, I2C_IRQS);
+    /* Anything still queued fails rather than waiting on a dead bus. */
+    while (osm_i2c_queue_front(&i2c_queues[i2c_index]))
+        osm_i2c_queue_finish(&i2c_queues[i2c_index], false);
     i2c_peripheral_disable(i2c_bus->i2c);
     rcc_periph_clock_disable(i2c_bus->rcc);
 }
@@ -28,11 +28,6 @@ typedef struct
 } io_watch_instance_t;
 
 
-const unsigned              ios_watch_ios[IOS_WATCH_COUNT]                  = IOS_WATCH_IOS;
-static osm_measurements_def_t*  _ios_watch_measurements_def[IOS_WATCH_COUNT];
-static osm_measurements_data_t* _ios_watch_measurements_data[IOS_WATCH_COUNT];
-
-
 static io_watch_instance_t _io_watch_instances[IOS_WATCH_COUNT] =
 {
     {
@@ -134,49 +129,6 @@ void osm_io_watch_isr(uint32_t exti_group)
 
         exti_reset_request(inst->exti);
 
-        osm_measurements_def_t* def = _ios_watch_measurements_def[i];
-        osm_measurements_data_t* data = _ios_watch_measurements_data[i];
-        if (!def || !data)
-            continue;
-
-        if (!def->interval || !def->samplecount)
-            continue;
-
-        data->instant_send = 1;
-        osm_sleep_exit_sleep_mode();
-    }
-}
-
-
-void osm_io_watch_init(void)
-{
-    /* Must be called after osm_measurements_init */
-    char name[OSM_MEASURE_NAME_NULLED_LEN] = OSM_IOS_MEASUREMENT_NAME_PRE;
-    unsigned len = strnlen(name, OSM_MEASURE_NAME_LEN);
-    char* p = name + len;
-    for (unsigned i = 0; i < IOS_WATCH_COUNT; i++)
-    {
-        snprintf(p, OSM_MEASURE_NAME_NULLED_LEN - len, "%02u", ios_watch_ios[i]);
-        if (!osm_measurements_get_measurements_def(name, &_ios_watch_measurements_def[i], &_ios_watch_measurements_data[i]))
-        {
-            _ios_watch_measurements_def[i] = NULL;
-            _ios_watch_measurements_data[i] = NULL;
-            osm_io_debug("Could not find measurements data for '%s'", name);
-        }
-    }
-
-    for(unsigned n = 0; n < OSM_ARRAY_SIZE(ios_pins); n++)
-    {
-        if (osm_io_is_watch_now(n))
-        {
-            uint8_t pupd;
-            if (!osm_ios_get_pupd(n, &pupd))
-            {
-                osm_io_debug("Could not get pull of IO %u", n);
-                continue;
-            }
-            if (!osm_io_watch_enable(n, true, pupd))
-                osm_io_debug("Could not enable IO watch for IO %u on init.", n);
-        }
+        osm_io_watch_push(inst->io, gpio_get(inst->pnp.port, inst->pnp.pins));
     }
 }
@@ -74,6 +74,7 @@ bool osm_persistent_init(void)
     if (persist_data_raw->version != PERSIST_VERSION)
     {
         osm_log_error("Persistent data version doesn't match.");
+        osm_persist_measurements_update(persist_data_raw->version, &persist_measurements);
         if (!osm_persist_config_update(persist_data_raw, &persist_data))
         {
             osm_log_error("Unable to update config");
@@ -110,6 +111,16 @@ static bool _persist_data_cmp(void)
         !osm_model_persist_config_cmp(
             &persist_data.model_config,
             &persist_data_raw->model_config)                            &&
+        memcmp(persist_data.deadbands,
+            persist_data_raw->deadbands,
+            sizeof(persist_data.deadbands)) == 0                            &&
+        memcmp(persist_data.stats,
+            persist_data_raw->stats,
+            sizeof(persist_data.stats)) == 0                                &&
+        persist_data.batch_intervals == persist_data_raw->batch_intervals &&
+        persist_data.batch_max_mins == persist_data_raw->batch_max_mins &&
+        persist_data.cc_energy_wh   == persist_data_raw->cc_energy_wh   &&
+        persist_data.io_watch_window_ms == persist_data_raw->io_watch_window_ms &&
         persist_data.config_count   == persist_data_raw->config_count   );
 }
 
@@ -13,11 +13,20 @@
 #include "pinmap.h"
 #include <osm/core/common.h>
 #include <osm/core/io.h>
+#include <osm/core/sleep.h>
+#include <osm/core/pulse_timing.h>
 #include <osm/sensors/pulsecount.h>
 #include "platform_model.h"
 
 #define PULSECOUNT_COLLECTION_TIME_MS       10
 
+#define PULSECOUNT_TIMING_RATE              0
+#define PULSECOUNT_TIMING_MIN               1
+#define PULSECOUNT_TIMING_MAX               2
+#define PULSECOUNT_TIMING_JITTER            3
+#define PULSECOUNT_TIMING_COUNT             4
+#define PULSECOUNT_TIMING_SHARE_MS          10000   /* Timings of one round of readings share a take */
+
 #if defined(W1_PULSE_1_LED_PORT_N_PINS) && defined(W1_PULSE_2_LED_PORT_N_PINS)
 #define PULSECOUNT_INSTANCES   {                                       \
     { { OSM_MEASUREMENTS_PULSE_COUNT_NAME_1, W1_PULSE_1_IO} ,          \
@@ -52,7 +61,7 @@
 }
 #endif // W1_PULSE_1_LED_PORT_N_PINS && W1_PULSE_2_LED_PORT_N_PINS
 
-#define PULSECOUNT_INDEX_FROM_INST(_inst, _arr)         ((_inst - _arr) / sizeof(pulsecount_instance_t))
+#define PULSECOUNT_INDEX_FROM_INST(_inst, _arr)         ((unsigned)(_inst - _arr))
 
 
 typedef struct
@@ -78,10 +87,34 @@ typedef struct
 } pulsecount_instance_t;
 
 
+typedef struct
+{
+    bool                        timed;      /* No debounce, each edge counted and timed as it comes */
+    uint64_t                    edge_us;    /* Of the edge being debounced */
+    osm_pulse_timing_t          timing;
+    osm_pulse_timing_result_t   result;
+    uint32_t                    time;
+    uint8_t                     taken;
+    bool                        valid;
+} pulsecount_timing_t;
+
+
 static pulsecount_instance_t _pulsecount_instances[] = PULSECOUNT_INSTANCES;
+static pulsecount_timing_t _pulsecount_timings[OSM_ARRAY_SIZE(_pulsecount_instances)];
+static const char * const _pulsecount_timing_names[][PULSECOUNT_TIMING_COUNT] =
+{
+    { OSM_MEASUREMENTS_PULSE_RATE_NAME_1, OSM_MEASUREMENTS_PULSE_MIN_NAME_1, OSM_MEASUREMENTS_PULSE_MAX_NAME_1, OSM_MEASUREMENTS_PULSE_JITTER_NAME_1 },
+    { OSM_MEASUREMENTS_PULSE_RATE_NAME_2, OSM_MEASUREMENTS_PULSE_MIN_NAME_2, OSM_MEASUREMENTS_PULSE_MAX_NAME_2, OSM_MEASUREMENTS_PULSE_JITTER_NAME_2 },
+};
 static uint32_t* _pulsecount_debounces_ms = NULL;
 
 
+static pulsecount_timing_t* _pulsecount_get_timing(pulsecount_instance_t* inst)
+{
+    return &_pulsecount_timings[PULSECOUNT_INDEX_FROM_INST(inst, _pulsecount_instances)];
+}
+
+
 static bool _pulsecount_get_pupd(pulsecount_instance_t* inst, uint8_t* pupd)
 {
     if (!inst || !pupd)
@@ -130,9 +163,13 @@ void pulsecount_2_led_timer_isr(void)
 #endif // W1_PULSE_1_LED_PORT_N_PINS && W1_PULSE_2_LED_PORT_N_PINS
 
 
-static void _pulsecount_count_pulse(pulsecount_instance_t* inst)
+/* Only the timestamp goes to the ring, the main loop is woken to drain
+ * it before it fills. */
+static void _pulsecount_count_pulse(pulsecount_instance_t* inst, uint64_t stamp_us)
 {
     __sync_add_and_fetch(&inst->count, 1);
+    if (osm_pulse_timing_push(&_pulsecount_get_timing(inst)->timing, stamp_us) == OSM_PULSE_TIMING_RING_WAKE)
+        osm_sleep_exit_sleep_mode();
 #if defined(W1_PULSE_1_LED_PORT_N_PINS) && defined(W1_PULSE_2_LED_PORT_N_PINS)
     _pulsecound_led_set(inst, true);
     timer_enable_counter(inst->led_tim);
@@ -145,6 +182,7 @@ static void _pulsecount_debounce_isr(pulsecount_instance_t* inst)
     if (inst)
     {
         timer_clear_flag(inst->tim, TIM_SR_UIF);
+        uint64_t edge_us = _pulsecount_get_timing(inst)->edge_us;
         /* Logic is:
          * - if triggered on both, assume good, no way to know if it should be high or low here, increment any condition
          * - if triggered on rising edge, check gpio is high, if it is high, increment
@@ -153,18 +191,18 @@ static void _pulsecount_debounce_isr(pulsecount_instance_t* inst)
         switch(inst->edge)
         {
             case OSM_IO_SPECIAL_PULSECOUNT_BOTH_EDGE:
-                _pulsecount_count_pulse(inst);
+                _pulsecount_count_pulse(inst, edge_us);
                 break;
             case OSM_IO_SPECIAL_PULSECOUNT_RISING_EDGE:
                 if (gpio_get(inst->pnp.port, inst->pnp.pins))
                 {
-                    _pulsecount_count_pulse(inst);
+                    _pulsecount_count_pulse(inst, edge_us);
                 }
                 break;
             case OSM_IO_SPECIAL_PULSECOUNT_FALLING_EDGE:
                 if (!gpio_get(inst->pnp.port, inst->pnp.pins))
                 {
-                    _pulsecount_count_pulse(inst);
+                    _pulsecount_count_pulse(inst, edge_us);
                 }
                 break;
             default:
@@ -190,6 +228,7 @@ void pulsecount_2_debounce_isr(void)
 
 void osm_pulsecount_isr(uint32_t exti_group)
 {
+    uint64_t now_us = osm_get_since_boot_us();
     for (unsigned i = 0; i < OSM_ARRAY_SIZE(_pulsecount_instances); i++)
     {
         pulsecount_instance_t* inst = &_pulsecount_instances[i];
@@ -201,6 +240,13 @@ void osm_pulsecount_isr(uint32_t exti_group)
         if (!exti_state)
             continue;
         exti_reset_request(inst->exti);
+        pulsecount_timing_t* timing = &_pulsecount_timings[i];
+        if (timing->timed)
+        {
+            _pulsecount_count_pulse(inst, now_us);
+            continue;
+        }
+        timing->edge_us = now_us;
         exti_disable_request(inst->exti);
         timer_enable_counter(inst->tim);
     }
@@ -257,22 +303,27 @@ static void _pulsecount_init_instance(pulsecount_instance_t* instance)
 
     instance->count = 0;
     instance->send_count = 0;
+    pulsecount_timing_t* timing = _pulsecount_get_timing(instance);
+    osm_pulse_timing_init(&timing->timing);
+    timing->valid = false;
+
+    /* A debounce of 0 is none, each edge is counted and timed in the EXTI
+     * interrupt, for when the source is clean and too fast to debounce. */
+    unsigned index = PULSECOUNT_INDEX_FROM_INST(instance, _pulsecount_instances);
+    uint32_t period = _pulsecount_debounces_ms[index] * 10;
+    timing->timed = !period;
 
     /* SETUP TIMERS - DEBOUNCE */
     rcc_periph_clock_enable(instance->tim_rcc);
 
     timer_disable_counter(instance->tim);
 
-    /* because it starts at zero, and interrupts on the overflow
-       Using 50ms for debounce
-     */
+    /* because it starts at zero, and interrupts on the overflow */
     timer_set_prescaler(instance->tim, rcc_apb1_frequency / 10000 -1);
-    unsigned index = PULSECOUNT_INDEX_FROM_INST(instance, _pulsecount_instances);
-    uint32_t period = _pulsecount_debounces_ms[index] * 10;
-    if (!period)
+    if (timing->timed)
     {
-        osm_pulsecount_debug("Set period is 0ms, using 50ms");
-        period = 500;
+        osm_pulsecount_debug("Set period is 0ms, timing each edge");
+        period = 1;
     }
     timer_set_period(instance->tim, period);
     timer_one_shot_mode(instance->tim);
@@ -477,6 +528,113 @@ void     osm_pulsecount_inf_init(osm_measurements_inf_t* inf)
 }
 
 
+static bool _pulsecount_timing_get_instance(pulsecount_instance_t** instance, unsigned* stat, char* name)
+{
+    for (unsigned i = 0; i < OSM_ARRAY_SIZE(_pulsecount_instances) && i < OSM_ARRAY_SIZE(_pulsecount_timing_names); i++)
+    {
+        for (unsigned j = 0; j < PULSECOUNT_TIMING_COUNT; j++)
+        {
+            if (strncmp(name, _pulsecount_timing_names[i][j], OSM_MEASURE_NAME_LEN) == 0)
+            {
+                *instance = &_pulsecount_instances[i];
+                *stat = j;
+                return true;
+            }
+        }
+    }
+    osm_pulsecount_debug("Could not find name in timings.");
+    return false;
+}
+
+
+static osm_measurements_sensor_state_t _pulsecount_timing_begin(char* name, bool in_isolation)
+{
+    pulsecount_instance_t* instance;
+    unsigned stat;
+    if (!_pulsecount_timing_get_instance(&instance, &stat, name))
+        return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+    if (!osm_io_is_pulsecount_now(instance->info.io))
+        return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+    return OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS;
+}
+
+
+/* Whether this timing can read the last take, not yet read by it and
+ * taken in this round of readings. */
+static bool _pulsecount_timing_has_take(pulsecount_timing_t* timing, unsigned stat)
+{
+    return timing->valid &&
+           !(timing->taken & (1 << stat)) &&
+           osm_since_boot_delta(osm_get_since_boot_ms(), timing->time) < PULSECOUNT_TIMING_SHARE_MS;
+}
+
+
+/* The first of a round of readings takes the timing since the last round,
+ * and clears it for the next, the rest read that take. */
+static osm_measurements_sensor_state_t _pulsecount_timing_get(char* name, osm_measurements_reading_t* value)
+{
+    pulsecount_instance_t* instance;
+    unsigned stat;
+    if (!_pulsecount_timing_get_instance(&instance, &stat, name))
+        return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+    if (!osm_io_is_pulsecount_now(instance->info.io))
+    {
+        osm_pulsecount_debug("IO %s not set up.", name);
+        return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+    }
+    pulsecount_timing_t* timing = _pulsecount_get_timing(instance);
+    osm_pulse_timing_result_t* result = &timing->result;
+    if (!_pulsecount_timing_has_take(timing, stat))
+    {
+        osm_pulse_timing_drain(&timing->timing);
+        osm_pulse_timing_take(&timing->timing, result);
+        timing->valid = true;
+        timing->taken = 0;
+        timing->time = osm_get_since_boot_ms();
+        osm_pulsecount_debug("%.4s timed %"PRIu32" intervals, %"PRIu32" edges dropped.",
+                             instance->info.name, result->count, result->overflows);
+    }
+    timing->taken |= 1 << stat;
+    float v;
+    switch (stat)
+    {
+        case PULSECOUNT_TIMING_RATE:    v = result->rate_hz;    break;
+        case PULSECOUNT_TIMING_MIN:     v = result->min_ms;     break;
+        case PULSECOUNT_TIMING_MAX:     v = result->max_ms;     break;
+        default:                        v = result->jitter_ms;  break;
+    }
+    if (stat != PULSECOUNT_TIMING_RATE && !result->count)
+    {
+        osm_pulsecount_debug("No intervals for %.4s.", name);
+        return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+    }
+    value->v_f32 = osm_to_f32_from_float(v);
+    return OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS;
+}
+
+
+static osm_measurements_value_type_t _pulsecount_timing_value_type(char* name)
+{
+    return OSM_MEASUREMENTS_VALUE_TYPE_FLOAT;
+}
+
+
+void     osm_pulsecount_timing_inf_init(osm_measurements_inf_t* inf)
+{
+    inf->collection_time_cb = _pulsecount_collection_time;
+    inf->init_cb            = _pulsecount_timing_begin;
+    inf->get_cb             = _pulsecount_timing_get;
+    inf->value_type_cb      = _pulsecount_timing_value_type;
+}
+
+
+void     osm_pulsecount_iterate(void)
+{
+    for (unsigned i = 0; i < OSM_ARRAY_SIZE(_pulsecount_instances); i++)
+        osm_pulse_timing_drain(&_pulsecount_timings[i].timing);
+}
+
+
 static osm_command_response_t _hw_pupd_cb(char* args, osm_cmd_ctx_t * ctx)
 {
     char* p;
@@ -565,8 +723,8 @@ struct osm_cmd_link_t* osm_pulsecount_add_commands(struct osm_cmd_link_t* tail)
 {
     static struct osm_cmd_link_t cmds[] =
     {
-        { "hw_pupd",      "Print all IOs.",                 _hw_pupd_cb                 , false , NULL },
-        { "pulse_dbnc",   "Get/set pulse debounce (ms)",    _pulsecount_pulse_dbnc_cb   , false , NULL },
+        { "hw_pupd",      "Print all IOs.",                                 _hw_pupd_cb                 , false , NULL },
+        { "pulse_dbnc",   "Get/set pulse debounce (ms), 0 times each edge", _pulsecount_pulse_dbnc_cb   , false , NULL },
     };
     return osm_add_commands(tail, cmds, OSM_ARRAY_SIZE(cmds));
 }
@@ -27,6 +27,8 @@ Documents used:
 #include <osm/core/uart_rings.h>
 #include <osm/core/measurements.h>
 #include <osm/core/persist_config.h>
+#include <osm/core/sai_bands.h>
+#include <osm/sensors/sai.h>
 
 #define SAI1   SAI1_BASE
 
@@ -240,9 +242,14 @@ enum sai_xsr_flvl {
 #define SAI_DEFAULT_COLLECTION_TIME         1000
 #define SAI_INIT_DELAY                      25
 
-#define SAI_NUM_SAMPLES                     10
-#define SAI_ARRAY_SIZE                      (SAI_NUM_SAMPLES * SAI_NB_SLOTS)
-#define SAI_NUM_OFLOW_SCALES                5
+/* Mono drops slot 1 on receive, so each word is the next sample. */
+#define SAI_HALF_SAMPLES                    128     /* 16ms, filtered in the DMA interrupt */
+#define SAI_ARRAY_SIZE                      (SAI_HALF_SAMPLES * 2)
+#define SAI_NO_BUF_SAMPLES                  20      /* Samples to each of sound_no_buf */
+
+#define SAI_SND_USER                        OSM_SAI_BANDS_LEVEL_COUNT
+#define SAI_LEVEL_USERS                     ((1 << OSM_SAI_BANDS_LEVEL_COUNT) - 1)
+#define SAI_LEVEL_SHARE_MS                  10000   /* Levels of one round of readings share a take */
 
 #define SAI_DEFAULT_COEFFS     {                                       \
     -1.4476694634028f ,                                                \
@@ -258,24 +265,48 @@ enum sai_xsr_flvl {
 
 
 typedef volatile    int32_t     sai_arr_t[SAI_ARRAY_SIZE];
-typedef const       uint32_t    sai_overflow_arr[SAI_NUM_OFLOW_SCALES];
 
 
 typedef struct
 {
-    uint64_t    rolling_rms;
-    uint32_t    num_rms;
-    bool        finished;
+    uint64_t    sum_squares;
+    uint32_t    count;
 } sai_sample_t;
 
 
+typedef struct
+{
+    float       rms[OSM_SAI_BANDS_LEVEL_COUNT];
+    uint32_t    time;
+    uint16_t    taken;
+    bool        valid;
+} sai_levels_t;
+
+
 static sai_arr_t             _sai_array              = {0};
-static sai_overflow_arr      _sai_overflow_scales    = { 1, 10, 100, 1000, 10000 };
 static float               * _sai_calibration_coeffs = NULL;
 
-static volatile sai_sample_t _sai_sample          = {.rolling_rms=0,
-                                                     .num_rms=0,
-                                                     .finished=false};
+static volatile sai_sample_t _sai_sample          = {.sum_squares=0,
+                                                     .count=0};
+
+static volatile uint16_t     _sai_stream_users    = 0;  /* A bit for SND and for each level */
+static osm_sai_bands_t       _sai_bands;
+static osm_sai_bands_acc_t   _sai_bands_acc;
+static sai_levels_t          _sai_levels          = {0};
+
+static const char * const    _sai_level_names[OSM_SAI_BANDS_LEVEL_COUNT] =
+{
+    OSM_MEASUREMENTS_SOUND_LAEQ_NAME,
+    OSM_MEASUREMENTS_SOUND_LAMAX_NAME,
+    OSM_MEASUREMENTS_SOUND_LAMIN_NAME,
+    OSM_MEASUREMENTS_SOUND_BAND_31_NAME,
+    OSM_MEASUREMENTS_SOUND_BAND_63_NAME,
+    OSM_MEASUREMENTS_SOUND_BAND_125_NAME,
+    OSM_MEASUREMENTS_SOUND_BAND_250_NAME,
+    OSM_MEASUREMENTS_SOUND_BAND_500_NAME,
+    OSM_MEASUREMENTS_SOUND_BAND_1K_NAME,
+    OSM_MEASUREMENTS_SOUND_BAND_2K_NAME,
+};
 
 
 static void _sai_clock_off(void)
@@ -318,6 +349,8 @@ static void _sai_dma_init(void)
     dma_set_priority(DMA2, DMA_CHANNEL1, DMA_CCR_PL_LOW);
 
     dma_enable_transfer_complete_interrupt(DMA2, DMA_CHANNEL1);
+    dma_enable_half_transfer_interrupt(DMA2, DMA_CHANNEL1);
+    dma_enable_circular_mode(DMA2, DMA_CHANNEL1);
 }
 
 
@@ -401,69 +434,6 @@ void osm_sai_init(void)
 }
 
 
-static bool _sai_rms(uint32_t* rms, const sai_arr_t arr, unsigned len, uint32_t downscale)
-{
-    /*
-     This is a bad way of calculating RMS. Need to look at convoltion
-     to minimise cycles and memory usage.
-     */
-    uint64_t sum = 0;
-    for (unsigned i = 0; i < len; i++)
-    {
-        // convert to signed 24 bit number
-        int32_t val = arr[i];
-        if (val & 0xC00000)
-            val |= 0xFF000000;
-
-        // scale down to avoid overflowing
-        val /= downscale;
-
-        // See if the square is larger than max uint64
-        uint64_t val_sqr = osm_abs_i64(val);
-        if (val_sqr >= UINT64_MAX / val_sqr)
-        {
-            osm_sound_debug("Overflow with scale %"PRIu32, downscale);
-            return false;
-        }
-        val_sqr *= val_sqr;
-
-        // See if the sum is larger than max uint64
-        if (sum > UINT64_MAX - val_sqr)
-        {
-            osm_sound_debug("Overflow with scale %"PRIu32, downscale);
-            return false;
-        }
-        sum = sum + val_sqr;
-    }
-    // Difference due to fast sqrt is +-0.1%. This is
-    // +-(0.1 * 1/ln(10))% = 0.04% after logging the RMS.
-    *rms = 1/osm_Q_rsqrt(sum/len) * downscale;
-    return true;
-}
-
-
-static bool _sai_rms_adaptive(uint32_t* rms, sai_arr_t arr, unsigned len)
-{
-    /*
-     This function uses a scale to downscale the amplitudes before
-     calculating the RMS to ensure the value doesn't overflow.
-     */
-    uint32_t rms_local;
-    uint32_t overflow_scale_index = 0;
-    while (!_sai_rms(&rms_local, arr, len, _sai_overflow_scales[overflow_scale_index]))
-    {
-        if (overflow_scale_index >= SAI_NUM_OFLOW_SCALES)
-        {
-            osm_sound_debug("Cannot downscale any more.");
-            return false;
-        }
-        overflow_scale_index++;
-    }
-    *rms = rms_local;
-    return true;
-}
-
-
 static uint32_t _sai_conv_dB(uint64_t rms)
 {
     /*
@@ -507,99 +477,88 @@ static uint32_t _sai_conv_dB(uint64_t rms)
 
 
 
-static bool _sai_collect(void)
+static uint32_t _sai_get_no_buf(void)
 {
-    /*
-     * Calculate the rolling RMS with an adaptive window size of the
-     * number of samples.
-     * Total RMS =    _________________________________
-     *               /old_rms² x num_old_rms + new_rms²
-     *              / ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
-     *             V         num_old_rms + 1
-     */
-    uint64_t prev_rms_cmp, new_rms_cmp, rms;
-    uint32_t rms_32;
-
-    _sai_sample.num_rms++;
-
-    if (!osm_u64_multiply_overflow_check(&prev_rms_cmp, _sai_sample.rolling_rms, _sai_sample.rolling_rms))
-    {
-        goto overflow_exit;
-    }
+    return persist_data.model_config.sai_no_buf;
+}
 
-    if (!osm_u64_multiply_overflow_check(&prev_rms_cmp, prev_rms_cmp, (_sai_sample.num_rms-1)))
-    {
-        goto overflow_exit;
-    }
 
-    if (!_sai_rms_adaptive(&rms_32, _sai_array, SAI_ARRAY_SIZE))
-    {
-        osm_sound_debug("Cannot collect RMS.");
-        return false;
-    }
-    new_rms_cmp = rms_32;
+static void _sai_set_no_buf(uint32_t new_no_buf)
+{
+    persist_data.model_config.sai_no_buf = new_no_buf;
+}
 
-    if (!osm_u64_multiply_overflow_check(&new_rms_cmp, new_rms_cmp, new_rms_cmp))
-    {
-        goto overflow_exit;
-    }
 
-    if (!osm_u64_addition_overflow_check(&rms, prev_rms_cmp, new_rms_cmp))
+static void _sai_stream_add(const volatile int32_t* half)
+{
+    uint16_t users = _sai_stream_users;
+    if ((users & (1 << SAI_SND_USER)) && _sai_sample.count < _sai_get_no_buf() * SAI_NO_BUF_SAMPLES)
     {
-        goto overflow_exit;
+        uint64_t sum = 0;
+        for (unsigned i = 0; i < SAI_HALF_SAMPLES; i++)
+        {
+            // convert to signed 24 bit number
+            int32_t val = (int32_t)((uint32_t)half[i] << 8) >> 8;
+            sum += (int64_t)val * val;
+        }
+        _sai_sample.sum_squares += sum;
+        _sai_sample.count += SAI_HALF_SAMPLES;
     }
-
-    rms /= _sai_sample.num_rms;
-    /* Difference due to fast sqrt is +-0.1%. This is
-     * +-(0.1 * 1/ln(10))% = 0.04% after logging the RMS.
-     * Companding of the errors are small enough to ignore.
-     */
-    rms = 1/osm_Q_rsqrt(rms);
-    _sai_sample.rolling_rms = rms;
-    return true;
-overflow_exit:
-    osm_sound_debug("Overflow issue.");
-    return false;
+    if (users & SAI_LEVEL_USERS)
+        osm_sai_bands_add(&_sai_bands, &_sai_bands_acc, half, SAI_HALF_SAMPLES);
 }
 
 
 // cppcheck-suppress unusedFunction ; System handler
 void dma2_channel1_isr(void)
 {
-    DMA2_IFCR |= DMA_IFCR_CTCIF(DMA_CHANNEL1);
-    _sai_sample.finished = true;
+    if (dma_get_interrupt_flag(DMA2, DMA_CHANNEL1, DMA_HTIF))
+    {
+        dma_clear_interrupt_flags(DMA2, DMA_CHANNEL1, DMA_HTIF);
+        _sai_stream_add(_sai_array);
+    }
+    if (dma_get_interrupt_flag(DMA2, DMA_CHANNEL1, DMA_TCIF))
+    {
+        dma_clear_interrupt_flags(DMA2, DMA_CHANNEL1, DMA_TCIF);
+        _sai_stream_add(_sai_array + SAI_HALF_SAMPLES);
+    }
 }
 
 
-static uint32_t _sai_get_no_buf(void)
+/* The stream runs while anything uses it. The filters start over when
+ * the first level does, SND only sums the squares. */
+static void _sai_stream_start(unsigned user)
 {
-    return persist_data.model_config.sai_no_buf;
+    uint16_t users = _sai_stream_users;
+    if (users & (1 << user))
+        return;
+    if (user != SAI_SND_USER && !(users & SAI_LEVEL_USERS))
+    {
+        osm_sai_bands_init(&_sai_bands);
+        osm_sai_bands_acc_clear(&_sai_bands_acc);
+        _sai_levels.valid = false;
+    }
+    _sai_stream_users = users | (1 << user);
+    if (!users)
+    {
+        _sai_dma_init();
+        _sai_dma_on();
+    }
 }
 
 
-static void _sai_set_no_buf(uint32_t new_no_buf)
+static void _sai_stream_stop(unsigned user)
 {
-    persist_data.model_config.sai_no_buf = new_no_buf;
+    _sai_stream_users &= ~(1 << user);
+    if (!_sai_stream_users)
+        _sai_dma_off();
 }
 
 
 static osm_measurements_sensor_state_t _sai_iteration_callback(char* name)
 {
-    if (_sai_sample.num_rms >= _sai_get_no_buf())
+    if (_sai_sample.count >= _sai_get_no_buf() * SAI_NO_BUF_SAMPLES)
         return OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS;
-
-    if (_sai_sample.finished)
-    {
-        _sai_sample.finished = false;
-        if (_sai_collect())
-        {
-            if (_sai_sample.num_rms >= _sai_get_no_buf())
-                return OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS;
-            _sai_dma_init();
-            _sai_dma_on();
-        }
-        else osm_sound_debug("Failed to collect.");
-    }
     return OSM_MEASUREMENTS_SENSOR_STATE_BUSY;
 }
 
@@ -613,33 +572,149 @@ static osm_measurements_sensor_state_t _sai_collection_time(char* name, uint32_t
 
 static osm_measurements_sensor_state_t _sai_measurements_init(char* name, bool in_isolation)
 {
-    _sai_dma_init();
-    _sai_dma_on();
+    nvic_disable_irq(NVIC_DMA2_CHANNEL1_IRQ);
+    _sai_sample.sum_squares = 0;
+    _sai_sample.count = 0;
+    nvic_enable_irq(NVIC_DMA2_CHANNEL1_IRQ);
+    _sai_stream_start(SAI_SND_USER);
     return OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS;
 }
 
 
 static osm_measurements_sensor_state_t _sai_measurements_get(char* name, osm_measurements_reading_t* value)
 {
-    _sai_dma_off();
-    if (_sai_sample.num_rms == 0)
+    _sai_stream_stop(SAI_SND_USER);
+    uint32_t num_samples = _sai_sample.count;
+    if (num_samples == 0)
     {
         osm_sound_debug("No samples computed.");
         return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
     }
-    uint32_t num_samples = _sai_sample.num_rms * SAI_ARRAY_SIZE;
-    uint32_t dB = _sai_conv_dB(_sai_sample.rolling_rms);
+    uint64_t rms = sqrt((double)_sai_sample.sum_squares / num_samples);
+    uint32_t dB = _sai_conv_dB(rms);
 
-    // Reset the rolling RMS
-    _sai_sample.num_rms = 0;
-
-    osm_sound_debug("Total RMS = %"PRIu64, _sai_sample.rolling_rms);
+    osm_sound_debug("Total RMS = %"PRIu64, rms);
     osm_sound_debug("%"PRIu32".%"PRIu32" dB from %"PRIu32" samples.", dB/10, dB%10, num_samples);
     value->v_f32 = osm_to_f32_from_float((float)dB / 10.f);
     return OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS;
 }
 
 
+static bool _sai_level_get_index(unsigned* index, char* name)
+{
+    for (unsigned i = 0; i < OSM_SAI_BANDS_LEVEL_COUNT; i++)
+    {
+        if (strncmp(name, _sai_level_names[i], OSM_MEASURE_NAME_LEN) == 0)
+        {
+            *index = i;
+            return true;
+        }
+    }
+    osm_sound_debug("Unknown sound level '%.*s'.", OSM_MEASURE_NAME_LEN, name);
+    return false;
+}
+
+
+static void _sai_level_enable(char* name, bool enabled)
+{
+    unsigned index;
+    if (!_sai_level_get_index(&index, name))
+        return;
+    if (enabled)
+        _sai_stream_start(index);
+    else
+        _sai_stream_stop(index);
+}
+
+
+static bool _sai_level_is_enabled(char* name)
+{
+    unsigned index;
+    if (!_sai_level_get_index(&index, name))
+        return false;
+    return _sai_stream_users & (1 << index);
+}
+
+
+static osm_measurements_sensor_state_t _sai_level_init(char* name, bool in_isolation)
+{
+    unsigned index;
+    if (!_sai_level_get_index(&index, name))
+        return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+    _sai_stream_start(index);
+    return OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS;
+}
+
+
+/* Whether this level can read the last take, not yet read by it and
+ * taken in this round of readings. */
+static bool _sai_level_has_take(unsigned index)
+{
+    return _sai_levels.valid &&
+           !(_sai_levels.taken & (1 << index)) &&
+           osm_since_boot_delta(osm_get_since_boot_ms(), _sai_levels.time) < SAI_LEVEL_SHARE_MS;
+}
+
+
+static osm_measurements_sensor_state_t _sai_level_iteration(char* name)
+{
+    unsigned index;
+    if (!_sai_level_get_index(&index, name))
+        return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+    if (_sai_level_has_take(index) || _sai_bands_acc.count >= OSM_SAI_BANDS_FAST_SAMPLES)
+        return OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS;
+    return OSM_MEASUREMENTS_SENSOR_STATE_BUSY;
+}
+
+
+/* The polynomial is only good over the range it was fitted, so bands,
+ * often well under it, are placed by their energy against the A
+ * weighted level. */
+static float _sai_level_dB(unsigned index)
+{
+    float* rms = _sai_levels.rms;
+    if (index < OSM_SAI_BANDS_LEVEL_BAND)
+        return _sai_conv_dB(rms[index] < 1.f ? 1 : rms[index]) / 10.f;
+    float ref = rms[OSM_SAI_BANDS_LEVEL_LAEQ];
+    if (ref < 1.f)
+        ref = 1.f;
+    float band = (rms[index] < 1e-3f) ? 1e-3f : rms[index];
+    return _sai_conv_dB(ref) / 10.f + 20.f * log10f(band / ref);
+}
+
+
+/* The first of a round of readings takes all the levels since the last
+ * round, and clears them for the next, the rest read that take. */
+static osm_measurements_sensor_state_t _sai_level_get(char* name, osm_measurements_reading_t* value)
+{
+    unsigned index;
+    if (!_sai_level_get_index(&index, name))
+        return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+    if (!_sai_level_has_take(index))
+    {
+        osm_sai_bands_acc_t acc;
+        nvic_disable_irq(NVIC_DMA2_CHANNEL1_IRQ);
+        acc = _sai_bands_acc;
+        osm_sai_bands_acc_clear(&_sai_bands_acc);
+        nvic_enable_irq(NVIC_DMA2_CHANNEL1_IRQ);
+        _sai_levels.valid = osm_sai_bands_get(&acc, _sai_levels.rms);
+        _sai_levels.taken = 0;
+        _sai_levels.time = osm_get_since_boot_ms();
+        if (!_sai_levels.valid)
+        {
+            osm_sound_debug("No filtered samples.");
+            return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+        }
+        osm_sound_debug("Levels from %"PRIu32" samples, %"PRIu32" fast.", acc.count, acc.fast_blocks);
+    }
+    _sai_levels.taken |= 1 << index;
+    float dB = _sai_level_dB(index);
+    osm_sound_debug("%s = %.1f dB", _sai_level_names[index], dB);
+    value->v_f32 = osm_to_f32_from_float(dB);
+    return OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS;
+}
+
+
 void osm_sai_print_coeffs(osm_cmd_ctx_t * ctx)
 {
     for (unsigned i = 0; i < OSM_SAI_NUM_CAL_COEFFS; i++)
@@ -674,6 +749,18 @@ void  osm_sai_inf_init(osm_measurements_inf_t* inf)
 }
 
 
+void  osm_sai_level_inf_init(osm_measurements_inf_t* inf)
+{
+    inf->collection_time_cb = _sai_collection_time;
+    inf->init_cb            = _sai_level_init;
+    inf->get_cb             = _sai_level_get;
+    inf->iteration_cb       = _sai_level_iteration;
+    inf->enable_cb          = _sai_level_enable;
+    inf->is_enabled_cb      = _sai_level_is_enabled;
+    inf->value_type_cb      = _sai_value_type;
+}
+
+
 static osm_command_response_t _sound_cal_cb(char* args, osm_cmd_ctx_t * ctx)
 {
     char* p;
@@ -24,6 +24,7 @@
 #include <osm/core/i2c.h>
 
 #include <osm/core/adcs.h>
+#include <osm/core/backlog.h>
 
 
 #define ADC_CCR_PRESCALE_1     0x0  /* 0b0000 */
@@ -113,7 +114,10 @@ static void _stm_setup_adc_dma(osm_adc_setup_config_t* config)
     dma_set_priority(DMA1, DMA_CHANNEL1, DMA_CCR_PL_LOW);
 
     dma_enable_transfer_complete_interrupt(DMA1, DMA_CHANNEL1);
-    dma_set_number_of_data(DMA1, DMA_CHANNEL1, OSM_ADCS_NUM_SAMPLES);
+#ifdef __ADC_CONTINUOUS__
+    dma_enable_half_transfer_interrupt(DMA1, DMA_CHANNEL1);
+#endif
+    dma_set_number_of_data(DMA1, DMA_CHANNEL1, OSM_ADCS_DMA_SAMPLES);
     dma_enable_circular_mode(DMA1, DMA_CHANNEL1);
     dma_set_read_from_peripheral(DMA1, DMA_CHANNEL1);
 
@@ -291,6 +295,39 @@ bool osm_platform_overwrite_fw_page(uintptr_t dst, unsigned abs_page, uint8_t* f
 }
 
 
+#ifdef FLASH_BACKLOG_PAGE
+unsigned osm_platform_backlog_flash_pages(void)
+{
+    return FLASH_BACKLOG_PAGES;
+}
+
+
+const uint8_t* osm_platform_backlog_flash_page(unsigned page)
+{
+    return (const uint8_t*)PAGE2ADDR(FLASH_BACKLOG_PAGE + page);
+}
+
+
+bool osm_platform_backlog_flash_erase(unsigned page)
+{
+    flash_unlock();
+    flash_erase_page(FLASH_BACKLOG_PAGE + page);
+    flash_lock();
+    return true;
+}
+
+
+bool osm_platform_backlog_flash_write(unsigned page, unsigned offset, const void * data, unsigned size)
+{
+    const uint8_t* dst = osm_platform_backlog_flash_page(page) + offset;
+    flash_unlock();
+    flash_set_data(dst, data, size);
+    flash_lock();
+    return memcmp(dst, data, size) == 0;
+}
+#endif //FLASH_BACKLOG_PAGE
+
+
 uintptr_t osm_platform_get_fw_addr(unsigned fw_page_index)
 {
     return (uintptr_t)(NEW_FW_ADDR + (fw_page_index * FLASH_PAGE_SIZE));
@@ -358,6 +395,12 @@ void osm_platform_adc_start_conversion_regular(void)
 }
 
 
+void osm_platform_adc_stop_conversion_regular(void)
+{
+    ADC_CR(ADC1) |= ADC_CR_ADSTP;
+}
+
+
 void osm_platform_adc_power_off(void)
 {
     adc_power_off(ADC1);
@@ -367,6 +410,11 @@ void osm_platform_adc_power_off(void)
 // cppcheck-suppress unusedFunction ; System handler
 void dma1_channel1_isr(void)  /* ADC1 dma interrupt */
 {
+    if (dma_get_interrupt_flag(DMA1, DMA_CHANNEL1, DMA_HTIF))
+    {
+        dma_clear_interrupt_flags(DMA1, DMA_CHANNEL1, DMA_HTIF);
+        osm_adcs_dma_half_complete();
+    }
     if (dma_get_interrupt_flag(DMA1, DMA_CHANNEL1, DMA_TCIF))
     {
         dma_clear_interrupt_flags(DMA1, DMA_CHANNEL1, DMA_TCIF);
@@ -407,6 +455,7 @@ void __attribute__((weak)) osm_model_main_loop_iterate(void) {}
 
 void osm_platform_main_loop_iterate(void)
 {
+    osm_i2cs_iterate();
     osm_model_main_loop_iterate();
 }
 
@@ -417,6 +466,30 @@ uint32_t osm_get_since_boot_ms(void)
 }
 
 
+/* The milliseconds and how far SysTick has counted down into the next.
+ * From an interrupt that holds off SysTick, a tick can be pending and not
+ * yet counted, so it is counted here. */
+uint64_t osm_get_since_boot_us(void)
+{
+    uint32_t ms, val;
+    bool pending;
+    do
+    {
+        ms = since_boot_ms;
+        val = systick_get_value();
+        pending = SCB_ICSR & SCB_ICSR_PENDSTSET;
+    } while (ms != since_boot_ms);
+    if (pending)
+    {
+        /* Read again, so it is after the reload. */
+        val = systick_get_value();
+        ms++;
+    }
+    uint32_t reload = systick_get_reload();
+    return (uint64_t)ms * 1000 + (uint64_t)(reload - val) * 1000 / (reload + 1);
+}
+
+
 // cppcheck-suppress unusedFunction ; System handler
 void sys_tick_handler(void)
 {
@@ -8,7 +8,7 @@ STM_SIZE = $(STM_TOOLCHAIN)-size
 STM_NM =$(STM_TOOLCHAIN)-nm
 
 #Target CPU options
-STM_DEFINES = -DSTM32L4
+STM_DEFINES = -DSTM32L4 -DOSM_UART_DMA_ZERO_COPY
 STM_CPU_DEFINES = -mthumb -mcpu=cortex-m4 -pedantic -mfloat-abi=hard -mfpu=fpv4-sp-d16
 
 #Compiler options
@@ -328,7 +328,12 @@ unsigned osm_uart_dma_out(unsigned uart, char *data, unsigned size)
     const osm_uart_channel_t * channel = &uart_channels[uart];
 
     if (!channel->enabled)
+    {
+#ifdef OSM_UART_DMA_ZERO_COPY
+        osm_uart_ring_out_dma_done(uart);
+#endif
         return size; /* Drop the data */
+    }
 
     if (!(USART_ISR(channel->usart) & USART_ISR_TXE))
         return 0;
@@ -338,6 +343,9 @@ unsigned osm_uart_dma_out(unsigned uart, char *data, unsigned size)
         if (uart)
             osm_uart_debug(uart, "single out.");
         usart_send(channel->usart, *data);
+#ifdef OSM_UART_DMA_ZERO_COPY
+        osm_uart_ring_out_dma_done(uart);
+#endif
         return true;
     }
 
@@ -378,6 +386,10 @@ static void process_complete_dma(unsigned index)
     {
         DMA_ISR(channel->dma_unit) |= DMA_IFCR_CTCIF(channel->dma_channel);
 
+#ifdef OSM_UART_DMA_ZERO_COPY
+        /* Release the ring bytes before the main loop can see TX empty. */
+        osm_uart_ring_out_dma_done(index);
+#endif
         uart_doing_dma[index] = false;
 
         dma_disable_transfer_complete_interrupt(channel->dma_unit, channel->dma_channel);
@@ -2,10 +2,15 @@
 #include <inttypes.h>
 
 #include <libopencm3/stm32/gpio.h>
+#include <libopencm3/stm32/timer.h>
+#include <libopencm3/stm32/rcc.h>
+#include <libopencm3/cm3/nvic.h>
 
 #include <osm/core/w1.h>
 
-#include <osm/core/timers.h>
+#include <osm/core/config.h>
+#include <osm/core/common.h>
+#include <osm/core/uart_rings.h>
 #include "pinmap.h"
 #include <osm/core/log.h>
 #include <osm/core/base_types.h>
@@ -29,6 +34,8 @@
 #define W1_LEVEL_LOW        (uint8_t)0
 #define W1_LEVEL_HIGH       (uint8_t)1
 
+#define W1_TRANSFER_TIMEOUT_MS  10
+
 
 typedef struct
 {
@@ -36,12 +43,35 @@ typedef struct
     unsigned        io;
 } w1_ios_t;
 
-static w1_ios_t _w1_ios[] = W1_IOS;
 
-static void _w1_start_interrupt(void) {}
+typedef enum
+{
+    W1_OP_RESET,
+    W1_OP_SEND,
+    W1_OP_READ,
+} w1_op_t;
+
+
+/* Slots are stepped by the compare interrupt of a free running 1MHz
+ * timer, each step sets the bus and returns how long until the next. */
+typedef struct
+{
+    volatile bool   busy;
+    uint8_t         index;
+    w1_op_t         op;
+    uint8_t         byte;
+    uint8_t         bits;
+    uint8_t         bit;
+    uint8_t         phase;
+    bool            ok;
+    osm_w1_cb_t     cb;
+    void*           userdata;
+} w1_transfer_t;
 
-static void _w1_stop_interrupt(void) {}
 
+static w1_ios_t _w1_ios[] = W1_IOS;
+static w1_transfer_t _w1_transfer = {0};
+static bool _w1_timer_ready = false;
 
 static bool _w1_check_index(uint8_t index)
 {
@@ -59,17 +89,9 @@ static bool _w1_check_index(uint8_t index)
 }
 
 
-static void _w1_delay_us(uint64_t delay)
-{
-    osm_timer_delay_us_64(delay);
-}
-
-
+/* Below here is also called from the interrupt, so no checks. */
 static void _w1_set_direction(uint8_t index, bool out)
 {
-    if (!_w1_check_index(index))
-        return;
-
     if (out)
     {
         gpio_mode_setup(_w1_ios[index].pnp.port, GPIO_MODE_OUTPUT, GPIO_PUPD_PULLUP, _w1_ios[index].pnp.pins);
@@ -83,9 +105,6 @@ static void _w1_set_direction(uint8_t index, bool out)
 
 static void _w1_set_level(uint8_t index, uint8_t bit)
 {
-    if (!_w1_check_index(index))
-        return;
-
     if (bit)
     {
         gpio_set(_w1_ios[index].pnp.port, _w1_ios[index].pnp.pins);
@@ -99,9 +118,6 @@ static void _w1_set_level(uint8_t index, uint8_t bit)
 
 static uint8_t _w1_get_level(uint8_t index)
 {
-    if (!_w1_check_index(index))
-        return 0;
-
     if (gpio_get(_w1_ios[index].pnp.port, _w1_ios[index].pnp.pins))
     {
         return W1_LEVEL_HIGH;
@@ -113,102 +129,270 @@ static uint8_t _w1_get_level(uint8_t index)
 }
 
 
-static uint8_t _w1_read_bit(uint8_t index)
+static uint16_t _w1_step_reset(w1_transfer_t* transfer)
 {
-    if (!_w1_check_index(index))
-        return 0;
-
-    _w1_start_interrupt();
-    _w1_set_direction(index, W1_DIRECTION_OUTPUT);
-    _w1_set_level(index, W1_LEVEL_LOW);
-    _w1_delay_us(W1_DELAY_READ_START);
-    _w1_set_direction(index, W1_DIRECTION_INPUT);
-    _w1_delay_us(W1_DELAY_READ_WAIT);
-    uint8_t out = _w1_get_level(index);
-    _w1_delay_us(W1_DELAY_READ_RELEASE);
-    _w1_stop_interrupt();
-    return out;
+    uint8_t index = transfer->index;
+    switch (transfer->phase++)
+    {
+        case 0:
+            _w1_set_direction(index, W1_DIRECTION_OUTPUT);
+            _w1_set_level(index, W1_LEVEL_LOW);
+            return W1_DELAY_RESET_SET;
+        case 1:
+            _w1_set_direction(index, W1_DIRECTION_INPUT);
+            return W1_DELAY_RESET_WAIT;
+        case 2:
+            /* Nothing pulling the bus low, so no presence. */
+            if (_w1_get_level(index) == W1_LEVEL_HIGH)
+                return 0;
+            return W1_DELAY_RESET_READ;
+        default:
+            transfer->ok = (_w1_get_level(index) == W1_LEVEL_HIGH);
+            return 0;
+    }
 }
 
 
-static void _w1_send_bit(uint8_t index, int bit)
+static uint16_t _w1_step_send(w1_transfer_t* transfer)
 {
-    if (!_w1_check_index(index))
-        return;
-
-    _w1_start_interrupt();
-    if (bit)
+    uint8_t index = transfer->index;
+    if (transfer->bit >= transfer->bits)
     {
-        _w1_set_level(index, W1_LEVEL_LOW);
-        _w1_delay_us(W1_DELAY_WRITE_1_START);
-        _w1_set_level(index, W1_LEVEL_HIGH);
-        _w1_delay_us(W1_DELAY_WRITE_1_END);
+        _w1_set_direction(index, W1_DIRECTION_INPUT);
+        transfer->ok = true;
+        return 0;
     }
-    else
+    bool bit = transfer->byte & (1 << transfer->bit);
+    if (!transfer->phase)
     {
+        transfer->phase = 1;
+        _w1_set_direction(index, W1_DIRECTION_OUTPUT);
         _w1_set_level(index, W1_LEVEL_LOW);
-        _w1_delay_us(W1_DELAY_WRITE_0_START);
-        _w1_set_level(index, W1_LEVEL_HIGH);
-        _w1_delay_us(W1_DELAY_WRITE_0_END);
+        return bit ? W1_DELAY_WRITE_1_START : W1_DELAY_WRITE_0_START;
     }
-    _w1_stop_interrupt();
+    transfer->phase = 0;
+    transfer->bit++;
+    _w1_set_level(index, W1_LEVEL_HIGH);
+    return bit ? W1_DELAY_WRITE_1_END : W1_DELAY_WRITE_0_END;
 }
 
 
-bool osm_w1_reset(uint8_t index)
+static uint16_t _w1_step_read(w1_transfer_t* transfer)
 {
-    if (!_w1_check_index(index))
+    uint8_t index = transfer->index;
+    if (transfer->bit >= transfer->bits)
+    {
+        transfer->ok = true;
         return 0;
+    }
+    switch (transfer->phase++)
+    {
+        case 0:
+            _w1_set_direction(index, W1_DIRECTION_OUTPUT);
+            _w1_set_level(index, W1_LEVEL_LOW);
+            return W1_DELAY_READ_START;
+        case 1:
+            _w1_set_direction(index, W1_DIRECTION_INPUT);
+            return W1_DELAY_READ_WAIT;
+        default:
+            if (_w1_get_level(index) == W1_LEVEL_HIGH)
+                transfer->byte |= (1 << transfer->bit);
+            transfer->bit++;
+            transfer->phase = 0;
+            return W1_DELAY_READ_RELEASE;
+    }
+}
 
 
-    _w1_set_direction(index, W1_DIRECTION_OUTPUT);
-    _w1_set_level(index, W1_LEVEL_LOW);
-    _w1_delay_us(W1_DELAY_RESET_SET);
-    _w1_set_direction(index, W1_DIRECTION_INPUT);
-    _w1_delay_us(W1_DELAY_RESET_WAIT);
-    if (_w1_get_level(index) == W1_LEVEL_HIGH)
+static uint16_t _w1_step(w1_transfer_t* transfer)
+{
+    switch (transfer->op)
     {
-        return false;
+        case W1_OP_RESET:   return _w1_step_reset(transfer);
+        case W1_OP_SEND:    return _w1_step_send(transfer);
+        case W1_OP_READ:    return _w1_step_read(transfer);
     }
-    _w1_delay_us(W1_DELAY_RESET_READ);
-    return (_w1_get_level(index) == W1_LEVEL_HIGH);
+    return 0;
 }
 
 
-uint8_t osm_w1_read_byte(uint8_t index)
+static void _w1_finish(w1_transfer_t* transfer)
 {
-    if (!_w1_check_index(index))
-        return 0;
+    timer_disable_irq(OSM_W1_TIM, TIM_DIER_CC1IE);
+    timer_disable_counter(OSM_W1_TIM);
+    osm_w1_cb_t cb = transfer->cb;
+    transfer->busy = false;
+    if (cb)
+        cb(transfer->index, transfer->ok, transfer->byte, transfer->userdata);
+}
 
-    uint8_t val = 0;
-    for (uint8_t i = 0; i < 8; i++)
+
+void osm_w1_tim_isr(void)
+{
+    if (!timer_get_flag(OSM_W1_TIM, TIM_SR_CC1IF))
+        return;
+    timer_clear_flag(OSM_W1_TIM, TIM_SR_CC1IF);
+    if (!_w1_transfer.busy)
+        return;
+    uint16_t delay = _w1_step(&_w1_transfer);
+    if (!delay)
     {
-        val = val + (_w1_read_bit(index) << i);
+        _w1_finish(&_w1_transfer);
+        return;
     }
-    return val;
+    /* From the last compare, not now, so latency doesn't add up. */
+    uint16_t target = TIM_CCR1(OSM_W1_TIM) + delay;
+    uint16_t now = TIM_CNT(OSM_W1_TIM);
+    /* Held off past it, don't wait for the counter to wrap round to it. */
+    if ((int16_t)(target - now) <= 0)
+        target = now + 1;
+    timer_set_oc_value(OSM_W1_TIM, TIM_OC1, target);
 }
 
 
-void osm_w1_send_byte(uint8_t index, uint8_t byte)
+static void _w1_timer_init(void)
 {
-    if (!_w1_check_index(index))
+    if (_w1_timer_ready)
         return;
+    rcc_periph_clock_enable(OSM_W1_RCC_TIM);
+    rcc_periph_reset_pulse(OSM_W1_RST_TIM);
+    timer_disable_counter(OSM_W1_TIM);
+    timer_set_mode(OSM_W1_TIM,
+                   TIM_CR1_CKD_CK_INT,
+                   TIM_CR1_CMS_EDGE,
+                   TIM_CR1_DIR_UP);
+    timer_set_prescaler(OSM_W1_TIM, rcc_apb2_frequency / 1000000 - 1);
+    timer_set_period(OSM_W1_TIM, UINT16_MAX);
+    timer_continuous_mode(OSM_W1_TIM);
+    nvic_set_priority(OSM_W1_TIM_IRQ, OSM_W1_PRIORITY);
+    nvic_enable_irq(OSM_W1_TIM_IRQ);
+    _w1_timer_ready = true;
+}
+
 
-    _w1_set_direction(index, W1_DIRECTION_OUTPUT);
-    for (uint8_t i = 0; i < 8; i++)
+static bool _w1_start(uint8_t index, w1_op_t op, uint8_t byte, uint8_t bits, osm_w1_cb_t cb, void* userdata)
+{
+    if (!_w1_check_index(index))
+        return false;
+    if (_w1_transfer.busy)
     {
-        if (byte & (1 << i))
-        {
-            _w1_send_bit(index, W1_LEVEL_HIGH);
-        }
-        else
+        osm_log_error("W1 transfer already in progress.");
+        return false;
+    }
+    _w1_timer_init();
+
+    w1_transfer_t* transfer = &_w1_transfer;
+    transfer->index     = index;
+    transfer->op        = op;
+    transfer->byte      = (op == W1_OP_SEND) ? byte : 0;
+    transfer->bits      = bits;
+    transfer->bit       = 0;
+    transfer->phase     = 0;
+    transfer->ok        = false;
+    transfer->cb        = cb;
+    transfer->userdata  = userdata;
+    transfer->busy      = true;
+
+    uint16_t delay = _w1_step(transfer);
+    timer_set_counter(OSM_W1_TIM, 0);
+    timer_set_oc_value(OSM_W1_TIM, TIM_OC1, delay);
+    timer_clear_flag(OSM_W1_TIM, TIM_SR_CC1IF);
+    timer_enable_irq(OSM_W1_TIM, TIM_DIER_CC1IE);
+    timer_enable_counter(OSM_W1_TIM);
+    return true;
+}
+
+
+bool osm_w1_reset_async(uint8_t index, osm_w1_cb_t cb, void* userdata)
+{
+    return _w1_start(index, W1_OP_RESET, 0, 0, cb, userdata);
+}
+
+
+bool osm_w1_send_byte_async(uint8_t index, uint8_t byte, osm_w1_cb_t cb, void* userdata)
+{
+    return _w1_start(index, W1_OP_SEND, byte, 8, cb, userdata);
+}
+
+
+bool osm_w1_read_byte_async(uint8_t index, osm_w1_cb_t cb, void* userdata)
+{
+    return _w1_start(index, W1_OP_READ, 0, 8, cb, userdata);
+}
+
+
+bool osm_w1_busy(void)
+{
+    return _w1_transfer.busy;
+}
+
+
+/* The blocking calls wait out a transfer with interrupts still on, so
+ * the UARTs keep being serviced between slots. */
+static bool _w1_wait(uint8_t* byte)
+{
+    uint32_t start_ms = osm_get_since_boot_ms();
+    while (_w1_transfer.busy)
+    {
+        if (osm_since_boot_delta(osm_get_since_boot_ms(), start_ms) > W1_TRANSFER_TIMEOUT_MS)
         {
-            _w1_send_bit(index, W1_LEVEL_LOW);
+            osm_log_error("W1 transfer timed out.");
+            _w1_set_direction(_w1_transfer.index, W1_DIRECTION_INPUT);
+            _w1_transfer.ok = false;
+            _w1_transfer.cb = NULL;
+            _w1_finish(&_w1_transfer);
+            return false;
         }
+        osm_uart_rings_out_drain();
     }
-    _w1_set_direction(index, W1_DIRECTION_INPUT);
+    if (byte)
+        *byte = _w1_transfer.byte;
+    return _w1_transfer.ok;
 }
 
+
+bool osm_w1_reset(uint8_t index)
+{
+    if (!_w1_start(index, W1_OP_RESET, 0, 0, NULL, NULL))
+        return false;
+    return _w1_wait(NULL);
+}
+
+
+uint8_t osm_w1_read_byte(uint8_t index)
+{
+    uint8_t byte = 0;
+    if (!_w1_start(index, W1_OP_READ, 0, 8, NULL, NULL))
+        return 0;
+    _w1_wait(&byte);
+    return byte;
+}
+
+
+void osm_w1_send_byte(uint8_t index, uint8_t byte)
+{
+    if (_w1_start(index, W1_OP_SEND, byte, 8, NULL, NULL))
+        _w1_wait(NULL);
+}
+
+
+bool osm_w1_read_bit(uint8_t index)
+{
+    uint8_t byte = 0;
+    if (!_w1_start(index, W1_OP_READ, 0, 1, NULL, NULL))
+        return false;
+    _w1_wait(&byte);
+    return byte & 1;
+}
+
+
+void osm_w1_send_bit(uint8_t index, bool bit)
+{
+    if (_w1_start(index, W1_OP_SEND, bit ? 1 : 0, 1, NULL, NULL))
+        _w1_wait(NULL);
+}
+
+
 void osm_w1_init(uint8_t index)
 {
     if (index >= OSM_ARRAY_SIZE(_w1_ios))
@@ -5,6 +5,8 @@
 
 #include <osm/core/log.h>
 #include <osm/core/measurements.h>
+#include <osm/core/backlog.h>
+#include <osm/protocols/protocol.h>
 #include <osm/comms/comms.h>
 #include "platform_model.h"
 
@@ -12,6 +14,13 @@ static int8_t                       _measurements_hex_arr[OSM_PROTOCOL_HEX_ARRAY
 
 #define PROTOCOL_SEND_STR_LEN               8
 #define PROTOCOL_ERR_CODE_NAME                  "ERR"
+#define PROTOCOL_AGE_NAME                       "AGE"
+#define PROTOCOL_INTERVAL_NAME                  "IOFF"
+#define PROTOCOL_IO_EVENTS_NAME                 "IOEV"
+#define PROTOCOL_IO_EVENTS_LEVEL                0x8000
+#define PROTOCOL_IO_EVENTS_DELTA_MAX            0x7FFF
+/* Name, datatype, type and up to a uint32 age. */
+#define PROTOCOL_AGE_SIZE                       10
 
 
 #define PROTOCOL_SEND_IS_SIGNED             0x10
@@ -86,30 +95,6 @@ static bool _protocol_append_i64(int64_t val)
 }
 
 
-static bool _protocol_append_float(int32_t val)
-{
-    return _protocol_append_i32(val);
-}
-
-
-static bool _protocol_append_str(char* val, unsigned len)
-{
-    if (len > PROTOCOL_SEND_STR_LEN)
-        len = PROTOCOL_SEND_STR_LEN;
-    for (unsigned i = 0; i < len; i++)
-    {
-        if (!_protocol_append_i8((int8_t)(val[i])))
-            return false;
-    }
-    for (unsigned i = len; i < PROTOCOL_SEND_STR_LEN; i++)
-    {
-        if (!_protocol_append_i8((int8_t)0))
-            return false;
-    }
-    return true;
-}
-
-
 static bool _protocol_append_data_type_i64(int64_t* value)
 {
     protocol_send_type_t compressed_type;
@@ -171,6 +156,31 @@ static bool _protocol_append_data_type_i64(int64_t* value)
 }
 
 
+#ifndef OSM_PROTOCOL_HEXBLOB_COMPACT
+static bool _protocol_append_float(int32_t val)
+{
+    return _protocol_append_i32(val);
+}
+
+
+static bool _protocol_append_str(char* val, unsigned len)
+{
+    if (len > PROTOCOL_SEND_STR_LEN)
+        len = PROTOCOL_SEND_STR_LEN;
+    for (unsigned i = 0; i < len; i++)
+    {
+        if (!_protocol_append_i8((int8_t)(val[i])))
+            return false;
+    }
+    for (unsigned i = len; i < PROTOCOL_SEND_STR_LEN; i++)
+    {
+        if (!_protocol_append_i8((int8_t)0))
+            return false;
+    }
+    return true;
+}
+
+
 static bool _protocol_append_data_type_str(char* value)
 {
     if (!_protocol_append_i8(PROTOCOL_SEND_TYPE_STR))
@@ -188,7 +198,7 @@ static bool _protocol_append_data_type_float(int32_t* value)
 }
 
 
-static bool _protocol_append_value_type_i64(osm_measurements_data_t* data, bool single)
+static bool _protocol_append_value_type_i64(osm_measurements_data_t* data, bool single, osm_measurements_stats_t* stats)
 {
     if (single)
         return _protocol_append_data_type_i64(&data->value.value_64.sum);
@@ -197,6 +207,12 @@ static bool _protocol_append_value_type_i64(osm_measurements_data_t* data, bool
     r |= !_protocol_append_data_type_i64(&mean);
     r |= !_protocol_append_data_type_i64(&data->value.value_64.min);
     r |= !_protocol_append_data_type_i64(&data->value.value_64.max);
+    if (stats)
+    {
+        r |= !_protocol_append_data_type_i64(&stats->stddev);
+        r |= !_protocol_append_data_type_i64(&stats->p50);
+        r |= !_protocol_append_data_type_i64(&stats->p95);
+    }
     return !r;
 }
 
@@ -207,7 +223,7 @@ static bool _protocol_append_value_type_str(osm_measurements_data_t* data)
 }
 
 
-static bool _protocol_append_value_type_float(osm_measurements_data_t* data, bool single)
+static bool _protocol_append_value_type_float(osm_measurements_data_t* data, bool single, osm_measurements_stats_t* stats)
 {
     if (single)
         return _protocol_append_data_type_float(&data->value.value_f.sum);
@@ -216,37 +232,326 @@ static bool _protocol_append_value_type_float(osm_measurements_data_t* data, boo
     r |= !_protocol_append_data_type_float(&mean);
     r |= !_protocol_append_data_type_float(&data->value.value_f.min);
     r |= !_protocol_append_data_type_float(&data->value.value_f.max);
+    if (stats)
+    {
+        int32_t stddev = stats->stddev;
+        int32_t p50    = stats->p50;
+        int32_t p95    = stats->p95;
+        r |= !_protocol_append_data_type_float(&stddev);
+        r |= !_protocol_append_data_type_float(&p50);
+        r |= !_protocol_append_data_type_float(&p95);
+    }
     return !r;
 }
 
 
-bool osm_protocol_append_measurement(osm_measurements_def_t* def, osm_measurements_data_t* data)
+#else
+/* Compact version: measurements are referred to by an index, defined
+ * inline until a payload carrying the definition is acked. Values are
+ * zigzag varints, sent as deltas against the last acked value. */
+#define PROTOCOL_COMPACT_FORM_SINGLE        0
+#define PROTOCOL_COMPACT_FORM_AVERAGED      1
+#define PROTOCOL_COMPACT_FORM_STR           2
+#define PROTOCOL_COMPACT_FORM_SYS           3
+#define PROTOCOL_COMPACT_DELTA              0x4
+#define PROTOCOL_COMPACT_FLOAT              0x8
+#define PROTOCOL_COMPACT_INDEX_SHIFT        4
+
+#define PROTOCOL_COMPACT_SYS_AGE            0
+#define PROTOCOL_COMPACT_SYS_DEFINE         1
+#define PROTOCOL_COMPACT_SYS_STATS          2
+#define PROTOCOL_COMPACT_SYS_INTERVAL       3
+#define PROTOCOL_COMPACT_SYS_IO_EVENTS      4
+
+/* Absolute values this often, so a decoder that lost its state recovers. */
+#define PROTOCOL_COMPACT_KEYFRAME           16
+
+/* Sequence of backlog records, which decode alone, whenever they are sent.
+ * Each value is absolute, after its own definition of this index. */
+#define PROTOCOL_COMPACT_BACKLOG_SEQ        0
+#define PROTOCOL_COMPACT_BACKLOG_INDEX      0
+
+
+typedef struct
+{
+    uint32_t key;
+    int64_t  value;
+    uint8_t  seq;
+    uint8_t  define_seq;
+    uint8_t  sends;
+    uint8_t  has_value:1;
+    uint8_t  is_float:1;
+    uint8_t  acked:1;
+    uint8_t  define_sent:1;
+    uint8_t  define_acked:1;
+} protocol_compact_slot_t;
+
+
+static struct
+{
+    protocol_compact_slot_t slots[OSM_PROTOCOL_COMPACT_SLOTS];
+    unsigned                next_evict;
+    uint8_t                 seq;
+    uint8_t                 payload_seq;    /* Of the payload being encoded */
+    uint8_t                 inflight_seq;
+    bool                    inflight;
+    bool                    backlog;        /* Encoding a backlog record */
+} _protocol_compact = {0};
+
+
+static bool _protocol_append_varint(uint64_t val)
+{
+    do
+    {
+        uint8_t b = val & 0x7F;
+        val >>= 7;
+        if (val)
+            b |= 0x80;
+        if (!_protocol_append_i8(*(int8_t*)&b))
+            return false;
+    }
+    while (val);
+    return true;
+}
+
+
+static bool _protocol_append_zigzag(int64_t val)
+{
+    return _protocol_append_varint(((uint64_t)val << 1) ^ (uint64_t)(val >> 63));
+}
+
+
+static protocol_compact_slot_t* _protocol_compact_get_slot(uint32_t key, unsigned* index)
+{
+    unsigned n;
+    for (n = 0; n < OSM_PROTOCOL_COMPACT_SLOTS; n++)
+    {
+        if (_protocol_compact.slots[n].key == key)
+        {
+            *index = n;
+            return &_protocol_compact.slots[n];
+        }
+    }
+    for (n = 0; n < OSM_PROTOCOL_COMPACT_SLOTS; n++)
+    {
+        if (!_protocol_compact.slots[n].key)
+            break;
+    }
+    if (n == OSM_PROTOCOL_COMPACT_SLOTS)
+    {
+        /* More measurements than slots, reuse round robin, redefining. */
+        n = _protocol_compact.next_evict;
+        _protocol_compact.next_evict = (n + 1) % OSM_PROTOCOL_COMPACT_SLOTS;
+    }
+    protocol_compact_slot_t* slot = &_protocol_compact.slots[n];
+    memset(slot, 0, sizeof(protocol_compact_slot_t));
+    slot->key = key;
+    *index = n;
+    return slot;
+}
+
+
+static bool _protocol_compact_append_sys(unsigned sys)
 {
+    return _protocol_append_varint((sys << PROTOCOL_COMPACT_INDEX_SHIFT) | PROTOCOL_COMPACT_FORM_SYS);
+}
+
+
+static bool _protocol_compact_append_measurement(osm_measurements_def_t* def, osm_measurements_data_t* data)
+{
+    uint32_t key = osm_measurements_name_key(def->name);
+    unsigned index = PROTOCOL_COMPACT_BACKLOG_INDEX;
+    protocol_compact_slot_t* slot = NULL;
     bool single = def->samplecount == 1;
+    bool r = false;
+    bool define = true;
+
+    /* Backlog records may be sent long after, so don't use the live slots. */
+    if (!_protocol_compact.backlog)
+    {
+        slot = _protocol_compact_get_slot(key, &index);
+        /* A batch can hold the index more than once, defined the first time. */
+        bool in_payload = slot->define_sent && slot->define_seq == _protocol_compact.payload_seq;
+        define = !slot->define_acked && !in_payload;
+    }
+    if (define)
+    {
+        r |= !_protocol_compact_append_sys(PROTOCOL_COMPACT_SYS_DEFINE);
+        r |= !_protocol_append_varint(index);
+        r |= !_protocol_append_i32((int32_t)key);
+    }
+
+    unsigned header = index << PROTOCOL_COMPACT_INDEX_SHIFT;
+    bool is_float = false;
+    int64_t sum, min, max, mean = 0;
+
+    switch(data->value_type)
+    {
+        case OSM_MEASUREMENTS_VALUE_TYPE_STR:
+        {
+            uint8_t len = strnlen(data->value.value_s.str, OSM_MEASUREMENTS_VALUE_STR_LEN);
+            r |= !_protocol_append_varint(header | PROTOCOL_COMPACT_FORM_STR);
+            r |= !_protocol_append_i8(len);
+            for (unsigned n = 0; n < len; n++)
+                r |= !_protocol_append_i8((int8_t)data->value.value_s.str[n]);
+            break;
+        }
+        case OSM_MEASUREMENTS_VALUE_TYPE_FLOAT:
+            is_float = true;
+            sum = data->value.value_f.sum;
+            min = data->value.value_f.min;
+            max = data->value.value_f.max;
+            /* fall through */
+        case OSM_MEASUREMENTS_VALUE_TYPE_I64:
+        {
+            if (!is_float)
+            {
+                sum = data->value.value_64.sum;
+                min = data->value.value_64.min;
+                max = data->value.value_64.max;
+            }
+            mean = single ? sum : sum / data->num_samples;
+            bool delta = slot && slot->has_value &&
+                         (slot->acked || slot->seq == _protocol_compact.payload_seq) &&
+                         slot->is_float == is_float &&
+                         (slot->sends % PROTOCOL_COMPACT_KEYFRAME);
+            header |= single ? PROTOCOL_COMPACT_FORM_SINGLE : PROTOCOL_COMPACT_FORM_AVERAGED;
+            if (delta)
+                header |= PROTOCOL_COMPACT_DELTA;
+            if (is_float)
+                header |= PROTOCOL_COMPACT_FLOAT;
+            r |= !_protocol_append_varint(header);
+            r |= !_protocol_append_zigzag(delta ? mean - slot->value : mean);
+            if (!single)
+            {
+                r |= !_protocol_append_zigzag(mean - min);
+                r |= !_protocol_append_zigzag(max - mean);
+            }
+            osm_measurements_stats_t stats;
+            if (!single && osm_measurements_get_stats(data, &stats))
+            {
+                r |= !_protocol_compact_append_sys(PROTOCOL_COMPACT_SYS_STATS);
+                r |= !_protocol_append_varint(index);
+                r |= !_protocol_append_zigzag(stats.stddev);
+                r |= !_protocol_append_zigzag(stats.p50 - mean);
+                r |= !_protocol_append_zigzag(stats.p95 - mean);
+            }
+            break;
+        }
+        default:
+            osm_log_error("Unknown type '%"PRIu8"'.", data->value_type);
+            r = true;
+            break;
+    }
+    if (r)
+        return false;
+    if (!slot)
+        return true;
 
+    /* Only once it is in the payload, so a failed append changes nothing. */
+    if (define)
+    {
+        slot->define_seq = _protocol_compact.payload_seq;
+        slot->define_sent = 1;
+    }
+    if (data->value_type != OSM_MEASUREMENTS_VALUE_TYPE_STR)
+    {
+        slot->value = mean;
+        slot->seq = _protocol_compact.payload_seq;
+        slot->is_float = is_float;
+        slot->has_value = 1;
+        slot->acked = 0;
+        slot->sends++;
+    }
+    return true;
+}
+
+
+static bool _protocol_compact_append_age(uint32_t age_secs)
+{
+    unsigned before_pos = _protocol_ctx.pos;
+    if (_protocol_compact_append_sys(PROTOCOL_COMPACT_SYS_AGE) &&
+        _protocol_append_varint(age_secs))
+        return true;
+    _protocol_ctx.pos = before_pos;
+    return false;
+}
+
+
+static bool _protocol_compact_append_interval(uint32_t offset_secs)
+{
+    unsigned before_pos = _protocol_ctx.pos;
+    if (_protocol_compact_append_sys(PROTOCOL_COMPACT_SYS_INTERVAL) &&
+        _protocol_append_varint(offset_secs))
+        return true;
+    _protocol_ctx.pos = before_pos;
+    return false;
+}
+
+
+static bool _protocol_compact_append_io_events(const osm_io_event_t* events, unsigned count, uint32_t dropped, uint32_t now_ms)
+{
+    bool r = false;
+    r |= !_protocol_compact_append_sys(PROTOCOL_COMPACT_SYS_IO_EVENTS);
+    r |= !_protocol_append_varint(count);
+    r |= !_protocol_append_varint(dropped);
+    r |= !_protocol_append_varint(now_ms - events[0].ms);
+    for (unsigned n = 0; n < count; n++)
+    {
+        uint32_t delta = n ? events[n].ms - events[n - 1].ms : 0;
+        r |= !_protocol_append_varint(events[n].io);
+        r |= !_protocol_append_varint(((uint64_t)delta << 1) | (events[n].level ? 1 : 0));
+    }
+    return !r;
+}
+
+
+static void _protocol_compact_sending(const int8_t* buf, unsigned len)
+{
+    if (len < 2 || (uint8_t)buf[0] != OSM_MEASUREMENTS_PAYLOAD_COMPACT_VERSION)
+        return;
+    /* A backlog record's ack says nothing of the live slots. */
+    _protocol_compact.inflight_seq = buf[1];
+    _protocol_compact.inflight = (uint8_t)buf[1] != PROTOCOL_COMPACT_BACKLOG_SEQ;
+}
+#endif //OSM_PROTOCOL_HEXBLOB_COMPACT
+
+
+bool osm_protocol_append_measurement(osm_measurements_def_t* def, osm_measurements_data_t* data)
+{
     unsigned before_pos = _protocol_ctx.pos;
 
     bool r = 0;
+#ifdef OSM_PROTOCOL_HEXBLOB_COMPACT
+    r |= !_protocol_compact_append_measurement(def, data);
+#else
+    bool single = def->samplecount == 1;
+    osm_measurements_stats_t stats;
+    bool has_stats = !single && osm_measurements_get_stats(data, &stats);
+
     r |= !_protocol_append_i32(*(int32_t*)def->name);
     uint8_t datatype = single ? OSM_MEASUREMENTS_DATATYPE_SINGLE : OSM_MEASUREMENTS_DATATYPE_AVERAGED;
+    if (has_stats)
+        datatype = OSM_MEASUREMENTS_DATATYPE_STATS;
     r |= !_protocol_append_i8(datatype);
 
     switch(data->value_type)
     {
         case OSM_MEASUREMENTS_VALUE_TYPE_I64:
-            r |= !_protocol_append_value_type_i64(data, single);
+            r |= !_protocol_append_value_type_i64(data, single, has_stats ? &stats : NULL);
             break;
         case OSM_MEASUREMENTS_VALUE_TYPE_STR:
             r |= !_protocol_append_value_type_str(data);
             break;
         case OSM_MEASUREMENTS_VALUE_TYPE_FLOAT:
-            r |= !_protocol_append_value_type_float(data, single);
+            r |= !_protocol_append_value_type_float(data, single, has_stats ? &stats : NULL);
             break;
         default:
             osm_log_error("Unknown type '%"PRIu8"'.", data->value_type);
             r = true;
             break;
     }
+#endif
     if (r)
     {
         _protocol_ctx.pos = before_pos;
@@ -255,16 +560,16 @@ bool osm_protocol_append_measurement(osm_measurements_def_t* def, osm_measuremen
 }
 
 
-static bool _protocol_append_error_code(uint8_t err_code)
+static bool _protocol_append_single_i64(const char* name_str, int64_t value)
 {
     unsigned before_pos = _protocol_ctx.pos;
 
     bool r = false;
-    char name[OSM_MEASURE_NAME_NULLED_LEN] = PROTOCOL_ERR_CODE_NAME;
+    char name[OSM_MEASURE_NAME_NULLED_LEN] = {0};
+    strncpy(name, name_str, OSM_MEASURE_NAME_LEN);
     r |= !_protocol_append_i32(*(int32_t*)name);
     r |= !_protocol_append_i8(OSM_MEASUREMENTS_DATATYPE_SINGLE);
-    int64_t err_code64 = err_code;
-    r |= !_protocol_append_data_type_i64(&err_code64);
+    r |= !_protocol_append_data_type_i64(&value);
     if (r)
     {
         _protocol_ctx.pos = before_pos;
@@ -273,7 +578,56 @@ static bool _protocol_append_error_code(uint8_t err_code)
 }
 
 
-static bool _protocol_init(int8_t* buf, unsigned buflen)
+#ifndef OSM_PROTOCOL_HEXBLOB_COMPACT
+/* Each edge is its IO, then its level in the top bit of the milliseconds
+ * since the one before. */
+static bool _protocol_append_io_events(const osm_io_event_t* events, unsigned count, uint32_t dropped, uint32_t now_ms)
+{
+    bool r = false;
+    char name[OSM_MEASURE_NAME_NULLED_LEN] = PROTOCOL_IO_EVENTS_NAME;
+    r |= !_protocol_append_i32(*(int32_t*)name);
+    r |= !_protocol_append_i8(OSM_MEASUREMENTS_DATATYPE_EVENTS);
+    r |= !_protocol_append_i8((int8_t)OSM_MIN(count, UINT8_MAX));
+    r |= !_protocol_append_i16((int16_t)OSM_MIN(dropped, UINT16_MAX));
+    r |= !_protocol_append_i32((int32_t)(now_ms - events[0].ms));
+    for (unsigned n = 0; n < count && n < UINT8_MAX; n++)
+    {
+        uint32_t delta = n ? events[n].ms - events[n - 1].ms : 0;
+        uint16_t edge = OSM_MIN(delta, PROTOCOL_IO_EVENTS_DELTA_MAX);
+        if (events[n].level)
+            edge |= PROTOCOL_IO_EVENTS_LEVEL;
+        r |= !_protocol_append_i8((int8_t)events[n].io);
+        r |= !_protocol_append_i16((int16_t)edge);
+    }
+    return !r;
+}
+#endif //OSM_PROTOCOL_HEXBLOB_COMPACT
+
+
+bool osm_protocol_append_io_events(const osm_io_event_t* events, unsigned count, uint32_t dropped, uint32_t now_ms)
+{
+    if (!count)
+        return false;
+    unsigned before_pos = _protocol_ctx.pos;
+    bool r;
+#ifdef OSM_PROTOCOL_HEXBLOB_COMPACT
+    r = _protocol_compact_append_io_events(events, count, dropped, now_ms);
+#else
+    r = _protocol_append_io_events(events, count, dropped, now_ms);
+#endif
+    if (!r)
+        _protocol_ctx.pos = before_pos;
+    return r;
+}
+
+
+static bool _protocol_append_error_code(uint8_t err_code)
+{
+    return _protocol_append_single_i64(PROTOCOL_ERR_CODE_NAME, err_code);
+}
+
+
+static bool _protocol_init(int8_t* buf, unsigned buflen, uint8_t version)
 {
     memset(buf, 0, buflen);
 
@@ -282,7 +636,7 @@ static bool _protocol_init(int8_t* buf, unsigned buflen)
     _protocol_ctx.pos = 0;
 
     memset(_protocol_ctx.buf, 0, _protocol_ctx.buflen);
-    if (!_protocol_append_i8((int8_t)OSM_MEASUREMENTS_PAYLOAD_VERSION))
+    if (!_protocol_append_i8((int8_t)version))
     {
         osm_log_error("Failed to add even version to measurem     ents hex array.");
         return false;
@@ -291,9 +645,31 @@ static bool _protocol_init(int8_t* buf, unsigned buflen)
 }
 
 
+static bool _protocol_init_measurements(unsigned buflen, bool backlog)
+{
+#ifdef OSM_PROTOCOL_HEXBLOB_COMPACT
+    _protocol_compact.backlog = backlog;
+    if (backlog)
+    {
+        _protocol_compact.payload_seq = PROTOCOL_COMPACT_BACKLOG_SEQ;
+    }
+    else
+    {
+        if (++_protocol_compact.seq == PROTOCOL_COMPACT_BACKLOG_SEQ)
+            _protocol_compact.seq++;
+        _protocol_compact.payload_seq = _protocol_compact.seq;
+    }
+    return _protocol_init(_measurements_hex_arr, buflen, OSM_MEASUREMENTS_PAYLOAD_COMPACT_VERSION) &&
+           _protocol_append_i8((int8_t)_protocol_compact.payload_seq);
+#else
+    return _protocol_init(_measurements_hex_arr, buflen, OSM_MEASUREMENTS_PAYLOAD_VERSION);
+#endif
+}
+
+
 bool osm_protocol_init(void)
 {
-    return _protocol_init(_measurements_hex_arr, OSM_PROTOCOL_HEX_ARRAY_SIZE);
+    return _protocol_init_measurements(OSM_PROTOCOL_HEX_ARRAY_SIZE, false);
 }
 
 
@@ -303,18 +679,123 @@ static unsigned _protocol_get_length(void)
 }
 
 
+/* Leave room for the age added when the backlog is drained. */
+static unsigned _protocol_get_backlog_size(void)
+{
+    return OSM_MIN(OSM_PROTOCOL_HEX_ARRAY_SIZE, osm_comms_get_mtu()) - PROTOCOL_AGE_SIZE;
+}
+
+
+bool osm_protocol_init_backlog(void)
+{
+    return _protocol_init_measurements(_protocol_get_backlog_size(), true);
+}
+
+
+/* Carry on encoding a backlog payload, for batching intervals. */
+bool osm_protocol_resume(const int8_t* payload, unsigned len)
+{
+    unsigned buflen = _protocol_get_backlog_size();
+    if (!len || len > buflen)
+        return false;
+
+    memcpy(_measurements_hex_arr, payload, len);
+    _protocol_ctx.buf = _measurements_hex_arr;
+    _protocol_ctx.buflen = buflen;
+    _protocol_ctx.pos = len;
+#ifdef OSM_PROTOCOL_HEXBLOB_COMPACT
+    _protocol_compact.backlog = true;
+    _protocol_compact.payload_seq = PROTOCOL_COMPACT_BACKLOG_SEQ;
+#endif
+    return true;
+}
+
+
+/* Following measurements are of an interval this long after the first. */
+bool osm_protocol_append_interval(uint32_t offset_secs)
+{
+#ifdef OSM_PROTOCOL_HEXBLOB_COMPACT
+    return _protocol_compact_append_interval(offset_secs);
+#else
+    return _protocol_append_single_i64(PROTOCOL_INTERVAL_NAME, offset_secs);
+#endif
+}
+
+
+unsigned osm_protocol_get_payload(int8_t** payload)
+{
+    *payload = _protocol_ctx.buf;
+    return _protocol_get_length();
+}
+
+
+bool osm_protocol_send_backlog(const int8_t* payload, unsigned len, uint32_t age_secs)
+{
+    if (len > OSM_PROTOCOL_HEX_ARRAY_SIZE)
+        return false;
+
+    memcpy(_measurements_hex_arr, payload, len);
+    _protocol_ctx.buf = _measurements_hex_arr;
+    _protocol_ctx.buflen = OSM_PROTOCOL_HEX_ARRAY_SIZE;
+    _protocol_ctx.pos = len;
+
+    if (age_secs != OSM_BACKLOG_TIMESTAMP_UNKNOWN)
+    {
+        bool r;
+#ifdef OSM_PROTOCOL_HEXBLOB_COMPACT
+        if ((uint8_t)payload[0] == OSM_MEASUREMENTS_PAYLOAD_COMPACT_VERSION)
+            r = _protocol_compact_append_age(age_secs);
+        else
+#endif
+            r = _protocol_append_single_i64(PROTOCOL_AGE_NAME, age_secs);
+        if (!r)
+            osm_comms_debug("No room for backlog age.");
+    }
+
+#ifdef OSM_PROTOCOL_HEXBLOB_COMPACT
+    _protocol_compact_sending(_protocol_ctx.buf, _protocol_get_length());
+#endif
+    return osm_comms_send(_protocol_ctx.buf, _protocol_get_length());
+}
+
+
 bool osm_protocol_send(void)
 {
+#ifdef OSM_PROTOCOL_HEXBLOB_COMPACT
+    _protocol_compact_sending(_protocol_ctx.buf, _protocol_get_length());
+#endif
     return osm_comms_send(_protocol_ctx.buf, _protocol_get_length());
 }
 
 
+void osm_protocol_sent_ack(bool acked)
+{
+#ifdef OSM_PROTOCOL_HEXBLOB_COMPACT
+    if (!_protocol_compact.inflight)
+        return;
+    _protocol_compact.inflight = false;
+    if (!acked)
+        return;
+    for (unsigned n = 0; n < OSM_PROTOCOL_COMPACT_SLOTS; n++)
+    {
+        protocol_compact_slot_t* slot = &_protocol_compact.slots[n];
+        if (!slot->key)
+            continue;
+        if (slot->has_value && slot->seq == _protocol_compact.inflight_seq)
+            slot->acked = 1;
+        if (slot->define_sent && slot->define_seq == _protocol_compact.inflight_seq)
+            slot->define_acked = 1;
+    }
+#endif
+}
+
+
 void        osm_protocol_send_error_code(uint8_t err_code)
 {
     /* Immediate sent, so temporary use a different memory buffer for protocol. */
     int8_t arr[15] = {0};
     protocol_ctx_t org = _protocol_ctx;
-    if (!_protocol_init(arr, sizeof(arr)))
+    if (!_protocol_init(arr, sizeof(arr), OSM_MEASUREMENTS_PAYLOAD_VERSION))
     {
         _protocol_ctx = org;
         osm_comms_debug("Could not init memory protocol.");
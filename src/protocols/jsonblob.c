@@ -10,6 +10,7 @@
 #include <osm/core/measurements.h>
 #include <osm/comms/comms.h>
 #include <osm/core/persist_config.h>
+#include <osm/protocols/protocol.h>
 
 
 #define JSON_CLOSE_SIZE 3
@@ -70,6 +71,27 @@ static bool _protocol_append_data_type_i64(const char * name, int64_t value)
 }
 
 
+static bool _protocol_append_stat(const char * name, const char * suffix, int64_t value, bool is_float)
+{
+    char tmp[OSM_MEASURE_NAME_NULLED_LEN + 4];
+    snprintf(tmp, sizeof(tmp), "%s%s", name, suffix);
+    if (is_float)
+        return _protocol_append_data_type_float(tmp, value);
+    return _protocol_append_data_type_i64(tmp, value);
+}
+
+
+static bool _protocol_append_stats(const char * name, osm_measurements_data_t* data, bool is_float)
+{
+    osm_measurements_stats_t stats;
+    if (!osm_measurements_get_stats(data, &stats))
+        return true;
+    return _protocol_append_stat(name, "_sd",  stats.stddev, is_float) &&
+           _protocol_append_stat(name, "_p50", stats.p50,    is_float) &&
+           _protocol_append_stat(name, "_p95", stats.p95,    is_float);
+}
+
+
 static bool _protocol_append_value_type_float(const char * name, osm_measurements_data_t* data)
 {
     if (data->num_samples == 1)
@@ -82,6 +104,7 @@ static bool _protocol_append_value_type_float(const char * name, osm_measurement
     r &= _protocol_append_data_type_float(tmp, data->value.value_f.min);
     snprintf(tmp, sizeof(tmp), "%s_max", name);
     r &= _protocol_append_data_type_float(tmp, data->value.value_f.max);
+    r &= _protocol_append_stats(name, data, true);
     return r;
 }
 
@@ -98,6 +121,7 @@ static bool _protocol_append_value_type_i64(const char * name, osm_measurements_
     r &= _protocol_append_data_type_i64(tmp, data->value.value_64.min);
     snprintf(tmp, sizeof(tmp), "%s_max", name);
     r &= _protocol_append_data_type_i64(tmp, data->value.value_64.max);
+    r &= _protocol_append_stats(name, data, false);
     return r;
 }
 
@@ -138,7 +162,7 @@ bool        osm_protocol_append_measurement(osm_measurements_def_t* def, osm_mea
 }
 
 
-bool osm_protocol_send(void)
+static bool _protocol_close(void)
 {
     unsigned available = JSON_BUF_SIZE - _json_buf_pos;
 
@@ -151,6 +175,14 @@ bool osm_protocol_send(void)
     unsigned r = snprintf(_json_buf + _json_buf_pos, available, "}}");
 
     _json_buf_pos += r;
+    return true;
+}
+
+
+bool osm_protocol_send(void)
+{
+    if (!_protocol_close())
+        return false;
 
     osm_comms_debug("_json_buf(%u) = %s", _json_buf_pos, _json_buf);
 
@@ -163,6 +195,11 @@ bool osm_protocol_send(void)
 }
 
 
+void osm_protocol_sent_ack(bool acked)
+{
+}
+
+
 bool osm_protocol_init(void)
 {
     int64_t ts;
@@ -174,3 +211,69 @@ bool osm_protocol_init(void)
 
     return _protocol_append("{\"UNIX\":%"PRIi64",\"NAME\":\"%.*s\",\"VALUES\":{", ts, OSM_HUMAN_NAME_LEN, osm_persist_get_human_name());
 }
+
+
+bool osm_protocol_init_backlog(void)
+{
+    return osm_protocol_init();
+}
+
+
+unsigned osm_protocol_get_payload(int8_t** payload)
+{
+    if (!_protocol_close())
+        return 0;
+    *payload = (int8_t*)_json_buf;
+    return _json_buf_pos;
+}
+
+
+/* Carry on encoding a backlog payload, for batching intervals. */
+bool osm_protocol_resume(const int8_t* payload, unsigned len)
+{
+    unsigned close_len = OSM_STRLEN("}}");
+    if (len < close_len || len > JSON_BUF_SIZE ||
+        memcmp(payload + len - close_len, "}}", close_len))
+        return false;
+    memcpy(_json_buf, payload, len);
+    _json_buf_pos = len - close_len;
+    _json_buf[_json_buf_pos] = 0;
+    return true;
+}
+
+
+/* Following measurements are of an interval this long after "UNIX". */
+bool osm_protocol_append_interval(uint32_t offset_secs)
+{
+    return _protocol_append("},\"VALUES+%"PRIu32"\":{", offset_secs);
+}
+
+
+/* "IOEV":[[io,level,ms before the uplink],...],"IOEV_drop":n */
+bool osm_protocol_append_io_events(const osm_io_event_t* events, unsigned count, uint32_t dropped, uint32_t now_ms)
+{
+    if (!count)
+        return false;
+    unsigned before_pos = _json_buf_pos;
+    bool r = _protocol_append_meas("\"IOEV\":[");
+    for (unsigned n = 0; n < count; n++)
+        r = r && _protocol_append("%s[%"PRIu8",%"PRIu8",%"PRIu32"]", n ? "," : "",
+                                  events[n].io, events[n].level, now_ms - events[n].ms);
+    r = r && _protocol_append("]") &&
+        _protocol_append_meas("\"IOEV_drop\":%"PRIu32, dropped);
+    if (!r)
+        _json_buf_pos = before_pos;
+    return r;
+}
+
+
+bool osm_protocol_send_backlog(const int8_t* payload, unsigned len, uint32_t age_secs)
+{
+    /* Already carries its UNIX time, so the age isn't needed. */
+    if (len > JSON_BUF_SIZE)
+        return false;
+    memcpy(_json_buf, payload, len);
+    _json_buf_pos = len;
+    osm_comms_debug("_json_buf(%u) = %.*s", _json_buf_pos, _json_buf_pos, _json_buf);
+    return osm_comms_send(_json_buf, _json_buf_pos);
+}
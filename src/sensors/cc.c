@@ -11,6 +11,7 @@
 #include <osm/core/common.h>
 #include <osm/core/log.h>
 #include <osm/core/adcs.h>
+#include <osm/core/adcs_harmonics.h>
 #include <osm/core/persist_config.h>
 #include <osm/core/uart_rings.h>
 #include "pinmap.h"
@@ -34,6 +35,12 @@
 #define CC_IS_NOT_PLUGGED_IN_THRESHOLD      (1000 * CC_IS_NOT_PLUGGED_IN_THRESHOLD_MV * (OSM_ADC_MAX_VAL + 1) / ADC_MAX_MV)
 #define CC_MIDPOINT_VALID_WIDTH             (1000 * 500)
 
+#define CC_ENERGY_COMMIT_MS                 (6 * 60 * 60 * 1000)
+#define CC_ENERGY_MAX_GAP_MS                (60 * 60 * 1000)    /* Longer between readings is not counted */
+#define CC_MJ_PER_WH                        3600000
+#define CC_PHASES                           3
+#define CC_DEFAULT_HARMONICS                OSM_ADCS_HARMONICS_MAX
+
 
 typedef struct
 {
@@ -42,6 +49,23 @@ typedef struct
 } cc_active_clamps_t;
 
 
+typedef struct
+{
+    float       real_W;
+    float       apparent_VA;
+} cc_power_t;
+
+
+typedef enum
+{
+    CC_POWER_REAL,
+    CC_POWER_APPARENT,
+    CC_POWER_FACTOR,
+    CC_POWER_ENERGY,
+    CC_POWER_COUNT,
+} cc_power_index_t;
+
+
 static osm_adcs_type_t          _cc_adc_clamp_array[ADC_CC_COUNT]   = ADC_TYPES_ALL_CC;
 static cc_active_clamps_t   _cc_adc_active_clamps               = {0};
 static osm_adcs_type_t          _cc_running_isolated                = OSM_ADCS_TYPE_INVALID;
@@ -49,6 +73,15 @@ static bool                 _cc_running[ADC_CC_COUNT]           = {false};
 static uint32_t             _cc_collection_time                 = CC_DEFAULT_COLLECTION_TIME;
 static osm_cc_config_t*         _configs = NULL;
 
+static uint8_t              _cc_power_running                   = 0;        /* Bit per cc_power_index_t begun */
+static bool                 _cc_power_collected                 = false;
+static cc_power_t           _cc_power                           = {0};
+static uint64_t             _cc_energy_mJ                       = 0;
+static uint32_t             _cc_energy_last_ms                  = 0;
+static uint32_t             _cc_energy_commit_ms                = 0;
+
+static unsigned             _cc_thd_running                     = ADC_CC_COUNT; /* ADC_CC_COUNT for none */
+
 
 static bool _cc_conv(uint32_t adc_val, uint32_t* cc_mA, uint32_t midpoint, uint32_t scale_factor, bool is_iv_ct)
 {
@@ -380,6 +413,8 @@ static osm_measurements_sensor_state_t _cc_get(char* name, osm_measurements_read
             is_iv_ct = false;
             break;
         case OSM_CC_TYPE_V:
+            /* fall through */
+        case OSM_CC_TYPE_U:
             is_iv_ct = true;
             break;
         default:
@@ -708,6 +743,383 @@ static bool _cc_is_enabled(char* name)
 }
 
 
+/* Power from every clamp against the one of type U. A voltage
+ * transformer's ext max is the mains V at the int max mV. */
+static bool _cc_power_get_ref(unsigned* ref)
+{
+    for (unsigned i = 0; i < ADC_CC_COUNT; i++)
+    {
+        if (_configs[i].type == OSM_CC_TYPE_U)
+        {
+            *ref = i;
+            return true;
+        }
+    }
+    osm_adc_debug("No CC is a voltage reference.");
+    return false;
+}
+
+
+/* mV or mA on the other side of the clamp for one ADC count. */
+static float _cc_power_per_count(unsigned index)
+{
+    if (!_configs[index].int_max_mV)
+        return 0;
+    float per_count = (float)ADC_MAX_MV / OSM_ADC_MAX_VAL;
+    per_count *= (float)_configs[index].ext_max_mA / _configs[index].int_max_mV;
+    if (_configs[index].type == OSM_CC_TYPE_A)
+        per_count /= CC_RESISTOR_OHM;
+    return per_count;
+}
+
+
+static bool _cc_power_get_name_index(char* name, cc_power_index_t* index)
+{
+    static const char* names[CC_POWER_COUNT] = {OSM_MEASUREMENTS_CC_REAL_POWER_NAME,
+                                                OSM_MEASUREMENTS_CC_APPARENT_POWER_NAME,
+                                                OSM_MEASUREMENTS_CC_POWER_FACTOR_NAME,
+                                                OSM_MEASUREMENTS_CC_ENERGY_NAME};
+    for (unsigned i = 0; i < CC_POWER_COUNT; i++)
+    {
+        if (strncmp(name, names[i], OSM_MEASURE_NAME_LEN) == 0)
+        {
+            *index = i;
+            return true;
+        }
+    }
+    osm_adc_debug("'%s' is not a power name.", name);
+    return false;
+}
+
+
+static void _cc_energy_add(float real_W)
+{
+    uint32_t now = osm_get_since_boot_ms();
+    uint32_t delta = osm_since_boot_delta(now, _cc_energy_last_ms);
+    if (_cc_energy_last_ms && delta < CC_ENERGY_MAX_GAP_MS && real_W > 0)
+        _cc_energy_mJ += (uint64_t)(real_W * delta);
+    _cc_energy_last_ms = now;
+
+    /* Flash is only written every few hours, it wears. */
+    uint32_t energy_Wh = _cc_energy_mJ / CC_MJ_PER_WH;
+    if (energy_Wh != persist_data.cc_energy_wh &&
+        osm_since_boot_delta(now, _cc_energy_commit_ms) > CC_ENERGY_COMMIT_MS)
+    {
+        persist_data.cc_energy_wh = energy_Wh;
+        osm_persist_commit();
+        _cc_energy_commit_ms = now;
+    }
+}
+
+
+static osm_adcs_resp_t _cc_power_collect(cc_power_t* power)
+{
+    unsigned ref;
+    if (!_cc_power_get_ref(&ref))
+        return OSM_ADCS_RESP_FAIL;
+
+    uint32_t v_rms;
+    uint32_t v_mp = _configs[ref].midpoint;
+    osm_adcs_resp_t resp = osm_adcs_collect_rms(&v_rms, v_mp, ADC_CC_COUNT, CC_NUM_SAMPLES, ref, OSM_ADCS_KEY_CC_POWER, NULL);
+    if (resp != OSM_ADCS_RESP_OK)
+        return resp;
+    float v_per_count = _cc_power_per_count(ref);
+    float v_rms_mV = (float)(v_mp - v_rms) / 1000 * v_per_count;
+
+    const float omega = 2 * M_PI * OSM_CC_LINE_FREQ_HZ;
+    const float conv_s = OSM_ADCS_SAMPLE_PERIOD_NS / 1e9f;
+    /* Lead products are of v[n+1] - v[n-1], 2sin(wT) times v a quarter cycle ahead. */
+    const float lead_scale = 2 * sinf(omega * conv_s * ADC_CC_COUNT);
+
+    power->real_W = 0;
+    power->apparent_VA = 0;
+    for (unsigned i = 0; i < ADC_CC_COUNT; i++)
+    {
+        if (i == ref)
+            continue;
+        uint32_t i_mp = _configs[i].midpoint;
+        uint32_t i_rms, i_avg;
+        if (_configs[i].type == OSM_CC_TYPE_V)
+        {
+            resp = osm_adcs_collect_avg(&i_avg, ADC_CC_COUNT, CC_NUM_SAMPLES, i, OSM_ADCS_KEY_CC_POWER, NULL);
+            if (resp != OSM_ADCS_RESP_OK)
+                return resp;
+            if (i_avg < i_mp - CC_IS_NOT_PLUGGED_IN_THRESHOLD)
+                continue;
+        }
+        int64_t in_phase, lead;
+        resp = osm_adcs_collect_rms(&i_rms, i_mp, ADC_CC_COUNT, CC_NUM_SAMPLES, i, OSM_ADCS_KEY_CC_POWER, NULL);
+        if (resp != OSM_ADCS_RESP_OK)
+            return resp;
+        resp = osm_adcs_collect_power(&in_phase, &lead, i_mp, v_mp, i, OSM_ADCS_KEY_CC_POWER, NULL);
+        if (resp != OSM_ADCS_RESP_OK)
+            return resp;
+
+        /* The clamp's phase voltage is the reference delayed by its
+         * phase, less the time between converting the two. */
+        uint8_t phase = _configs[i].phase < CC_PHASES ? _configs[i].phase : 0;
+        float theta = 2 * M_PI * phase / CC_PHASES - omega * conv_s * ((int)i - (int)ref);
+        float counts2 = (in_phase * cosf(theta) - lead * sinf(theta) / lead_scale) / 1e6f;
+
+        float i_per_count = _cc_power_per_count(i);
+        float i_rms_mA = (float)(i_mp - i_rms) / 1000 * i_per_count;
+        power->real_W += counts2 * v_per_count * i_per_count / 1e6f;
+        power->apparent_VA += v_rms_mV * i_rms_mA / 1e6f;
+    }
+    osm_adc_debug("P = %"PRIi32"W, S = %"PRIi32"VA", (int32_t)power->real_W, (int32_t)power->apparent_VA);
+    _cc_energy_add(power->real_W);
+    return OSM_ADCS_RESP_OK;
+}
+
+
+static float _cc_power_factor(const cc_power_t* power)
+{
+    if (power->apparent_VA <= 0)
+        return 0;
+    return power->real_W / power->apparent_VA;
+}
+
+
+static float _cc_energy_kWh(void)
+{
+    return (float)_cc_energy_mJ / (1000.f * CC_MJ_PER_WH);
+}
+
+
+static osm_adcs_resp_t _cc_power_begin(void)
+{
+    unsigned ref;
+    if (!_cc_power_get_ref(&ref))
+        return OSM_ADCS_RESP_FAIL;
+    osm_adcs_type_t all_cc_clamps[ADC_CC_COUNT] = ADC_TYPES_ALL_CC;
+    return osm_adcs_begin_power(all_cc_clamps, ADC_CC_COUNT, CC_NUM_SAMPLES, ref, OSM_ADCS_KEY_CC_POWER);
+}
+
+
+static void _cc_power_release(void)
+{
+    _cc_power_running = 0;
+    _cc_power_collected = false;
+    osm_adcs_release(OSM_ADCS_KEY_CC_POWER);
+}
+
+
+static osm_measurements_sensor_state_t _cc_power_measurement_begin(char* name, bool in_isolation)
+{
+    cc_power_index_t index;
+    if (!_configs || !_cc_power_get_name_index(name, &index))
+        return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+
+    if (!_cc_power_running)
+    {
+        switch (_cc_power_begin())
+        {
+            case OSM_ADCS_RESP_FAIL:
+                osm_adc_debug("Failed to begin CC power ADC.");
+                return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+            case OSM_ADCS_RESP_WAIT:
+                return OSM_MEASUREMENTS_SENSOR_STATE_BUSY;
+            case OSM_ADCS_RESP_OK:
+                break;
+        }
+    }
+    _cc_power_running |= 1 << index;
+    return OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS;
+}
+
+
+/* One run of the ADC gives all of them, the last to be read releases it. */
+static osm_measurements_sensor_state_t _cc_power_measurement_get(char* name, osm_measurements_reading_t* value)
+{
+    cc_power_index_t index;
+    if (!_configs || !_cc_power_get_name_index(name, &index))
+        return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+
+    if (!(_cc_power_running & (1 << index)))
+    {
+        osm_adc_debug("CC power was not running.");
+        return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+    }
+
+    if (!_cc_power_collected)
+    {
+        switch (_cc_power_collect(&_cc_power))
+        {
+            case OSM_ADCS_RESP_FAIL:
+                _cc_power_release();
+                osm_adc_debug("Failed to get CC power.");
+                return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+            case OSM_ADCS_RESP_WAIT:
+                return OSM_MEASUREMENTS_SENSOR_STATE_BUSY;
+            case OSM_ADCS_RESP_OK:
+                break;
+        }
+        _cc_power_collected = true;
+    }
+
+    switch (index)
+    {
+        case CC_POWER_REAL:
+            value->v_i64 = (int64_t)_cc_power.real_W;
+            break;
+        case CC_POWER_APPARENT:
+            value->v_i64 = (int64_t)_cc_power.apparent_VA;
+            break;
+        case CC_POWER_FACTOR:
+            value->v_f32 = osm_to_f32_from_float(_cc_power_factor(&_cc_power));
+            break;
+        default:
+            value->v_f32 = osm_to_f32_from_float(_cc_energy_kWh());
+            break;
+    }
+
+    _cc_power_running &= ~(1 << index);
+    if (!_cc_power_running)
+        _cc_power_release();
+    return OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS;
+}
+
+
+static osm_measurements_value_type_t _cc_power_value_type(char* name)
+{
+    cc_power_index_t index;
+    if (!_cc_power_get_name_index(name, &index))
+        return OSM_MEASUREMENTS_VALUE_TYPE_INVALID;
+    if (index == CC_POWER_REAL || index == CC_POWER_APPARENT)
+        return OSM_MEASUREMENTS_VALUE_TYPE_I64;
+    return OSM_MEASUREMENTS_VALUE_TYPE_FLOAT;
+}
+
+
+static bool _cc_power_get_blocking(cc_power_t* power)
+{
+    if (_cc_power_running || _cc_power_begin() != OSM_ADCS_RESP_OK)
+    {
+        osm_adc_debug("Can not begin ADC.");
+        return false;
+    }
+    bool r = (osm_adcs_wait_done(CC_TIMEOUT_MS, OSM_ADCS_KEY_CC_POWER) == OSM_ADCS_RESP_OK &&
+              _cc_power_collect(power) == OSM_ADCS_RESP_OK);
+    osm_adcs_release(OSM_ADCS_KEY_CC_POWER);
+    return r;
+}
+
+
+/* Highest harmonic, it is also how many bins with the fundamental. */
+static unsigned _cc_harmonics_get_num(unsigned index)
+{
+    uint8_t harmonics = _configs[index].harmonics;
+    if (harmonics < 2 || harmonics > OSM_ADCS_HARMONICS_MAX)
+        return CC_DEFAULT_HARMONICS;
+    return harmonics;
+}
+
+
+static bool _cc_thd_get_index(char* name, unsigned* index)
+{
+    static const char* names[ADC_CC_COUNT] = {OSM_MEASUREMENTS_CC_THD_1_NAME,
+                                              OSM_MEASUREMENTS_CC_THD_2_NAME,
+                                              OSM_MEASUREMENTS_CC_THD_3_NAME};
+    for (unsigned i = 0; i < ADC_CC_COUNT; i++)
+    {
+        if (strncmp(name, names[i], OSM_MEASURE_NAME_LEN) == 0)
+        {
+            *index = i;
+            return true;
+        }
+    }
+    osm_adc_debug("'%s' is not a THD name.", name);
+    return false;
+}
+
+
+/* The clamp alone, sampled three times as fast, reaches three times the harmonics. */
+static osm_adcs_resp_t _cc_harmonics_begin(unsigned index)
+{
+    osm_adcs_type_t clamp = OSM_ADCS_TYPE_CC_CLAMP1 + index;
+    return osm_adcs_begin_harmonics(&clamp, 1, CC_NUM_SAMPLES, _cc_harmonics_get_num(index), OSM_ADCS_KEY_CC_THD);
+}
+
+
+static osm_adcs_resp_t _cc_harmonics_collect(uint32_t* rms, unsigned* num_bins)
+{
+    *num_bins = OSM_ADCS_HARMONICS_MAX;
+    return osm_adcs_collect_harmonics(rms, num_bins, 1, CC_NUM_SAMPLES, 0, OSM_ADCS_KEY_CC_THD, NULL);
+}
+
+
+static osm_measurements_sensor_state_t _cc_thd_begin(char* name, bool in_isolation)
+{
+    unsigned index;
+    if (!_configs || !_cc_thd_get_index(name, &index))
+        return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+    /* One clamp at a time, the others wait their turn. */
+    if (_cc_thd_running != ADC_CC_COUNT)
+        return OSM_MEASUREMENTS_SENSOR_STATE_BUSY;
+    switch (_cc_harmonics_begin(index))
+    {
+        case OSM_ADCS_RESP_FAIL:
+            osm_adc_debug("Failed to begin CC harmonics ADC.");
+            return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+        case OSM_ADCS_RESP_WAIT:
+            return OSM_MEASUREMENTS_SENSOR_STATE_BUSY;
+        case OSM_ADCS_RESP_OK:
+            break;
+    }
+    _cc_thd_running = index;
+    return OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS;
+}
+
+
+static osm_measurements_sensor_state_t _cc_thd_get(char* name, osm_measurements_reading_t* value)
+{
+    unsigned index;
+    if (!_configs || !_cc_thd_get_index(name, &index))
+        return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+    if (_cc_thd_running != index)
+    {
+        osm_adc_debug("CC THD was not running.");
+        return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+    }
+    uint32_t rms[OSM_ADCS_HARMONICS_MAX];
+    unsigned num_bins;
+    osm_adcs_resp_t resp = _cc_harmonics_collect(rms, &num_bins);
+    if (resp == OSM_ADCS_RESP_WAIT)
+        return OSM_MEASUREMENTS_SENSOR_STATE_BUSY;
+    _cc_thd_running = ADC_CC_COUNT;
+    osm_adcs_release(OSM_ADCS_KEY_CC_THD);
+    uint32_t thd;
+    if (resp != OSM_ADCS_RESP_OK || !osm_adcs_harmonics_thd(rms, num_bins, &thd))
+    {
+        osm_adc_debug("Failed to get CC THD.");
+        return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
+    }
+    osm_adc_debug("THD = %"PRIu32".%03"PRIu32"%%", thd/1000, thd%1000);
+    value->v_f32 = osm_to_f32_from_float(thd / 1000.f);
+    return OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS;
+}
+
+
+static osm_measurements_value_type_t _cc_thd_value_type(char* name)
+{
+    return OSM_MEASUREMENTS_VALUE_TYPE_FLOAT;
+}
+
+
+static bool _cc_harmonics_get_blocking(unsigned index, uint32_t* rms, unsigned* num_bins)
+{
+    if (_cc_thd_running != ADC_CC_COUNT || _cc_harmonics_begin(index) != OSM_ADCS_RESP_OK)
+    {
+        osm_adc_debug("Can not begin ADC.");
+        return false;
+    }
+    bool r = (osm_adcs_wait_done(CC_TIMEOUT_MS, OSM_ADCS_KEY_CC_THD) == OSM_ADCS_RESP_OK &&
+              _cc_harmonics_collect(rms, num_bins) == OSM_ADCS_RESP_OK);
+    osm_adcs_release(OSM_ADCS_KEY_CC_THD);
+    return r;
+}
+
+
 void osm_cc_inf_init(osm_measurements_inf_t* inf)
 {
     inf->collection_time_cb = _cc_get_collection_time;
@@ -719,6 +1131,24 @@ void osm_cc_inf_init(osm_measurements_inf_t* inf)
 }
 
 
+void osm_cc_power_inf_init(osm_measurements_inf_t* inf)
+{
+    inf->collection_time_cb = _cc_get_collection_time;
+    inf->init_cb            = _cc_power_measurement_begin;
+    inf->get_cb             = _cc_power_measurement_get;
+    inf->value_type_cb      = _cc_power_value_type;
+}
+
+
+void osm_cc_thd_inf_init(osm_measurements_inf_t* inf)
+{
+    inf->collection_time_cb = _cc_get_collection_time;
+    inf->init_cb            = _cc_thd_begin;
+    inf->get_cb             = _cc_thd_get;
+    inf->value_type_cb      = _cc_thd_value_type;
+}
+
+
 void osm_cc_setup_default_mem(osm_cc_config_t* memory, unsigned size)
 {
     uint8_t num_cc_configs = ADC_CC_COUNT;
@@ -733,6 +1163,8 @@ void osm_cc_setup_default_mem(osm_cc_config_t* memory, unsigned size)
         memory[i].ext_max_mA    = OSM_CC_DEFAULT_EXT_MAX_MA;
         memory[i].int_max_mV    = OSM_CC_DEFAULT_INT_MAX_MV;
         memory[i].type          = CC_DEFAULT_TYPE;
+        memory[i].phase         = 0;
+        memory[i].harmonics     = CC_DEFAULT_HARMONICS;
     }
 }
 
@@ -747,6 +1179,10 @@ void osm_cc_init(void)
         osm_cc_setup_default_mem(default_configs, sizeof(osm_cc_config_t) * ADC_CC_COUNT);
         _configs = default_configs;
     }
+    /* Erased flash from before it was kept. */
+    if (persist_data.cc_energy_wh == UINT32_MAX)
+        persist_data.cc_energy_wh = 0;
+    _cc_energy_mJ = (uint64_t)persist_data.cc_energy_wh * CC_MJ_PER_WH;
 }
 
 
@@ -828,6 +1264,13 @@ static osm_command_response_t _cc_mp_cb(char* args, osm_cmd_ctx_t * ctx)
 }
 
 
+/* A voltage transformer's ext max is in V. */
+static char _cc_ext_unit(unsigned index)
+{
+    return (_configs[index].type == OSM_CC_TYPE_U) ? 'V' : 'A';
+}
+
+
 static osm_command_response_t _cc_gain(char* args, osm_cmd_ctx_t * ctx)
 {
     if (!_configs)
@@ -844,7 +1287,7 @@ static osm_command_response_t _cc_gain(char* args, osm_cmd_ctx_t * ctx)
     {
         for (uint8_t i = 0; i < ADC_CC_COUNT; i++)
         {
-            osm_cmd_ctx_out(ctx,"CC%"PRIu8" EXT max: %"PRIu32".%03"PRIu32"A", i+1, _configs[i].ext_max_mA/1000, _configs[i].ext_max_mA%1000);
+            osm_cmd_ctx_out(ctx,"CC%"PRIu8" EXT max: %"PRIu32".%03"PRIu32"%c", i+1, _configs[i].ext_max_mA/1000, _configs[i].ext_max_mA%1000, _cc_ext_unit(i));
             osm_cmd_ctx_out(ctx,"CC%"PRIu8" INT max: %"PRIu32".%03"PRIu32"%c", i+1, _configs[i].int_max_mV/1000, _configs[i].int_max_mV%1000, _configs[i].type);
         }
         return OSM_COMMAND_RESP_ERR;
@@ -865,7 +1308,7 @@ static osm_command_response_t _cc_gain(char* args, osm_cmd_ctx_t * ctx)
     _configs[index].int_max_mV = int_mA;
     osm_cmd_ctx_out(ctx,"Set the CC gain:");
 print_exit:
-    osm_cmd_ctx_out(ctx,"EXT max: %"PRIu32".%03"PRIu32"A", _configs[index].ext_max_mA/1000, _configs[index].ext_max_mA%1000);
+    osm_cmd_ctx_out(ctx,"EXT max: %"PRIu32".%03"PRIu32"%c", _configs[index].ext_max_mA/1000, _configs[index].ext_max_mA%1000, _cc_ext_unit(index));
     osm_cmd_ctx_out(ctx,"INT max: %"PRIu32".%03"PRIu32"%c", _configs[index].int_max_mV/1000, _configs[index].int_max_mV%1000, _configs[index].type);
     return OSM_COMMAND_RESP_OK;
 syntax_exit:
@@ -908,6 +1351,8 @@ static osm_command_response_t _cc_type_cb(char* args, osm_cmd_ctx_t * ctx)
         {
             case OSM_CC_TYPE_V:
                 /* fall through */
+            case OSM_CC_TYPE_U:
+                /* fall through */
             case OSM_CC_TYPE_A:
                 _configs[index].type = new_type;
                 ret = OSM_COMMAND_RESP_OK;
@@ -919,13 +1364,124 @@ static osm_command_response_t _cc_type_cb(char* args, osm_cmd_ctx_t * ctx)
     }
     else
     {
-        osm_cmd_ctx_out(ctx,"Syntax: cc_type <channel> <V/A>");
+        osm_cmd_ctx_out(ctx,"Syntax: cc_type <channel> <V/A/U>");
         osm_cmd_ctx_out(ctx,"e.g cc_type 3 100 50");
     }
     return ret;
 }
 
 
+static osm_command_response_t _cc_power_cb(char* args, osm_cmd_ctx_t * ctx)
+{
+    if (!_configs)
+    {
+        osm_cmd_ctx_error(ctx,"No CC calibration");
+        return OSM_COMMAND_RESP_ERR;
+    }
+    cc_power_t power;
+    if (!_cc_power_get_blocking(&power))
+    {
+        osm_cmd_ctx_out(ctx,"Could not get CC power.");
+        return OSM_COMMAND_RESP_ERR;
+    }
+    int32_t pf = osm_to_f32_from_float(_cc_power_factor(&power));
+    osm_cmd_ctx_out(ctx,"Real = %"PRIi32"W", (int32_t)power.real_W);
+    osm_cmd_ctx_out(ctx,"Apparent = %"PRIi32"VA", (int32_t)power.apparent_VA);
+    osm_cmd_ctx_out(ctx,"PF = %s%"PRIi32".%03"PRIi32, (pf < 0) ? "-" : "", abs(pf) / 1000, abs(pf) % 1000);
+    osm_cmd_ctx_out(ctx,"Energy = %"PRIu32"Wh", (uint32_t)(_cc_energy_mJ / CC_MJ_PER_WH));
+    return OSM_COMMAND_RESP_OK;
+}
+
+
+static osm_command_response_t _cc_phase_cb(char* args, osm_cmd_ctx_t * ctx)
+{
+    if (!_configs)
+    {
+        osm_cmd_ctx_error(ctx,"No CC calibration");
+        return OSM_COMMAND_RESP_ERR;
+    }
+    // <index> <0/1/2>
+    char* p;
+    uint8_t index = strtoul(args, &p, 10);
+    if (p != args)
+    {
+        if (index == 0 || index > ADC_CC_COUNT)
+            goto syntax_exit;
+        char* q = osm_skip_space(p);
+        unsigned phase = strtoul(q, &p, 10);
+        if (p != q)
+        {
+            if (phase >= CC_PHASES)
+                goto syntax_exit;
+            _configs[index - 1].phase = phase;
+        }
+    }
+    for (uint8_t i = 0; i < ADC_CC_COUNT; i++)
+        osm_cmd_ctx_out(ctx,"CC%"PRIu8" Phase: %"PRIu8, i+1, _configs[i].phase);
+    return OSM_COMMAND_RESP_OK;
+syntax_exit:
+    osm_cmd_ctx_out(ctx,"Syntax: cc_phase <channel> <0/1/2>");
+    osm_cmd_ctx_out(ctx,"Thirds of a cycle behind the voltage reference");
+    return OSM_COMMAND_RESP_ERR;
+}
+
+
+static osm_command_response_t _cc_kwh_cb(char* args, osm_cmd_ctx_t * ctx)
+{
+    char* p;
+    uint32_t energy_Wh = strtoul(args, &p, 10);
+    if (p != args)
+    {
+        _cc_energy_mJ = (uint64_t)energy_Wh * CC_MJ_PER_WH;
+        persist_data.cc_energy_wh = energy_Wh;
+    }
+    osm_cmd_ctx_out(ctx,"Energy = %"PRIu32"Wh", (uint32_t)(_cc_energy_mJ / CC_MJ_PER_WH));
+    return OSM_COMMAND_RESP_OK;
+}
+
+
+static osm_command_response_t _cc_harm_cb(char* args, osm_cmd_ctx_t * ctx)
+{
+    if (!_configs)
+    {
+        osm_cmd_ctx_error(ctx,"No CC calibration");
+        return OSM_COMMAND_RESP_ERR;
+    }
+    // <index> [highest harmonic]
+    char* p;
+    uint8_t index = strtoul(args, &p, 10);
+    if (p == args || index == 0 || index > ADC_CC_COUNT)
+        goto syntax_exit;
+    index--;
+    char* q = osm_skip_space(p);
+    unsigned harmonics = strtoul(q, &p, 10);
+    if (p != q)
+    {
+        if (harmonics < 2 || harmonics > OSM_ADCS_HARMONICS_MAX)
+            goto syntax_exit;
+        _configs[index].harmonics = harmonics;
+    }
+
+    uint32_t rms[OSM_ADCS_HARMONICS_MAX];
+    unsigned num_bins;
+    if (!_cc_harmonics_get_blocking(index, rms, &num_bins))
+    {
+        osm_cmd_ctx_out(ctx,"Could not get CC harmonics.");
+        return OSM_COMMAND_RESP_ERR;
+    }
+    float per_count = _cc_power_per_count(index);
+    for (unsigned i = 0; i < num_bins; i++)
+        osm_cmd_ctx_out(ctx,"H%u = %"PRIu32"m%c", i+1, (uint32_t)(rms[i] / 1000.f * per_count), _cc_ext_unit(index));
+    uint32_t thd;
+    if (osm_adcs_harmonics_thd(rms, num_bins, &thd))
+        osm_cmd_ctx_out(ctx,"THD = %"PRIu32".%03"PRIu32"%%", thd/1000, thd%1000);
+    return OSM_COMMAND_RESP_OK;
+syntax_exit:
+    osm_cmd_ctx_out(ctx,"Syntax: cc_harm <channel> [highest harmonic 2-%u]", OSM_ADCS_HARMONICS_MAX);
+    return OSM_COMMAND_RESP_ERR;
+}
+
+
 struct osm_cmd_link_t* osm_cc_add_commands(struct osm_cmd_link_t* tail)
 {
     static struct osm_cmd_link_t cmds[] =
@@ -935,6 +1491,10 @@ struct osm_cmd_link_t* osm_cc_add_commands(struct osm_cmd_link_t* tail)
         { "cc_mp"       , "Set the CC midpoint"     , _cc_mp_cb                      , false , NULL },
         { "cc_gain"     , "Set the max int and ext" , _cc_gain                       , false , NULL },
         { "cc_type"     , "Set type of CT"          , _cc_type_cb                    , false , NULL },
+        { "cc_power"    , "CC power and energy"     , _cc_power_cb                   , false , NULL },
+        { "cc_phase"    , "Set phase of CT"         , _cc_phase_cb                   , false , NULL },
+        { "cc_kwh"      , "Get/Set energy in Wh"    , _cc_kwh_cb                     , false , NULL },
+        { "cc_harm"     , "CC harmonics and THD"    , _cc_harm_cb                    , false , NULL },
     };
     return osm_add_commands(tail, cmds, OSM_ARRAY_SIZE(cmds));
 }
@@ -8,19 +8,25 @@ Documents used:
     : https://maximintegrated.com/en/design/technical-documents/app-notes/2/27.html     (Accessed: 25.03.21)
 */
 #include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
 
 #include <osm/core/log.h>
 #include <osm/core/common.h>
 #include <osm/core/io.h>
 #include <osm/core/w1.h>
+#include <osm/core/w1_rom.h>
+#include <osm/core/persist_config.h>
 #include <osm/sensors/ds18b20.h>
 #include "pinmap.h"
 
-#define DS18B20_CMD_SKIP_ROM        0xCC
 #define DS18B20_CMD_CONV_T          0x44
 #define DS18B20_CMD_READ_SCP        0xBE
 
 #define DS18B20_DEFAULT_COLLECTION_TIME_MS 750
+#define DS18B20_BUS_MAX                    4
+#define DS18B20_ROM_STR_LEN                (OSM_W1_ROM_LEN * 2)
 
 
 typedef union
@@ -46,42 +52,31 @@ typedef struct
 } ds18b20_instance_t;
 
 
-static ds18b20_instance_t _ds18b20_instances[] = DS18B20_INSTANCES;
+/* A probe is either addressed by its mapped ROM, or is the only one on
+ * the bus of its instance. */
+typedef struct
+{
+    uint8_t             w1_index;
+    const uint8_t*      rom;
+} ds18b20_probe_t;
 
 
-static void _ds18b20_read_scpad(ds18b20_memory_t* d, ds18b20_instance_t* instance)
+typedef struct
 {
-    for (int i = 0; i < 9; i++)
-    {
-        d->raw[i] = osm_w1_read_byte(instance->w1_index);
-    }
-}
+    uint32_t            start_ms;
+    bool                started;
+} ds18b20_conversion_t;
+
+
+static ds18b20_instance_t _ds18b20_instances[] = DS18B20_INSTANCES;
+static ds18b20_conversion_t _ds18b20_conversions[DS18B20_BUS_MAX];
 
 
-static bool _ds18b20_crc_check(const uint8_t* mem, uint8_t size)
+static void _ds18b20_read_scpad(ds18b20_memory_t* d, ds18b20_probe_t* probe)
 {
-    uint8_t crc = 0x00;
-    for (uint8_t i = 0; i < size; i++)
-    {
-         uint8_t byte = mem[i];
-         for (uint8_t j = 0; j < 8; ++j)
-         {
-            uint8_t blend = (crc ^ byte) & 0x01;
-            crc >>= 1;
-            if (blend)
-            {
-                crc ^= 0x8C;
-            }
-            byte >>= 1;
-         }
-    }
-    if (crc == mem[size])
-    {
-        return true;
-    }
-    else
+    for (int i = 0; i < 9; i++)
     {
-        return false;
+        d->raw[i] = osm_w1_read_byte(probe->w1_index);
     }
 }
 
@@ -115,39 +110,85 @@ static bool _ds18b20_get_instance(ds18b20_instance_t** instance, char* name)
 }
 
 
-static osm_measurements_sensor_state_t _ds18b20_measurements_init(char* name, bool in_isolation)
+static bool _ds18b20_rom_map_used(const osm_w1_rom_map_t* map)
 {
+    return map->name[0] && (uint8_t)map->name[0] != 0xFF;
+}
+
+
+static osm_w1_rom_map_t* _ds18b20_get_rom_map(const char* name)
+{
+    for (unsigned i = 0; i < OSM_W1_ROM_MAP_MAX; i++)
+    {
+        osm_w1_rom_map_t* map = &persist_measurements.w1_roms[i];
+        if (_ds18b20_rom_map_used(map) &&
+            strncmp(name, map->name, OSM_MEASURE_NAME_LEN) == 0)
+            return map;
+    }
+    return NULL;
+}
+
+
+static bool _ds18b20_get_probe(ds18b20_probe_t* probe, char* name)
+{
+    osm_w1_rom_map_t* map = _ds18b20_get_rom_map(name);
+    if (map)
+    {
+        probe->w1_index = map->w1_index;
+        probe->rom = map->rom;
+        return true;
+    }
     ds18b20_instance_t* instance;
     if (!_ds18b20_get_instance(&instance, name))
+        return false;
+    probe->w1_index = instance->w1_index;
+    probe->rom = NULL;
+    return true;
+}
+
+
+static osm_measurements_sensor_state_t _ds18b20_measurements_init(char* name, bool in_isolation)
+{
+    ds18b20_probe_t probe;
+    if (!_ds18b20_get_probe(&probe, name) || probe.w1_index >= DS18B20_BUS_MAX)
         return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
 
-    if (!osm_w1_reset(instance->w1_index))
+    /* One conversion by all the probes on the bus, read in turn after. */
+    ds18b20_conversion_t* conversion = &_ds18b20_conversions[probe.w1_index];
+    uint32_t now = osm_get_since_boot_ms();
+    if (conversion->started &&
+        osm_since_boot_delta(now, conversion->start_ms) < DS18B20_DEFAULT_COLLECTION_TIME_MS)
+        return OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS;
+
+    if (!osm_w1_reset(probe.w1_index))
     {
         osm_exttemp_debug("Temperature probe did not respond");
         return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
     }
-    osm_w1_send_byte(instance->w1_index, DS18B20_CMD_SKIP_ROM);
-    osm_w1_send_byte(instance->w1_index, DS18B20_CMD_CONV_T);
+    osm_w1_select(probe.w1_index, NULL);
+    osm_w1_send_byte(probe.w1_index, DS18B20_CMD_CONV_T);
+    conversion->start_ms = now;
+    conversion->started = true;
     return OSM_MEASUREMENTS_SENSOR_STATE_SUCCESS;
 }
 
 
 static osm_measurements_sensor_state_t _ds18b20_measurements_collect(char* name, osm_measurements_reading_t* value)
 {
-    ds18b20_instance_t* instance;
-    if (!_ds18b20_get_instance(&instance, name))
+    ds18b20_probe_t probe;
+    if (!_ds18b20_get_probe(&probe, name))
         return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
     ds18b20_memory_t d;
-    if (!osm_w1_reset(instance->w1_index))
+    if (!osm_w1_reset(probe.w1_index))
     {
         osm_exttemp_debug("Temperature probe did not respond");
         return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
     }
-    osm_w1_send_byte(instance->w1_index, DS18B20_CMD_SKIP_ROM);
-    osm_w1_send_byte(instance->w1_index, DS18B20_CMD_READ_SCP);
-    _ds18b20_read_scpad(&d, instance);
+    osm_w1_select(probe.w1_index, probe.rom);
+    osm_w1_send_byte(probe.w1_index, DS18B20_CMD_READ_SCP);
+    _ds18b20_read_scpad(&d, &probe);
 
-    if (!_ds18b20_crc_check(d.raw, 8))
+    if (!osm_w1_crc_check(d.raw, 8))
     {
         osm_exttemp_debug("Data not confirmed by CRC");
         return OSM_MEASUREMENTS_SENSOR_STATE_ERROR;
@@ -213,3 +254,131 @@ void osm_ds18b20_temp_init(void)
         _ds18b20_init_instance(&_ds18b20_instances[i]);
     }
 }
+
+
+static void _ds18b20_rom_to_str(const uint8_t* rom, char str[DS18B20_ROM_STR_LEN + 1])
+{
+    for (unsigned i = 0; i < OSM_W1_ROM_LEN; i++)
+        snprintf(&str[i * 2], 3, "%02X", rom[i]);
+}
+
+
+static bool _ds18b20_rom_from_str(const char* str, uint8_t* rom)
+{
+    for (unsigned i = 0; i < OSM_W1_ROM_LEN; i++)
+    {
+        char byte_str[3] = {str[i * 2], str[i * 2] ? str[i * 2 + 1] : 0, 0};
+        char* end;
+        rom[i] = strtoul(byte_str, &end, 16);
+        if (end != byte_str + 2)
+            return false;
+    }
+    return osm_w1_crc_check(rom, OSM_W1_ROM_LEN - 1);
+}
+
+
+static osm_command_response_t _ds18b20_scan_cb(char* args, osm_cmd_ctx_t * ctx)
+{
+    /* [<bus>]
+     */
+    uint8_t w1_index = strtoul(osm_skip_space(args), NULL, 10);
+    osm_w1_search_t search;
+    osm_w1_search_init(&search);
+    unsigned count = 0;
+    while (osm_w1_search_next(w1_index, &search))
+    {
+        char rom_str[DS18B20_ROM_STR_LEN + 1];
+        _ds18b20_rom_to_str(search.rom, rom_str);
+        const char* name = "";
+        for (unsigned i = 0; i < OSM_W1_ROM_MAP_MAX; i++)
+        {
+            osm_w1_rom_map_t* map = &persist_measurements.w1_roms[i];
+            if (_ds18b20_rom_map_used(map) && map->w1_index == w1_index &&
+                memcmp(map->rom, search.rom, OSM_W1_ROM_LEN) == 0)
+                name = map->name;
+        }
+        osm_cmd_ctx_out(ctx,"%s %.*s", rom_str, OSM_MEASURE_NAME_LEN, name);
+        count++;
+    }
+    osm_cmd_ctx_out(ctx,"%u devices on bus %"PRIu8, count, w1_index);
+    return OSM_COMMAND_RESP_OK;
+}
+
+
+static osm_command_response_t _ds18b20_rom_cb(char* args, osm_cmd_ctx_t * ctx)
+{
+    /* <name> [<rom> [<bus>]|none]
+     */
+    char* p = osm_skip_space(args);
+    char* name = p;
+    p = strchr(p, ' ');
+    if (p)
+    {
+        p[0] = 0;
+        p = osm_skip_space(p + 1);
+    }
+    if (!name[0] || strlen(name) > OSM_MEASURE_NAME_LEN)
+        goto bad_exit;
+    osm_w1_rom_map_t* map = _ds18b20_get_rom_map(name);
+    if (p && p[0])
+    {
+        if (strncmp(p, "none", 4) == 0)
+        {
+            if (map)
+                memset(map, 0, sizeof(osm_w1_rom_map_t));
+            osm_cmd_ctx_out(ctx,"%s has no ROM", name);
+            return OSM_COMMAND_RESP_OK;
+        }
+        uint8_t rom[OSM_W1_ROM_LEN];
+        if (!_ds18b20_rom_from_str(p, rom))
+        {
+            osm_cmd_ctx_error(ctx,"Bad ROM, expected %u hex digits as scanned", DS18B20_ROM_STR_LEN);
+            return OSM_COMMAND_RESP_ERR;
+        }
+        uint8_t w1_index = strtoul(osm_skip_space(p + DS18B20_ROM_STR_LEN), NULL, 10);
+        if (w1_index >= DS18B20_BUS_MAX)
+            goto bad_exit;
+        for (unsigned i = 0; !map && i < OSM_W1_ROM_MAP_MAX; i++)
+        {
+            if (!_ds18b20_rom_map_used(&persist_measurements.w1_roms[i]))
+                map = &persist_measurements.w1_roms[i];
+        }
+        if (!map)
+        {
+            osm_cmd_ctx_error(ctx,"No space for another ROM");
+            return OSM_COMMAND_RESP_ERR;
+        }
+        memset(map, 0, sizeof(osm_w1_rom_map_t));
+        memcpy(map->name, name, strlen(name));
+        memcpy(map->rom, rom, OSM_W1_ROM_LEN);
+        map->w1_index = w1_index;
+        if (!osm_measurements_get_measurements_def(name, NULL, NULL))
+        {
+            osm_measurements_repop_indiv(name, 1, 1, OSM_W1_PROBE);
+            osm_cmd_ctx_out(ctx,"Added measurement %s", name);
+        }
+    }
+    if (!map)
+    {
+        osm_cmd_ctx_out(ctx,"%s has no ROM", name);
+        return OSM_COMMAND_RESP_OK;
+    }
+    char rom_str[DS18B20_ROM_STR_LEN + 1];
+    _ds18b20_rom_to_str(map->rom, rom_str);
+    osm_cmd_ctx_out(ctx,"%s = %s on bus %"PRIu8, name, rom_str, map->w1_index);
+    return OSM_COMMAND_RESP_OK;
+bad_exit:
+    osm_cmd_ctx_error(ctx,"<name> [<rom> [<bus>]|none]");
+    return OSM_COMMAND_RESP_ERR;
+}
+
+
+struct osm_cmd_link_t* osm_ds18b20_add_commands(struct osm_cmd_link_t* tail)
+{
+    static struct osm_cmd_link_t cmds[] =
+    {
+        { "w1_scan"     , "Search a 1-Wire bus"     , _ds18b20_scan_cb               , false , NULL },
+        { "w1_rom"      , "Get/Set ROM of a probe"  , _ds18b20_rom_cb                , false , NULL },
+    };
+    return osm_add_commands(tail, cmds, OSM_ARRAY_SIZE(cmds));
+}
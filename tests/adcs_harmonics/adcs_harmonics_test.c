@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include <osm/core/adcs_harmonics.h>
+
+#include "test.h"
+
+#define TEST_SAMPLES        1500    /* As OSM_ADCS_NUM_SAMPLES */
+#define TEST_CHANNELS       3
+#define TEST_HALF_SAMPLES   120     /* As OSM_ADCS_HALF_SAMPLES */
+#define TEST_CONV_NS        522400  /* As OSM_ADCS_SAMPLE_PERIOD_NS */
+#define TEST_LINE_HZ        50
+#define TEST_ADC_MAX        4095
+#define TEST_BENCH_ROUNDS   2000
+
+
+/* As linux_adc.c's AC wave, with harmonics 2.. as fractions of the
+ * fundamental. Each sample a conversion time after the last. */
+static void test_fill(uint16_t* buf, unsigned channels, double amplitude, double offset, const double* harmonics, unsigned num_harmonics)
+{
+    for (unsigned i = 0; i < TEST_SAMPLES; i++)
+    {
+        double t = i * TEST_CONV_NS / 1e9;
+        double w = 2 * M_PI * TEST_LINE_HZ * t + (i % channels);
+        double v = sin(w);
+        for (unsigned h = 0; h < num_harmonics; h++)
+            v += harmonics[h] * sin((h + 2) * w);
+        v = offset + amplitude * v;
+        if (v < 0)
+            v = 0;
+        else if (v > TEST_ADC_MAX)
+            v = TEST_ADC_MAX;
+        buf[i] = (uint16_t)lround(v);
+    }
+}
+
+
+/* RMS of a channel at a harmonic as a Hann windowed DFT in double finds it, x1000 counts. */
+static double test_dft(const uint16_t* buf, unsigned channel, unsigned channels, unsigned harmonic)
+{
+    unsigned len = (TEST_SAMPLES - channel + channels - 1) / channels;
+    double w = 2 * M_PI * harmonic * TEST_LINE_HZ * channels * TEST_CONV_NS / 1e9;
+    double re = 0, im = 0;
+    for (unsigned n = 0; n < len; n++)
+    {
+        double x = buf[channel + n * channels] * (0.5 - 0.5 * cos(2 * M_PI * n / len));
+        re += x * cos(w * n);
+        im -= x * sin(w * n);
+    }
+    return 2 * M_SQRT2 * sqrt(re * re + im * im) * 1000 / len;
+}
+
+
+static unsigned test_analyse(const uint16_t* buf, unsigned channel, unsigned channels, unsigned num_bins, uint32_t* rms)
+{
+    osm_adcs_harmonics_t harmonics;
+    unsigned len = (TEST_SAMPLES - channel + channels - 1) / channels;
+    unsigned found = osm_adcs_harmonics_init(&harmonics, num_bins, len, TEST_CONV_NS * channels, TEST_LINE_HZ);
+    osm_adcs_harmonics_add(&harmonics, buf, TEST_SAMPLES, channel, channels);
+    if (!osm_adcs_harmonics_get(&harmonics, rms))
+        return 0;
+    return found;
+}
+
+
+static bool test_within(double got, double expected, double fraction)
+{
+    return fabs(got - expected) <= fabs(expected) * fraction;
+}
+
+
+int main(int argc, char * argv[])
+{
+    static uint16_t buf[TEST_SAMPLES];
+    uint32_t rms[OSM_ADCS_HARMONICS_MAX];
+    uint32_t thd;
+    osm_adcs_harmonics_t harmonics;
+
+    /* 3 channels are sampled at 638Hz, the 6th harmonic is past 0.9 Nyquist. */
+    basic_test("Bins to Nyquist of 3 channels", 5, osm_adcs_harmonics_init(&harmonics, OSM_ADCS_HARMONICS_MAX, 500, TEST_CONV_NS * 3, TEST_LINE_HZ));
+    basic_test("Bins to Nyquist of 1 channel", OSM_ADCS_HARMONICS_MAX, osm_adcs_harmonics_init(&harmonics, 20, 1500, TEST_CONV_NS, TEST_LINE_HZ));
+    basic_test("Empty", false, osm_adcs_harmonics_get(&harmonics, rms));
+    osm_adcs_harmonics_add(&harmonics, buf, 100, 0, 1);
+    basic_test("Short of the window", false, osm_adcs_harmonics_get(&harmonics, rms));
+
+    /* Pure sine, not a whole number of cycles, about an off count midpoint. */
+    test_fill(buf, TEST_CHANNELS, 1000, 2047.5, NULL, 0);
+    basic_test("Pure sine bins", 5, test_analyse(buf, 1, TEST_CHANNELS, 5, rms));
+    basic_test("Pure sine fundamental within 0.5%", 1, test_within(rms[0], 1000000 / M_SQRT2, 0.005));
+    basic_test("Pure sine THD", true, osm_adcs_harmonics_thd(rms, 5, &thd));
+    basic_test("Pure sine THD under 0.05%", 1, thd < 50);
+
+    /* Against the DFT in double, every bin of a distorted wave. */
+    const double distortion[] = {0.05, 0.2, 0, 0.1, 0, 0.04};
+    test_fill(buf, 1, 600, 2048, distortion, ARRAY_SIZE(distortion));
+    unsigned found = test_analyse(buf, 0, 1, 9, rms);
+    basic_test("Distorted bins", 9, found);
+    unsigned worst = 0;
+    for (unsigned h = 0; h < found; h++)
+    {
+        unsigned diff = abs((int)rms[h] - (int)lround(test_dft(buf, 0, 1, h + 1)));
+        if (diff > worst)
+            worst = diff;
+    }
+    basic_test("Fixed within 1/100 count of double DFT", 1, worst <= 10);
+    basic_test("Third harmonic within 1%", 1, test_within(rms[2], 600 * 0.2 * 1000 / M_SQRT2, 0.01));
+    double expected_thd = 0;
+    for (unsigned h = 0; h < ARRAY_SIZE(distortion); h++)
+        expected_thd += distortion[h] * distortion[h];
+    expected_thd = sqrt(expected_thd) * 100000;
+    osm_adcs_harmonics_thd(rms, found, &thd);
+    basic_test("Distorted THD within 0.5% of 23.3%", 1, fabs(thd - expected_thd) < 500);
+
+    /* Far off the midpoint, which the window keeps out of the bins. */
+    test_fill(buf, 1, 300, 1587.25, distortion, ARRAY_SIZE(distortion));
+    test_analyse(buf, 0, 1, 9, rms);
+    basic_test("Off midpoint fifth harmonic within 1%", 1, test_within(rms[4], 300 * 0.1 * 1000 / M_SQRT2, 0.01));
+    basic_test("Off midpoint second harmonic within 2%", 1, test_within(rms[1], 300 * 0.05 * 1000 / M_SQRT2, 0.02));
+
+    /* Summed a DMA half at a time, as continuous sampling does. */
+    test_fill(buf, TEST_CHANNELS, 1500, 2048, distortion, 3);
+    uint32_t whole[OSM_ADCS_HARMONICS_MAX];
+    test_analyse(buf, 2, TEST_CHANNELS, 5, whole);
+    osm_adcs_harmonics_init(&harmonics, 5, TEST_SAMPLES / TEST_CHANNELS, TEST_CONV_NS * TEST_CHANNELS, TEST_LINE_HZ);
+    for (unsigned i = 0; i < TEST_SAMPLES; i += TEST_HALF_SAMPLES)
+    {
+        unsigned len = (TEST_SAMPLES - i < TEST_HALF_SAMPLES) ? TEST_SAMPLES - i : TEST_HALF_SAMPLES;
+        osm_adcs_harmonics_add(&harmonics, buf + i, len, 2, TEST_CHANNELS);
+    }
+    osm_adcs_harmonics_get(&harmonics, rms);
+    unsigned same = 0;
+    for (unsigned h = 0; h < 5; h++)
+        same += (rms[h] == whole[h]);
+    basic_test("Accumulated same as whole", 5, same);
+
+    basic_test("No THD of no fundamental", false, osm_adcs_harmonics_thd((uint32_t[2]){0, 10}, 2, &thd));
+
+    /* Host timing, all of one clamp sampled alone. */
+    test_fill(buf, 1, 1000, 2048, distortion, ARRAY_SIZE(distortion));
+    volatile uint32_t sink = 0;
+    clock_t start = clock();
+    for (unsigned n = 0; n < TEST_BENCH_ROUNDS; n++)
+    {
+        test_analyse(buf, 0, 1, OSM_ADCS_HARMONICS_MAX, rms);
+        sink += rms[0];
+    }
+    (void)sink;
+    double us = (double)(clock() - start) * 1e6 / CLOCKS_PER_SEC / TEST_BENCH_ROUNDS;
+    printf("%u bins of %u samples: %.2fus, %.1f ns per sample per bin\n",
+           OSM_ADCS_HARMONICS_MAX, TEST_SAMPLES, us, us * 1000 / (TEST_SAMPLES * OSM_ADCS_HARMONICS_MAX));
+    return 0;
+}
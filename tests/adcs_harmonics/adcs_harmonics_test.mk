@@ -0,0 +1,11 @@
+adcs_harmonics_test_DIR:=$(tests_DIR)/adcs_harmonics
+
+adcs_harmonics_test_CFLAGS:=-I$(adcs_harmonics_test_DIR)
+adcs_harmonics_test_LDFLAGS:=-lm
+
+adcs_harmonics_test_SOURCES:= \
+  $(OSM_DIR)/src/core/adcs_harmonics.c \
+  $(OSM_DIR)/src/core/adcs_rms.c \
+  $(adcs_harmonics_test_DIR)/adcs_harmonics_test.c
+
+$(eval $(call tests_PROGRAM_template,adcs_harmonics_test))
@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include <osm/core/adcs_rms.h>
+
+#include "test.h"
+
+#define TEST_SAMPLES        1500    /* As OSM_ADCS_NUM_SAMPLES */
+#define TEST_CHANNELS       3
+#define TEST_HALF_SAMPLES   120     /* As OSM_ADCS_HALF_SAMPLES */
+#define TEST_CONV_S         522.4e-6
+#define TEST_ADC_MAX        4095
+#define TEST_BENCH_ROUNDS   2000
+
+
+static unsigned test_rand_state = 1234;
+
+static int test_noise(unsigned amplitude)
+{
+    test_rand_state = test_rand_state * 1103515245 + 12345;
+    return (int)((test_rand_state >> 16) % (2 * amplitude + 1)) - (int)amplitude;
+}
+
+
+/* Interleaved channels of 50Hz sine, at the CC sampling rate, clipped to the ADC. */
+static void test_fill(uint16_t* buf, const double* amplitudes, double midpoint, unsigned noise)
+{
+    for (unsigned i = 0; i < TEST_SAMPLES; i++)
+    {
+        unsigned channel = i % TEST_CHANNELS;
+        double t = (double)(i / TEST_CHANNELS) * 522.4e-6;
+        double v = midpoint + amplitudes[channel] * sin(2 * M_PI * 50 * t + channel) + test_noise(noise);
+        if (v < 0)
+            v = 0;
+        else if (v > TEST_ADC_MAX)
+            v = TEST_ADC_MAX;
+        buf[i] = (uint16_t)v;
+    }
+}
+
+
+/* Difference of the fixed point RMS from the double, in 1/1000 of an ADC count. */
+static unsigned test_diff(const uint16_t* buf, unsigned len, unsigned channel, uint32_t midpoint)
+{
+    uint32_t fixed = 0, ref = 0;
+    if (!osm_adcs_rms_fixed(buf, len, channel, TEST_CHANNELS, midpoint, &fixed) ||
+        !osm_adcs_rms_double(buf, len, channel, TEST_CHANNELS, midpoint, &ref))
+        return UINT32_MAX;
+    return (fixed > ref) ? fixed - ref : ref - fixed;
+}
+
+
+/* Real power of a channel against channel 0, as the CC code finds it,
+ * for a clamp the given thirds of a cycle behind the reference. */
+static double test_power(const uint16_t* buf, unsigned channel, unsigned phase)
+{
+    osm_adcs_rms_acc_t x_acc = {0}, v_acc = {0};
+    osm_adcs_rms_power_acc_t p_acc = {0};
+    for (unsigned i = 0; i < TEST_SAMPLES; i += TEST_HALF_SAMPLES)
+    {
+        unsigned len = (TEST_SAMPLES - i < TEST_HALF_SAMPLES) ? TEST_SAMPLES - i : TEST_HALF_SAMPLES;
+        osm_adcs_rms_acc_add(&x_acc, buf + i, len, channel, TEST_CHANNELS);
+        osm_adcs_rms_acc_add(&v_acc, buf + i, len, 0, TEST_CHANNELS);
+        osm_adcs_rms_power_add(&p_acc, buf + i, len, channel, 0, TEST_CHANNELS);
+    }
+    int64_t in_phase, lead;
+    if (!osm_adcs_rms_power_get(&p_acc, &x_acc, &v_acc, 2048000, 2048000, &in_phase, &lead))
+        return 0;
+    double omega = 2 * M_PI * 50;
+    double theta = 2 * M_PI * phase / 3 - omega * TEST_CONV_S * channel;
+    double lead_scale = 2 * sin(omega * TEST_CONV_S * TEST_CHANNELS);
+    return (in_phase * cos(theta) - lead * sin(theta) / lead_scale) / 1e6;
+}
+
+
+static double test_bench(bool (*rms_cb)(const uint16_t*, unsigned, unsigned, unsigned, uint32_t, uint32_t*), const uint16_t* buf)
+{
+    volatile uint32_t sink = 0;
+    clock_t start = clock();
+    for (unsigned n = 0; n < TEST_BENCH_ROUNDS; n++)
+    {
+        for (unsigned channel = 0; channel < TEST_CHANNELS; channel++)
+        {
+            uint32_t rms;
+            rms_cb(buf, TEST_SAMPLES, channel, TEST_CHANNELS, 2048000, &rms);
+            sink += rms;
+        }
+    }
+    (void)sink;
+    return (double)(clock() - start) * 1e6 / CLOCKS_PER_SEC / TEST_BENCH_ROUNDS;
+}
+
+
+int main(int argc, char * argv[])
+{
+    static uint16_t buf[TEST_SAMPLES];
+
+    basic_test("Sqrt 0", 0, osm_adcs_rms_isqrt(0));
+    basic_test("Sqrt 1", 1, osm_adcs_rms_isqrt(1));
+    basic_test("Sqrt 2 rounds down", 1, osm_adcs_rms_isqrt(2));
+    basic_test("Sqrt 3 rounds up", 2, osm_adcs_rms_isqrt(3));
+    basic_test("Sqrt 1000000", 1000, osm_adcs_rms_isqrt(1000000));
+    basic_test("Sqrt largest", UINT32_MAX, osm_adcs_rms_isqrt(UINT64_MAX));
+    basic_test("Sqrt 4095^2", 4095, osm_adcs_rms_isqrt(4095 * 4095));
+
+    /* Known RMS, a square wave of +-100 about 2000. */
+    for (unsigned i = 0; i < TEST_SAMPLES; i++)
+        buf[i] = (i / TEST_CHANNELS) % 2 ? 2100 : 1900;
+    uint32_t rms = 0;
+    basic_test("Square wave", true, osm_adcs_rms_fixed(buf, TEST_SAMPLES, 1, TEST_CHANNELS, 2000000, &rms));
+    basic_test("Square wave RMS", 2000000 - 100000, rms);
+    basic_test("Sum squares tail", 100 * 100 * 3, osm_adcs_rms_sum_squares(buf, 9, 0, 3, 2000));
+    basic_test("No step", false, osm_adcs_rms_fixed(buf, TEST_SAMPLES, 0, 0, 2000000, &rms));
+
+    /* Against the double version, quiet to clipped and off midpoint. */
+    const double amplitudes[][TEST_CHANNELS] = {{0, 0, 0}, {10, 300, 1200}, {2000, 2500, 50}};
+    const uint32_t midpoints[] = {2048000, 2047513, 1987250};
+    unsigned worst = 0;
+    for (unsigned a = 0; a < ARRAY_SIZE(amplitudes); a++)
+    {
+        for (unsigned m = 0; m < ARRAY_SIZE(midpoints); m++)
+        {
+            test_fill(buf, amplitudes[a], midpoints[m] / 1000., 20);
+            for (unsigned channel = 0; channel < TEST_CHANNELS; channel++)
+            {
+                unsigned diff = test_diff(buf, TEST_SAMPLES, channel, midpoints[m]);
+                if (diff > worst)
+                    worst = diff;
+                /* Odd lengths run the tail after the unrolled loop. */
+                diff = test_diff(buf, TEST_SAMPLES - 7, channel, midpoints[m]);
+                if (diff > worst)
+                    worst = diff;
+            }
+        }
+    }
+    basic_test("Fixed within 1/1000 count of double", 1, worst <= 1);
+
+    /* Summed a DMA half at a time, as continuous sampling does, against the whole buffer. */
+    const double acc_amplitudes[TEST_CHANNELS] = {0, 700, 1800};
+    test_fill(buf, acc_amplitudes, 2047.513, 20);
+    worst = 0;
+    for (unsigned channel = 0; channel < TEST_CHANNELS; channel++)
+    {
+        osm_adcs_rms_acc_t acc = {0};
+        /* The last half is only part used, as it is by the ADC code. */
+        for (unsigned i = 0; i < TEST_SAMPLES; i += TEST_HALF_SAMPLES)
+        {
+            unsigned len = (TEST_SAMPLES - i < TEST_HALF_SAMPLES) ? TEST_SAMPLES - i : TEST_HALF_SAMPLES;
+            osm_adcs_rms_acc_add(&acc, buf + i, len, channel, TEST_CHANNELS);
+        }
+        /* Exact midpoint here, where the buffer kernels drop its fraction. */
+        double sum = 0;
+        for (unsigned i = channel; i < TEST_SAMPLES; i += TEST_CHANNELS)
+            sum += (buf[i] - 2047.513) * (buf[i] - 2047.513);
+        uint32_t whole = 2047513 - (uint32_t)round(sqrt(sum / (TEST_SAMPLES / TEST_CHANNELS)) * 1000);
+        uint32_t folded = 0;
+        osm_adcs_rms_acc_get_rms(&acc, 2047513, &folded);
+        unsigned diff = (folded > whole) ? folded - whole : whole - folded;
+        if (diff > worst)
+            worst = diff;
+    }
+    basic_test("Accumulated within 1/1000 count of whole", 1, worst <= 1);
+
+    osm_adcs_rms_acc_t acc = {0};
+    basic_test("Empty accumulator", false, osm_adcs_rms_acc_get_avg(&acc, &rms));
+    for (unsigned i = 0; i < TEST_SAMPLES; i++)
+        buf[i] = (i / TEST_CHANNELS) % 2 ? 2100 : 1900;
+    osm_adcs_rms_acc_add(&acc, buf, TEST_HALF_SAMPLES, 2, TEST_CHANNELS);
+    osm_adcs_rms_acc_add(&acc, buf + TEST_HALF_SAMPLES, TEST_HALF_SAMPLES, 2, TEST_CHANNELS);
+    uint32_t avg = 0;
+    basic_test("Accumulated average", true, osm_adcs_rms_acc_get_avg(&acc, &avg));
+    basic_test("Accumulated average value", 2000000, avg);
+    basic_test("Accumulated square wave", true, osm_adcs_rms_acc_get_rms(&acc, 2000000, &rms));
+    basic_test("Accumulated square wave RMS", 2000000 - 100000, rms);
+
+    /* Voltage on channel 0, a lagging current on its phase and a leading
+     * one on the phase a third of a cycle behind, each converted a
+     * conversion time after the last. */
+    const double v_amp = 1500, i_amp = 600, lag = 0.6, lead = -0.3;
+    for (unsigned i = 0; i < TEST_SAMPLES; i += TEST_CHANNELS)
+    {
+        double t = i * TEST_CONV_S;
+        double w = 2 * M_PI * 50;
+        buf[i] = (uint16_t)lround(2048 + v_amp * sin(w * t));
+        buf[i + 1] = (uint16_t)lround(2048 + i_amp * sin(w * (t + TEST_CONV_S) - lag));
+        buf[i + 2] = (uint16_t)lround(2048 + i_amp * sin(w * (t + 2 * TEST_CONV_S) - 2 * M_PI / 3 - lead));
+    }
+    double expected = v_amp * i_amp / 2;
+    basic_test("Power in phase within 1%", 1, fabs(test_power(buf, 1, 0) - expected * cos(lag)) < expected / 100);
+    basic_test("Power of second phase within 1%", 1, fabs(test_power(buf, 2, 1) - expected * cos(lead)) < expected / 100);
+
+    const double bench_amplitudes[TEST_CHANNELS] = {300, 800, 1500};
+    test_fill(buf, bench_amplitudes, 2048, 20);
+    double fixed_us = test_bench(osm_adcs_rms_fixed, buf);
+    double double_us = test_bench(osm_adcs_rms_double, buf);
+    printf("RMS of %u channels of %u samples: fixed %.2fus, double %.2fus\n",
+           TEST_CHANNELS, TEST_SAMPLES / TEST_CHANNELS, fixed_us, double_us);
+    return 0;
+}
@@ -0,0 +1,10 @@
+adcs_rms_test_DIR:=$(tests_DIR)/adcs_rms
+
+adcs_rms_test_CFLAGS:=-I$(adcs_rms_test_DIR)
+adcs_rms_test_LDFLAGS:=-lm
+
+adcs_rms_test_SOURCES:= \
+  $(OSM_DIR)/src/core/adcs_rms.c \
+  $(adcs_rms_test_DIR)/adcs_rms_test.c
+
+$(eval $(call tests_PROGRAM_template,adcs_rms_test))
@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include <osm/core/backlog.h>
+#include <osm/core/config.h>
+
+#include "test.h"
+
+#define TEST_FLASH_PAGES    4
+#define TEST_RECORD_LEN     20
+
+
+static uint8_t  _test_flash[TEST_FLASH_PAGES][OSM_BACKLOG_FLASH_PAGE_SIZE];
+static unsigned _test_flash_pages = 0;
+static unsigned _test_flash_misaligned = 0;
+
+
+void osm_log_debug(uint32_t flag, const char * s, ...) {}
+void osm_log_error(const char * s, ...) {}
+
+
+unsigned osm_platform_backlog_flash_pages(void)
+{
+    return _test_flash_pages;
+}
+
+
+const uint8_t* osm_platform_backlog_flash_page(unsigned page)
+{
+    return _test_flash[page];
+}
+
+
+bool osm_platform_backlog_flash_erase(unsigned page)
+{
+    memset(_test_flash[page], 0xFF, OSM_BACKLOG_FLASH_PAGE_SIZE);
+    return true;
+}
+
+
+bool osm_platform_backlog_flash_write(unsigned page, unsigned offset, const void * data, unsigned size)
+{
+    const uint8_t* src = (const uint8_t*)data;
+    if (offset % 8)
+        _test_flash_misaligned++;
+    for (unsigned n = 0; n < size; n++)
+        _test_flash[page][offset + n] &= src[n];
+    return memcmp(_test_flash[page] + offset, src, size) == 0;
+}
+
+
+static void test_push(uint32_t seq)
+{
+    int8_t data[TEST_RECORD_LEN];
+    memset(data, (int8_t)seq, sizeof(data));
+    memcpy(data, &seq, sizeof(seq));
+    osm_backlog_push(seq, data, sizeof(data));
+}
+
+
+/* Drain everything, returning how many of the records broke order. */
+static unsigned test_drain(uint32_t first_seq, bool timestamps_known, unsigned* drained)
+{
+    unsigned errors = 0;
+    uint32_t expected = first_seq;
+    *drained = 0;
+
+    while (osm_backlog_get_count())
+    {
+        int8_t data[OSM_BACKLOG_RECORD_MAX_SIZE];
+        uint32_t timestamp, seq;
+        unsigned len = osm_backlog_peek(&timestamp, data, sizeof(data));
+        memcpy(&seq, data, sizeof(seq));
+        if (len != TEST_RECORD_LEN || seq != expected ||
+            (uint8_t)data[TEST_RECORD_LEN - 1] != (uint8_t)seq)
+            errors++;
+        if (timestamps_known && timestamp != seq)
+            errors++;
+        osm_backlog_pop();
+        expected = seq + 1;
+        (*drained)++;
+    }
+    return errors;
+}
+
+
+int main(int argc, char * argv[])
+{
+    unsigned drained;
+    unsigned ram_records = (OSM_BACKLOG_RAM_SIZE - 1) / (TEST_RECORD_LEN + 6);
+
+    /* RAM only, oldest are dropped. */
+    _test_flash_pages = 0;
+    osm_backlog_init();
+    for (uint32_t n = 0; n < 100; n++)
+        test_push(n);
+    basic_test("RAM count", ram_records, osm_backlog_get_count());
+    basic_test("RAM dropped", 100 - ram_records, osm_backlog_get_dropped());
+    basic_test("RAM order", 0, test_drain(100 - ram_records, true, &drained));
+    basic_test("RAM drained", ram_records, drained);
+
+    /* Spill into flash, all kept. */
+    _test_flash_pages = TEST_FLASH_PAGES;
+    memset(_test_flash, 0, sizeof(_test_flash));
+    osm_backlog_init();
+    for (uint32_t n = 0; n < 150; n++)
+        test_push(n);
+    basic_test("Flash count", 150, osm_backlog_get_count());
+    basic_test("Flash dropped", 0, osm_backlog_get_dropped());
+    basic_test("Flash order", 0, test_drain(0, true, &drained));
+    basic_test("Flash drained", 150, drained);
+
+    /* Partly send, then reset. Only what spilled to flash survives. */
+    for (uint32_t n = 200; n < 350; n++)
+        test_push(n);
+    for (unsigned n = 0; n < 10; n++)
+        osm_backlog_pop();
+    unsigned in_flash = 150 - ram_records - 10;
+    osm_backlog_init();
+    basic_test("Reset count", in_flash, osm_backlog_get_count());
+    uint32_t timestamp;
+    int8_t data[OSM_BACKLOG_RECORD_MAX_SIZE];
+    osm_backlog_peek(&timestamp, data, sizeof(data));
+    basic_test("Reset timestamp unknown", OSM_BACKLOG_TIMESTAMP_UNKNOWN, timestamp);
+
+    /* New records after reset keep going after the old ones. */
+    for (uint32_t n = 0; n < 2 * ram_records; n++)
+        test_push(200 + 10 + in_flash + n);
+    basic_test("Reset order", 0, test_drain(210, false, &drained));
+    basic_test("Reset drained", in_flash + 2 * ram_records, drained);
+
+    /* Overflow flash too, oldest pages go. */
+    osm_backlog_init();
+    for (uint32_t n = 1000; n < 1400; n++)
+        test_push(n);
+    unsigned count = osm_backlog_get_count();
+    basic_test("Overflow accounted", 400, count + osm_backlog_get_dropped());
+    basic_test("Overflow order", 0, test_drain(1400 - count, true, &drained));
+    basic_test("Overflow drained", count, drained);
+
+    /* One too big is refused, and counted as dropped. */
+    unsigned dropped = osm_backlog_get_dropped();
+    int8_t too_big[OSM_BACKLOG_RECORD_MAX_SIZE + 1] = {0};
+    basic_test("Too big refused", false, osm_backlog_push(0, too_big, sizeof(too_big)));
+    basic_test("Too big dropped", dropped + 1, osm_backlog_get_dropped());
+
+    basic_test("Flash aligned", 0, _test_flash_misaligned);
+    return 0;
+}
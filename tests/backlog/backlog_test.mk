@@ -0,0 +1,10 @@
+backlog_test_DIR:=$(tests_DIR)/backlog
+
+backlog_test_CFLAGS:=-I$(backlog_test_DIR)
+
+backlog_test_SOURCES:= \
+  $(OSM_DIR)/src/core/ring.c \
+  $(OSM_DIR)/src/core/backlog.c \
+  $(backlog_test_DIR)/backlog_test.c
+
+$(eval $(call tests_PROGRAM_template,backlog_test))
@@ -31,11 +31,14 @@
 
 #include <osm/core/config.h>
 #include <osm/core/log.h>
+#include <osm/core/measurements.h>
 
 
 static bool (*_test_comms_send)(int8_t* hex_arr, uint16_t arr_len) = NULL;
 static void (*_log_error)(char * s) = NULL;
 static void (*_log_debug)(uint32_t flag, char * s) = NULL;
+static osm_measurements_stats_t _test_stats;
+static bool _test_stats_enabled = false;
 
 
 void test_comms_send_set_cb(bool (*cb)(int8_t* hex_arr, uint16_t arr_len))
@@ -44,6 +47,24 @@ void test_comms_send_set_cb(bool (*cb)(int8_t* hex_arr, uint16_t arr_len))
 }
 
 
+void test_stats_set(bool enabled, int64_t stddev, int64_t p50, int64_t p95)
+{
+    _test_stats_enabled = enabled;
+    _test_stats.stddev = stddev;
+    _test_stats.p50 = p50;
+    _test_stats.p95 = p95;
+}
+
+
+bool osm_measurements_get_stats(osm_measurements_data_t* data, osm_measurements_stats_t* stats)
+{
+    if (!_test_stats_enabled)
+        return false;
+    *stats = _test_stats;
+    return true;
+}
+
+
 void log_error_set_cb(void (*cb)(char * s))
 {
     _log_error = cb;
@@ -59,21 +80,23 @@ void log_debug_set_cb(void (*cb)(uint32_t flag, char * s))
 static int _log(const char* prefix, const char * s, va_list ap, char** buf)
 {
     unsigned prefix_len = strlen(prefix);
-    unsigned len = vsnprintf(NULL, 0, s, ap);
+    va_list ap_len;
+    va_copy(ap_len, ap);
+    unsigned len = vsnprintf(NULL, 0, s, ap_len);
+    va_end(ap_len);
     *buf = malloc(len + prefix_len + 1);
-    if (!buf)
+    if (!*buf)
     {
         /* Ran out of memory */
         return -1;
     }
-    strncpy(*buf, prefix, prefix_len);
-    len = vsnprintf(*buf + prefix_len, len+1, s, ap);
-    buf[len + prefix_len + 1] = 0;
+    memcpy(*buf, prefix, prefix_len);
+    len = vsnprintf(*buf + prefix_len, len + 1, s, ap);
     return len;
 }
 
 
-void PRINTF_FMT_CHECK( 1, 2) log_error(const char * s, ...)
+void OSM_PRINTF_FMT_CHECK( 1, 2) osm_log_error(const char * s, ...)
 {
     if (_log_error)
     {
@@ -81,13 +104,14 @@ void PRINTF_FMT_CHECK( 1, 2) log_error(const char * s, ...)
         va_start(ap, s);
         char* buf = NULL;
         _log("ERROR:", s, ap, &buf);
+        va_end(ap);
         _log_error(buf);
         free(buf);
     }
 }
 
 
-void PRINTF_FMT_CHECK( 2, 3) log_debug(uint32_t flag, const char * s, ...)
+void OSM_PRINTF_FMT_CHECK( 2, 3) osm_log_debug(uint32_t flag, const char * s, ...)
 {
     if (_log_debug)
     {
@@ -95,13 +119,14 @@ void PRINTF_FMT_CHECK( 2, 3) log_debug(uint32_t flag, const char * s, ...)
         va_start(ap, s);
         char* buf = NULL;
         _log("DEBUG:", s, ap, &buf);
+        va_end(ap);
         _log_debug(flag, buf);
         free(buf);
     }
 }
 
 
-bool test_comms_send(int8_t* hex_arr, uint16_t arr_len)
+bool osm_test_comms_send(int8_t* hex_arr, uint16_t arr_len)
 {
     if (_test_comms_send)
     {
@@ -110,3 +135,9 @@ bool test_comms_send(int8_t* hex_arr, uint16_t arr_len)
     return false;
 }
 
+
+uint16_t osm_test_comms_get_mtu(void)
+{
+    /* LoRaWAN's largest */
+    return 242;
+}
@@ -3,5 +3,6 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-bool test_comms_send(int8_t* hex_arr, uint16_t arr_len);
+bool osm_test_comms_send(int8_t* hex_arr, uint16_t arr_len);
+uint16_t osm_test_comms_get_mtu(void);
 
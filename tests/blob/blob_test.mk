@@ -20,6 +20,20 @@ $(tests_OSM_BUILD_DIR)/tests/blob/bloblib.so: $(tests_OSM_BUILD_DIR)/tests/blob/
 	@mkdir -p $(@D)
 	$(CC) $^ $(tests_LDFLAGS) -shared -o $@
 
+blob_test_compact_OBJS:=$(blob_test_SOURCES:%.c=$(OSM_BUILD_DIR)/tests/compact/%.o)
+
+$(blob_test_compact_OBJS): $(OSM_BUILD_DIR)/tests/compact/%.o: $(OSM_DIR)/%.c
+	@mkdir -p "$(@D)"
+	$(CC) -c $(tests_CFLAGS) $(blob_test_CFLAGS) -DOSM_PROTOCOL_HEXBLOB_COMPACT $< -o $@
+
+$(tests_OSM_BUILD_DIR)/tests/blob/bloblib_compact.o: $(blob_test_compact_OBJS)
+	@mkdir -p $(@D)
+	ld -r $^ -o $@
+
+$(tests_OSM_BUILD_DIR)/tests/blob/bloblib_compact.so: $(tests_OSM_BUILD_DIR)/tests/blob/bloblib_compact.o
+	@mkdir -p $(@D)
+	$(CC) $^ $(tests_LDFLAGS) -shared -o $@
+
 $(tests_OSM_BUILD_DIR)/tests/blob/blob_tests.py: $(blob_test_DIR)/blob_tests.py
 	@mkdir -p $(@D)
 	cp $< $@
@@ -33,7 +47,7 @@ $(tests_OSM_BUILD_DIR)/tests/blob/cs_protocol.js: $(OSM_DIR)/lorawan_protocol/cs
 	@mkdir -p $(@D)
 	cp $< $@
 
-build/tests/blob_test.elf: $(tests_OSM_BUILD_DIR)/tests/blob/blob_tests.py $(tests_OSM_BUILD_DIR)/tests/blob/bloblib.so $(tests_OSM_BUILD_DIR)/tests/blob/debug.js $(tests_OSM_BUILD_DIR)/tests/blob/cs_protocol.js
+build/tests/blob_test.elf: $(tests_OSM_BUILD_DIR)/tests/blob/blob_tests.py $(tests_OSM_BUILD_DIR)/tests/blob/bloblib.so $(tests_OSM_BUILD_DIR)/tests/blob/bloblib_compact.so $(tests_OSM_BUILD_DIR)/tests/blob/debug.js $(tests_OSM_BUILD_DIR)/tests/blob/cs_protocol.js
 	echo "#!/bin/sh \n\
-	python3 $(shell realpath $(tests_OSM_BUILD_DIR)/tests/blob/blob_tests.py) $(shell realpath $(tests_OSM_BUILD_DIR)/tests/blob/bloblib.so)" > $@
+	python3 $(shell realpath $(tests_OSM_BUILD_DIR)/tests/blob/blob_tests.py) $(shell realpath $(tests_OSM_BUILD_DIR)/tests/blob/bloblib.so) $(shell realpath $(tests_OSM_BUILD_DIR)/tests/blob/bloblib_compact.so)" > $@
 	chmod +x $@
@@ -6,6 +6,7 @@ import sys
 import enum
 import math
 import yaml
+import shutil
 import ctypes
 import datetime
 import subprocess
@@ -31,6 +32,19 @@ class value_s_t(ctypes.Structure):
     ]
 
 
+class io_event_t(ctypes.Structure):
+    """
+    uint32_t    ms;
+    uint8_t     io;
+    uint8_t     level;
+    """
+    _fields_ = [
+        ("ms"   , ctypes.c_uint32 ),
+        ("io"   , ctypes.c_ubyte  ),
+        ("level", ctypes.c_ubyte  ),
+    ]
+
+
 class measurements_value_t(ctypes.Union):
     """
     union
@@ -130,7 +144,7 @@ class measurements_data_t(ctypes.Structure):
     uint8_t                 num_samples:7;
     uint8_t                 has_sent:1;
     uint8_t                 num_samples_init:7;
-    uint8_t                 _:1;
+    uint8_t                 inf_cached:1;
     uint8_t                 num_samples_collected:7;
     uint8_t                 __:1;
     uint32_t                collection_time_cache;
@@ -143,7 +157,7 @@ class measurements_data_t(ctypes.Structure):
         ("num_samples"              , ctypes.c_ubyte        , 7 ),
         ("has_sent"                 , ctypes.c_ubyte        , 1 ),
         ("num_samples_init"         , ctypes.c_ubyte        , 7 ),
-        ("_"                        , ctypes.c_ubyte        , 1 ),
+        ("inf_cached"               , ctypes.c_ubyte        , 1 ),
         ("num_samples_collected"    , ctypes.c_ubyte        , 7 ),
         ("__"                       , ctypes.c_ubyte        , 1 ),
         ("collection_time_cache"    , ctypes.c_uint             ),
@@ -176,7 +190,6 @@ class test_blob(object):
 
     def __init__(self, lib_blob):
         self.lib = lib_blob
-        self.lib.connect()
         self._TEST_COMMS_SEND_FUNC = ctypes.CFUNCTYPE(
             ctypes.c_bool,                  # Retval
             ctypes.POINTER(ctypes.c_byte),  # Param1
@@ -261,7 +274,7 @@ class test_blob(object):
         def_, data = self.construct_measurement(*args, **kwargs)
         self.measurements.append((def_, data))
         return self.bool_check(f"Append measurement '{args[0]}'",
-            self.lib.protocol_append_measurement(ctypes.pointer(def_), ctypes.pointer(data))
+            self.lib.osm_protocol_append_measurement(ctypes.pointer(def_), ctypes.pointer(data))
             )
 
     def _threshold_check_measurement(self, dict_, measurement):
@@ -280,7 +293,7 @@ class test_blob(object):
 
     def test(self) -> bool:
         success = True
-        self.lib.protocol_init()
+        self.lib.osm_protocol_init()
 
         self.measurements = []
         success &= self._bool_check_add_measurement(
@@ -292,7 +305,7 @@ class test_blob(object):
 
         self._sent_packet = None
         success &= self.bool_check("Send protocol",
-            self.lib.protocol_send()
+            self.lib.osm_protocol_send()
             )
         if not self._sent_packet:
             self._log(f"Packet is empty? {self._sent_packet}")
@@ -300,15 +313,169 @@ class test_blob(object):
 
         packet_str = "".join([f"{i:02X}" for i in self._sent_packet])
 
-        command = f"js {self.COMMS_PROTOCOL_PATH}".split() + ["%s"%packet_str]
+        resp_dict = self._decode([packet_str])
+        for measurement in self.measurements:
+            self._threshold_check_measurement(resp_dict, measurement)
+        return success
+
+    def test_stats(self) -> bool:
+        success = True
+        self.lib.osm_protocol_init()
+        self.measurements = []
+        # Floats are sent x1000, as the values they go with.
+        self.lib.test_stats_set(ctypes.c_bool(True), ctypes.c_longlong(420), ctypes.c_longlong(23400), ctypes.c_longlong(23900))
+        success &= self._bool_check_add_measurement(
+            "TEMP",
+            23.5,
+            measurements_def_t.TYPES.HTU21D_TMP,
+            min_ = 23.,
+            max_ = 24.)
+        self.lib.test_stats_set(ctypes.c_bool(False), ctypes.c_longlong(0), ctypes.c_longlong(0), ctypes.c_longlong(0))
+        self._sent_packet = None
+        success &= self.bool_check("Send protocol with stats", self.lib.osm_protocol_send())
+        resp_dict = self._decode(["".join([f"{i:02X}" for i in self._sent_packet])])
+        for measurement in self.measurements:
+            success &= self._threshold_check_measurement(resp_dict, measurement)
+        success &= self.threshold_check("Measurement 'TEMP Stddev'", 0.42, resp_dict.get("TEMP_sd", -1))
+        success &= self.threshold_check("Measurement 'TEMP Median'", 23.4, resp_dict.get("TEMP_p50", -1))
+        success &= self.threshold_check("Measurement 'TEMP P95'", 23.9, resp_dict.get("TEMP_p95", -1))
+        return success
+
+    def test_batch(self) -> bool:
+        success = True
+        TYPES = measurements_def_t.TYPES
+        intervals = [
+            (0,   [("TEMP", 21.5, TYPES.HTU21D_TMP, 21.,  22.), ("HUMI", 40.2, TYPES.HTU21D_HUM, 39.8, 40.9)]),
+            (300, [("HUMI", 41.0, TYPES.HTU21D_HUM, 40.1, 41.6)]),
+            (600, [("TEMP", 22.1, TYPES.HTU21D_TMP, 21.8, 22.4)]),
+        ]
+        age = 900
+        payload = None
+        sent = []
+        for offset, readings in intervals:
+            if payload is None:
+                success &= self.bool_check("Init batch", self.lib.osm_protocol_init_backlog())
+            else:
+                success &= self.bool_check("Resume batch",
+                    self.lib.osm_protocol_resume(payload, ctypes.c_uint(len(payload))))
+                success &= self.bool_check("Append interval",
+                    self.lib.osm_protocol_append_interval(ctypes.c_uint32(offset)))
+            self.measurements = []
+            for name, avg, type_, min_, max_ in readings:
+                success &= self._bool_check_add_measurement(name, avg, type_, min_=min_, max_=max_)
+            sent.append(self.measurements)
+            buf = ctypes.POINTER(ctypes.c_byte)()
+            length = self.lib.osm_protocol_get_payload(ctypes.byref(buf))
+            payload = (ctypes.c_byte * length)(*buf[:length])
+
+        self._sent_packet = None
+        success &= self.bool_check("Send batch",
+            self.lib.osm_protocol_send_backlog(payload, ctypes.c_uint(len(payload)), ctypes.c_uint32(age)))
+        resp_dict = self._decode(["".join([f"{i:02X}" for i in self._sent_packet])])
+        resp_intervals = resp_dict.get("INTERVALS", [])
+        success &= self.bool_check("Batch intervals", len(resp_intervals) == len(intervals))
+        success &= self.bool_check("Batch age", resp_dict.get("AGE") == age)
+        for resp_interval, (offset, readings), measurements in zip(resp_intervals, intervals, sent):
+            success &= self.bool_check(f"Interval offset {offset}", resp_interval.get("OFFSET") == offset)
+            success &= self.bool_check(f"Interval age {age - offset}", resp_interval.get("AGE") == age - offset)
+            for measurement in measurements:
+                success &= self._threshold_check_measurement(resp_interval, measurement)
+        return success
+
+    def test_compact(self) -> bool:
+        success = True
+        TYPES = measurements_def_t.TYPES
+        intervals = [
+            [("TEMP", 23.5, TYPES.HTU21D_TMP, 23., 24.), ("HUMI", 45.2, TYPES.HTU21D_HUM, 44.1, 46.), ("BAT", 3.61, TYPES.BAT_MON)],
+            [("TEMP", 23.6, TYPES.HTU21D_TMP, 23.1, 24.), ("HUMI", 45.0, TYPES.HTU21D_HUM, 44.5, 45.5), ("BAT", 3.60, TYPES.BAT_MON)],
+            # Not acked, so the next interval must not be relative to it.
+            [("TEMP", 23.8, TYPES.HTU21D_TMP, 23.3, 24.2), ("HUMI", 44.0, TYPES.HTU21D_HUM, 43.5, 44.5), ("BAT", 3.60, TYPES.BAT_MON)],
+            [("TEMP", 22.9, TYPES.HTU21D_TMP, 22.5, 23.1), ("HUMI", 46.0, TYPES.HTU21D_HUM, 45.5, 46.5), ("BAT", 3.59, TYPES.BAT_MON)],
+            [("TEMP", 23.0, TYPES.HTU21D_TMP, 22.6, 23.4), ("HUMI", 46.1, TYPES.HTU21D_HUM, 45.9, 46.5), ("BAT", 3.59, TYPES.BAT_MON)],
+        ]
+        acks = [True, True, False, True, True]
+        # Sent, and acked, between the live ones it must not upset.
+        backlog_after = 1
+        backlog = [("TEMP", 31.2, TYPES.HTU21D_TMP, 30.5, 31.9), ("PRES", 1012.5, TYPES.CUSTOM_0, 1011., 1013.)]
+        backlog_age = 3600
+        packets = []
+        sent = []
+        for n, (readings, ack) in enumerate(zip(intervals, acks)):
+            self.lib.osm_protocol_init()
+            self.measurements = []
+            for reading in readings:
+                name, avg, type_ = reading[:3]
+                kwargs = {"min_": reading[3], "max_": reading[4]} if len(reading) > 3 else {"count": 1}
+                success &= self._bool_check_add_measurement(name, avg, type_, **kwargs)
+            self._sent_packet = None
+            success &= self.bool_check("Send compact protocol", self.lib.osm_protocol_send())
+            success &= self.bool_check("Compact version", self._sent_packet[0] == 3)
+            packets.append("".join([f"{i:02X}" for i in self._sent_packet]))
+            sent.append(self.measurements)
+            self.lib.osm_protocol_sent_ack(ctypes.c_bool(ack))
+            if n == backlog_after:
+                success &= self.bool_check("Init compact backlog", self.lib.osm_protocol_init_backlog())
+                self.measurements = []
+                for name, avg, type_, min_, max_ in backlog:
+                    success &= self._bool_check_add_measurement(name, avg, type_, min_=min_, max_=max_)
+                buf = ctypes.POINTER(ctypes.c_byte)()
+                length = self.lib.osm_protocol_get_payload(ctypes.byref(buf))
+                payload = (ctypes.c_byte * length)(*buf[:length])
+                self._sent_packet = None
+                success &= self.bool_check("Send compact backlog",
+                    self.lib.osm_protocol_send_backlog(payload, ctypes.c_uint(length), ctypes.c_uint32(backlog_age)))
+                success &= self.bool_check("Compact backlog sequence", self._sent_packet[1] == 0)
+                backlog_packet = "".join([f"{i:02X}" for i in self._sent_packet])
+                backlog_sent = self.measurements
+                self.lib.osm_protocol_sent_ack(ctypes.c_bool(True))
+
+        uplinks = list(packets)
+        uplinks.insert(backlog_after + 1, backlog_packet)
+        resp_dicts = self._decode(uplinks)
+        backlog_dict = resp_dicts.pop(backlog_after + 1)
+        for measurement in backlog_sent:
+            success &= self._threshold_check_measurement(backlog_dict, measurement)
+        success &= self.bool_check("Compact backlog age", backlog_dict.get("AGE") == backlog_age)
+        # Decodes alone, defining all it uses.
+        alone_dict = self._decode([backlog_packet])
+        for measurement in backlog_sent:
+            success &= self._threshold_check_measurement(alone_dict, measurement)
+        for resp_dict, measurements in zip(resp_dicts, sent):
+            for measurement in measurements:
+                success &= self._threshold_check_measurement(resp_dict, measurement)
+
+        sizes = [len(packet) // 2 for packet in packets]
+        self._log(f"Compact sizes: {sizes}")
+        success &= self.bool_check("Definitions dropped once acked", sizes[1] < sizes[0])
+        success &= self.bool_check("Absolute after unacked send", sizes[3] > sizes[1])
+        return success
+
+    def test_io_events(self) -> bool:
+        success = True
+        now = 100000
+        edges = [(94000, 3, 1), (94020, 3, 0), (94020, 5, 1), (99950, 3, 1)]
+        dropped = 7
+        events = (io_event_t * len(edges))(*[io_event_t(ms=ms, io=io, level=level) for ms, io, level in edges])
+        self.lib.osm_protocol_init()
+        success &= self.bool_check("Append IO events",
+            self.lib.osm_protocol_append_io_events(events, ctypes.c_uint(len(edges)), ctypes.c_uint32(dropped), ctypes.c_uint32(now)))
+        self._sent_packet = None
+        success &= self.bool_check("Send IO events", self.lib.osm_protocol_send())
+        resp_dict = self._decode(["".join([f"{i:02X}" for i in self._sent_packet])])
+        expected = [[io, level, now - ms] for ms, io, level in edges]
+        success &= self.bool_check("IO events", resp_dict.get("IOEV") == expected)
+        success &= self.bool_check("IO events dropped", resp_dict.get("IOEV_drop") == dropped)
+        return success
+
+    def _decode(self, packet_strs: list):
+        js = shutil.which("js") or shutil.which("node")
+        command = [js, self.COMMS_PROTOCOL_PATH] + packet_strs
         self._log(command)
         with subprocess.Popen(command, stdout=subprocess.PIPE) as proc:
             resp = proc.stdout.read()
         resp_dict = yaml.safe_load(resp)
         self._log(resp_dict)
-        for measurement in self.measurements:
-            self._threshold_check_measurement(resp_dict, measurement)
-        return success
+        return resp_dict
 
     def _log(self, msg: str, **kwargs):
         print(f"{self.COLOUR_GREY}{self.now()}: {msg}{self.COLOUR_DEFAULT}", flush=True, **kwargs)
@@ -333,7 +500,19 @@ def main(args):
     print("Hello World!");
     lib_blob = ctypes.CDLL(args[0])
     test_obj = test_blob(lib_blob)
-    return 0 if test_obj.test() else 1;
+    success = test_obj.test()
+    success &= test_obj.test_stats()
+    success &= test_obj.test_batch()
+    success &= test_obj.test_io_events()
+    if len(args) > 1:
+        lib_blob_compact = ctypes.CDLL(args[1])
+        test_obj_compact = test_blob(lib_blob_compact)
+        # Before the compact test acks any definitions, so this decodes alone.
+        success &= test_obj_compact.test_stats()
+        success &= test_obj_compact.test_batch()
+        success &= test_obj_compact.test_io_events()
+        success &= test_obj_compact.test_compact()
+    return 0 if success else 1;
 
 
 if __name__ == '__main__':
@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <osm/core/modbus_crc.h>
+
+#include "test.h"
+
+#define CRC_BENCH_SIZE   (64 * 1024)
+#define CRC_BENCH_LOOPS  256
+
+
+typedef uint16_t (*crc_update_cb_t)(uint16_t crc, const uint8_t * buf, unsigned length);
+
+typedef struct
+{
+    const char *    name;
+    crc_update_cb_t cb;
+} crc_variant_t;
+
+typedef struct
+{
+    const char *    name;
+    uint8_t         data[16];
+    unsigned        len;
+    uint16_t        crc;
+} crc_vector_t;
+
+
+static const crc_variant_t crc_variants[] =
+{
+    { "bitwise", osm_modbus_crc_update_bitwise },
+    { "table",   osm_modbus_crc_update_table   },
+    { "slice4",  osm_modbus_crc_update_slice4  },
+};
+
+static const crc_vector_t crc_vectors[] =
+{
+    { "Check string",       {'1','2','3','4','5','6','7','8','9'}, 9, 0x4B37 },
+    { "Read holding req",   {0x01, 0x03, 0x00, 0x00, 0x00, 0x0A}, 6, 0xCDC5 },
+    { "Empty",              {0},                                     0, 0xFFFF },
+};
+
+static uint8_t crc_bench_buf[CRC_BENCH_SIZE];
+
+
+static double crc_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+int main(int argc, char ** argv)
+{
+    char name[64];
+
+    for (unsigned n = 0; n < sizeof(crc_bench_buf); n++)
+        crc_bench_buf[n] = (uint8_t)(n * 31 + (n >> 8));
+
+    uint16_t ref_crc = osm_modbus_crc_update_bitwise(OSM_MODBUS_CRC_INIT, crc_bench_buf, sizeof(crc_bench_buf));
+
+    for (unsigned v = 0; v < ARRAY_SIZE(crc_variants); v++)
+    {
+        const crc_variant_t * variant = &crc_variants[v];
+
+        for (unsigned n = 0; n < ARRAY_SIZE(crc_vectors); n++)
+        {
+            const crc_vector_t * vector = &crc_vectors[n];
+            uint16_t crc = variant->cb(OSM_MODBUS_CRC_INIT, vector->data, vector->len);
+            snprintf(name, sizeof(name), "%s %s", variant->name, vector->name);
+            basic_test(name, vector->crc, crc);
+        }
+
+        /* A frame with its CRC appended leaves no remainder. */
+        uint8_t frame[8] = {0x01, 0x03, 0x00, 0x00, 0x00, 0x0A};
+        uint16_t crc = variant->cb(OSM_MODBUS_CRC_INIT, frame, 6);
+        frame[6] = crc & 0xFF;
+        frame[7] = crc >> 8;
+        snprintf(name, sizeof(name), "%s Residue", variant->name);
+        basic_test(name, 0, variant->cb(OSM_MODBUS_CRC_INIT, frame, sizeof(frame)));
+
+        /* Feeding in uneven chunks must match a single pass. */
+        crc = OSM_MODBUS_CRC_INIT;
+        for (unsigned pos = 0, chunk = 1; pos < sizeof(crc_bench_buf); pos += chunk, chunk = (chunk % 7) + 1)
+        {
+            if (chunk > sizeof(crc_bench_buf) - pos)
+                chunk = sizeof(crc_bench_buf) - pos;
+            crc = variant->cb(crc, crc_bench_buf + pos, chunk);
+        }
+        snprintf(name, sizeof(name), "%s Chunked", variant->name);
+        basic_test(name, ref_crc, crc);
+
+        double start = crc_now();
+        for (unsigned n = 0; n < CRC_BENCH_LOOPS; n++)
+            crc = variant->cb(OSM_MODBUS_CRC_INIT, crc_bench_buf, sizeof(crc_bench_buf));
+        double taken = crc_now() - start;
+        printf("%s : %.1f MB/s (%04X)\n", variant->name,
+               (double)CRC_BENCH_SIZE * CRC_BENCH_LOOPS / taken / (1024 * 1024), crc);
+    }
+
+    printf("Built with : %s\n", crc_variants[OSM_MODBUS_CRC_IMPL].name);
+    basic_test("Selected", ref_crc, osm_modbus_crc(crc_bench_buf, sizeof(crc_bench_buf)));
+
+    return 0;
+}
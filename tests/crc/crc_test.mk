@@ -0,0 +1,9 @@
+crc_test_DIR:=$(tests_DIR)/crc
+
+crc_test_CFLAGS:=-I$(crc_test_DIR)
+
+crc_test_SOURCES:= \
+  $(OSM_DIR)/src/core/modbus_crc.c \
+  $(crc_test_DIR)/crc_test.c
+
+$(eval $(call tests_PROGRAM_template,crc_test))
@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <osm/core/deadband.h>
+
+#include "test.h"
+
+
+/* Run values through as the measurements send loop does, returning a
+ * bit per value that was sent. */
+static unsigned test_run(const osm_deadband_t* band, osm_deadband_state_t* state, const int64_t* values, unsigned count)
+{
+    unsigned sent = 0;
+    for (unsigned n = 0; n < count; n++)
+    {
+        if (osm_deadband_hold(band, state, values[n]))
+            continue;
+        osm_deadband_sent(state, values[n]);
+        sent |= 1 << n;
+    }
+    return sent;
+}
+
+
+int main(int argc, char * argv[])
+{
+    osm_deadband_t bands[OSM_DEADBAND_MAX];
+    osm_deadband_state_t state;
+
+    /* Erased flash and zeroed entries are both unset. */
+    memset(bands, 0xFF, sizeof(bands));
+    basic_test("Erased unset", OSM_DEADBAND_NONE, osm_deadband_find(bands, 0xFF));
+    basic_test("Erased free", 0, osm_deadband_get_free(bands));
+    memset(bands, 0, sizeof(bands));
+    basic_test("Zeroed unset", OSM_DEADBAND_NONE, osm_deadband_find(bands, 0));
+
+    bands[3] = (osm_deadband_t){.index = 7, .abs_band = 10};
+    basic_test("Find", 3, osm_deadband_find(bands, 7));
+    basic_test("Find other", OSM_DEADBAND_NONE, osm_deadband_find(bands, 6));
+    basic_test("Free skips set", 0, osm_deadband_get_free(bands));
+
+    /* Absolute, first value always goes. */
+    const int64_t abs_values[] = {100, 105, 110, 111, 101, 90, 90};
+    memset(&state, 0, sizeof(state));
+    basic_test("Absolute", 0x1 | 0x8 | 0x20,
+               test_run(&bands[3], &state, abs_values, ARRAY_SIZE(abs_values)));
+
+    /* Relative, 5% of the last sent. */
+    osm_deadband_t rel = {.rel_band = 50};
+    const int64_t rel_values[] = {-2000, -2090, -1901, -2200, -2300, -2311};
+    memset(&state, 0, sizeof(state));
+    basic_test("Relative", 0x1 | 0x8 | 0x20,
+               test_run(&rel, &state, rel_values, ARRAY_SIZE(rel_values)));
+
+    /* The larger band wins, abs is the floor near 0. */
+    osm_deadband_t both = {.abs_band = 5, .rel_band = 100};
+    const int64_t both_values[] = {0, 4, 6, 1000, 1090, 1201};
+    memset(&state, 0, sizeof(state));
+    basic_test("Both", 0x1 | 0x4 | 0x8 | 0x20,
+               test_run(&both, &state, both_values, ARRAY_SIZE(both_values)));
+
+    /* Heartbeat sends after 3 held back, even unchanged. */
+    osm_deadband_t heartbeat = {.abs_band = 1000, .heartbeat = 3};
+    const int64_t hb_values[] = {5, 5, 5, 5, 5, 5, 5, 5, 5};
+    memset(&state, 0, sizeof(state));
+    basic_test("Heartbeat", 0x1 | 0x10 | 0x100,
+               test_run(&heartbeat, &state, hb_values, ARRAY_SIZE(hb_values)));
+
+    /* Asking doesn't count towards the heartbeat. */
+    memset(&state, 0, sizeof(state));
+    osm_deadband_sent(&state, 5);
+    for (unsigned n = 0; n < 5; n++)
+        osm_deadband_within(&heartbeat, &state, 5);
+    basic_test("Within not held", 0, state.held);
+
+    /* No heartbeat stays quiet. */
+    heartbeat.heartbeat = 0;
+    memset(&state, 0, sizeof(state));
+    basic_test("No heartbeat", 0x1,
+               test_run(&heartbeat, &state, hb_values, ARRAY_SIZE(hb_values)));
+
+    /* Extremes don't overflow. */
+    osm_deadband_t wide = {.abs_band = UINT32_MAX - 1, .rel_band = 1000};
+    const int64_t wide_values[] = {INT64_MIN, INT64_MAX, INT64_MIN};
+    memset(&state, 0, sizeof(state));
+    basic_test("Extremes", 0x1 | 0x2 | 0x4,
+               test_run(&wide, &state, wide_values, ARRAY_SIZE(wide_values)));
+
+    /* Cleared forgets the last value. */
+    osm_deadband_clear(&bands[3], &state);
+    basic_test("Cleared", OSM_DEADBAND_NONE, osm_deadband_find(bands, 7));
+    basic_test("Cleared state", 0, state.has_last);
+    return 0;
+}
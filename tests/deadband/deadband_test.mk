@@ -0,0 +1,9 @@
+deadband_test_DIR:=$(tests_DIR)/deadband
+
+deadband_test_CFLAGS:=-I$(deadband_test_DIR)
+
+deadband_test_SOURCES:= \
+  $(OSM_DIR)/src/core/deadband.c \
+  $(deadband_test_DIR)/deadband_test.c
+
+$(eval $(call tests_PROGRAM_template,deadband_test))
@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <osm/core/i2c_queue.h>
+
+#include "test.h"
+
+
+static osm_i2c_queue_t _queue;
+static unsigned _done_order[16];
+static unsigned _done_count = 0;
+static osm_i2c_xfer_t* _resubmit = NULL;
+
+
+static void _test_cb(osm_i2c_xfer_t* xfer)
+{
+    _done_order[_done_count++] = xfer->addr;
+    if (xfer == _resubmit)
+    {
+        _resubmit = NULL;
+        osm_i2c_queue_push(&_queue, xfer);
+    }
+}
+
+
+int main(int argc, char * argv[])
+{
+    osm_i2c_xfer_t htu = {.addr = 0x40, .timeout_ms = 100, .cb = _test_cb};
+    osm_i2c_xfer_t veml = {.addr = 0x10, .timeout_ms = 100, .cb = _test_cb};
+    osm_i2c_xfer_t sen = {.addr = 0x69, .timeout_ms = 100, .cb = _test_cb};
+    osm_i2c_xfer_t fill[OSM_I2C_QUEUE_SIZE];
+
+    osm_i2c_queue_init(&_queue);
+    basic_test("Empty", 1, osm_i2c_queue_front(&_queue) == NULL);
+    basic_test("Finish empty", 1, osm_i2c_queue_finish(&_queue, true) == NULL);
+    basic_test("Nothing to time out", false, osm_i2c_queue_timed_out(&_queue, 1000));
+
+    /* Drivers queue behind each other and are run in turn. */
+    basic_test("Push HTU", true, osm_i2c_queue_push(&_queue, &htu));
+    basic_test("Push VEML", true, osm_i2c_queue_push(&_queue, &veml));
+    basic_test("Push SEN", true, osm_i2c_queue_push(&_queue, &sen));
+    basic_test("Queued", OSM_I2C_XFER_QUEUED, veml.status);
+    basic_test("Pending", true, osm_i2c_xfer_pending(&veml));
+    basic_test("HTU in front", 1, osm_i2c_queue_front(&_queue) == &htu);
+    basic_test("Finish to VEML", 1, osm_i2c_queue_finish(&_queue, true) == &veml);
+    basic_test("HTU done", OSM_I2C_XFER_DONE, htu.status);
+    basic_test("HTU not pending", false, osm_i2c_xfer_pending(&htu));
+    basic_test("Finish to SEN", 1, osm_i2c_queue_finish(&_queue, false) == &sen);
+    basic_test("VEML failed", OSM_I2C_XFER_FAILED, veml.status);
+    basic_test("Finish to empty", 1, osm_i2c_queue_finish(&_queue, true) == NULL);
+    basic_test("Callbacks in order", 1, _done_count == 3 &&
+                                        _done_order[0] == 0x40 &&
+                                        _done_order[1] == 0x10 &&
+                                        _done_order[2] == 0x69);
+
+    /* Timed out from when started, not while waiting its turn. */
+    osm_i2c_queue_push(&_queue, &htu);
+    osm_i2c_queue_push(&_queue, &veml);
+    osm_i2c_queue_start(&htu, 1000);
+    basic_test("Active", OSM_I2C_XFER_ACTIVE, htu.status);
+    basic_test("Not timed out", false, osm_i2c_queue_timed_out(&_queue, 1100));
+    basic_test("Timed out", true, osm_i2c_queue_timed_out(&_queue, 1101));
+    osm_i2c_queue_finish(&_queue, false);
+    basic_test("Waiting not timed out", false, osm_i2c_queue_timed_out(&_queue, 5000));
+    osm_i2c_queue_start(&veml, 5000);
+    basic_test("Started not timed out", false, osm_i2c_queue_timed_out(&_queue, 5100));
+    osm_i2c_queue_finish(&_queue, false);
+    osm_i2c_queue_push(&_queue, &htu);
+    osm_i2c_queue_start(&htu, UINT32_MAX - 50);
+    basic_test("Not timed out over wrap", false, osm_i2c_queue_timed_out(&_queue, 49));
+    basic_test("Timed out over wrap", true, osm_i2c_queue_timed_out(&_queue, 50));
+    osm_i2c_queue_finish(&_queue, false);
+    _done_count = 0;
+
+    /* Submitting again from the callback goes to the back. */
+    osm_i2c_queue_push(&_queue, &htu);
+    osm_i2c_queue_push(&_queue, &veml);
+    _resubmit = &htu;
+    basic_test("Resubmitted after VEML", 1, osm_i2c_queue_finish(&_queue, true) == &veml);
+    basic_test("Resubmitted queued", OSM_I2C_XFER_QUEUED, htu.status);
+    basic_test("Then HTU again", 1, osm_i2c_queue_finish(&_queue, true) == &htu);
+    basic_test("Then empty", 1, osm_i2c_queue_finish(&_queue, true) == NULL);
+
+    /* A full queue turns more away. */
+    for (unsigned i = 0; i < OSM_I2C_QUEUE_SIZE; i++)
+    {
+        fill[i] = (osm_i2c_xfer_t){.addr = i};
+        osm_i2c_queue_push(&_queue, &fill[i]);
+    }
+    basic_test("Full", false, osm_i2c_queue_push(&_queue, &htu));
+    basic_test("Turned away left alone", OSM_I2C_XFER_DONE, htu.status);
+    unsigned in_order = 0;
+    osm_i2c_xfer_t* xfer = osm_i2c_queue_front(&_queue);
+    for (unsigned i = 0; xfer; i++)
+    {
+        if (xfer == &fill[i])
+            in_order++;
+        xfer = osm_i2c_queue_finish(&_queue, true);
+    }
+    basic_test("Drained in order", OSM_I2C_QUEUE_SIZE, in_order);
+
+    return EXIT_SUCCESS;
+}
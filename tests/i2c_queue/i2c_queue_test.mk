@@ -0,0 +1,9 @@
+i2c_queue_test_DIR:=$(tests_DIR)/i2c_queue
+
+i2c_queue_test_CFLAGS:=-I$(i2c_queue_test_DIR)
+
+i2c_queue_test_SOURCES:= \
+  $(OSM_DIR)/src/core/i2c_queue.c \
+  $(i2c_queue_test_DIR)/i2c_queue_test.c
+
+$(eval $(call tests_PROGRAM_template,i2c_queue_test))
@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <osm/core/io_events.h>
+
+#include "test.h"
+
+
+#define IO_A        4
+#define IO_B        5
+#define WINDOW_MS   100
+
+
+int main(int argc, char * argv[])
+{
+    osm_io_events_t events;
+    osm_io_event_t list[OSM_IO_EVENTS_LIST_MAX];
+    uint32_t dropped;
+    uint32_t mask = (1UL << IO_A) | (1UL << IO_B);
+
+    osm_io_events_init(&events);
+    basic_test("Nothing pending", false, osm_io_events_pending(&events));
+    basic_test("Nothing due", 0, osm_io_events_due(&events, 1000, WINDOW_MS));
+
+    /* A burst is held until the first of it is a window old. */
+    basic_test("First wakes", 1, osm_io_events_push(&events, IO_A, true, 1000));
+    osm_io_events_push(&events, IO_A, false, 1010);
+    osm_io_events_push(&events, IO_B, true, 1050);
+    basic_test("Pending", true, osm_io_events_pending(&events));
+    basic_test("Held in the window", 0, osm_io_events_due(&events, 1099, WINDOW_MS));
+    basic_test("Due after the window", mask, osm_io_events_due(&events, 1100, WINDOW_MS));
+    unsigned count = osm_io_events_take(&events, mask, list, OSM_IO_EVENTS_LIST_MAX, &dropped);
+    basic_test("Burst in one list", 3, count);
+    basic_test("Burst none dropped", 0, dropped);
+    basic_test("Burst in order", 1, list[0].ms == 1000 && list[1].ms == 1010 && list[2].ms == 1050);
+    basic_test("Burst IOs", 1, list[1].io == IO_A && list[2].io == IO_B);
+    basic_test("Burst levels", 1, list[0].level && !list[1].level && list[2].level);
+    basic_test("Taken all", false, osm_io_events_pending(&events));
+
+    /* Only the IOs asked for are listed, the others thrown away. */
+    osm_io_events_push(&events, IO_B, false, 2000);
+    osm_io_events_push(&events, IO_A, true, 2001);
+    basic_test("Both due", (1UL << IO_B) | (1UL << IO_A), osm_io_events_due(&events, 2200, WINDOW_MS));
+    count = osm_io_events_take(&events, 1UL << IO_A, list, OSM_IO_EVENTS_LIST_MAX, &dropped);
+    basic_test("Only IO A listed", 1, count == 1 && list[0].io == IO_A);
+    basic_test("Others not dropped", 0, dropped);
+
+    /* Chattering past the list only counts the rest. */
+    for (unsigned i = 0; i < 50; i++)
+        osm_io_events_push(&events, IO_A, i % 2, 3000 + i);
+    basic_test("Filling sends early", 1UL << IO_A, osm_io_events_due(&events, 3050, WINDOW_MS));
+    count = osm_io_events_take(&events, mask, list, OSM_IO_EVENTS_LIST_MAX, &dropped);
+    basic_test("Chatter listed", OSM_IO_EVENTS_LIST_MAX, count);
+    basic_test("Chatter folded", 50 - OSM_IO_EVENTS_LIST_MAX, dropped);
+    basic_test("Chatter keeps the first", 3000, list[0].ms);
+
+    /* More than the queue holds before a take. */
+    unsigned waiting = 0, overflowed = 0;
+    for (unsigned i = 0; i < OSM_IO_EVENTS_QUEUE_SIZE + 10; i++)
+    {
+        unsigned r = osm_io_events_push(&events, IO_B, i % 2, 4000 + i);
+        if (r)
+            waiting = r;
+        else
+            overflowed++;
+    }
+    basic_test("Queue full", OSM_IO_EVENTS_QUEUE_SIZE, waiting);
+    basic_test("Overflowed", 10, overflowed);
+    count = osm_io_events_take(&events, mask, list, OSM_IO_EVENTS_LIST_MAX, &dropped);
+    basic_test("Overflow listed", OSM_IO_EVENTS_LIST_MAX, count);
+    basic_test("Overflow and folded dropped", OSM_IO_EVENTS_QUEUE_SIZE + 10 - OSM_IO_EVENTS_LIST_MAX, dropped);
+
+    /* Overflows only counted once, and the millisecond count wrapping. */
+    osm_io_events_push(&events, IO_A, true, UINT32_MAX - 10);
+    basic_test("Held over a wrap", 0, osm_io_events_due(&events, 20, WINDOW_MS));
+    basic_test("Due over a wrap", 1UL << IO_A, osm_io_events_due(&events, 90, WINDOW_MS));
+    osm_io_events_take(&events, mask, list, OSM_IO_EVENTS_LIST_MAX, &dropped);
+    basic_test("Drops only taken once", 0, dropped);
+
+    /* Dropped that went in no list are counted in the next. */
+    osm_io_events_push(&events, IO_A, true, 5000);
+    osm_io_events_carry(&events, 3);
+    count = osm_io_events_take(&events, mask, list, OSM_IO_EVENTS_LIST_MAX, &dropped);
+    basic_test("Carried dropped", 1, count == 1 && dropped == 3);
+    osm_io_events_take(&events, mask, list, OSM_IO_EVENTS_LIST_MAX, &dropped);
+    basic_test("Carried only once", 0, dropped);
+    basic_test("Lists counted", 6, events.lists);
+    return 0;
+}
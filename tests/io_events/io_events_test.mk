@@ -0,0 +1,9 @@
+io_events_test_DIR:=$(tests_DIR)/io_events
+
+io_events_test_CFLAGS:=-I$(io_events_test_DIR)
+
+io_events_test_SOURCES:= \
+  $(OSM_DIR)/src/core/io_events.c \
+  $(io_events_test_DIR)/io_events_test.c
+
+$(eval $(call tests_PROGRAM_template,io_events_test))
@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <osm/core/pulse_timing.h>
+
+#include "test.h"
+
+
+static bool test_near(double got, double expected, double within)
+{
+    return fabs(got - expected) <= within;
+}
+
+
+int main(int argc, char * argv[])
+{
+    osm_pulse_timing_t timing;
+    osm_pulse_timing_result_t result;
+
+    osm_pulse_timing_init(&timing);
+    basic_test("Nothing to take", false, osm_pulse_timing_take(&timing, &result));
+    basic_test("No rate", 1, result.rate_hz == 0);
+
+    osm_pulse_timing_push(&timing, 1000);
+    osm_pulse_timing_drain(&timing);
+    basic_test("One edge is no interval", false, osm_pulse_timing_take(&timing, &result));
+
+    /* Steady 100Hz, the first edge above then ten more. */
+    uint64_t t = 1000;
+    for (unsigned i = 0; i < 10; i++)
+    {
+        t += 10000;
+        osm_pulse_timing_push(&timing, t);
+    }
+    osm_pulse_timing_drain(&timing);
+    basic_test("Steady taken", true, osm_pulse_timing_take(&timing, &result));
+    basic_test("Steady intervals", 10, result.count);
+    basic_test("Steady 100Hz", 1, test_near(result.rate_hz, 100, 1e-3));
+    basic_test("Steady min 10ms", 1, test_near(result.min_ms, 10, 1e-6));
+    basic_test("Steady max 10ms", 1, test_near(result.max_ms, 10, 1e-6));
+    basic_test("Steady no jitter", 1, test_near(result.jitter_ms, 0, 1e-6));
+
+    /* 9ms and 11ms in turn, the first interval spans the take. */
+    for (unsigned i = 0; i < 20; i++)
+    {
+        t += (i % 2) ? 11000 : 9000;
+        osm_pulse_timing_push(&timing, t);
+    }
+    osm_pulse_timing_drain(&timing);
+    osm_pulse_timing_take(&timing, &result);
+    basic_test("Spanning the take counted", 20, result.count);
+    basic_test("Uneven 100Hz", 1, test_near(result.rate_hz, 100, 1e-3));
+    basic_test("Uneven min 9ms", 1, test_near(result.min_ms, 9, 1e-6));
+    basic_test("Uneven max 11ms", 1, test_near(result.max_ms, 11, 1e-6));
+    basic_test("Uneven jitter 1ms", 1, test_near(result.jitter_ms, 1, 1e-6));
+
+    /* More than the ring holds before a drain, the rest are dropped. */
+    unsigned waiting = 0, dropped = 0;
+    for (unsigned i = 0; i < OSM_PULSE_TIMING_RING_SIZE + 8; i++)
+    {
+        t += 1000;
+        unsigned r = osm_pulse_timing_push(&timing, t);
+        if (r)
+            waiting = r;
+        else
+            dropped++;
+    }
+    basic_test("Ring full", OSM_PULSE_TIMING_RING_SIZE, waiting);
+    basic_test("Dropped", 8, dropped);
+    osm_pulse_timing_drain(&timing);
+    /* The gap over what was dropped is not an interval. */
+    t += 8 * 1000;
+    osm_pulse_timing_push(&timing, t);
+    t += 1000;
+    osm_pulse_timing_push(&timing, t);
+    osm_pulse_timing_drain(&timing);
+    osm_pulse_timing_take(&timing, &result);
+    basic_test("Intervals around the drop", OSM_PULSE_TIMING_RING_SIZE + 1, result.count);
+    basic_test("Drops taken", 8, result.overflows);
+    basic_test("No interval over the drop", 1, test_near(result.max_ms, 1, 1e-6));
+
+    /* Back over the millisecond count wrapping. */
+    osm_pulse_timing_push(&timing, 500);
+    osm_pulse_timing_push(&timing, 1500);
+    osm_pulse_timing_drain(&timing);
+    osm_pulse_timing_take(&timing, &result);
+    basic_test("Not back over a wrap", 1, result.count);
+    basic_test("Drops only taken once", 0, result.overflows);
+    return 0;
+}
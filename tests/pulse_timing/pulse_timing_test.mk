@@ -0,0 +1,10 @@
+pulse_timing_test_DIR:=$(tests_DIR)/pulse_timing
+
+pulse_timing_test_CFLAGS:=-I$(pulse_timing_test_DIR)
+pulse_timing_test_LDFLAGS:=-lm
+
+pulse_timing_test_SOURCES:= \
+  $(OSM_DIR)/src/core/pulse_timing.c \
+  $(pulse_timing_test_DIR)/pulse_timing_test.c
+
+$(eval $(call tests_PROGRAM_template,pulse_timing_test))
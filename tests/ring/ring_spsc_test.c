@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <osm/core/ring.h>
+
+#include "test.h"
+
+/* One thread producing and one consuming, as an ISR and the main loop
+ * would. Every byte is a running sequence so any reordering, loss or
+ * duplicate shows as a mismatch on the consumer side. Yielding when
+ * stalled keeps it quick on a single core. */
+
+#define SPSC_TEST_BYTES (4 * 1024 * 1024)
+
+
+typedef struct
+{
+    osm_ring_buf_t  ring;
+    unsigned        errors;
+    unsigned        received;
+} spsc_test_t;
+
+
+static void* spsc_producer(void * arg)
+{
+    spsc_test_t * test = (spsc_test_t*)arg;
+    uint8_t seq = 0;
+    unsigned sent = 0;
+    char chunk[37];
+
+    while (sent < SPSC_TEST_BYTES)
+    {
+        /* Alternate single byte and block adds. */
+        if (sent & 1)
+        {
+            if (osm_ring_buf_add(&test->ring, seq))
+            {
+                seq++;
+                sent++;
+            }
+            else sched_yield();
+            continue;
+        }
+
+        unsigned space = test->ring.size - 1 - osm_ring_buf_get_pending(&test->ring);
+        unsigned len = (sent % sizeof(chunk)) + 1;
+        if (len > space)
+            len = space;
+        if (len > SPSC_TEST_BYTES - sent)
+            len = SPSC_TEST_BYTES - sent;
+        for (unsigned n = 0; n < len; n++)
+            chunk[n] = seq + n;
+        if (len && osm_ring_buf_add_data(&test->ring, chunk, len))
+        {
+            seq += len;
+            sent += len;
+        }
+        else sched_yield();
+    }
+    return NULL;
+}
+
+
+static unsigned spsc_consume_cb(char * buf, unsigned len, void * data)
+{
+    /* Only take part, so the rest is seen again. */
+    return (len > 1)?(len / 2):len;
+}
+
+
+static void* spsc_consumer(void * arg)
+{
+    spsc_test_t * test = (spsc_test_t*)arg;
+    uint8_t seq = 0;
+    char buf[29];
+
+    while (test->received < SPSC_TEST_BYTES)
+    {
+        unsigned got;
+        if (test->received & 2)
+            got = osm_ring_buf_consume(&test->ring, spsc_consume_cb, buf, sizeof(buf), NULL);
+        else
+            got = osm_ring_buf_read(&test->ring, buf, sizeof(buf));
+
+        for (unsigned n = 0; n < got; n++)
+            if ((uint8_t)buf[n] != seq++)
+                test->errors++;
+        test->received += got;
+        if (!got)
+            sched_yield();
+    }
+    return NULL;
+}
+
+
+static void spsc_test(unsigned size)
+{
+    char buf[256];
+    char name[64];
+    pthread_t producer, consumer;
+
+    spsc_test_t test = { .ring = {buf, size, RING_BUF_MASK(size), 0, 0} };
+
+    pthread_create(&consumer, NULL, spsc_consumer, &test);
+    pthread_create(&producer, NULL, spsc_producer, &test);
+    pthread_join(producer, NULL);
+    pthread_join(consumer, NULL);
+
+    snprintf(name, sizeof(name), "SPSC %u received", size);
+    basic_test(name, SPSC_TEST_BYTES, test.received);
+    snprintf(name, sizeof(name), "SPSC %u errors", size);
+    basic_test(name, 0, test.errors);
+    snprintf(name, sizeof(name), "SPSC %u empty", size);
+    basic_test(name, 0, osm_ring_buf_get_pending(&test.ring));
+}
+
+
+int main(int argc, char ** argv)
+{
+    spsc_test(64);
+    spsc_test(256);
+    spsc_test(61);
+    return 0;
+}
@@ -0,0 +1,10 @@
+ring_spsc_test_DIR:=$(tests_DIR)/ring
+
+ring_spsc_test_CFLAGS:=-I$(ring_spsc_test_DIR) -pthread
+ring_spsc_test_LDFLAGS:=-pthread
+
+ring_spsc_test_SOURCES:= \
+  $(OSM_DIR)/src/core/ring.c \
+  $(ring_spsc_test_DIR)/ring_spsc_test.c
+
+$(eval $(call tests_PROGRAM_template,ring_spsc_test))
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdint.h>
 #include <string.h>
 
 #include <osm/core/ring.h>
@@ -19,21 +20,75 @@ static unsigned test_consume_cb(char * buf, unsigned len, void *data)
 }
 
 
+/* Push data through rings of power of two and other sizes so the
+ * block copies have to split at the wrap. */
+static void test_wrap(unsigned size)
+{
+    char buf[64];
+    char out[64];
+    char in[64];
+    char name[64];
+    unsigned errors = 0;
+    uint8_t w_seq = 0, r_seq = 0;
+
+    osm_ring_buf_t ring = {buf, size, RING_BUF_MASK(size), 0, 0};
+
+    snprintf(name, sizeof(name), "Wrap %u mask", size);
+    basic_test(name, (size & (size - 1))?0:(size - 1), ring.mask);
+
+    for (unsigned n = 0; n < 200; n++)
+    {
+        unsigned chunk = (n * 7) % (size - 1) + 1;
+        unsigned space = size - 1 - osm_ring_buf_get_pending(&ring);
+
+        for (unsigned i = 0; i < chunk; i++)
+            in[i] = w_seq + i;
+
+        bool fits = osm_ring_buf_add_data(&ring, in, chunk);
+        if (fits != (chunk <= space))
+            errors++;
+        w_seq += (chunk <= space)?chunk:space;
+
+        unsigned got = osm_ring_buf_read(&ring, out, (n * 5) % size + 1);
+        for (unsigned i = 0; i < got; i++)
+            if (out[i] != (char)r_seq++)
+                errors++;
+    }
+    snprintf(name, sizeof(name), "Wrap %u data", size);
+    basic_test(name, 0, errors);
+
+    while (osm_ring_buf_get_pending(&ring))
+        for (unsigned i = osm_ring_buf_read(&ring, out, sizeof(out)); i--;)
+            r_seq++;
+    snprintf(name, sizeof(name), "Wrap %u drained", size);
+    basic_test(name, w_seq, r_seq);
+
+    /* Line straddling the wrap point. */
+    ring.r_pos = ring.w_pos = size - 3;
+    osm_ring_buf_add_str(&ring, "abcdef\r\nxy");
+    unsigned line_len = osm_ring_buf_readline(&ring, out, sizeof(out));
+    snprintf(name, sizeof(name), "Wrap %u line", size);
+    basic_test(name, 6, line_len);
+    basic_test(name, 0, strcmp(out, "abcdef"));
+    basic_test(name, 2, osm_ring_buf_get_pending(&ring));
+}
+
+
 int main(int argc, char ** argv)
 {
     char buf[512];
 
-    ring_buf_t ring = RING_BUF_INIT(buf, sizeof(buf));
+    osm_ring_buf_t ring = RING_BUF_INIT(buf, sizeof(buf));
 
-    basic_test("Init", 0, ring_buf_get_pending(&ring));
+    basic_test("Init", 0, osm_ring_buf_get_pending(&ring));
 
     for(unsigned n = 0; n < ARRAY_SIZE(test_lines); n++)
     {
         char * line = test_lines[n];
 
-        unsigned before = ring_buf_get_pending(&ring);
-        ring_buf_add_str(&ring, line);
-        basic_test("Added", before + strlen(line), ring_buf_get_pending(&ring));
+        unsigned before = osm_ring_buf_get_pending(&ring);
+        osm_ring_buf_add_str(&ring, line);
+        basic_test("Added", before + strlen(line), osm_ring_buf_get_pending(&ring));
     }
 
     for(unsigned n = 0; n < ARRAY_SIZE(test_lines); n++)
@@ -50,12 +105,12 @@ int main(int argc, char ** argv)
 
         char line[128];
 
-        unsigned before = ring_buf_get_pending(&ring);
+        unsigned before = osm_ring_buf_get_pending(&ring);
 
-        ring_buf_readline(&ring, line, sizeof(line));
+        osm_ring_buf_readline(&ring, line, sizeof(line));
 
         basic_test("Read line", org_line_len, strlen(line));
-        basic_test("Removed", before - org_line_len - eol, ring_buf_get_pending(&ring));
+        basic_test("Removed", before - org_line_len - eol, osm_ring_buf_get_pending(&ring));
         basic_test("Data Diff", 0, strncmp(org_line, line, org_line_len));
     }
 
@@ -63,9 +118,9 @@ int main(int argc, char ** argv)
     {
         char * line = test_lines[n];
 
-        unsigned before = ring_buf_get_pending(&ring);
-        ring_buf_add_str(&ring, line);
-        basic_test("Added", before + strlen(line), ring_buf_get_pending(&ring));
+        unsigned before = osm_ring_buf_get_pending(&ring);
+        osm_ring_buf_add_str(&ring, line);
+        basic_test("Added", before + strlen(line), osm_ring_buf_get_pending(&ring));
     }
 
     for(unsigned n = 0; n < ARRAY_SIZE(test_lines); n++)
@@ -81,7 +136,7 @@ int main(int argc, char ** argv)
             unsigned chunk = org_line_len - total;
             if (chunk > 8)
                 chunk = 8;
-            unsigned got = ring_buf_read(&ring, line + total, chunk);
+            unsigned got = osm_ring_buf_read(&ring, line + total, chunk);
             basic_test("Chunk", chunk, got);
             total += got;
         }
@@ -91,34 +146,38 @@ int main(int argc, char ** argv)
     }
 
     for(unsigned n = 0; n < sizeof(buf); n++)
-        ring_buf_add(&ring, 'X');
+        osm_ring_buf_add(&ring, 'X');
 
-    basic_test("Full", 1, ring_buf_is_full(&ring));
-    basic_test("Fill", sizeof(buf) - 1,  ring_buf_get_pending(&ring));
+    basic_test("Full", 1, osm_ring_buf_is_full(&ring));
+    basic_test("Fill", sizeof(buf) - 1,  osm_ring_buf_get_pending(&ring));
 
     char temp[128] = {0};
 
-    while(ring_buf_get_pending(&ring))
+    while(osm_ring_buf_get_pending(&ring))
     {
-        unsigned left = ring_buf_get_pending(&ring);
+        unsigned left = osm_ring_buf_get_pending(&ring);
         unsigned chunk = 100;
 
-        unsigned consumed = ring_buf_consume(&ring, test_consume_cb, temp, sizeof(temp), &chunk);
+        unsigned consumed = osm_ring_buf_consume(&ring, test_consume_cb, temp, sizeof(temp), &chunk);
 
-        basic_test("Consumed", left - consumed, ring_buf_get_pending(&ring));
+        basic_test("Consumed", left - consumed, osm_ring_buf_get_pending(&ring));
     }
 
     for(unsigned n = 0; n < 100; n++)
-        ring_buf_add(&ring, 'X');
+        osm_ring_buf_add(&ring, 'X');
 
-    while(ring_buf_get_pending(&ring))
+    while(osm_ring_buf_get_pending(&ring))
     {
-        unsigned chunk = ring_buf_get_pending(&ring);
+        unsigned chunk = osm_ring_buf_get_pending(&ring);
         if (chunk > 64)
             chunk = 64;
-        unsigned got = ring_buf_read(&ring, temp, 64);
+        unsigned got = osm_ring_buf_read(&ring, temp, 64);
         basic_test("Overread", chunk, got);
     }
 
+    test_wrap(64);
+    test_wrap(60);
+    test_wrap(17);
+
     return 0;
 }
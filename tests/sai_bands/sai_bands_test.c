@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include <osm/core/sai_bands.h>
+
+#include "test.h"
+
+#define TEST_SAMPLES        15625   /* 2s */
+#define TEST_HALF_SAMPLES   128     /* As the SAI's DMA half */
+#define TEST_AMPLITUDE      1000000 /* Of 2^23 full scale */
+#define TEST_BENCH_ROUNDS   20
+
+
+static unsigned test_rand_state = 1234;
+
+static int32_t test_noise(unsigned amplitude)
+{
+    test_rand_state = test_rand_state * 1103515245 + 12345;
+    return (int32_t)((test_rand_state >> 8) % (2 * amplitude + 1)) - (int32_t)amplitude;
+}
+
+
+/* Tone as the microphone gives it, 24 bit in the low bits of 32. */
+static void test_fill(int32_t* buf, unsigned len, double hz, double amplitude, unsigned noise)
+{
+    for (unsigned i = 0; i < len; i++)
+    {
+        double v = amplitude * sin(2 * M_PI * hz * i / OSM_SAI_BANDS_SAMPLE_RATE_HZ) + test_noise(noise);
+        buf[i] = (int32_t)lround(v) & 0xFFFFFF;
+    }
+}
+
+
+static bool test_levels(const int32_t* buf, unsigned len, unsigned block, float* rms)
+{
+    osm_sai_bands_t bands;
+    osm_sai_bands_acc_t acc;
+    osm_sai_bands_init(&bands);
+    osm_sai_bands_acc_clear(&acc);
+    for (unsigned i = 0; i < len; i += block)
+        osm_sai_bands_add(&bands, &acc, buf + i, (len - i < block) ? len - i : block);
+    return osm_sai_bands_get(&acc, rms);
+}
+
+
+/* Level of a tone against its RMS, in dB. */
+static double test_db(float rms, double amplitude)
+{
+    return 20 * log10(rms / (amplitude / M_SQRT2));
+}
+
+
+static bool test_near(double got, double expected, double within)
+{
+    return fabs(got - expected) <= within;
+}
+
+
+/* A weighting of IEC 61672, in dB. */
+static double test_a_weighting(double hz)
+{
+    double f2 = hz * hz;
+    double ra = 148693636. * f2 * f2 / ((f2 + 424.318) * sqrt((f2 + 11589.1) * (f2 + 544440.7)) * (f2 + 148693636.));
+    return 20 * log10(ra) + 2.0;
+}
+
+
+int main(int argc, char * argv[])
+{
+    static int32_t buf[TEST_SAMPLES];
+    float rms[OSM_SAI_BANDS_LEVEL_COUNT];
+
+    osm_sai_bands_t bands;
+    osm_sai_bands_acc_t acc;
+    osm_sai_bands_init(&bands);
+    osm_sai_bands_acc_clear(&acc);
+    test_fill(buf, OSM_SAI_BANDS_SETTLE_SAMPLES, 1000, TEST_AMPLITUDE, 0);
+    osm_sai_bands_add(&bands, &acc, buf, OSM_SAI_BANDS_SETTLE_SAMPLES);
+    basic_test("Nothing while settling", false, osm_sai_bands_get(&acc, rms));
+
+    /* Each band's own middle passes at its level, the next band over is down. */
+    unsigned worst_mid = 0, worst_next = 0;
+    for (unsigned n = 0; n < OSM_SAI_BANDS_COUNT; n++)
+    {
+        double hz = 31.25 * (1 << n);
+        test_fill(buf, TEST_SAMPLES, hz, TEST_AMPLITUDE, 0);
+        test_levels(buf, TEST_SAMPLES, TEST_HALF_SAMPLES, rms);
+        double mid = test_db(rms[OSM_SAI_BANDS_LEVEL_BAND + n], TEST_AMPLITUDE);
+        if (fabs(mid) * 100 > worst_mid)
+            worst_mid = fabs(mid) * 100;
+        for (unsigned m = 0; m < OSM_SAI_BANDS_COUNT; m++)
+        {
+            if (m == n)
+                continue;
+            double next = -test_db(rms[OSM_SAI_BANDS_LEVEL_BAND + m], TEST_AMPLITUDE);
+            if (abs((int)m - (int)n) == 1 && (!worst_next || next < worst_next))
+                worst_next = next;
+        }
+    }
+    basic_test("Band middles within 0.1dB", 1, worst_mid <= 10);
+    basic_test("Next band over down 11dB", 1, worst_next >= 11);
+
+    /* A weighting against IEC 61672 to 2kHz, past that the bilinear
+     * transform bends it early. */
+    const double a_hz[] = {31.5, 63, 125, 250, 500, 1000, 2000};
+    double worst_a = 0;
+    for (unsigned i = 0; i < ARRAY_SIZE(a_hz); i++)
+    {
+        test_fill(buf, TEST_SAMPLES, a_hz[i], TEST_AMPLITUDE, 0);
+        test_levels(buf, TEST_SAMPLES, TEST_HALF_SAMPLES, rms);
+        double diff = fabs(test_db(rms[OSM_SAI_BANDS_LEVEL_LAEQ], TEST_AMPLITUDE) - test_a_weighting(a_hz[i]));
+        if (diff > worst_a)
+            worst_a = diff;
+    }
+    basic_test("A weighting within 0.3dB to 2kHz", 1, worst_a <= 0.3);
+    test_fill(buf, TEST_SAMPLES, 1000, TEST_AMPLITUDE, 0);
+    test_levels(buf, TEST_SAMPLES, TEST_HALF_SAMPLES, rms);
+    basic_test("Steady max is Leq", 1, test_near(test_db(rms[OSM_SAI_BANDS_LEVEL_LAMAX], TEST_AMPLITUDE), 0, 0.05));
+    basic_test("Steady min is Leq", 1, test_near(test_db(rms[OSM_SAI_BANDS_LEVEL_LAMIN], TEST_AMPLITUDE), 0, 0.05));
+
+    /* Quiet, near the microphone's own noise, in the lowest band. */
+    test_fill(buf, TEST_SAMPLES, 31.25, 1000, 0);
+    test_levels(buf, TEST_SAMPLES, TEST_HALF_SAMPLES, rms);
+    basic_test("Quiet lowest band within 0.1dB", 1, test_near(test_db(rms[OSM_SAI_BANDS_LEVEL_BAND], 1000), 0, 0.1));
+
+    /* Loud for the first half, 20dB down for the second. */
+    test_fill(buf, TEST_SAMPLES, 1000, TEST_AMPLITUDE, 0);
+    for (unsigned i = TEST_SAMPLES / 2; i < TEST_SAMPLES; i++)
+        buf[i] = (int32_t)lround(TEST_AMPLITUDE / 10. * sin(2 * M_PI * 1000 * i / OSM_SAI_BANDS_SAMPLE_RATE_HZ)) & 0xFFFFFF;
+    test_levels(buf, TEST_SAMPLES, TEST_HALF_SAMPLES, rms);
+    basic_test("Max of loud half", 1, test_near(test_db(rms[OSM_SAI_BANDS_LEVEL_LAMAX], TEST_AMPLITUDE), 0, 0.1));
+    basic_test("Min of quiet half", 1, test_near(test_db(rms[OSM_SAI_BANDS_LEVEL_LAMIN], TEST_AMPLITUDE), -20, 0.1));
+
+    /* A DMA half at a time is the same as all at once. */
+    test_fill(buf, TEST_SAMPLES, 440, TEST_AMPLITUDE, 20000);
+    float whole[OSM_SAI_BANDS_LEVEL_COUNT];
+    test_levels(buf, TEST_SAMPLES, TEST_SAMPLES, whole);
+    test_levels(buf, TEST_SAMPLES, TEST_HALF_SAMPLES, rms);
+    unsigned same = 0;
+    for (unsigned i = 0; i < OSM_SAI_BANDS_LEVEL_COUNT; i++)
+        same += (rms[i] == whole[i]);
+    basic_test("Accumulated same as whole", OSM_SAI_BANDS_LEVEL_COUNT, same);
+
+    /* Taken and cleared part way, the filters run on. */
+    osm_sai_bands_init(&bands);
+    osm_sai_bands_acc_clear(&acc);
+    osm_sai_bands_add(&bands, &acc, buf, TEST_SAMPLES / 2);
+    osm_sai_bands_acc_clear(&acc);
+    osm_sai_bands_add(&bands, &acc, buf + TEST_SAMPLES / 2, TEST_SAMPLES / 2);
+    osm_sai_bands_get(&acc, rms);
+    basic_test("Taken part way", 1, test_near(20 * log10(rms[OSM_SAI_BANDS_LEVEL_BAND + 4] / whole[OSM_SAI_BANDS_LEVEL_BAND + 4]), 0, 0.1));
+
+    /* Host timing, a DMA half at a time. */
+    volatile float sink = 0;
+    clock_t start = clock();
+    for (unsigned n = 0; n < TEST_BENCH_ROUNDS; n++)
+    {
+        test_levels(buf, TEST_SAMPLES, TEST_HALF_SAMPLES, rms);
+        sink += rms[0];
+    }
+    (void)sink;
+    double ns = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / TEST_BENCH_ROUNDS / TEST_SAMPLES;
+    printf("%u bands and A weighting: %.1f ns per sample, %.2f%% of real time\n",
+           OSM_SAI_BANDS_COUNT, ns, ns * OSM_SAI_BANDS_SAMPLE_RATE_HZ / 1e7);
+    return 0;
+}
@@ -0,0 +1,10 @@
+sai_bands_test_DIR:=$(tests_DIR)/sai_bands
+
+sai_bands_test_CFLAGS:=-I$(sai_bands_test_DIR)
+sai_bands_test_LDFLAGS:=-lm
+
+sai_bands_test_SOURCES:= \
+  $(OSM_DIR)/src/core/sai_bands.c \
+  $(sai_bands_test_DIR)/sai_bands_test.c
+
+$(eval $(call tests_PROGRAM_template,sai_bands_test))
@@ -0,0 +1,75 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <osm/core/sched.h>
+
+#include "test.h"
+
+
+#define BUSY_SLOT       3
+#define SLOTS           8
+#define PASS_LIMIT      100
+
+
+static unsigned _sampled[SLOTS];
+
+
+/* As a sensor that stays busy, waits 0 each time it is sampled. */
+static uint32_t _sample(unsigned slot)
+{
+    _sampled[slot]++;
+    return (slot == BUSY_SLOT) ? 0 : 100 + slot;
+}
+
+
+/* One pass as the measurements loop makes it, returning how many were
+ * taken, or PASS_LIMIT if it would never have got out. */
+static unsigned _pass(osm_sched_t* sched, uint32_t now)
+{
+    unsigned taken = 0;
+    unsigned slot;
+    while (osm_sched_take_due(sched, now, &slot))
+    {
+        if (++taken >= PASS_LIMIT)
+            break;
+        osm_sched_put_back(sched, slot, now, _sample(slot));
+    }
+    return taken;
+}
+
+
+int main(int argc, char * argv[])
+{
+    static osm_sched_t sched;
+    uint32_t wait;
+
+    osm_sched_clear(&sched);
+    basic_test("Empty has no wait", 0, osm_sched_get_wait(&sched, 0, &wait));
+    for (unsigned i = 0; i < SLOTS; i++)
+        osm_sched_push(&sched, i, 1000 - i * 10);
+    basic_test("Soonest wait", 1, osm_sched_get_wait(&sched, 900, &wait) && wait == 1000 - (SLOTS - 1) * 10 - 900);
+
+    unsigned slot;
+    basic_test("None due early", 0, osm_sched_take_due(&sched, 900, &slot));
+    basic_test("Soonest first", 1, osm_sched_take_due(&sched, 1000, &slot) && slot == SLOTS - 1);
+    osm_sched_put_back(&sched, slot, 1000, 50);
+
+    /* All due, the busy one among them. */
+    memset(_sampled, 0, sizeof(_sampled));
+    basic_test("Busy pass ends", SLOTS - 1, _pass(&sched, 1000));
+    basic_test("Busy sampled once a pass", 1, _sampled[BUSY_SLOT]);
+    basic_test("Busy retried next", 1, osm_sched_get_wait(&sched, 1000, &wait) && wait == OSM_SCHED_RETRY_MS);
+    basic_test("Still busy pass ends", 1, _pass(&sched, 1000 + OSM_SCHED_RETRY_MS));
+    basic_test("Busy sampled again", 2, _sampled[BUSY_SLOT]);
+    basic_test("Others waited", 1, _sampled[0] == 1 && _sampled[SLOTS - 1] == 0);
+
+    /* Due times over the millisecond count wrapping. */
+    osm_sched_clear(&sched);
+    osm_sched_push(&sched, 1, 10);
+    osm_sched_push(&sched, 2, UINT32_MAX - 10);
+    basic_test("Before a wrap first", 1, osm_sched_take_due(&sched, UINT32_MAX, &slot) && slot == 2);
+    basic_test("After a wrap held", 0, osm_sched_take_due(&sched, UINT32_MAX, &slot));
+    basic_test("After a wrap due", 1, osm_sched_take_due(&sched, 10, &slot) && slot == 1);
+    return 0;
+}
@@ -0,0 +1,9 @@
+sched_test_DIR:=$(tests_DIR)/sched
+
+sched_test_CFLAGS:=-I$(sched_test_DIR)
+
+sched_test_SOURCES:= \
+  $(OSM_DIR)/src/core/sched.c \
+  $(sched_test_DIR)/sched_test.c
+
+$(eval $(call tests_PROGRAM_template,sched_test))
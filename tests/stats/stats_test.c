@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <osm/core/stats.h>
+
+#include "test.h"
+
+#define TEST_SAMPLES    1000
+
+
+static int test_cmp(const void* a, const void* b)
+{
+    float fa = *(const float*)a;
+    float fb = *(const float*)b;
+    return (fa > fb) - (fa < fb);
+}
+
+
+static unsigned test_rand_state = 1234;
+
+/* Roughly normal, from the sum of uniforms, so the test is repeatable. */
+static float test_noise(void)
+{
+    float sum = 0;
+    for (unsigned n = 0; n < 12; n++)
+    {
+        test_rand_state = test_rand_state * 1103515245 + 12345;
+        sum += (float)((test_rand_state >> 16) & 0x7FFF) / 0x7FFF;
+    }
+    return sum - 6;
+}
+
+
+/* Percent error of got against expected, to the nearest whole. */
+static unsigned test_err(float expected, float got, float range)
+{
+    return (unsigned)lroundf(fabsf(got - expected) * 100 / range);
+}
+
+
+int main(int argc, char * argv[])
+{
+    osm_stats_t stats;
+    static float samples[TEST_SAMPLES];
+
+    osm_stats_init(&stats);
+    basic_test("Empty variance", 0, osm_stats_get_variance(&stats));
+    basic_test("Empty median", 0, osm_stats_get_p50(&stats));
+
+    /* Exact while there are few samples. */
+    const float few[] = {7, 1, 5, 3};
+    for (unsigned n = 0; n < ARRAY_SIZE(few); n++)
+        osm_stats_add(&stats, few[n]);
+    basic_test("Few mean", 4, stats.mean);
+    basic_test("Few variance x3", 20, lroundf(osm_stats_get_variance(&stats) * 3));
+    basic_test("Few median", 4, osm_stats_get_p50(&stats));
+    basic_test("Few p95 x100", 670, lroundf(osm_stats_get_p95(&stats) * 100));
+
+    /* A noisy signal around 2300 with a spread of 50. */
+    osm_stats_init(&stats);
+    double sum = 0;
+    for (unsigned n = 0; n < TEST_SAMPLES; n++)
+    {
+        samples[n] = 2300 + 50 * test_noise();
+        sum += samples[n];
+        osm_stats_add(&stats, samples[n]);
+    }
+    double mean = sum / TEST_SAMPLES;
+    double m2 = 0;
+    for (unsigned n = 0; n < TEST_SAMPLES; n++)
+        m2 += (samples[n] - mean) * (samples[n] - mean);
+    float stddev = sqrt(m2 / (TEST_SAMPLES - 1));
+    qsort(samples, TEST_SAMPLES, sizeof(float), test_cmp);
+    float range = samples[TEST_SAMPLES - 1] - samples[0];
+
+    basic_test("Count", TEST_SAMPLES, stats.count);
+    basic_test("Mean", lround(mean), lroundf(stats.mean));
+    basic_test("Stddev", lroundf(stddev), lroundf(osm_stats_get_stddev(&stats)));
+    basic_test("Median within 2% of range", 0, test_err(samples[TEST_SAMPLES / 2], osm_stats_get_p50(&stats), range) > 2);
+    basic_test("P95 within 2% of range", 0, test_err(samples[TEST_SAMPLES * 95 / 100], osm_stats_get_p95(&stats), range) > 2);
+
+    /* Skewed, most samples low with a long tail. */
+    osm_stats_init(&stats);
+    for (unsigned n = 0; n < TEST_SAMPLES; n++)
+    {
+        float v = test_noise() + 6;
+        samples[n] = v * v * v;
+        osm_stats_add(&stats, samples[n]);
+    }
+    qsort(samples, TEST_SAMPLES, sizeof(float), test_cmp);
+    range = samples[TEST_SAMPLES - 1] - samples[0];
+    basic_test("Skewed median within 2% of range", 0, test_err(samples[TEST_SAMPLES / 2], osm_stats_get_p50(&stats), range) > 2);
+    basic_test("Skewed p95 within 2% of range", 0, test_err(samples[TEST_SAMPLES * 95 / 100], osm_stats_get_p95(&stats), range) > 2);
+    basic_test("Skewed min kept", 1, stats.p50.q[0] == samples[0]);
+    basic_test("Skewed max kept", 1, stats.p95.q[4] == samples[TEST_SAMPLES - 1]);
+    return 0;
+}
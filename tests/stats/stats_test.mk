@@ -0,0 +1,10 @@
+stats_test_DIR:=$(tests_DIR)/stats
+
+stats_test_CFLAGS:=-I$(stats_test_DIR)
+stats_test_LDFLAGS:=-lm
+
+stats_test_SOURCES:= \
+  $(OSM_DIR)/src/core/stats.c \
+  $(stats_test_DIR)/stats_test.c
+
+$(eval $(call tests_PROGRAM_template,stats_test))
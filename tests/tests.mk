@@ -18,13 +18,13 @@ tests: $(TESTS_ELFS)
 	@echo "====== DONE ==== "
 
 define tests_PROGRAM_template
-  $(1)_OBJS=$$($(1)_SOURCES:%.c=$(OSM_BUILD_DIR)/tests/%.o)
-  $$($(1)_OBJS): $$(OSM_BUILD_DIR)/tests/%.o: $$(OSM_DIR)/%.c
+  $(1)_OBJS=$$($(1)_SOURCES:%.c=$(OSM_BUILD_DIR)/tests/$(1)/%.o)
+  $$($(1)_OBJS): $$(OSM_BUILD_DIR)/tests/$(1)/%.o: $$(OSM_DIR)/%.c
 	@mkdir -p "$$(@D)"
 	$(CC) -c $(tests_CFLAGS) $$($(1)_CFLAGS) $$< -o $$@
   $(tests_OSM_BUILD_DIR)/$(1).elf: $$($(1)_OBJS)
 	@mkdir -p "$$(@D)"
-	$(CC) $$($(1)_OBJS) $$(tests_LDFLAGS) -o $$@
+	$(CC) $$($(1)_OBJS) $$(tests_LDFLAGS) $$($(1)_LDFLAGS) -o $$@
 endef
 
 $(foreach file_mk,$(shell find $(tests_DIR) -maxdepth 2 -mindepth 2 -name "*.mk"),$(eval include $(file_mk)))
@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <osm/core/w1.h>
+#include <osm/core/w1_rom.h>
+
+#include "test.h"
+
+
+#define DEVS_MAX    16
+
+
+/* A bus of devices in the ROM search, the bus low if any pull it low. */
+static uint8_t  _roms[DEVS_MAX][OSM_W1_ROM_LEN];
+static unsigned _dev_count;
+static bool     _active[DEVS_MAX];
+static unsigned _bit;
+static unsigned _reads;
+static uint8_t  _sent[OSM_W1_ROM_LEN + 1];
+static unsigned _sent_count;
+
+
+static bool _rom_bit(unsigned dev, unsigned bit)
+{
+    return _roms[dev][bit / 8] & (1 << (bit % 8));
+}
+
+
+bool osm_w1_reset(uint8_t index)
+{
+    for (unsigned i = 0; i < _dev_count; i++)
+        _active[i] = true;
+    _bit = 0;
+    _reads = 0;
+    _sent_count = 0;
+    return _dev_count > 0;
+}
+
+
+void osm_w1_send_byte(uint8_t index, uint8_t byte)
+{
+    if (_sent_count < sizeof(_sent))
+        _sent[_sent_count++] = byte;
+}
+
+
+uint8_t osm_w1_read_byte(uint8_t index)
+{
+    return 0xFF;
+}
+
+
+bool osm_w1_read_bit(uint8_t index)
+{
+    bool cmp = _reads++ % 2;
+    bool level = true;
+    for (unsigned i = 0; i < _dev_count; i++)
+    {
+        if (_active[i] && _rom_bit(i, _bit) == cmp)
+            level = false;
+    }
+    return level;
+}
+
+
+void osm_w1_send_bit(uint8_t index, bool bit)
+{
+    for (unsigned i = 0; i < _dev_count; i++)
+    {
+        if (_rom_bit(i, _bit) != bit)
+            _active[i] = false;
+    }
+    _bit++;
+}
+
+
+static void _add_dev(uint8_t family, uint64_t serial)
+{
+    uint8_t* rom = _roms[_dev_count++];
+    rom[0] = family;
+    for (unsigned i = 1; i < 7; i++)
+        rom[i] = serial >> (8 * (i - 1));
+    uint8_t crc = 0;
+    for (unsigned i = 0; i < 7; i++)
+    {
+        uint8_t byte = rom[i];
+        for (unsigned j = 0; j < 8; j++)
+        {
+            uint8_t blend = (crc ^ byte) & 1;
+            crc >>= 1;
+            if (blend)
+                crc ^= 0x8C;
+            byte >>= 1;
+        }
+    }
+    rom[7] = crc;
+}
+
+
+static unsigned _search_all(unsigned* found_each)
+{
+    osm_w1_search_t search;
+    osm_w1_search_init(&search);
+    unsigned count = 0;
+    while (osm_w1_search_next(0, &search))
+    {
+        count++;
+        for (unsigned i = 0; i < _dev_count; i++)
+        {
+            if (!memcmp(search.rom, _roms[i], OSM_W1_ROM_LEN))
+                found_each[i]++;
+        }
+        if (count > DEVS_MAX)
+            break;
+    }
+    return count;
+}
+
+
+int main(int argc, char * argv[])
+{
+    unsigned found[DEVS_MAX] = {0};
+
+    _dev_count = 0;
+    basic_test("Empty bus", 0, _search_all(found));
+
+    _add_dev(0x28, 0x0000000F1E64FFULL);
+    basic_test("Single device", 1, _search_all(found));
+    basic_test("Single device ROM", 1, found[0]);
+
+    /* Shared prefixes, so the search has to branch deep into the ROMs. */
+    _dev_count = 0;
+    memset(found, 0, sizeof(found));
+    for (unsigned i = 0; i < 12; i++)
+        _add_dev(0x28, 0x0000000F1E6400ULL | (i * 37 % 64));
+    _add_dev(0x10, 0x0000000F1E6400ULL);
+    basic_test("Multi-drop devices", 13, _search_all(found));
+    unsigned each_once = 1;
+    for (unsigned i = 0; i < _dev_count; i++)
+    {
+        if (found[i] != 1)
+            each_once = 0;
+    }
+    basic_test("Each found once", 1, each_once);
+
+    _roms[3][7] ^= 0x01;
+    memset(found, 0, sizeof(found));
+    basic_test("Stops at a bad CRC", 1, _search_all(found) < 13);
+
+    _dev_count = 1;
+    _add_dev(0x28, 0x0000000F1E64FFULL);
+    osm_w1_reset(0);
+    osm_w1_select(0, _roms[0]);
+    basic_test("Match ROM command", OSM_W1_CMD_MATCH_ROM, _sent[0]);
+    basic_test("Match ROM sent", 1, _sent_count == OSM_W1_ROM_LEN + 1 && !memcmp(&_sent[1], _roms[0], OSM_W1_ROM_LEN));
+    osm_w1_reset(0);
+    osm_w1_select(0, NULL);
+    basic_test("Skip ROM", 1, _sent_count == 1 && _sent[0] == OSM_W1_CMD_SKIP_ROM);
+    return 0;
+}
@@ -0,0 +1,9 @@
+w1_rom_test_DIR:=$(tests_DIR)/w1_rom
+
+w1_rom_test_CFLAGS:=-I$(w1_rom_test_DIR)
+
+w1_rom_test_SOURCES:= \
+  $(OSM_DIR)/src/core/w1_rom.c \
+  $(w1_rom_test_DIR)/w1_rom_test.c
+
+$(eval $(call tests_PROGRAM_template,w1_rom_test))